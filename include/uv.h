@@ -149,7 +149,14 @@ extern "C" {
   XX(EFTYPE, "inappropriate file type or format")                             \
   XX(EILSEQ, "illegal byte sequence")                                         \
 
+/* Handle types added after UV_FILE go in UV__HANDLE_TYPE_MAP_NEW so the
+ * values of the older ones, and of UV_FILE, don't change.
+ */
 #define UV_HANDLE_TYPE_MAP(XX)                                                \
+  UV__HANDLE_TYPE_MAP_OLD(XX)                                                 \
+  UV__HANDLE_TYPE_MAP_NEW(XX)                                                 \
+
+#define UV__HANDLE_TYPE_MAP_OLD(XX)                                           \
   XX(ASYNC, async)                                                            \
   XX(CHECK, check)                                                            \
   XX(FS_EVENT, fs_event)                                                      \
@@ -167,6 +174,9 @@ extern "C" {
   XX(UDP, udp)                                                                \
   XX(SIGNAL, signal)                                                          \
 
+#define UV__HANDLE_TYPE_MAP_NEW(XX)                                           \
+  XX(FILE_WRITER, file_writer)                                                \
+
 #define UV_REQ_TYPE_MAP(XX)                                                   \
   XX(REQ, req)                                                                \
   XX(CONNECT, connect)                                                        \
@@ -189,9 +199,10 @@ typedef enum {
 typedef enum {
   UV_UNKNOWN_HANDLE = 0,
 #define XX(uc, lc) UV_##uc,
-  UV_HANDLE_TYPE_MAP(XX)
-#undef XX
+  UV__HANDLE_TYPE_MAP_OLD(XX)
   UV_FILE,
+  UV__HANDLE_TYPE_MAP_NEW(XX)
+#undef XX
   UV_HANDLE_TYPE_MAX
 } uv_handle_type;
 
@@ -224,6 +235,7 @@ typedef struct uv_process_s uv_process_t;
 typedef struct uv_fs_event_s uv_fs_event_t;
 typedef struct uv_fs_poll_s uv_fs_poll_t;
 typedef struct uv_signal_s uv_signal_t;
+typedef struct uv_file_writer_s uv_file_writer_t;
 
 /* Request types. */
 typedef struct uv_req_s uv_req_t;
@@ -248,13 +260,25 @@ typedef struct uv_statfs_s uv_statfs_t;
 
 typedef enum {
   UV_LOOP_BLOCK_SIGNAL = 0,
-  UV_METRICS_IDLE_TIME
+  UV_METRICS_IDLE_TIME,
+  UV_LOOP_THREADPOOL_SIZE,
+  UV_METRICS_THREADPOOL,
+  UV_LOOP_NATIVE_DNS,
+  UV_LOOP_USE_IO_URING,
+  UV_LOOP_IO_URING_STREAMS,
+  UV_LOOP_EPOLL_EDGE_TRIGGERED,
+  UV_LOOP_BUSY_POLL,
+  UV_LOOP_POLL_BATCH_MAX,
+  UV_LOOP_RUN_BUDGET,
+  UV_METRICS_LOOP_PHASES,
+  UV_LOOP_TRACE
 } uv_loop_option;
 
 typedef enum {
   UV_RUN_DEFAULT = 0,
   UV_RUN_ONCE,
-  UV_RUN_NOWAIT
+  UV_RUN_NOWAIT,
+  UV_RUN_BUDGET
 } uv_run_mode;
 
 
@@ -378,6 +402,8 @@ typedef void (*uv_fs_poll_cb)(uv_fs_poll_t* handle,
 
 typedef void (*uv_signal_cb)(uv_signal_t* handle, int signum);
 
+typedef void (*uv_file_writer_cb)(uv_file_writer_t* handle, int status);
+
 
 typedef enum {
   UV_LEAVE_GROUP = 0,
@@ -578,6 +604,10 @@ UV_EXTERN int uv_tcp_connect(uv_connect_t* req,
                              uv_tcp_t* handle,
                              const struct sockaddr* addr,
                              uv_connect_cb cb);
+UV_EXTERN int uv_tcp_connect_addrinfo(uv_connect_t* req,
+                                      uv_tcp_t* handle,
+                                      const struct addrinfo* ai,
+                                      uv_connect_cb cb);
 
 /* uv_connect_t is a subclass of uv_req_t. */
 struct uv_connect_s {
@@ -889,6 +919,26 @@ UV_EXTERN int uv_getaddrinfo(uv_loop_t* loop,
                              const struct addrinfo* hints);
 UV_EXTERN void uv_freeaddrinfo(struct addrinfo* ai);
 
+typedef struct {
+  unsigned int max_entries;  /* 0 turns the cache off. */
+  uint64_t ttl;              /* Milliseconds, upper bound for answers. */
+  uint64_t negative_ttl;     /* Milliseconds, for names that don't exist. */
+  uint64_t stale_ttl;        /* Milliseconds past expiry served stale. */
+} uv_dns_cache_options_t;
+
+typedef struct {
+  uint64_t hits;
+  uint64_t negative_hits;
+  uint64_t stale_hits;
+  uint64_t misses;
+  uint64_t evictions;
+  uint64_t entries;
+} uv_dns_cache_metrics_t;
+
+UV_EXTERN int uv_dns_cache_configure(const uv_dns_cache_options_t* options);
+UV_EXTERN void uv_dns_cache_flush(void);
+UV_EXTERN void uv_dns_cache_metrics(uv_dns_cache_metrics_t* metrics);
+
 
 /*
 * uv_getnameinfo_t is a subclass of uv_req_t.
@@ -1069,8 +1119,66 @@ UV_EXTERN int uv_queue_work(uv_loop_t* loop,
                             uv_work_cb work_cb,
                             uv_after_work_cb after_work_cb);
 
+typedef enum {
+  UV_WORK_PRIORITY_HIGH,
+  UV_WORK_PRIORITY_NORMAL,
+  UV_WORK_PRIORITY_LOW
+} uv_work_priority;
+
+UV_EXTERN int uv_queue_work_priority(uv_loop_t* loop,
+                                     uv_work_t* req,
+                                     uv_work_priority priority,
+                                     uint64_t deadline,
+                                     uv_work_cb work_cb,
+                                     uv_after_work_cb after_work_cb);
+
 UV_EXTERN int uv_cancel(uv_req_t* req);
 
+typedef struct {
+  unsigned int threads;
+  unsigned int idle_threads;
+  unsigned int min_threads;
+  unsigned int max_threads;
+  uint64_t idle_timeout;
+  uint64_t threads_spawned;
+  uint64_t threads_retired;
+} uv_threadpool_metrics_t;
+
+UV_EXTERN int uv_threadpool_set_limits(uv_loop_t* loop,
+                                       unsigned int min_threads,
+                                       unsigned int max_threads,
+                                       uint64_t idle_timeout);
+UV_EXTERN int uv_threadpool_metrics(uv_loop_t* loop,
+                                    uv_threadpool_metrics_t* metrics);
+
+typedef enum {
+  UV_WORK_CPU,
+  UV_WORK_FAST_IO,
+  UV_WORK_SLOW_IO
+} uv_work_kind;
+
+/* Bucket 0 counts values below 1, bucket n values in [2^(n-1), 2^n). */
+#define UV_THREADPOOL_HISTOGRAM_SIZE 32
+
+typedef struct {
+  uint64_t queued;  /* Currently waiting to run. */
+  uint64_t completed;
+  uint64_t wait_time;  /* Nanoseconds, from submission to start. */
+  uint64_t run_time;  /* Nanoseconds. */
+  uint64_t late;  /* Started after their deadline. */
+  uint64_t wait_histogram[UV_THREADPOOL_HISTOGRAM_SIZE];  /* Microseconds. */
+  uint64_t run_histogram[UV_THREADPOOL_HISTOGRAM_SIZE];  /* Microseconds. */
+  uint64_t queue_histogram[UV_THREADPOOL_HISTOGRAM_SIZE];  /* Queue length. */
+} uv_threadpool_work_metrics_t;
+
+UV_EXTERN int uv_threadpool_work_metrics(uv_loop_t* loop,
+                                         uv_work_kind kind,
+                                         uv_threadpool_work_metrics_t* metrics);
+UV_EXTERN int uv_threadpool_priority_metrics(
+    uv_loop_t* loop,
+    uv_work_priority priority,
+    uv_threadpool_work_metrics_t* metrics);
+
 
 struct uv_cpu_times_s {
   uint64_t user; /* milliseconds */
@@ -1246,6 +1354,101 @@ UV_EXTERN int uv_os_gethostname(char* buffer, size_t* size);
 UV_EXTERN int uv_os_uname(uv_utsname_t* buffer);
 
 UV_EXTERN uint64_t uv_metrics_idle_time(uv_loop_t* loop);
+UV_EXTERN uint64_t uv_metrics_epoll_ctl_elided(const uv_loop_t* loop);
+UV_EXTERN uint64_t uv_metrics_busy_poll_time(const uv_loop_t* loop);
+UV_EXTERN int uv_metrics_poll_batch(const uv_loop_t* loop,
+                                    unsigned int* size,
+                                    unsigned int* repolls);
+
+typedef enum {
+  UV_METRICS_PHASE_TIMERS,
+  UV_METRICS_PHASE_PENDING,
+  UV_METRICS_PHASE_IDLE,
+  UV_METRICS_PHASE_PREPARE,
+  UV_METRICS_PHASE_POLL,
+  UV_METRICS_PHASE_CHECK,
+  UV_METRICS_PHASE_CLOSING,
+  UV_METRICS_PHASE_COUNT
+} uv_metrics_phase;
+
+/* Bucket 0 counts values below 1, bucket n values in [2^(n-1), 2^n). */
+#define UV_METRICS_HISTOGRAM_SIZE 32
+
+typedef struct {
+  uint64_t loop_count;
+  uint64_t events;  /* I/O callbacks. */
+  uint64_t callbacks;
+  uint64_t max_callback_time;  /* Nanoseconds. */
+  uint64_t phase_time[UV_METRICS_PHASE_COUNT];  /* Nanoseconds. */
+  uint64_t loop_histogram[UV_METRICS_HISTOGRAM_SIZE];  /* Microseconds. */
+  uint64_t events_histogram[UV_METRICS_HISTOGRAM_SIZE];  /* Per poll. */
+  uint64_t callback_histogram[UV_METRICS_HISTOGRAM_SIZE];  /* Microseconds. */
+} uv_metrics_t;
+
+UV_EXTERN int uv_metrics_info(const uv_loop_t* loop, uv_metrics_t* metrics);
+
+typedef struct {
+  uint64_t epoll_wait;
+  uint64_t epoll_ctl;
+  uint64_t read;  /* read(), readv() and recvmsg() on streams. */
+  uint64_t write;  /* write(), writev() and sendmsg() on streams. */
+  uint64_t accept;
+  uint64_t sendmmsg;
+  uint64_t recvmmsg;
+  uint64_t io_submit;
+  uint64_t io_getevents;
+  uint64_t eventfd_read;
+  uint64_t eventfd_write;
+} uv_metrics_syscalls_t;
+
+UV_EXTERN int uv_metrics_syscalls(const uv_loop_t* loop,
+                                  uv_metrics_syscalls_t* syscalls);
+
+/* The callback the loop was running when it stalled. */
+typedef struct {
+  uv_handle_type type;  /* UV_UNKNOWN_HANDLE for I/O callbacks. */
+  void* handle;  /* NULL for I/O callbacks. */
+  void (*callback)(void);
+  int fd;  /* -1 if not an I/O callback. */
+  uint64_t elapsed;  /* Nanoseconds. */
+  uint64_t time;  /* uv_hrtime() when the stall was seen. */
+} uv_stall_t;
+
+typedef void (*uv_stall_cb)(uv_loop_t* loop, const uv_stall_t* stall);
+
+#define UV_WATCHDOG_STALLS 16
+
+UV_EXTERN int uv_loop_watchdog_start(uv_loop_t* loop,
+                                     uint64_t threshold,
+                                     uv_stall_cb cb);
+UV_EXTERN int uv_loop_watchdog_stop(uv_loop_t* loop);
+UV_EXTERN int uv_loop_watchdog_stalls(const uv_loop_t* loop,
+                                      uv_stall_t* stalls,
+                                      unsigned int* count);
+
+typedef enum {
+  UV_TRACE_POLL_ENTER = 1,  /* arg: timeout in milliseconds. */
+  UV_TRACE_POLL_EXIT,  /* arg: events. */
+  UV_TRACE_IO,  /* arg: poll events. */
+  UV_TRACE_TIMER,  /* arg: handle. */
+  UV_TRACE_AIO_SUBMIT,  /* arg: control blocks. */
+  UV_TRACE_AIO_COMPLETE,  /* arg: result. */
+  UV_TRACE_WRITE,  /* arg: status. */
+  UV_TRACE_CLOSE  /* arg: handle. */
+} uv_trace_event;
+
+typedef struct {
+  uint64_t time;  /* uv_hrtime(). */
+  uint16_t event;  /* uv_trace_event. */
+  uint16_t type;  /* uv_handle_type, UV_UNKNOWN_HANDLE if not known. */
+  int32_t fd;  /* -1 if none. */
+  uint64_t arg;
+} uv_trace_record_t;
+
+UV_EXTERN int uv_loop_trace_records(const uv_loop_t* loop,
+                                    uv_trace_record_t* records,
+                                    unsigned int* count);
+UV_EXTERN int uv_loop_trace_dump(uv_loop_t* loop, uv_file file);
 
 typedef enum {
   UV_FS_UNKNOWN = -1,
@@ -1285,7 +1488,8 @@ typedef enum {
   UV_FS_CLOSEDIR,
   UV_FS_STATFS,
   UV_FS_MKSTEMP,
-  UV_FS_LUTIME
+  UV_FS_LUTIME,
+  UV_FS_FALLOCATE
 } uv_fs_type;
 
 struct uv_dir_s {
@@ -1430,6 +1634,35 @@ UV_EXTERN int uv_fs_ftruncate(uv_loop_t* loop,
                               uv_file file,
                               int64_t offset,
                               uv_fs_cb cb);
+
+/*
+ * Flags for uv_fs_fallocate(). Without flags the range is allocated and the
+ * file is extended if the range reaches past its end.
+ */
+
+/*
+ * Allocate the range but leave the file size alone.
+ */
+#define UV_FS_FALLOCATE_KEEP_SIZE   0x0001
+
+/*
+ * Deallocate the range, reads return zeroes. Implies
+ * UV_FS_FALLOCATE_KEEP_SIZE.
+ */
+#define UV_FS_FALLOCATE_PUNCH_HOLE  0x0002
+
+/*
+ * Zero the range, allocating it where necessary.
+ */
+#define UV_FS_FALLOCATE_ZERO_RANGE  0x0004
+
+UV_EXTERN int uv_fs_fallocate(uv_loop_t* loop,
+                              uv_fs_t* req,
+                              uv_file file,
+                              int flags,
+                              int64_t offset,
+                              int64_t length,
+                              uv_fs_cb cb);
 UV_EXTERN int uv_fs_sendfile(uv_loop_t* loop,
                              uv_fs_t* req,
                              uv_file out_fd,
@@ -1553,16 +1786,43 @@ struct uv_fs_poll_s {
   void* poll_ctx;
 };
 
-// TODO(chengzhong.wcz): there is no sync or aio support for fs polling.
-// UV_EXTERN int uv_fs_poll_init(uv_loop_t* loop, uv_fs_poll_t* handle);
-// UV_EXTERN int uv_fs_poll_start(uv_fs_poll_t* handle,
-//                                uv_fs_poll_cb poll_cb,
-//                                const char* path,
-//                                unsigned int interval);
-// UV_EXTERN int uv_fs_poll_stop(uv_fs_poll_t* handle);
-// UV_EXTERN int uv_fs_poll_getpath(uv_fs_poll_t* handle,
-//                                  char* buffer,
-//                                  size_t* size);
+UV_EXTERN int uv_fs_poll_init(uv_loop_t* loop, uv_fs_poll_t* handle);
+UV_EXTERN int uv_fs_poll_start(uv_fs_poll_t* handle,
+                               uv_fs_poll_cb poll_cb,
+                               const char* path,
+                               unsigned int interval);
+UV_EXTERN int uv_fs_poll_stop(uv_fs_poll_t* handle);
+UV_EXTERN int uv_fs_poll_getpath(uv_fs_poll_t* handle,
+                                 char* buffer,
+                                 size_t* size);
+
+
+/*
+ * Buffered write-behind file writer. Appends are copied into a buffer and
+ * written out with a single pwrite once a size or time threshold is hit.
+ */
+struct uv_file_writer_s {
+  UV_HANDLE_FIELDS
+  /* Private, don't touch. */
+  void* writer_ctx;
+};
+
+UV_EXTERN int uv_file_writer_init(uv_loop_t* loop,
+                                  uv_file_writer_t* handle,
+                                  uv_file file,
+                                  int64_t offset);
+UV_EXTERN int uv_file_writer_set_thresholds(uv_file_writer_t* handle,
+                                            size_t flush_size,
+                                            uint64_t flush_delay,
+                                            size_t high_water_mark);
+UV_EXTERN int uv_file_writer_write(uv_file_writer_t* handle,
+                                   const uv_buf_t bufs[],
+                                   unsigned int nbufs,
+                                   uv_file_writer_cb drain_cb);
+UV_EXTERN int uv_file_writer_flush(uv_file_writer_t* handle,
+                                   uv_file_writer_cb cb);
+UV_EXTERN size_t uv_file_writer_get_buffered_size(
+    const uv_file_writer_t* handle);
 
 
 struct uv_signal_s {
@@ -28,6 +28,7 @@
   uv__io_t inotify_read_watcher;                                              \
   void* inotify_watchers;                                                     \
   int inotify_fd;                                                             \
+  void* edge_queue[2];                                                        \
 
 #define UV_PLATFORM_FS_EVENT_FIELDS                                           \
   void* watchers[2];                                                          \
@@ -40,4 +41,12 @@
   unsigned int done_iocbs_count;                                              \
   void* iocb_pending_queue[2];
 
+#define UV_IO_PRIVATE_PLATFORM_FIELDS                                         \
+  void* ready_queue[2];                                                       \
+  unsigned int ready;  /* Edge-triggered: readiness not used up yet. */       \
+  int edge;                                                                   \
+
+#define UV_STREAM_PRIVATE_PLATFORM_FIELDS                                     \
+  void* iou;                                                                  \
+
 #endif /* UV_LINUX_H */
@@ -32,6 +32,10 @@ struct uv__work {
   void (*done)(struct uv__work *w, int status);
   struct uv_loop_s* loop;
   void* wq[2];
+  uint64_t queued_at;  /* Only set when threadpool metrics are enabled. */
+  uint64_t deadline;
+  unsigned int kind;
+  unsigned int priority;
 };
 
 #endif /* UV_THREADPOOL_H_ */
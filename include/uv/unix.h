@@ -115,6 +115,7 @@ struct uv__aio_s {
   uv__io_t aio_io_watcher;
   uv__aio_cb aio_cb;
   void* iocb_pending_queue[2];
+  void* iocb_done_queue[2];
 };
 
 #ifndef UV_PLATFORM_SEM_T
@@ -288,6 +289,7 @@ typedef struct {
 
 #define UV_CONNECT_PRIVATE_FIELDS                                             \
   void* queue[2];                                                             \
+  void* race;                                                                 \
 
 #define UV_SHUTDOWN_PRIVATE_FIELDS /* empty */
 
@@ -362,7 +364,8 @@ typedef struct {
   char* hostname;                                                             \
   char* service;                                                              \
   struct addrinfo* addrinfo;                                                  \
-  int retcode;
+  int retcode;                                                                \
+  void* dns_query;
 
 #define UV_GETNAMEINFO_PRIVATE_FIELDS                                         \
   struct uv__work work_req;                                                   \
@@ -371,7 +374,8 @@ typedef struct {
   int flags;                                                                  \
   char host[NI_MAXHOST];                                                      \
   char service[NI_MAXSERV];                                                   \
-  int retcode;
+  int retcode;                                                                \
+  void* dns_query;
 
 #define UV_PROCESS_PRIVATE_FIELDS                                             \
   void* queue[2];                                                             \
@@ -385,6 +389,7 @@ typedef struct {
   unsigned int nbufs;                                                         \
   uv_buf_t* bufs;                                                             \
   off_t off;                                                                  \
+  off_t len;                                                                  \
   uv_uid_t uid;                                                               \
   uv_gid_t gid;                                                               \
   double atime;                                                               \
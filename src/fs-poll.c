@@ -21,6 +21,7 @@
 
 #include "uv.h"
 #include "uv-common.h"
+#include "heap-inl.h"
 
 #ifdef _WIN32
 #include "win/internal.h"
@@ -34,28 +35,384 @@
 #include <stdlib.h>
 #include <string.h>
 
+/* Upper bound on the number of paths stat'ed in one batch. Anything beyond
+ * that goes into the next batch so a large set of paths falling due at once
+ * doesn't tie up a threadpool thread for too long.
+ */
+#define MAX_STATS_PER_TICK 512
+
+/* All polled paths of a loop share one registry: a single timer that is
+ * armed for the earliest due path and a min heap of paths ordered by due
+ * time. Every tick hands all due paths to the threadpool as one work item
+ * that stats them back to back; the results are reported from its done
+ * callback. At most one batch is in flight at a time.
+ */
+struct poll_registry {
+  uv_loop_t* loop;
+  uv_timer_t timer_handle;
+  struct heap heap;
+  unsigned int count;
+  uint64_t next_id;
+  struct uv__work work_req;
+  struct poll_ctx* batch;
+  int closed;
+};
+
 struct poll_ctx {
   uv_fs_poll_t* parent_handle;
+  struct poll_registry* registry;
+  struct heap_node heap_node;
+  uint64_t due;
+  uint64_t id;
   int busy_polling;
+  int stopped;
   unsigned int interval;
-  uint64_t start_time;
-  uv_loop_t* loop;
   uv_fs_poll_cb poll_cb;
-  uv_timer_t timer_handle;
-  uv_fs_t fs_req; /* TODO(bnoordhuis) mark fs_req internal */
   uv_stat_t statbuf;
+  /* Set while the path is part of the batch that is in flight. It is out
+   * of the heap and can't be freed until the batch is done.
+   */
+  int batched;
+  int batch_status;
+  uv_stat_t batch_statbuf;
+  struct poll_ctx* batch_next;
+#if defined(__linux__)
+  /* inotify watch that makes the path due right away when it changes. The
+   * timer keeps polling regardless, inotify doesn't see every change (e.g.
+   * on network file systems).
+   */
+  uv_fs_event_t event_handle;
+  int event_state;
+#endif
   struct poll_ctx* previous; /* context from previous start()..stop() period */
   char path[1]; /* variable length */
 };
 
+enum {
+  EVENT_NONE,    /* No watch. */
+  EVENT_ACTIVE,  /* Watching the inode in |statbuf|. */
+  EVENT_FAILED   /* Couldn't add a watch, don't try again. */
+};
+
 static int statbuf_eq(const uv_stat_t* a, const uv_stat_t* b);
-static void poll_cb(uv_fs_t* req);
-static void timer_cb(uv_timer_t* timer);
-static void timer_close_cb(uv_handle_t* handle);
+static void registry_timer_cb(uv_timer_t* timer);
+static void registry_close_cb(uv_handle_t* handle);
+static void poll_ctx_release(struct poll_ctx* ctx);
 
 static uv_stat_t zero_statbuf;
 
 
+static int poll_ctx_less_than(const struct heap_node* ha,
+                              const struct heap_node* hb) {
+  const struct poll_ctx* a;
+  const struct poll_ctx* b;
+
+  a = container_of(ha, struct poll_ctx, heap_node);
+  b = container_of(hb, struct poll_ctx, heap_node);
+
+  if (a->due < b->due)
+    return 1;
+  if (b->due < a->due)
+    return 0;
+
+  return a->id < b->id;
+}
+
+
+static struct poll_registry* registry_get(uv_loop_t* loop) {
+  uv__loop_internal_fields_t* lfields;
+  struct poll_registry* reg;
+
+  lfields = uv__get_internal_fields(loop);
+  if (lfields->fs_poll_registry != NULL)
+    return lfields->fs_poll_registry;
+
+  reg = uv__calloc(1, sizeof(*reg));
+  if (reg == NULL)
+    return NULL;
+
+  if (uv_timer_init(loop, &reg->timer_handle)) {
+    uv__free(reg);
+    return NULL;
+  }
+
+  reg->timer_handle.flags |= UV_HANDLE_INTERNAL;
+  uv__handle_unref(&reg->timer_handle);
+  reg->loop = loop;
+  heap_init(&reg->heap);
+  lfields->fs_poll_registry = reg;
+
+  return reg;
+}
+
+
+/* Arms the shared timer for the earliest due path. */
+static void registry_schedule(struct poll_registry* reg) {
+  struct poll_ctx* ctx;
+  uint64_t now;
+  uint64_t timeout;
+
+  if (uv__is_closing(&reg->timer_handle))
+    return;
+
+  if (heap_min(&reg->heap) == NULL) {
+    uv_timer_stop(&reg->timer_handle);
+    return;
+  }
+
+  ctx = container_of(heap_min(&reg->heap), struct poll_ctx, heap_node);
+  now = uv_now(reg->loop);
+  timeout = ctx->due > now ? ctx->due - now : 0;
+
+  if (uv_timer_start(&reg->timer_handle, registry_timer_cb, timeout, 0))
+    abort();
+}
+
+
+static void registry_insert(struct poll_registry* reg, struct poll_ctx* ctx) {
+  ctx->id = reg->next_id++;
+  heap_insert(&reg->heap, &ctx->heap_node, poll_ctx_less_than);
+}
+
+
+static void registry_remove(struct poll_registry* reg, struct poll_ctx* ctx) {
+  uv__loop_internal_fields_t* lfields;
+
+  ctx->stopped = 1;
+  if (!ctx->batched)
+    heap_remove(&reg->heap, &ctx->heap_node, poll_ctx_less_than);
+
+  /* Last path gone, tear the registry down. A later start creates a new
+   * one; this one is freed once its timer is closed.
+   */
+  if (--reg->count == 0) {
+    lfields = uv__get_internal_fields(reg->loop);
+    if (lfields->fs_poll_registry == reg)
+      lfields->fs_poll_registry = NULL;
+    uv_close((uv_handle_t*)&reg->timer_handle, registry_close_cb);
+  }
+}
+
+
+#if defined(__linux__)
+static void poll_event_cb(uv_fs_event_t* handle,
+                          const char* filename,
+                          int events,
+                          int status) {
+  struct poll_ctx* ctx;
+  struct poll_registry* reg;
+
+  ctx = container_of(handle, struct poll_ctx, event_handle);
+  reg = ctx->registry;
+
+  if (ctx->stopped || ctx->batched)
+    return;
+
+  /* Make the path due now, the stat on the next tick reports the change. */
+  heap_remove(&reg->heap, &ctx->heap_node, poll_ctx_less_than);
+  ctx->due = uv_now(reg->loop);
+  registry_insert(reg, ctx);
+  registry_schedule(reg);
+}
+
+
+static void poll_event_update(struct poll_ctx* ctx,
+                              int status,
+                              const uv_stat_t* prev,
+                              const uv_stat_t* curr) {
+  if (ctx->event_state == EVENT_FAILED)
+    return;
+
+  /* inotify watches inodes. Drop the watch when the path goes away or
+   * starts pointing at a different inode and set up a new one below.
+   */
+  if (ctx->event_state == EVENT_ACTIVE) {
+    if (status == 0 &&
+        prev->st_ino == curr->st_ino &&
+        prev->st_dev == curr->st_dev) {
+      return;
+    }
+    uv_fs_event_stop(&ctx->event_handle);
+    ctx->event_state = EVENT_NONE;
+  }
+
+  if (status != 0)
+    return;
+
+  if (ctx->event_handle.type != UV_FS_EVENT) {
+    if (uv_fs_event_init(ctx->registry->loop, &ctx->event_handle)) {
+      ctx->event_state = EVENT_FAILED;
+      return;
+    }
+    ctx->event_handle.flags |= UV_HANDLE_INTERNAL;
+    uv__handle_unref(&ctx->event_handle);
+  }
+
+  if (uv_fs_event_start(&ctx->event_handle, poll_event_cb, ctx->path, 0))
+    ctx->event_state = EVENT_FAILED;
+  else
+    ctx->event_state = EVENT_ACTIVE;
+}
+#endif  /* defined(__linux__) */
+
+
+static void poll_ctx_report(struct poll_ctx* ctx) {
+  const uv_stat_t* statbuf;
+  int err;
+
+  err = ctx->batch_status;
+  statbuf = &ctx->batch_statbuf;
+
+#if defined(__linux__)
+  poll_event_update(ctx, err, &ctx->statbuf, statbuf);
+#endif
+
+  if (err != 0) {
+    if (ctx->busy_polling != err) {
+      ctx->poll_cb(ctx->parent_handle, err, &ctx->statbuf, &zero_statbuf);
+      ctx->busy_polling = err;
+    }
+    return;
+  }
+
+  if (ctx->busy_polling != 0)
+    if (ctx->busy_polling < 0 || !statbuf_eq(&ctx->statbuf, statbuf))
+      ctx->poll_cb(ctx->parent_handle, 0, &ctx->statbuf, statbuf);
+
+  ctx->statbuf = *statbuf;
+  ctx->busy_polling = 1;
+}
+
+
+/* Runs on the threadpool. Only reads the paths, which don't change while
+ * the batch is in flight, and writes the per-path results.
+ */
+static void registry_batch_work(struct uv__work* w) {
+  struct poll_registry* reg;
+  struct poll_ctx* ctx;
+  uv_fs_t req;
+
+  reg = container_of(w, struct poll_registry, work_req);
+
+  for (ctx = reg->batch; ctx != NULL; ctx = ctx->batch_next) {
+    ctx->batch_status = uv_fs_stat(NULL, &req, ctx->path, NULL);
+    ctx->batch_statbuf = req.statbuf;
+    uv_fs_req_cleanup(&req);
+  }
+}
+
+
+static void registry_batch_done(struct uv__work* w, int status) {
+  struct poll_registry* reg;
+  struct poll_ctx* next;
+  struct poll_ctx* ctx;
+  uint64_t now;
+
+  reg = container_of(w, struct poll_registry, work_req);
+  uv__req_unregister(reg->loop, w);
+  assert(status == 0);
+
+  now = uv_now(reg->loop);
+  ctx = reg->batch;
+  reg->batch = NULL;
+
+  for (; ctx != NULL; ctx = next) {
+    next = ctx->batch_next;
+    ctx->batch_next = NULL;
+
+    if (!ctx->stopped)
+      poll_ctx_report(ctx);
+    ctx->batched = 0;
+
+    /* The handle was stopped while the stat was in flight or by the
+     * callback.
+     */
+    if (ctx->stopped) {
+      poll_ctx_release(ctx);
+      continue;
+    }
+
+    /* Stay on the interval grid, skipping ticks that were missed. */
+    ctx->due += ctx->interval;
+    if (ctx->due <= now)
+      ctx->due = now + ctx->interval - (now - ctx->due) % ctx->interval;
+    registry_insert(reg, ctx);
+  }
+
+  /* The last path went away while the batch was in flight and the timer
+   * is already closed, the registry was left for us to free.
+   */
+  if (reg->closed) {
+    uv__free(reg);
+    return;
+  }
+
+  registry_schedule(reg);
+}
+
+
+static void registry_timer_cb(uv_timer_t* timer) {
+  struct poll_registry* reg;
+  struct heap_node* node;
+  struct poll_ctx** tail;
+  struct poll_ctx* ctx;
+  unsigned int nstats;
+  uint64_t now;
+
+  reg = container_of(timer, struct poll_registry, timer_handle);
+
+  /* Due paths are picked up when the batch in flight is done. */
+  if (reg->batch != NULL)
+    return;
+
+  now = uv_now(reg->loop);
+  tail = &reg->batch;
+
+  for (nstats = 0; nstats < MAX_STATS_PER_TICK; nstats++) {
+    node = heap_min(&reg->heap);
+    if (node == NULL)
+      break;
+
+    ctx = container_of(node, struct poll_ctx, heap_node);
+    if (ctx->due > now)
+      break;
+
+    heap_remove(&reg->heap, node, poll_ctx_less_than);
+    ctx->batched = 1;
+    *tail = ctx;
+    tail = &ctx->batch_next;
+  }
+
+  if (reg->batch == NULL) {
+    registry_schedule(reg);
+    return;
+  }
+
+  /* Keeps the loop alive until the results are in, even if every handle
+   * is stopped in the meantime.
+   */
+  uv__req_register(reg->loop, &reg->work_req);
+  uv__work_submit(reg->loop,
+                  &reg->work_req,
+                  UV__WORK_FAST_IO,
+                  registry_batch_work,
+                  registry_batch_done);
+}
+
+
+static void registry_close_cb(uv_handle_t* handle) {
+  struct poll_registry* reg;
+
+  reg = container_of(handle, struct poll_registry, timer_handle);
+  assert(reg->count == 0);
+
+  /* registry_batch_done() frees it when a batch is still in flight. */
+  reg->closed = 1;
+  if (reg->batch == NULL)
+    uv__free(reg);
+}
+
+
 int uv_fs_poll_init(uv_loop_t* loop, uv_fs_poll_t* handle) {
   uv__handle_init(loop, (uv_handle_t*)handle, UV_FS_POLL);
   handle->poll_ctx = NULL;
@@ -67,10 +424,10 @@ int uv_fs_poll_start(uv_fs_poll_t* handle,
                      uv_fs_poll_cb cb,
                      const char* path,
                      unsigned int interval) {
+  struct poll_registry* reg;
   struct poll_ctx* ctx;
   uv_loop_t* loop;
   size_t len;
-  int err;
 
   if (uv_is_active((uv_handle_t*)handle))
     return 0;
@@ -82,23 +439,23 @@ int uv_fs_poll_start(uv_fs_poll_t* handle,
   if (ctx == NULL)
     return UV_ENOMEM;
 
-  ctx->loop = loop;
+  reg = registry_get(loop);
+  if (reg == NULL) {
+    uv__free(ctx);
+    return UV_ENOMEM;
+  }
+
+  ctx->registry = reg;
   ctx->poll_cb = cb;
   ctx->interval = interval ? interval : 1;
-  ctx->start_time = uv_now(loop);
   ctx->parent_handle = handle;
   memcpy(ctx->path, path, len + 1);
 
-  err = uv_timer_init(loop, &ctx->timer_handle);
-  if (err < 0)
-    goto error;
-
-  ctx->timer_handle.flags |= UV_HANDLE_INTERNAL;
-  uv__handle_unref(&ctx->timer_handle);
-
-  err = uv_fs_stat(loop, &ctx->fs_req, ctx->path, poll_cb);
-  if (err < 0)
-    goto error;
+  /* First stat happens on the next tick. */
+  ctx->due = uv_now(loop);
+  reg->count++;
+  registry_insert(reg, ctx);
+  registry_schedule(reg);
 
   if (handle->poll_ctx != NULL)
     ctx->previous = handle->poll_ctx;
@@ -106,10 +463,6 @@ int uv_fs_poll_start(uv_fs_poll_t* handle,
   uv__handle_start(handle);
 
   return 0;
-
-error:
-  uv__free(ctx);
-  return err;
 }
 
 
@@ -123,11 +476,12 @@ int uv_fs_poll_stop(uv_fs_poll_t* handle) {
   assert(ctx != NULL);
   assert(ctx->parent_handle == handle);
 
-  /* Close the timer if it's active. If it's inactive, there's a stat request
-   * in progress and poll_cb will take care of the cleanup.
+  /* A context that is part of the batch in flight is released by the done
+   * callback of the batch.
    */
-  if (uv_is_active((uv_handle_t*)&ctx->timer_handle))
-    uv_close((uv_handle_t*)&ctx->timer_handle, timer_close_cb);
+  registry_remove(ctx->registry, ctx);
+  if (!ctx->batched)
+    poll_ctx_release(ctx);
 
   uv__handle_stop(handle);
 
@@ -162,82 +516,21 @@ int uv_fs_poll_getpath(uv_fs_poll_t* handle, char* buffer, size_t* size) {
 
 
 void uv__fs_poll_close(uv_fs_poll_t* handle) {
-  uv_fs_poll_stop(handle);
-
+  /* Contexts are released synchronously when nothing else holds on to
+   * them, the last one to go makes the handle close pending.
+   */
   if (handle->poll_ctx == NULL)
     uv__make_close_pending((uv_handle_t*)handle);
+  else
+    uv_fs_poll_stop(handle);
 }
 
 
-static void timer_cb(uv_timer_t* timer) {
-  struct poll_ctx* ctx;
-
-  ctx = container_of(timer, struct poll_ctx, timer_handle);
-  assert(ctx->parent_handle != NULL);
-  assert(ctx->parent_handle->poll_ctx == ctx);
-  ctx->start_time = uv_now(ctx->loop);
-
-  if (uv_fs_stat(ctx->loop, &ctx->fs_req, ctx->path, poll_cb))
-    abort();
-}
-
-
-static void poll_cb(uv_fs_t* req) {
-  uv_stat_t* statbuf;
-  struct poll_ctx* ctx;
-  uint64_t interval;
-  uv_fs_poll_t* handle;
-
-  ctx = container_of(req, struct poll_ctx, fs_req);
-  handle = ctx->parent_handle;
-
-  if (!uv_is_active((uv_handle_t*)handle) || uv__is_closing(handle))
-    goto out;
-
-  if (req->result != 0) {
-    if (ctx->busy_polling != req->result) {
-      ctx->poll_cb(ctx->parent_handle,
-                   req->result,
-                   &ctx->statbuf,
-                   &zero_statbuf);
-      ctx->busy_polling = req->result;
-    }
-    goto out;
-  }
-
-  statbuf = &req->statbuf;
-
-  if (ctx->busy_polling != 0)
-    if (ctx->busy_polling < 0 || !statbuf_eq(&ctx->statbuf, statbuf))
-      ctx->poll_cb(ctx->parent_handle, 0, &ctx->statbuf, statbuf);
-
-  ctx->statbuf = *statbuf;
-  ctx->busy_polling = 1;
-
-out:
-  uv_fs_req_cleanup(req);
-
-  if (!uv_is_active((uv_handle_t*)handle) || uv__is_closing(handle)) {
-    uv_close((uv_handle_t*)&ctx->timer_handle, timer_close_cb);
-    return;
-  }
-
-  /* Reschedule timer, subtract the delay from doing the stat(). */
-  interval = ctx->interval;
-  interval -= (uv_now(ctx->loop) - ctx->start_time) % interval;
-
-  if (uv_timer_start(&ctx->timer_handle, timer_cb, interval, 0))
-    abort();
-}
-
-
-static void timer_close_cb(uv_handle_t* timer) {
-  struct poll_ctx* ctx;
+static void poll_ctx_free(struct poll_ctx* ctx) {
   struct poll_ctx* it;
   struct poll_ctx* last;
   uv_fs_poll_t* handle;
 
-  ctx = container_of(timer, struct poll_ctx, timer_handle);
   handle = ctx->parent_handle;
   if (ctx == handle->poll_ctx) {
     handle->poll_ctx = ctx->previous;
@@ -255,6 +548,24 @@ static void timer_close_cb(uv_handle_t* timer) {
 }
 
 
+#if defined(__linux__)
+static void poll_event_close_cb(uv_handle_t* handle) {
+  poll_ctx_free(container_of(handle, struct poll_ctx, event_handle));
+}
+#endif
+
+
+static void poll_ctx_release(struct poll_ctx* ctx) {
+#if defined(__linux__)
+  if (ctx->event_handle.type == UV_FS_EVENT) {
+    uv_close((uv_handle_t*)&ctx->event_handle, poll_event_close_cb);
+    return;
+  }
+#endif
+  poll_ctx_free(ctx);
+}
+
+
 static int statbuf_eq(const uv_stat_t* a, const uv_stat_t* b) {
   return a->st_ctim.tv_nsec == b->st_ctim.tv_nsec
       && a->st_mtim.tv_nsec == b->st_mtim.tv_nsec
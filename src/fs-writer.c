@@ -0,0 +1,472 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "uv-common.h"
+
+#ifdef _WIN32
+#include "win/internal.h"
+#include "win/handle-inl.h"
+#define uv__make_close_pending(h) uv_want_endgame((h)->loop, (h))
+#else
+#include "unix/internal.h"
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_FLUSH_SIZE      (64 * 1024)
+#define DEFAULT_FLUSH_DELAY     10  /* Milliseconds. */
+#define DEFAULT_HIGH_WATER_MARK (1024 * 1024)
+
+struct writer_buf {
+  char* base;
+  size_t len;
+  size_t size;
+};
+
+/* Appends go into |fill| while |flight| is being written out. The two swap
+ * roles every time a write is started, so at most one pwrite is outstanding
+ * and the appending side never waits for the disk.
+ */
+struct writer_ctx {
+  uv_file_writer_t* parent_handle;
+  uv_loop_t* loop;
+  uv_file file;
+  int64_t offset;        /* File offset of the next byte written out. */
+  int64_t sync_target;   /* Offset that must be written before a flush syncs. */
+  size_t flush_size;
+  uint64_t flush_delay;
+  size_t high_water_mark;
+  int error;             /* First write error, reported until closed. */
+  int writing;
+  int syncing;
+  int flush_due;
+  int close_synced;
+  uv_file_writer_cb drain_cb;
+  uv_file_writer_cb flush_cb;
+  uv_file_writer_cb sync_cb;
+  struct writer_buf bufs[2];
+  struct writer_buf* fill;
+  struct writer_buf* flight;
+  size_t flight_written;
+  uv_timer_t timer_handle;
+  uv_fs_t write_req;
+  uv_fs_t sync_req;
+};
+
+static void writer_progress(struct writer_ctx* ctx);
+static void write_cb(uv_fs_t* req);
+static void sync_cb(uv_fs_t* req);
+static void timer_cb(uv_timer_t* timer);
+static void timer_close_cb(uv_handle_t* handle);
+
+
+int uv_file_writer_init(uv_loop_t* loop,
+                        uv_file_writer_t* handle,
+                        uv_file file,
+                        int64_t offset) {
+  struct writer_ctx* ctx;
+  uv_fs_t req;
+  int err;
+
+  if (file < 0)
+    return UV_EBADF;
+
+  /* A negative offset appends to whatever is in the file right now. */
+  if (offset < 0) {
+    err = uv_fs_fstat(NULL, &req, file, NULL);
+    offset = req.statbuf.st_size;
+    uv_fs_req_cleanup(&req);
+    if (err < 0)
+      return err;
+  }
+
+  ctx = uv__calloc(1, sizeof(*ctx));
+  if (ctx == NULL)
+    return UV_ENOMEM;
+
+  err = uv_timer_init(loop, &ctx->timer_handle);
+  if (err < 0) {
+    uv__free(ctx);
+    return err;
+  }
+
+  ctx->timer_handle.flags |= UV_HANDLE_INTERNAL;
+  uv__handle_unref(&ctx->timer_handle);
+
+  ctx->parent_handle = handle;
+  ctx->loop = loop;
+  ctx->file = file;
+  ctx->offset = offset;
+  ctx->flush_size = DEFAULT_FLUSH_SIZE;
+  ctx->flush_delay = DEFAULT_FLUSH_DELAY;
+  ctx->high_water_mark = DEFAULT_HIGH_WATER_MARK;
+  ctx->fill = &ctx->bufs[0];
+  ctx->flight = &ctx->bufs[1];
+
+  uv__handle_init(loop, (uv_handle_t*)handle, UV_FILE_WRITER);
+  handle->writer_ctx = ctx;
+
+  return 0;
+}
+
+
+int uv_file_writer_set_thresholds(uv_file_writer_t* handle,
+                                  size_t flush_size,
+                                  uint64_t flush_delay,
+                                  size_t high_water_mark) {
+  struct writer_ctx* ctx;
+
+  if (uv__is_closing(handle))
+    return UV_EINVAL;
+
+  if (flush_size == 0 || high_water_mark < flush_size)
+    return UV_EINVAL;
+
+  ctx = handle->writer_ctx;
+  ctx->flush_size = flush_size;
+  ctx->flush_delay = flush_delay;
+  ctx->high_water_mark = high_water_mark;
+
+  return 0;
+}
+
+
+size_t uv_file_writer_get_buffered_size(const uv_file_writer_t* handle) {
+  const struct writer_ctx* ctx;
+  size_t size;
+
+  ctx = handle->writer_ctx;
+  if (ctx == NULL)
+    return 0;
+
+  size = ctx->fill->len;
+  if (ctx->writing)
+    size += ctx->flight->len - ctx->flight_written;
+
+  return size;
+}
+
+
+int uv_file_writer_write(uv_file_writer_t* handle,
+                         const uv_buf_t bufs[],
+                         unsigned int nbufs,
+                         uv_file_writer_cb drain_cb) {
+  struct writer_ctx* ctx;
+  struct writer_buf* buf;
+  size_t buffered;
+  size_t size;
+  size_t len;
+  unsigned int i;
+  char* base;
+
+  if (uv__is_closing(handle))
+    return UV_EINVAL;
+
+  ctx = handle->writer_ctx;
+  if (ctx->error)
+    return ctx->error;
+
+  len = uv__count_bufs(bufs, nbufs);
+  if (len == 0)
+    return 0;
+
+  /* Refuse data past the high water mark but always take something when the
+   * writer is empty, otherwise a single large append could never go through.
+   */
+  buffered = uv_file_writer_get_buffered_size(handle);
+  if (buffered > 0 && buffered + len > ctx->high_water_mark) {
+    ctx->drain_cb = drain_cb;
+    return UV_EAGAIN;
+  }
+
+  buf = ctx->fill;
+  if (buf->len + len > buf->size) {
+    size = buf->size ? buf->size * 2 : ctx->flush_size;
+    while (size < buf->len + len)
+      size *= 2;
+
+    base = uv__realloc(buf->base, size);
+    if (base == NULL)
+      return UV_ENOMEM;
+
+    buf->base = base;
+    buf->size = size;
+  }
+
+  for (i = 0; i < nbufs; i++) {
+    memcpy(buf->base + buf->len, bufs[i].base, bufs[i].len);
+    buf->len += bufs[i].len;
+  }
+
+  writer_progress(ctx);
+
+  return 0;
+}
+
+
+int uv_file_writer_flush(uv_file_writer_t* handle, uv_file_writer_cb cb) {
+  struct writer_ctx* ctx;
+
+  if (uv__is_closing(handle))
+    return UV_EINVAL;
+
+  ctx = handle->writer_ctx;
+  if (ctx->flush_cb != NULL || ctx->sync_cb != NULL)
+    return UV_EBUSY;
+
+  assert(cb != NULL);
+  ctx->flush_cb = cb;
+  ctx->sync_target = ctx->offset + uv_file_writer_get_buffered_size(handle);
+  writer_progress(ctx);
+
+  return 0;
+}
+
+
+void uv__file_writer_close(uv_file_writer_t* handle) {
+  struct writer_ctx* ctx;
+
+  ctx = handle->writer_ctx;
+  assert(ctx != NULL);
+  ctx->drain_cb = NULL;
+  uv__handle_stop(handle);
+  writer_progress(ctx);
+}
+
+
+static void writer_submit(struct writer_ctx* ctx) {
+  struct writer_buf* buf;
+  uv_buf_t iov;
+  int err;
+
+  buf = ctx->flight;
+  iov = uv_buf_init(buf->base + ctx->flight_written,
+                    buf->len - ctx->flight_written);
+
+  err = uv_fs_write(ctx->loop,
+                    &ctx->write_req,
+                    ctx->file,
+                    &iov,
+                    1,
+                    ctx->offset,
+                    write_cb);
+  if (err == 0) {
+    ctx->writing = 1;
+    return;
+  }
+
+  uv_fs_req_cleanup(&ctx->write_req);
+  if (ctx->error == 0)
+    ctx->error = err;
+  buf->len = 0;
+  ctx->fill->len = 0;
+}
+
+
+static void writer_start_write(struct writer_ctx* ctx) {
+  struct writer_buf* buf;
+
+  assert(!ctx->writing);
+  assert(ctx->flight->len == 0);
+
+  buf = ctx->flight;
+  ctx->flight = ctx->fill;
+  ctx->fill = buf;
+  ctx->flight_written = 0;
+  ctx->flush_due = 0;
+  uv_timer_stop(&ctx->timer_handle);
+
+  writer_submit(ctx);
+}
+
+
+static void writer_start_sync(struct writer_ctx* ctx) {
+  int err;
+
+  assert(!ctx->writing);
+  assert(!ctx->syncing);
+
+  ctx->sync_cb = ctx->flush_cb;
+  ctx->flush_cb = NULL;
+  if (uv__is_closing(ctx->parent_handle))
+    ctx->close_synced = 1;
+
+  err = uv_fs_fdatasync(ctx->loop, &ctx->sync_req, ctx->file, sync_cb);
+  if (err == 0) {
+    ctx->syncing = 1;
+    return;
+  }
+
+  /* Not expected to happen; report it the same way a failed sync would be. */
+  ctx->sync_req.result = err;
+  sync_cb(&ctx->sync_req);
+}
+
+
+/* Decides what the writer does next. Called whenever its state changes. */
+static void writer_progress(struct writer_ctx* ctx) {
+  uv_file_writer_t* handle;
+  int closing;
+
+  handle = ctx->parent_handle;
+  closing = uv__is_closing(handle);
+
+  if (ctx->writing || ctx->syncing)
+    return;
+
+  if (ctx->fill->len > 0) {
+    if (closing ||
+        ctx->flush_due ||
+        ctx->flush_cb != NULL ||
+        ctx->fill->len >= ctx->flush_size) {
+      writer_start_write(ctx);
+      if (ctx->writing)
+        return;
+    } else if (!uv_is_active((uv_handle_t*)&ctx->timer_handle)) {
+      uv_timer_start(&ctx->timer_handle, timer_cb, ctx->flush_delay, 0);
+    }
+  }
+
+  if (ctx->fill->len == 0) {
+    if ((ctx->flush_cb != NULL &&
+         (ctx->offset >= ctx->sync_target || ctx->error != 0)) ||
+        (closing && !ctx->close_synced)) {
+      writer_start_sync(ctx);
+      if (ctx->syncing)
+        return;
+    }
+  }
+
+  if (closing) {
+    if (ctx->close_synced && !uv__is_closing(&ctx->timer_handle))
+      uv_close((uv_handle_t*)&ctx->timer_handle, timer_close_cb);
+    return;
+  }
+
+  /* Keep the loop alive for as long as there is data that isn't on disk. */
+  if (ctx->fill->len > 0 || ctx->flush_cb != NULL)
+    uv__handle_start(handle);
+  else
+    uv__handle_stop(handle);
+}
+
+
+static void write_cb(uv_fs_t* req) {
+  struct writer_ctx* ctx;
+  uv_file_writer_cb cb;
+  uv_file_writer_t* handle;
+  ssize_t result;
+
+  ctx = container_of(req, struct writer_ctx, write_req);
+  handle = ctx->parent_handle;
+  result = req->result;
+  uv_fs_req_cleanup(req);
+  ctx->writing = 0;
+
+  if (result == 0 && ctx->flight_written < ctx->flight->len)
+    result = UV_EIO;
+
+  if (result < 0) {
+    /* The data is lost either way, drop what's queued behind it as well so
+     * flush and close don't keep hammering a broken file.
+     */
+    if (ctx->error == 0)
+      ctx->error = result;
+    ctx->flight->len = 0;
+    ctx->fill->len = 0;
+  } else {
+    ctx->offset += result;
+    ctx->flight_written += result;
+    if (ctx->flight_written < ctx->flight->len) {
+      writer_submit(ctx);  /* Short write, send the rest. */
+      if (ctx->writing)
+        return;
+    }
+    ctx->flight->len = 0;
+  }
+
+  if (ctx->drain_cb != NULL &&
+      uv_file_writer_get_buffered_size(handle) <= ctx->high_water_mark / 2) {
+    cb = ctx->drain_cb;
+    ctx->drain_cb = NULL;
+    cb(handle, ctx->error);
+  }
+
+  writer_progress(ctx);
+}
+
+
+static void sync_cb(uv_fs_t* req) {
+  struct writer_ctx* ctx;
+  uv_file_writer_cb cb;
+  int status;
+
+  ctx = container_of(req, struct writer_ctx, sync_req);
+  status = ctx->error ? ctx->error : req->result;
+  uv_fs_req_cleanup(req);
+  ctx->syncing = 0;
+
+  cb = ctx->sync_cb;
+  ctx->sync_cb = NULL;
+  if (cb != NULL)
+    cb(ctx->parent_handle, status);
+
+  writer_progress(ctx);
+}
+
+
+static void timer_cb(uv_timer_t* timer) {
+  struct writer_ctx* ctx;
+
+  ctx = container_of(timer, struct writer_ctx, timer_handle);
+  ctx->flush_due = 1;
+  writer_progress(ctx);
+}
+
+
+static void timer_close_cb(uv_handle_t* timer) {
+  struct writer_ctx* ctx;
+  uv_file_writer_t* handle;
+
+  ctx = container_of(timer, struct writer_ctx, timer_handle);
+  handle = ctx->parent_handle;
+  handle->writer_ctx = NULL;
+
+  uv__free(ctx->bufs[0].base);
+  uv__free(ctx->bufs[1].base);
+  uv__free(ctx);
+
+  uv__make_close_pending((uv_handle_t*)handle);
+}
+
+
+#if defined(_WIN32)
+
+void uv__file_writer_endgame(uv_loop_t* loop, uv_file_writer_t* handle) {
+  assert(handle->flags & UV_HANDLE_CLOSING);
+  assert(!(handle->flags & UV_HANDLE_CLOSED));
+  uv__handle_close(handle);
+}
+
+#endif /* _WIN32 */
@@ -113,6 +113,14 @@ int uv_random(uv_loop_t* loop,
   req->buf = buf;
   req->buflen = buflen;
 
+#ifndef _WIN32
+  /* Served from the loop's keystream, the threadpool is the fallback for
+   * when the kernel can't seed it yet.
+   */
+  if (uv__random_pool_submit(loop, req) == 0)
+    return 0;
+#endif
+
   uv__work_submit(loop,
                   &req->work_req,
                   UV__WORK_CPU,
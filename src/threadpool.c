@@ -26,24 +26,91 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h>
 
 #define MAX_THREADPOOL_SIZE 1024
+#define DEFAULT_THREADPOOL_SIZE 4
+#define DEFAULT_IDLE_TIMEOUT 5000  /* Milliseconds. */
+#define LOW_PRIORITY_AGING 1000  /* Milliseconds. */
+#define HIGH_PRIORITY_BURST 16
+
+/* Work is spread over per-worker queues so that submitters and workers don't
+ * all serialize on one lock. A worker runs the work in its own queue first and
+ * steals the oldest work from the other queues when that is empty. Slow I/O is
+ * kept in a separate queue and throttled like before, so it can't occupy
+ * every thread.
+ *
+ * Threads are started when work comes in and nobody is idle, and exit again
+ * after sitting idle for a while. A worker slot outlives its thread, work left
+ * in the queue of an exited thread is stolen by the others, and the next
+ * thread that's started reuses the slot.
+ *
+ * High and low priority work, and work with a deadline, goes into queues of
+ * the executor that are ordered by deadline. Workers take work whose deadline
+ * has passed first, then high priority work, then normal work with a
+ * deadline, then everything else in the order of the normal queues, the slow
+ * I/O queue and the low priority queue.
+ * Low priority work without a deadline gets one LOW_PRIORITY_AGING from now
+ * so it can't be starved, and after HIGH_PRIORITY_BURST high priority items
+ * in a row normal work gets a turn.
+ *
+ * With UV_METRICS_THREADPOOL every worker keeps statistics for the work it
+ * ran in its slot, they're only added up when somebody asks for them.
+ */
+struct uv__work_stats {
+  uint64_t completed;
+  uint64_t wait_time;
+  uint64_t run_time;
+  uint64_t late;
+  uint64_t wait_histogram[UV_THREADPOOL_HISTOGRAM_SIZE];
+  uint64_t run_histogram[UV_THREADPOOL_HISTOGRAM_SIZE];
+  uint64_t queue_histogram[UV_THREADPOOL_HISTOGRAM_SIZE];
+};
+
+struct uv__worker {
+  uv_mutex_t mutex;  /* Protects |wq|. */
+  QUEUE wq;
+  uv_thread_t thread;
+  struct uv__executor* executor;
+  unsigned int index;
+  int running;   /* Protected by the executor's mutex. */
+  int joinable;  /* Likewise. */
+  /* Protected by |mutex|. */
+  struct uv__work_stats stats[UV__WORK_SLOW_IO + 1];
+  struct uv__work_stats priority_stats[UV_WORK_PRIORITY_LOW + 1];
+};
+
+struct uv__executor {
+  uv_mutex_t mutex;  /* Protects spawning, sleeping and the slow I/O queue. */
+  uv_cond_t cond;
+  unsigned int nslots;  /* Worker slots created so far. */
+  unsigned int nthreads;  /* Threads currently running. */
+  unsigned int idle_threads;
+  unsigned int min_threads;
+  unsigned int max_threads;
+  uint64_t idle_timeout;
+  unsigned int pending;  /* Work sitting in the per-worker queues. */
+  unsigned int next_worker;
+  unsigned int slow_io_work_running;
+  uint64_t threads_spawned;
+  uint64_t threads_retired;
+  QUEUE slow_io_pending_wq;
+  QUEUE priority_wq[UV_WORK_PRIORITY_LOW + 1];
+  unsigned int priority_pending;  /* Work in |priority_wq|. */
+  unsigned int high_priority_streak;
+  int exiting;
+  int metrics;
+  /* Only counted with |metrics|. */
+  unsigned int queued[UV__WORK_SLOW_IO + 1];
+  unsigned int queued_priority[UV_WORK_PRIORITY_LOW + 1];
+  struct uv__worker* workers[MAX_THREADPOOL_SIZE];
+};
 
 static uv_once_t once = UV_ONCE_INIT;
-static uv_cond_t cond;
-static uv_mutex_t mutex;
-static unsigned int idle_threads;
-static unsigned int slow_io_work_running;
-static unsigned int nthreads;
-static uv_thread_t* threads;
-static uv_thread_t default_threads[4];
-static QUEUE exit_message;
-static QUEUE wq;
-static QUEUE run_slow_work_message;
-static QUEUE slow_io_pending_wq;
-
-static unsigned int slow_work_thread_threshold(void) {
-  return (nthreads + 1) / 2;
+static struct uv__executor default_executor;
+
+static unsigned int slow_work_thread_threshold(struct uv__executor* exec) {
+  return (exec->max_threads + 1) / 2;
 }
 
 static void uv__cancelled(struct uv__work* w) {
@@ -51,146 +118,570 @@ static void uv__cancelled(struct uv__work* w) {
 }
 
 
+static unsigned int histogram_bucket(uint64_t val) {
+  unsigned int n;
+
+  for (n = 0; val != 0 && n < UV_THREADPOOL_HISTOGRAM_SIZE - 1; n++)
+    val >>= 1;
+
+  return n;
+}
+
+
+static void work_stats_add(struct uv__work_stats* stats,
+                           uint64_t wait_time,
+                           uint64_t run_time,
+                           unsigned int queue_length,
+                           int late) {
+  stats->completed++;
+  stats->wait_time += wait_time;
+  stats->run_time += run_time;
+  stats->late += late;
+  stats->wait_histogram[histogram_bucket(wait_time / 1000)]++;
+  stats->run_histogram[histogram_bucket(run_time / 1000)]++;
+  stats->queue_histogram[histogram_bucket(queue_length)]++;
+}
+
+
+static void work_stats_sum(uv_threadpool_work_metrics_t* metrics,
+                           const struct uv__work_stats* stats) {
+  unsigned int n;
+
+  metrics->completed += stats->completed;
+  metrics->wait_time += stats->wait_time;
+  metrics->run_time += stats->run_time;
+  metrics->late += stats->late;
+  for (n = 0; n < UV_THREADPOOL_HISTOGRAM_SIZE; n++) {
+    metrics->wait_histogram[n] += stats->wait_histogram[n];
+    metrics->run_histogram[n] += stats->run_histogram[n];
+    metrics->queue_histogram[n] += stats->queue_histogram[n];
+  }
+}
+
+
+/* Hands finished work back to the loop. Completions are pushed onto a
+ * lock-free list, the loop takes the whole list with one exchange. Only the
+ * push that makes the list non-empty has to wake the loop, and none at all
+ * while uv__work_done() is already draining it.
+ */
+static void uv__work_complete(uv_loop_t* loop, struct uv__work* w) {
+  uv__loop_internal_fields_t* lfields;
+  struct uv__work* head;
+
+  lfields = uv__get_internal_fields(loop);
+
+  do {
+    head = uv__atomic_load_ptr(&lfields->work_completed);
+    w->wq[0] = head;
+  } while (!uv__atomic_cas(&lfields->work_completed, head, w));
+
+  if (head == NULL && uv__atomic_load(&lfields->work_draining) == 0)
+    uv_async_send(&loop->wq_async);
+}
+
+
+static struct uv__executor* uv__loop_executor(uv_loop_t* loop) {
+  struct uv__executor* exec;
+
+  exec = uv__get_internal_fields(loop)->executor;
+  if (exec != NULL)
+    return exec;
+
+  return &default_executor;
+}
+
+
+static QUEUE* executor_take(struct uv__executor* exec,
+                            struct uv__worker* self) {
+  struct uv__worker* victim;
+  unsigned int nslots;
+  unsigned int i;
+  QUEUE* q;
+
+  if (uv__atomic_load(&exec->pending) == 0)
+    return NULL;
+
+  q = NULL;
+  uv_mutex_lock(&self->mutex);
+  if (!QUEUE_EMPTY(&self->wq)) {
+    q = QUEUE_HEAD(&self->wq);
+    QUEUE_REMOVE(q);
+  }
+  uv_mutex_unlock(&self->mutex);
+
+  nslots = uv__atomic_load(&exec->nslots);
+  for (i = 1; q == NULL && i < nslots; i++) {
+    victim = exec->workers[(self->index + i) % nslots];
+    uv_mutex_lock(&victim->mutex);
+    if (!QUEUE_EMPTY(&victim->wq)) {
+      q = QUEUE_HEAD(&victim->wq);
+      QUEUE_REMOVE(q);
+    }
+    uv_mutex_unlock(&victim->mutex);
+  }
+
+  if (q != NULL) {
+    QUEUE_INIT(q);  /* Signal uv_cancel() that the work req is executing. */
+    uv__atomic_fetch_add(&exec->pending, -1);
+  }
+
+  return q;
+}
+
+
+/* Called with |exec->mutex| held. */
+static QUEUE* executor_take_slow(struct uv__executor* exec) {
+  QUEUE* q;
+
+  if (QUEUE_EMPTY(&exec->slow_io_pending_wq))
+    return NULL;
+
+  if (exec->slow_io_work_running >= slow_work_thread_threshold(exec))
+    return NULL;
+
+  q = QUEUE_HEAD(&exec->slow_io_pending_wq);
+  QUEUE_REMOVE(q);
+  QUEUE_INIT(q);
+  exec->slow_io_work_running++;
+
+  return q;
+}
+
+
+/* Called with |exec->mutex| held. */
+static QUEUE* executor_take_priority(struct uv__executor* exec,
+                                     unsigned int priority) {
+  QUEUE* q;
+
+  if (QUEUE_EMPTY(&exec->priority_wq[priority]))
+    return NULL;
+
+  q = QUEUE_HEAD(&exec->priority_wq[priority]);
+  QUEUE_REMOVE(q);
+  QUEUE_INIT(q);
+  uv__atomic_fetch_add(&exec->priority_pending, -1);
+
+  return q;
+}
+
+
+/* Called with |exec->mutex| held. Returns work that is past its deadline,
+ * high priority work or normal work with a deadline, the things that go
+ * before the normal queues.
+ */
+static QUEUE* executor_take_urgent(struct uv__executor* exec) {
+  struct uv__work* w;
+  uint64_t deadline;
+  unsigned int priority;
+  unsigned int i;
+  uint64_t now;
+
+  if (exec->priority_pending == 0)
+    return NULL;
+
+  /* Every queue is ordered by deadline, only the heads are of interest. */
+  priority = UV_WORK_PRIORITY_LOW + 1;
+  deadline = UINT64_MAX;
+  for (i = 0; i <= UV_WORK_PRIORITY_LOW; i++) {
+    if (QUEUE_EMPTY(&exec->priority_wq[i]))
+      continue;
+    w = QUEUE_DATA(QUEUE_HEAD(&exec->priority_wq[i]), struct uv__work, wq);
+    if (w->deadline < deadline) {
+      deadline = w->deadline;
+      priority = i;
+    }
+  }
+
+  if (deadline != UINT64_MAX) {
+    now = uv_hrtime();
+    if (deadline <= now)
+      return executor_take_priority(exec, priority);
+  }
+
+  if (exec->high_priority_streak >= HIGH_PRIORITY_BURST &&
+      (uv__atomic_load(&exec->pending) != 0 ||
+       !QUEUE_EMPTY(&exec->priority_wq[UV_WORK_PRIORITY_NORMAL]))) {
+    exec->high_priority_streak = 0;
+    return executor_take_priority(exec, UV_WORK_PRIORITY_NORMAL);
+  }
+
+  if (!QUEUE_EMPTY(&exec->priority_wq[UV_WORK_PRIORITY_HIGH])) {
+    exec->high_priority_streak++;
+    return executor_take_priority(exec, UV_WORK_PRIORITY_HIGH);
+  }
+
+  /* A deadline doesn't make normal work wait for slow I/O, it goes ahead of
+   * the normal queues.
+   */
+  return executor_take_priority(exec, UV_WORK_PRIORITY_NORMAL);
+}
+
+
+/* Called with |exec->mutex| held when there's nothing to run. Waits for work
+ * to come in and returns non-zero when the calling thread should exit.
+ */
+static int executor_wait(struct uv__executor* exec) {
+  int timed_out;
+
+  if (exec->exiting) {
+    uv__atomic_fetch_add(&exec->nthreads, -1);
+    return 1;
+  }
+
+  timed_out = 0;
+
+  /* Submitters check |idle_threads| after bumping |pending|, one of the two
+   * sides always sees the other.
+   */
+  uv__atomic_fetch_add(&exec->idle_threads, 1);
+  if (uv__atomic_load(&exec->pending) == 0 &&
+      exec->priority_pending == 0 &&
+      exec->nthreads <= exec->max_threads) {
+    if (exec->nthreads > exec->min_threads && exec->idle_timeout > 0)
+      timed_out = UV_ETIMEDOUT == uv_cond_timedwait(&exec->cond,
+                                                    &exec->mutex,
+                                                    exec->idle_timeout * 1000000);
+    else
+      uv_cond_wait(&exec->cond, &exec->mutex);
+  }
+  uv__atomic_fetch_add(&exec->idle_threads, -1);
+
+  if (!timed_out && exec->nthreads <= exec->max_threads)
+    return 0;
+
+  if (exec->nthreads <= exec->min_threads)
+    return 0;
+
+  /* Leave before looking at |pending| again. A submitter that raced with us
+   * then sees the lower thread count and starts a new thread if need be.
+   */
+  uv__atomic_fetch_add(&exec->nthreads, -1);
+  if (uv__atomic_load(&exec->pending) != 0 || exec->priority_pending != 0) {
+    uv__atomic_fetch_add(&exec->nthreads, 1);
+    return 0;
+  }
+
+  exec->threads_retired++;
+  return 1;
+}
+
+
 /* To avoid deadlock with uv_cancel() it's crucial that the worker
- * never holds the global mutex and the loop-local mutex at the same time.
+ * never holds a queue mutex and the loop-local mutex at the same time.
  */
 static void worker(void* arg) {
+  struct uv__executor* exec;
+  struct uv__worker* self;
   struct uv__work* w;
   QUEUE* q;
+  uint64_t queued_at;
+  uint64_t started_at;
+  uint64_t deadline;
+  unsigned int queue_length;
+  unsigned int priority_length;
+  unsigned int priority;
+  unsigned int kind;
   int is_slow_work;
 
-  uv_sem_post((uv_sem_t*) arg);
-  arg = NULL;
+  self = arg;
+  exec = self->executor;
 
-  uv_mutex_lock(&mutex);
   for (;;) {
-    /* `mutex` should always be locked at this point. */
-
-    /* Keep waiting while either no work is present or only slow I/O
-       and we're at the threshold for that. */
-    while (QUEUE_EMPTY(&wq) ||
-           (QUEUE_HEAD(&wq) == &run_slow_work_message &&
-            QUEUE_NEXT(&run_slow_work_message) == &wq &&
-            slow_io_work_running >= slow_work_thread_threshold())) {
-      idle_threads += 1;
-      uv_cond_wait(&cond, &mutex);
-      idle_threads -= 1;
-    }
+    is_slow_work = 0;
+    q = NULL;
 
-    q = QUEUE_HEAD(&wq);
-    if (q == &exit_message) {
-      uv_cond_signal(&cond);
-      uv_mutex_unlock(&mutex);
-      break;
+    if (uv__atomic_load(&exec->priority_pending) != 0) {
+      uv_mutex_lock(&exec->mutex);
+      q = executor_take_urgent(exec);
+      uv_mutex_unlock(&exec->mutex);
     }
 
-    QUEUE_REMOVE(q);
-    QUEUE_INIT(q);  /* Signal uv_cancel() that the work req is executing. */
-
-    is_slow_work = 0;
-    if (q == &run_slow_work_message) {
-      /* If we're at the slow I/O threshold, re-schedule until after all
-         other work in the queue is done. */
-      if (slow_io_work_running >= slow_work_thread_threshold()) {
-        QUEUE_INSERT_TAIL(&wq, q);
-        continue;
+    if (q == NULL)
+      q = executor_take(exec, self);
+
+    if (q == NULL) {
+      uv_mutex_lock(&exec->mutex);
+      q = executor_take_slow(exec);
+      if (q != NULL)
+        is_slow_work = 1;
+      if (q == NULL)
+        q = executor_take_priority(exec, UV_WORK_PRIORITY_LOW);
+      if (q == NULL && executor_wait(exec)) {
+        self->running = 0;
+        uv_mutex_unlock(&exec->mutex);
+        break;
       }
+      uv_mutex_unlock(&exec->mutex);
 
-      /* If we encountered a request to run slow I/O work but there is none
-         to run, that means it's cancelled => Start over. */
-      if (QUEUE_EMPTY(&slow_io_pending_wq))
+      if (q == NULL)
         continue;
-
-      is_slow_work = 1;
-      slow_io_work_running++;
-
-      q = QUEUE_HEAD(&slow_io_pending_wq);
-      QUEUE_REMOVE(q);
-      QUEUE_INIT(q);
-
-      /* If there is more slow I/O work, schedule it to be run as well. */
-      if (!QUEUE_EMPTY(&slow_io_pending_wq)) {
-        QUEUE_INSERT_TAIL(&wq, &run_slow_work_message);
-        if (idle_threads > 0)
-          uv_cond_signal(&cond);
-      }
     }
 
-    uv_mutex_unlock(&mutex);
-
     w = QUEUE_DATA(q, struct uv__work, wq);
+    queued_at = w->queued_at;
+    deadline = w->deadline;
+    kind = w->kind;
+    priority = w->priority;
+
+    started_at = 0;
+    queue_length = 0;
+    priority_length = 0;
+    if (queued_at != 0) {
+      started_at = uv_hrtime();
+      queue_length = uv__atomic_fetch_add(&exec->queued[kind], -1) - 1;
+      priority_length =
+          uv__atomic_fetch_add(&exec->queued_priority[priority], -1) - 1;
+    }
+
     w->work(w);
 
-    uv_mutex_lock(&w->loop->wq_mutex);
-    w->work = NULL;  /* Signal uv_cancel() that the work req is done
-                        executing. */
-    QUEUE_INSERT_TAIL(&w->loop->wq, &w->wq);
-    uv_async_send(&w->loop->wq_async);
-    uv_mutex_unlock(&w->loop->wq_mutex);
+    w->work = NULL;  /* Signal uv__work_done() that the work req ran. */
+    uv__work_complete(w->loop, w);
+
+    /* |w| may be gone by now. */
+    if (queued_at != 0) {
+      uint64_t run_time;
+      int late;
+
+      run_time = uv_hrtime() - started_at;
+      late = deadline != 0 && started_at > deadline;
+      uv_mutex_lock(&self->mutex);
+      work_stats_add(&self->stats[kind],
+                     started_at - queued_at,
+                     run_time,
+                     queue_length,
+                     late);
+      work_stats_add(&self->priority_stats[priority],
+                     started_at - queued_at,
+                     run_time,
+                     priority_length,
+                     late);
+      uv_mutex_unlock(&self->mutex);
+    }
 
-    /* Lock `mutex` since that is expected at the start of the next
-     * iteration. */
-    uv_mutex_lock(&mutex);
     if (is_slow_work) {
-      /* `slow_io_work_running` is protected by `mutex`. */
-      slow_io_work_running--;
+      uv_mutex_lock(&exec->mutex);
+      exec->slow_io_work_running--;
+      if (!QUEUE_EMPTY(&exec->slow_io_pending_wq) && exec->idle_threads > 0)
+        uv_cond_signal(&exec->cond);
+      uv_mutex_unlock(&exec->mutex);
     }
   }
 }
 
 
-static void post(QUEUE* q, enum uv__work_kind kind) {
-  uv_mutex_lock(&mutex);
-  if (kind == UV__WORK_SLOW_IO) {
-    /* Insert into a separate queue. */
-    QUEUE_INSERT_TAIL(&slow_io_pending_wq, q);
-    if (!QUEUE_EMPTY(&run_slow_work_message)) {
-      /* Running slow I/O tasks is already scheduled => Nothing to do here.
-         The worker that runs said other task will schedule this one as well. */
-      uv_mutex_unlock(&mutex);
+/* Called with |exec->mutex| held. */
+static void executor_spawn(struct uv__executor* exec) {
+  struct uv__worker* w;
+  unsigned int i;
+
+  if (exec->exiting || exec->nthreads >= exec->max_threads)
+    return;
+
+  w = NULL;
+  for (i = 0; i < exec->nslots; i++) {
+    if (!exec->workers[i]->running) {
+      w = exec->workers[i];
+      break;
+    }
+  }
+
+  if (w == NULL) {
+    if (exec->nslots == MAX_THREADPOOL_SIZE)
       return;
+
+    w = uv__calloc(1, sizeof(*w));
+    if (w == NULL)
+      goto fail;
+
+    if (uv_mutex_init(&w->mutex)) {
+      uv__free(w);
+      goto fail;
     }
-    q = &run_slow_work_message;
+
+    QUEUE_INIT(&w->wq);
+    w->executor = exec;
+    w->index = exec->nslots;
+    exec->workers[exec->nslots] = w;
+    uv__atomic_store(&exec->nslots, exec->nslots + 1);
+  } else if (w->joinable) {
+    /* Reap the thread that used the slot last, it has exited or is about to. */
+    if (uv_thread_join(&w->thread))
+      abort();
+    w->joinable = 0;
+  }
+
+  w->running = 1;
+  if (uv_thread_create(&w->thread, worker, w)) {
+    w->running = 0;
+    goto fail;
   }
 
-  QUEUE_INSERT_TAIL(&wq, q);
-  if (idle_threads > 0)
-    uv_cond_signal(&cond);
-  uv_mutex_unlock(&mutex);
+  w->joinable = 1;
+  uv__atomic_fetch_add(&exec->nthreads, 1);
+  exec->threads_spawned++;
+  return;
+
+fail:
+  /* Without any thread the work would never run. */
+  if (exec->nthreads == 0)
+    abort();
 }
 
 
-void uv__threadpool_cleanup(void) {
-#ifndef _WIN32
+static void post(struct uv__executor* exec, QUEUE* q, enum uv__work_kind kind) {
+  struct uv__worker* w;
+  unsigned int idle_threads;
+  unsigned int pending;
+  unsigned int nslots;
+  unsigned int n;
   unsigned int i;
 
-  if (nthreads == 0)
+  if (kind == UV__WORK_SLOW_IO) {
+    uv_mutex_lock(&exec->mutex);
+    QUEUE_INSERT_TAIL(&exec->slow_io_pending_wq, q);
+    if (exec->idle_threads > 0)
+      uv_cond_signal(&exec->cond);
+    else
+      executor_spawn(exec);
+    uv_mutex_unlock(&exec->mutex);
     return;
+  }
 
-  post(&exit_message, UV__WORK_CPU);
+  nslots = uv__atomic_load(&exec->nslots);
+  if (nslots == 0) {
+    uv_mutex_lock(&exec->mutex);
+    executor_spawn(exec);
+    uv_mutex_unlock(&exec->mutex);
+    nslots = uv__atomic_load(&exec->nslots);
+  }
+
+  /* Prefer a slot with a thread behind it, but any slot will do. */
+  n = uv__atomic_fetch_add(&exec->next_worker, 1);
+  w = exec->workers[n % nslots];
+  for (i = 1; i < nslots && !uv__load_relaxed(&w->running); i++)
+    w = exec->workers[(n + i) % nslots];
+
+  uv_mutex_lock(&w->mutex);
+  QUEUE_INSERT_TAIL(&w->wq, q);
+  uv_mutex_unlock(&w->mutex);
+
+  /* Wake an idle thread, and start a new one when there's more work queued
+   * than there are idle threads to pick it up.
+   */
+  pending = uv__atomic_fetch_add(&exec->pending, 1) + 1;
+  idle_threads = uv__atomic_load(&exec->idle_threads);
+
+  if (idle_threads > 0 ||
+      (pending > idle_threads &&
+       uv__atomic_load(&exec->nthreads) < uv__load_relaxed(&exec->max_threads))) {
+    uv_mutex_lock(&exec->mutex);
+    if (idle_threads > 0)
+      uv_cond_signal(&exec->cond);
+    if (pending > idle_threads)
+      executor_spawn(exec);
+    uv_mutex_unlock(&exec->mutex);
+  }
+}
 
-  for (i = 0; i < nthreads; i++)
-    if (uv_thread_join(threads + i))
-      abort();
 
-  if (threads != default_threads)
-    uv__free(threads);
+static void executor_init(struct uv__executor* exec, unsigned int max_threads) {
+  memset(exec, 0, sizeof(*exec));
+  exec->max_threads = max_threads;
+  exec->idle_timeout = DEFAULT_IDLE_TIMEOUT;
+  QUEUE_INIT(&exec->slow_io_pending_wq);
+  QUEUE_INIT(&exec->priority_wq[UV_WORK_PRIORITY_HIGH]);
+  QUEUE_INIT(&exec->priority_wq[UV_WORK_PRIORITY_NORMAL]);
+  QUEUE_INIT(&exec->priority_wq[UV_WORK_PRIORITY_LOW]);
 
-  uv_mutex_destroy(&mutex);
-  uv_cond_destroy(&cond);
+  if (uv_cond_init(&exec->cond))
+    abort();
+
+  if (uv_mutex_init(&exec->mutex))
+    abort();
+}
+
+
+static void executor_destroy(struct uv__executor* exec) {
+  struct uv__worker* w;
+  unsigned int i;
+
+  uv_mutex_lock(&exec->mutex);
+  exec->exiting = 1;
+  uv_cond_broadcast(&exec->cond);
+  uv_mutex_unlock(&exec->mutex);
+
+  /* No more threads are started once |exiting| is set. */
+  for (i = 0; i < exec->nslots; i++) {
+    w = exec->workers[i];
+    if (w->joinable)
+      if (uv_thread_join(&w->thread))
+        abort();
+    uv_mutex_destroy(&w->mutex);
+    uv__free(w);
+    exec->workers[i] = NULL;
+  }
+
+  uv_mutex_destroy(&exec->mutex);
+  uv_cond_destroy(&exec->cond);
+  exec->nslots = 0;
+  exec->max_threads = 0;
+}
+
+
+void uv__threadpool_cleanup(void) {
+#ifndef _WIN32
+  if (default_executor.max_threads == 0)
+    return;
 
-  threads = NULL;
-  nthreads = 0;
+  executor_destroy(&default_executor);
 #endif
 }
 
 
-static void init_threads(void) {
+#ifndef _WIN32
+/* Re-initialize the executor after fork, the worker threads don't exist in
+ * the child. Note that this discards the queued work as well.
+ */
+static void executor_reset(struct uv__executor* exec) {
+  unsigned int min_threads;
+  unsigned int max_threads;
+  uint64_t idle_timeout;
   unsigned int i;
+  int metrics;
+
+  min_threads = exec->min_threads;
+  max_threads = exec->max_threads;
+  idle_timeout = exec->idle_timeout;
+  metrics = exec->metrics;
+
+  for (i = 0; i < exec->nslots; i++)
+    uv__free(exec->workers[i]);
+
+  executor_init(exec, max_threads);
+  exec->min_threads = min_threads;
+  exec->idle_timeout = idle_timeout;
+  exec->metrics = metrics;
+}
+
+
+static void reset_default_executor(void) {
+  if (default_executor.max_threads != 0)
+    executor_reset(&default_executor);
+}
+#endif
+
+
+static void init_once(void) {
+  unsigned int nthreads;
   const char* val;
-  uv_sem_t sem;
 
-  nthreads = ARRAY_SIZE(default_threads);
+#ifndef _WIN32
+  if (pthread_atfork(NULL, NULL, &reset_default_executor))
+    abort();
+#endif
+
+  nthreads = DEFAULT_THREADPOOL_SIZE;
   val = getenv("UV_THREADPOOL_SIZE");
   if (val != NULL)
     nthreads = atoi(val);
@@ -199,57 +690,210 @@ static void init_threads(void) {
   if (nthreads > MAX_THREADPOOL_SIZE)
     nthreads = MAX_THREADPOOL_SIZE;
 
-  threads = default_threads;
-  if (nthreads > ARRAY_SIZE(default_threads)) {
-    threads = uv__malloc(nthreads * sizeof(threads[0]));
-    if (threads == NULL) {
-      nthreads = ARRAY_SIZE(default_threads);
-      threads = default_threads;
-    }
-  }
+  executor_init(&default_executor, nthreads);
+}
 
-  if (uv_cond_init(&cond))
-    abort();
 
-  if (uv_mutex_init(&mutex))
-    abort();
+int uv__threadpool_loop_configure(uv_loop_t* loop, unsigned int nthreads) {
+  uv__loop_internal_fields_t* lfields;
+  struct uv__executor* exec;
 
-  QUEUE_INIT(&wq);
-  QUEUE_INIT(&slow_io_pending_wq);
-  QUEUE_INIT(&run_slow_work_message);
+  if (nthreads == 0 || nthreads > MAX_THREADPOOL_SIZE)
+    return UV_EINVAL;
 
-  if (uv_sem_init(&sem, 0))
-    abort();
+  lfields = uv__get_internal_fields(loop);
+  if (lfields->executor != NULL || uv__has_active_reqs(loop))
+    return UV_EBUSY;
+
+  exec = uv__malloc(sizeof(*exec));
+  if (exec == NULL)
+    return UV_ENOMEM;
+
+  executor_init(exec, nthreads);
+  lfields->executor = exec;
+  return 0;
+}
 
-  for (i = 0; i < nthreads; i++)
-    if (uv_thread_create(threads + i, worker, &sem))
-      abort();
 
-  for (i = 0; i < nthreads; i++)
-    uv_sem_wait(&sem);
+void uv__threadpool_loop_close(uv_loop_t* loop) {
+  uv__loop_internal_fields_t* lfields;
 
-  uv_sem_destroy(&sem);
+  lfields = uv__get_internal_fields(loop);
+  if (lfields->executor == NULL)
+    return;
+
+  executor_destroy(lfields->executor);
+  uv__free(lfields->executor);
+  lfields->executor = NULL;
 }
 
 
 #ifndef _WIN32
-static void reset_once(void) {
-  uv_once_t child_once = UV_ONCE_INIT;
-  memcpy(&once, &child_once, sizeof(child_once));
+void uv__threadpool_loop_fork(uv_loop_t* loop) {
+  uv__loop_internal_fields_t* lfields;
+
+  lfields = uv__get_internal_fields(loop);
+  if (lfields->executor != NULL)
+    executor_reset(lfields->executor);
 }
 #endif
 
 
-static void init_once(void) {
-#ifndef _WIN32
-  /* Re-initialize the threadpool after fork.
-   * Note that this discards the global mutex and condition as well
-   * as the work queue.
+static struct uv__executor* uv__executor_get(uv_loop_t* loop) {
+  uv_once(&once, init_once);
+
+  if (loop == NULL)
+    return &default_executor;
+
+  return uv__loop_executor(loop);
+}
+
+
+int uv_threadpool_set_limits(uv_loop_t* loop,
+                             unsigned int min_threads,
+                             unsigned int max_threads,
+                             uint64_t idle_timeout) {
+  struct uv__executor* exec;
+  unsigned int i;
+
+  if (max_threads == 0 || max_threads > MAX_THREADPOOL_SIZE)
+    return UV_EINVAL;
+
+  if (min_threads > max_threads)
+    return UV_EINVAL;
+
+  exec = uv__executor_get(loop);
+
+  uv_mutex_lock(&exec->mutex);
+  exec->min_threads = min_threads;
+  uv__store_relaxed(&exec->max_threads, max_threads);
+  exec->idle_timeout = idle_timeout;
+
+  for (i = exec->nthreads; i < min_threads; i++)
+    executor_spawn(exec);
+
+  /* Let idle threads pick up the new timeout, or exit when over the limit. */
+  uv_cond_broadcast(&exec->cond);
+  uv_mutex_unlock(&exec->mutex);
+
+  return 0;
+}
+
+
+int uv_threadpool_metrics(uv_loop_t* loop, uv_threadpool_metrics_t* metrics) {
+  struct uv__executor* exec;
+
+  if (metrics == NULL)
+    return UV_EINVAL;
+
+  exec = uv__executor_get(loop);
+
+  uv_mutex_lock(&exec->mutex);
+  metrics->threads = exec->nthreads;
+  metrics->idle_threads = exec->idle_threads;
+  metrics->min_threads = exec->min_threads;
+  metrics->max_threads = exec->max_threads;
+  metrics->idle_timeout = exec->idle_timeout;
+  metrics->threads_spawned = exec->threads_spawned;
+  metrics->threads_retired = exec->threads_retired;
+  uv_mutex_unlock(&exec->mutex);
+
+  return 0;
+}
+
+
+int uv__threadpool_metrics_enable(uv_loop_t* loop) {
+  uv__store_relaxed(&uv__executor_get(loop)->metrics, 1);
+  return 0;
+}
+
+
+int uv_threadpool_work_metrics(uv_loop_t* loop,
+                               uv_work_kind kind,
+                               uv_threadpool_work_metrics_t* metrics) {
+  struct uv__executor* exec;
+  struct uv__worker* w;
+  unsigned int i;
+
+  if (metrics == NULL || kind < UV_WORK_CPU || kind > UV_WORK_SLOW_IO)
+    return UV_EINVAL;
+
+  exec = uv__executor_get(loop);
+  memset(metrics, 0, sizeof(*metrics));
+  metrics->queued = uv__atomic_load(&exec->queued[kind]);
+
+  /* Slots are only freed with the executor, holding its mutex is enough to
+   * walk them.
    */
-  if (pthread_atfork(NULL, NULL, &reset_once))
-    abort();
-#endif
-  init_threads();
+  uv_mutex_lock(&exec->mutex);
+  for (i = 0; i < exec->nslots; i++) {
+    w = exec->workers[i];
+    uv_mutex_lock(&w->mutex);
+    work_stats_sum(metrics, &w->stats[kind]);
+    uv_mutex_unlock(&w->mutex);
+  }
+  uv_mutex_unlock(&exec->mutex);
+
+  return 0;
+}
+
+
+int uv_threadpool_priority_metrics(uv_loop_t* loop,
+                                   uv_work_priority priority,
+                                   uv_threadpool_work_metrics_t* metrics) {
+  struct uv__executor* exec;
+  struct uv__worker* w;
+  unsigned int i;
+
+  if (metrics == NULL ||
+      priority < UV_WORK_PRIORITY_HIGH ||
+      priority > UV_WORK_PRIORITY_LOW) {
+    return UV_EINVAL;
+  }
+
+  exec = uv__executor_get(loop);
+  memset(metrics, 0, sizeof(*metrics));
+  metrics->queued = uv__atomic_load(&exec->queued_priority[priority]);
+
+  uv_mutex_lock(&exec->mutex);
+  for (i = 0; i < exec->nslots; i++) {
+    w = exec->workers[i];
+    uv_mutex_lock(&w->mutex);
+    work_stats_sum(metrics, &w->priority_stats[priority]);
+    uv_mutex_unlock(&w->mutex);
+  }
+  uv_mutex_unlock(&exec->mutex);
+
+  return 0;
+}
+
+
+static struct uv__executor* work_init(uv_loop_t* loop,
+                                      struct uv__work* w,
+                                      enum uv__work_kind kind,
+                                      uv_work_priority priority,
+                                      void (*work)(struct uv__work* w),
+                                      void (*done)(struct uv__work* w,
+                                                   int status)) {
+  struct uv__executor* exec;
+
+  uv_once(&once, init_once);
+  exec = uv__loop_executor(loop);
+  w->loop = loop;
+  w->work = work;
+  w->done = done;
+  w->kind = kind;
+  w->priority = priority;
+  w->deadline = 0;
+  w->queued_at = 0;
+
+  if (uv__load_relaxed(&exec->metrics)) {
+    w->queued_at = uv_hrtime();
+    uv__atomic_fetch_add(&exec->queued[kind], 1);
+    uv__atomic_fetch_add(&exec->queued_priority[priority], 1);
+  }
+
+  return exec;
 }
 
 
@@ -258,63 +902,159 @@ void uv__work_submit(uv_loop_t* loop,
                      enum uv__work_kind kind,
                      void (*work)(struct uv__work* w),
                      void (*done)(struct uv__work* w, int status)) {
-#if defined(__linux__)
-  assert("uv__work_submit is disabled on linux, use aio instead" && 0);
-#endif
-  uv_once(&once, init_once);
-  w->loop = loop;
-  w->work = work;
-  w->done = done;
-  post(&w->wq, kind);
+  struct uv__executor* exec;
+
+  exec = work_init(loop, w, kind, UV_WORK_PRIORITY_NORMAL, work, done);
+  post(exec, &w->wq, kind);
+}
+
+
+/* |deadline| is in milliseconds from now, 0 for none. */
+static void uv__work_submit_priority(uv_loop_t* loop,
+                                     struct uv__work* w,
+                                     uv_work_priority priority,
+                                     uint64_t deadline,
+                                     void (*work)(struct uv__work* w),
+                                     void (*done)(struct uv__work* w,
+                                                  int status)) {
+  struct uv__executor* exec;
+  struct uv__work* prev;
+  QUEUE* wq;
+  QUEUE* q;
+
+  exec = work_init(loop, w, UV__WORK_CPU, priority, work, done);
+
+  if (priority == UV_WORK_PRIORITY_NORMAL && deadline == 0) {
+    post(exec, &w->wq, UV__WORK_CPU);
+    return;
+  }
+
+  if (deadline == 0 && priority == UV_WORK_PRIORITY_LOW)
+    deadline = LOW_PRIORITY_AGING;
+
+  w->deadline = UINT64_MAX;
+  if (deadline != 0)
+    w->deadline = uv_hrtime() + deadline * 1000000;
+
+  uv_mutex_lock(&exec->mutex);
+
+  /* Keep the queue ordered by deadline. Most work has the default deadline,
+   * which is later than everything before it, so search from the back.
+   */
+  wq = &exec->priority_wq[priority];
+  for (q = QUEUE_PREV(wq); q != wq; q = QUEUE_PREV(q)) {
+    prev = QUEUE_DATA(q, struct uv__work, wq);
+    if (prev->deadline <= w->deadline)
+      break;
+  }
+  QUEUE_INSERT_HEAD(q, &w->wq);
+  uv__atomic_fetch_add(&exec->priority_pending, 1);
+
+  if (exec->idle_threads > 0)
+    uv_cond_signal(&exec->cond);
+  else
+    executor_spawn(exec);
+  uv_mutex_unlock(&exec->mutex);
+}
+
+
+static int queue_remove(QUEUE* h, QUEUE* wq) {
+  QUEUE* q;
+
+  QUEUE_FOREACH(q, h) {
+    if (q == wq) {
+      QUEUE_REMOVE(q);
+      return 1;
+    }
+  }
+
+  return 0;
 }
 
 
 static int uv__work_cancel(uv_loop_t* loop, uv_req_t* req, struct uv__work* w) {
+  struct uv__executor* exec;
+  unsigned int i;
   int cancelled;
 
-  uv_mutex_lock(&mutex);
-  uv_mutex_lock(&w->loop->wq_mutex);
+  /* The work can sit in any of the queues. Cancelling is rare, so just look
+   * for it instead of tracking its position.
+   */
+  uv_once(&once, init_once);
+  exec = uv__loop_executor(loop);
+  cancelled = 0;
 
-  cancelled = !QUEUE_EMPTY(&w->wq) && w->work != NULL;
-  if (cancelled)
-    QUEUE_REMOVE(&w->wq);
+  for (i = 0; !cancelled && i < uv__atomic_load(&exec->nslots); i++) {
+    uv_mutex_lock(&exec->workers[i]->mutex);
+    cancelled = queue_remove(&exec->workers[i]->wq, &w->wq);
+    uv_mutex_unlock(&exec->workers[i]->mutex);
+  }
 
-  uv_mutex_unlock(&w->loop->wq_mutex);
-  uv_mutex_unlock(&mutex);
+  if (cancelled) {
+    uv__atomic_fetch_add(&exec->pending, -1);
+  } else {
+    uv_mutex_lock(&exec->mutex);
+    cancelled = queue_remove(&exec->slow_io_pending_wq, &w->wq);
+    for (i = 0; !cancelled && i <= UV_WORK_PRIORITY_LOW; i++) {
+      cancelled = queue_remove(&exec->priority_wq[i], &w->wq);
+      if (cancelled)
+        uv__atomic_fetch_add(&exec->priority_pending, -1);
+    }
+    uv_mutex_unlock(&exec->mutex);
+  }
 
   if (!cancelled)
     return UV_EBUSY;
 
+  if (w->queued_at != 0) {
+    uv__atomic_fetch_add(&exec->queued[w->kind], -1);
+    uv__atomic_fetch_add(&exec->queued_priority[w->priority], -1);
+  }
+
   w->work = uv__cancelled;
-  uv_mutex_lock(&loop->wq_mutex);
-  QUEUE_INSERT_TAIL(&loop->wq, &w->wq);
-  uv_async_send(&loop->wq_async);
-  uv_mutex_unlock(&loop->wq_mutex);
+  uv__work_complete(loop, w);
 
   return 0;
 }
 
 
 void uv__work_done(uv_async_t* handle) {
+  uv__loop_internal_fields_t* lfields;
+  struct uv__work* batch;
+  struct uv__work* next;
   struct uv__work* w;
   uv_loop_t* loop;
-  QUEUE* q;
-  QUEUE wq;
   int err;
 
   loop = container_of(handle, uv_loop_t, wq_async);
-  uv_mutex_lock(&loop->wq_mutex);
-  QUEUE_MOVE(&loop->wq, &wq);
-  uv_mutex_unlock(&loop->wq_mutex);
-
-  while (!QUEUE_EMPTY(&wq)) {
-    q = QUEUE_HEAD(&wq);
-    QUEUE_REMOVE(q);
+  lfields = uv__get_internal_fields(loop);
+
+  uv__atomic_store(&lfields->work_draining, 1);
+  batch = uv__atomic_exchange(&lfields->work_completed, NULL);
+
+  /* The list is LIFO, flip it so callbacks run in completion order. */
+  w = NULL;
+  while (batch != NULL) {
+    next = batch->wq[0];
+    batch->wq[0] = w;
+    w = batch;
+    batch = next;
+  }
 
-    w = container_of(q, struct uv__work, wq);
+  while (w != NULL) {
+    next = w->wq[0];
     err = (w->work == uv__cancelled) ? UV_ECANCELED : 0;
     w->done(w, err);
+    w = next;
   }
+
+  /* Workers didn't wake the loop for what they finished in the meantime.
+   * Leave that for the next iteration so a steady stream of completions
+   * can't starve the other phases.
+   */
+  uv__atomic_store(&lfields->work_draining, 0);
+  if (uv__atomic_load_ptr(&lfields->work_completed) != NULL)
+    uv_async_send(&loop->wq_async);
 }
 
 
@@ -358,6 +1098,32 @@ int uv_queue_work(uv_loop_t* loop,
 }
 
 
+int uv_queue_work_priority(uv_loop_t* loop,
+                           uv_work_t* req,
+                           uv_work_priority priority,
+                           uint64_t deadline,
+                           uv_work_cb work_cb,
+                           uv_after_work_cb after_work_cb) {
+  if (work_cb == NULL)
+    return UV_EINVAL;
+
+  if (priority < UV_WORK_PRIORITY_HIGH || priority > UV_WORK_PRIORITY_LOW)
+    return UV_EINVAL;
+
+  uv__req_init(loop, req, UV_WORK);
+  req->loop = loop;
+  req->work_cb = work_cb;
+  req->after_work_cb = after_work_cb;
+  uv__work_submit_priority(loop,
+                           &req->work_req,
+                           priority,
+                           deadline,
+                           uv__queue_work,
+                           uv__queue_done);
+  return 0;
+}
+
+
 int uv_cancel(uv_req_t* req) {
   struct uv__work* wreq;
   uv_loop_t* loop;
@@ -368,14 +1134,26 @@ int uv_cancel(uv_req_t* req) {
     wreq = &((uv_fs_t*) req)->work_req;
     break;
   case UV_GETADDRINFO:
+#ifndef _WIN32
+    if (((uv_getaddrinfo_t*) req)->dns_query != NULL)
+      return uv__dns_cancel(((uv_getaddrinfo_t*) req)->dns_query);
+#endif
     loop =  ((uv_getaddrinfo_t*) req)->loop;
     wreq = &((uv_getaddrinfo_t*) req)->work_req;
     break;
   case UV_GETNAMEINFO:
+#ifndef _WIN32
+    if (((uv_getnameinfo_t*) req)->dns_query != NULL)
+      return uv__dns_cancel(((uv_getnameinfo_t*) req)->dns_query);
+#endif
     loop = ((uv_getnameinfo_t*) req)->loop;
     wreq = &((uv_getnameinfo_t*) req)->work_req;
     break;
   case UV_RANDOM:
+#ifndef _WIN32
+    if (((uv_random_t*) req)->work_req.done == uv__random_pool_done)
+      return uv__random_pool_cancel((uv_random_t*) req);
+#endif
     loop = ((uv_random_t*) req)->loop;
     wreq = &((uv_random_t*) req)->work_req;
     break;
@@ -164,8 +164,14 @@ void uv__run_timers(uv_loop_t* loop) {
     if (handle->timeout > loop->time)
       break;
 
+    /* Still due on the next call. */
+    if (uv__run_budget_take(loop))
+      break;
+
     uv_timer_stop(handle);
     uv_timer_again(handle);
+    uv__trace(loop, UV_TRACE_TIMER, UV_TIMER, -1, (uintptr_t) handle);
+    uv__loop_callback(loop, UV_TIMER, handle, handle->timer_cb, -1);
     handle->timer_cb(handle);
   }
 }
@@ -0,0 +1,231 @@
+/* Copyright libuv contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "uv-common.h"
+
+#include <string.h>
+
+/* The loop thread is the only one that records events and reads them, the
+ * ring needs no lock. The oldest records are overwritten once it's full.
+ */
+struct uv__trace {
+  uv_trace_record_t* records;
+  unsigned int mask;  /* Size of |records| minus one, a power of two. */
+  uint64_t next;  /* Records ever written. */
+};
+
+/* The file uv_loop_trace_dump() writes starts with this, then come |count|
+ * records, all in the byte order of the host. tools/trace_to_chrome.py
+ * tells the byte order from |version|.
+ */
+struct uv__trace_header {
+  char magic[8];  /* "UVTRACE" */
+  uint32_t version;  /* 1 */
+  uint32_t record_size;  /* sizeof(uv_trace_record_t) */
+  uint64_t count;
+};
+
+STATIC_ASSERT(sizeof(uv_trace_record_t) == 24);
+STATIC_ASSERT(sizeof(struct uv__trace_header) == 24);
+
+
+int uv__trace_configure(uv_loop_t* loop, unsigned int records) {
+#ifdef UV_NO_TRACE
+  return UV_ENOSYS;
+#else
+  uv__loop_internal_fields_t* lfields;
+  struct uv__trace* trace;
+
+  if (records != 0 && (records & (records - 1)) != 0)
+    return UV_EINVAL;
+
+  lfields = uv__get_internal_fields(loop);
+
+  trace = NULL;
+  if (records != 0) {
+    trace = uv__malloc(sizeof(*trace));
+    if (trace == NULL)
+      return UV_ENOMEM;
+
+    trace->records = uv__malloc(records * sizeof(trace->records[0]));
+    if (trace->records == NULL) {
+      uv__free(trace);
+      return UV_ENOMEM;
+    }
+
+    trace->mask = records - 1;
+    trace->next = 0;
+  }
+
+  uv__trace_loop_close(loop);
+  lfields->trace = trace;
+
+  return 0;
+#endif
+}
+
+
+void uv__trace_record(uv_loop_t* loop,
+                      uv_trace_event event,
+                      int type,
+                      int fd,
+                      uint64_t arg) {
+  struct uv__trace* trace;
+  uv_trace_record_t* record;
+
+  trace = uv__get_internal_fields(loop)->trace;
+  record = &trace->records[trace->next++ & trace->mask];
+  record->time = uv_hrtime();
+  record->event = (uint16_t) event;
+  record->type = (uint16_t) type;
+  record->fd = fd;
+  record->arg = arg;
+}
+
+
+void uv__trace_loop_close(uv_loop_t* loop) {
+  uv__loop_internal_fields_t* lfields;
+  struct uv__trace* trace;
+
+  lfields = uv__get_internal_fields(loop);
+  trace = lfields->trace;
+  if (trace == NULL)
+    return;
+
+  lfields->trace = NULL;
+  uv__free(trace->records);
+  uv__free(trace);
+}
+
+
+/* The records that are kept, oldest first. |first| is the index of the
+ * oldest one in the ring, the ones after it may wrap around.
+ */
+static unsigned int uv__trace_span(const struct uv__trace* trace,
+                                   unsigned int* first) {
+  uint64_t n;
+
+  n = trace->next;
+  if (n > (uint64_t) trace->mask + 1)
+    n = (uint64_t) trace->mask + 1;
+
+  *first = (unsigned int) ((trace->next - n) & trace->mask);
+  return (unsigned int) n;
+}
+
+
+int uv_loop_trace_records(const uv_loop_t* loop,
+                          uv_trace_record_t* records,
+                          unsigned int* count) {
+  const struct uv__trace* trace;
+  unsigned int first;
+  unsigned int skip;
+  unsigned int n;
+  unsigned int i;
+
+  if (records == NULL || count == NULL)
+    return UV_EINVAL;
+
+  trace = uv__get_internal_fields(loop)->trace;
+  if (trace == NULL)
+    return UV_ENOSYS;
+
+  /* The most recent ones if they don't all fit. */
+  n = uv__trace_span(trace, &first);
+  skip = 0;
+  if (n > *count) {
+    skip = n - *count;
+    n = *count;
+  }
+
+  for (i = 0; i < n; i++)
+    records[i] = trace->records[(first + skip + i) & trace->mask];
+
+  *count = n;
+  return 0;
+}
+
+
+static int uv__trace_write(uv_loop_t* loop,
+                           uv_file file,
+                           const void* data,
+                           size_t len) {
+  uv_fs_t req;
+  uv_buf_t buf;
+  int r;
+
+  while (len > 0) {
+    buf = uv_buf_init((char*) data, (unsigned int) len);
+    r = uv_fs_write(loop, &req, file, &buf, 1, -1, NULL);
+    uv_fs_req_cleanup(&req);
+    if (r < 0)
+      return r;
+    if (r == 0)
+      return UV_EIO;
+
+    data = (const char*) data + r;
+    len -= r;
+  }
+
+  return 0;
+}
+
+
+int uv_loop_trace_dump(uv_loop_t* loop, uv_file file) {
+  const struct uv__trace* trace;
+  struct uv__trace_header header;
+  unsigned int first;
+  unsigned int tail;
+  unsigned int n;
+  int err;
+
+  trace = uv__get_internal_fields(loop)->trace;
+  if (trace == NULL)
+    return UV_ENOSYS;
+
+  n = uv__trace_span(trace, &first);
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, "UVTRACE", sizeof("UVTRACE"));
+  header.version = 1;
+  header.record_size = sizeof(uv_trace_record_t);
+  header.count = n;
+
+  /* Up to the end of the ring, then what wrapped around. */
+  tail = trace->mask + 1 - first;
+  if (tail > n)
+    tail = n;
+
+  err = uv__trace_write(loop, file, &header, sizeof(header));
+  if (err == 0)
+    err = uv__trace_write(loop,
+                          file,
+                          trace->records + first,
+                          tail * sizeof(trace->records[0]));
+  if (err == 0)
+    err = uv__trace_write(loop,
+                          file,
+                          trace->records,
+                          (n - tail) * sizeof(trace->records[0]));
+
+  return err;
+}
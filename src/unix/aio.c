@@ -57,6 +57,7 @@ int uv__aio_init(uv_loop_t* loop, uv__aio_t* w, uv__aio_cb aio_cb) {
   w->aio_ctx = 0;
   w->aio_cb = aio_cb;
   QUEUE_INIT(&w->iocb_pending_queue);
+  QUEUE_INIT(&w->iocb_done_queue);
 
   int err;
   err = uv__aio_start(w);
@@ -65,6 +66,40 @@ int uv__aio_init(uv_loop_t* loop, uv__aio_t* w, uv__aio_cb aio_cb) {
   return 0;
 }
 
+/**
+ * Completes the iocbs of |req| that the kernel refused to take. Filesystems
+ * without aio fsync support reject IOCB_CMD_FSYNC/FDSYNC with EINVAL, those
+ * go to the threadpool instead, a sync can take seconds. Otherwise the
+ * request is handed to the done queue and the callback is deferred to the
+ * next loop iteration, never run from within uv_fs_*() itself.
+ */
+static void uv__aio_fail_pending(uv__aio_t* w, uv_fs_t* req, int error) {
+  if (error == EINVAL &&
+      req->submitted_iocbs_count == 0 &&
+      (req->fs_type == UV_FS_FSYNC || req->fs_type == UV_FS_FDATASYNC)) {
+    QUEUE_REMOVE(&req->iocb_pending_queue);
+    uv__work_submit(w->loop,
+                    &req->work_req,
+                    UV__WORK_FAST_IO,
+                    req->work_req.work,
+                    req->work_req.done);
+    return;
+  }
+
+  req->result = UV__ERR(error);
+
+  req->done_iocbs_count += req->iocbs_count - req->submitted_iocbs_count;
+  req->submitted_iocbs_count = req->iocbs_count;
+  QUEUE_REMOVE(&req->iocb_pending_queue);
+
+  /* The submitted iocbs, if any, finish the request when they are reaped. */
+  if (req->done_iocbs_count < req->iocbs_count)
+    return;
+
+  QUEUE_INSERT_TAIL(&w->iocb_done_queue, &req->iocb_pending_queue);
+  uv__io_feed(w->loop, &w->aio_io_watcher);
+}
+
 void uv__aio_drain_pending_queue(uv__aio_t* w) {
   QUEUE* q;
   uv_fs_t* req;
@@ -83,16 +118,17 @@ void uv__aio_drain_pending_queue(uv__aio_t* w) {
       iocbs[i] = req->iocbs + i + req->submitted_iocbs_count;
     }
 
+    uv__count_syscall(w->loop, io_submit);
     int r = uv__io_submit(w->aio_ctx, pending_count, iocbs);
     uv__free(iocbs);
     if (r < 0 && errno == EAGAIN) {
       break;
     } else if (r < 0) {
-      assert(errno);
-      assert(r >= 0);
-      break;
+      uv__aio_fail_pending(w, req, errno);
+      continue;
     }
 
+    uv__trace(w->loop, UV_TRACE_AIO_SUBMIT, UV_UNKNOWN_HANDLE, req->file, r);
     req->submitted_iocbs_count += r;
     if (req->submitted_iocbs_count >= req->iocbs_count) {
       QUEUE_REMOVE(q);
@@ -102,20 +138,29 @@ void uv__aio_drain_pending_queue(uv__aio_t* w) {
 
 void uv__aio_submit(uv_loop_t* loop,
                     uv_fs_t* req,
+                    void (*work)(struct uv__work* w),
                     void (*done)(struct uv__work* w, int status)) {
   req->work_req.loop = loop;
+  req->work_req.work = work;
   req->work_req.done = done;
 
   unsigned int i;
+  unsigned int count;
 
   if (req->iocbs == NULL) {
-    req->iocbs = uv__calloc(req->nbufs, sizeof(struct iocb));
+    /* Sync requests carry no buffers and take a single control block. */
+    if (req->fs_type == UV_FS_FSYNC || req->fs_type == UV_FS_FDATASYNC)
+      count = 1;
+    else
+      count = req->nbufs;
+
+    req->iocbs = uv__calloc(count, sizeof(struct iocb));
     assert(req->iocbs);
 
     struct iocb* ctrl_blk = req->iocbs;
     off_t offset = req->off;
     if (offset < 0) offset = 0;
-    for (i = 0; i < req->nbufs; i++, ctrl_blk++) {
+    for (i = 0; i < count; i++, ctrl_blk++) {
       switch (req->fs_type) {
         case UV_FS_READ:
           ctrl_blk->aio_lio_opcode = IOCB_CMD_PREAD;
@@ -125,22 +170,33 @@ void uv__aio_submit(uv_loop_t* loop,
           ctrl_blk->aio_lio_opcode = IOCB_CMD_PWRITE;
           break;
 
+        case UV_FS_FSYNC:
+          ctrl_blk->aio_lio_opcode = IOCB_CMD_FSYNC;
+          break;
+
+        case UV_FS_FDATASYNC:
+          ctrl_blk->aio_lio_opcode = IOCB_CMD_FDSYNC;
+          break;
+
         default:
           UNREACHABLE();
           break;
       }
 
       ctrl_blk->aio_fildes = req->file;
-      ctrl_blk->aio_buf = (uint64_t)req->bufs[i].base;
-      ctrl_blk->aio_offset = offset;
-      ctrl_blk->aio_nbytes = req->bufs[i].len;
       ctrl_blk->aio_data = (uint64_t)req;
       ctrl_blk->aio_flags = IOCB_FLAG_RESFD;
       ctrl_blk->aio_resfd = loop->wq_aio.aio_io_watcher.fd;
-      offset += req->bufs[i].len;
+
+      if (req->bufs != NULL) {
+        ctrl_blk->aio_buf = (uint64_t)req->bufs[i].base;
+        ctrl_blk->aio_offset = offset;
+        ctrl_blk->aio_nbytes = req->bufs[i].len;
+        offset += req->bufs[i].len;
+      }
     }
 
-    req->iocbs_count = req->nbufs;
+    req->iocbs_count = count;
     req->submitted_iocbs_count = 0;
   }
 
@@ -152,25 +208,45 @@ void uv__aio_submit(uv_loop_t* loop,
 void uv__aio_work_done(uv__aio_t* w) {
   struct timespec tms = {0};
   int i, r;
+  QUEUE* q;
+  QUEUE done;
+
+  QUEUE_MOVE(&w->iocb_done_queue, &done);
+  while (!QUEUE_EMPTY(&done)) {
+    q = QUEUE_HEAD(&done);
+    QUEUE_REMOVE(q);
+    uv_fs_t* req = QUEUE_DATA(q, uv_fs_t, iocb_pending_queue);
+    if (req->work_req.done) {
+      req->work_req.done(&req->work_req, 0);
+    }
+  }
 
   long n = UV_AIO_NR_EVENTS;
   struct io_event* events = uv__calloc(n, sizeof(struct io_event));
   do {
+    uv__count_syscall(w->loop, io_getevents);
     r = uv__io_getevents(w->aio_ctx, 0, n, events, &tms);
 
     for (i = 0; i < r; i++) {
       uv_fs_t* req = (uv_fs_t*)events[i].data;
 
-      if (events[i].res >= 0 && req->result >= 0) {
+      /* The first error sticks, later completions must not mask it. */
+      if (events[i].res < 0) {
+        if (req->result >= 0)
+          req->result = events[i].res;
+      } else if (req->result >= 0) {
         req->result += events[i].res;
-      } else {
-        req->result = events[i].res;
       }
 
       req->done_iocbs_count++;
       if (req->done_iocbs_count < req->iocbs_count) {
         continue;
       }
+      uv__trace(req->loop,
+                UV_TRACE_AIO_COMPLETE,
+                UV_UNKNOWN_HANDLE,
+                req->file,
+                (int64_t) req->result);
       struct uv__work* w = &req->work_req;
       if (w->done) {
         w->done(w, 0);
@@ -191,6 +267,7 @@ static void uv__aio_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
   assert(w == &loop->wq_aio.aio_io_watcher);
 
   for (;;) {
+    uv__count_syscall(loop, eventfd_read);
     r = read(w->fd, buf, sizeof(buf));
     if (r > 0) n += r;
 
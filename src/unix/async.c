@@ -38,6 +38,7 @@
 #include <sys/eventfd.h>
 #endif
 
+static int uv__async_push(uv_loop_t* loop, uv_async_t* handle);
 static void uv__async_send(uv_loop_t* loop);
 static int uv__async_start(uv_loop_t* loop);
 
@@ -52,8 +53,8 @@ int uv_async_init(uv_loop_t* loop, uv_async_t* handle, uv_async_cb async_cb) {
   uv__handle_init(loop, (uv_handle_t*)handle, UV_ASYNC);
   handle->async_cb = async_cb;
   handle->pending = 0;
+  QUEUE_INIT(&handle->queue);
 
-  QUEUE_INSERT_TAIL(&loop->async_handles, &handle->queue);
   uv__handle_start(handle);
 
   return 0;
@@ -69,8 +70,11 @@ int uv_async_send(uv_async_t* handle) {
   if (cmpxchgi(&handle->pending, 0, 1) != 0)
     return 0;
 
-  /* Wake up the other thread's event loop. */
-  uv__async_send(handle->loop);
+  /* Wake up the other thread's event loop, unless other handles that are
+   * pending already did.
+   */
+  if (uv__async_push(handle->loop, handle))
+    uv__async_send(handle->loop);
 
   /* Tell the other thread we're done. */
   if (cmpxchgi(&handle->pending, 1, 2) != 1)
@@ -112,9 +116,53 @@ static int uv__async_spin(uv_async_t* handle) {
 }
 
 
+/* Pending handles are pushed onto a lock-free stack, the loop takes the
+ * whole stack with one exchange and only visits the handles on it. Returns
+ * non-zero if the stack was empty, only that push has to wake the loop.
+ * |handle->queue[0]| links the stack.
+ */
+static int uv__async_push(uv_loop_t* loop, uv_async_t* handle) {
+  uv__loop_internal_fields_t* lfields;
+  uv_async_t* head;
+
+  lfields = uv__get_internal_fields(loop);
+
+  do {
+    head = uv__atomic_load_ptr(&lfields->async_pending);
+    handle->queue[0] = head;
+  } while (!uv__atomic_cas(&lfields->async_pending, head, handle));
+
+  return head == NULL;
+}
+
+
+/* Only call this from the event loop thread. Moves the pending handles from
+ * the stack to the end of |loop->async_handles|, in the order they were sent.
+ */
+static void uv__async_take(uv_loop_t* loop) {
+  uv_async_t* h;
+  uv_async_t* next;
+  QUEUE* tail;
+
+  h = uv__atomic_exchange(&uv__get_internal_fields(loop)->async_pending, NULL);
+
+  /* The stack is LIFO, each handle goes in front of the one sent after it. */
+  tail = QUEUE_PREV(&loop->async_handles);
+  while (h != NULL) {
+    next = h->queue[0];
+    QUEUE_INSERT_HEAD(tail, &h->queue);
+    h = next;
+  }
+}
+
+
 void uv__async_close(uv_async_t* handle) {
-  uv__async_spin(handle);
-  QUEUE_REMOVE(&handle->queue);
+  /* A pending handle is on the stack or in |loop->async_handles|. */
+  if (uv__async_spin(handle) != 0) {
+    uv__async_take(handle->loop);
+    QUEUE_REMOVE(&handle->queue);
+  }
+
   uv__handle_stop(handle);
 }
 
@@ -129,6 +177,7 @@ static void uv__async_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
   assert(w == &loop->async_io_watcher);
 
   for (;;) {
+    uv__count_syscall(loop, eventfd_read);
     r = read(w->fd, buf, sizeof(buf));
 
     if (r == sizeof(buf))
@@ -146,16 +195,21 @@ static void uv__async_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
     abort();
   }
 
+  /* The stack is taken after the read. A handle that's sent later either
+   * makes it, or it wakes the loop again.
+   */
+  uv__async_take(loop);
+
   QUEUE_MOVE(&loop->async_handles, &queue);
   while (!QUEUE_EMPTY(&queue)) {
     q = QUEUE_HEAD(&queue);
     h = QUEUE_DATA(q, uv_async_t, queue);
 
     QUEUE_REMOVE(q);
-    QUEUE_INSERT_TAIL(&loop->async_handles, q);
+    QUEUE_INIT(q);
 
-    if (0 == uv__async_spin(h))
-      continue;  /* Not pending. */
+    /* Waits for the sender, the next uv_async_send() pushes it again. */
+    uv__async_spin(h);
 
     if (h->async_cb == NULL)
       continue;
@@ -184,9 +238,10 @@ static void uv__async_send(uv_loop_t* loop) {
   }
 #endif
 
-  do
+  do {
+    uv__count_syscall_atomic(loop, eventfd_write);
     r = write(fd, buf, len);
-  while (r == -1 && errno == EINTR);
+  } while (r == -1 && errno == EINTR);
 
   if (r == len)
     return;
@@ -228,12 +283,25 @@ static int uv__async_start(uv_loop_t* loop) {
 
 
 int uv__async_fork(uv_loop_t* loop) {
+  int err;
+
   if (loop->async_io_watcher.fd == -1) /* never started */
     return 0;
 
   uv__async_stop(loop);
 
-  return uv__async_start(loop);
+  err = uv__async_start(loop);
+  if (err)
+    return err;
+
+  /* Handles sent before the fork are still pending, their wakeup was for
+   * the old eventfd.
+   */
+  if (!QUEUE_EMPTY(&loop->async_handles) ||
+      uv__atomic_load_ptr(&uv__get_internal_fields(loop)->async_pending))
+    uv__async_send(loop);
+
+  return 0;
 }
 
 
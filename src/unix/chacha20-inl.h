@@ -0,0 +1,86 @@
+/* Copyright libuv contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* The ChaCha20 block function of RFC 8439, shared with the known-answer
+ * test in test/test-random.c.
+ */
+
+#ifndef UV_UNIX_CHACHA20_INL_H_
+#define UV_UNIX_CHACHA20_INL_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+#define QUARTERROUND(x, a, b, c, d)                                           \
+  do {                                                                        \
+    x[a] += x[b]; x[d] ^= x[a]; x[d] = ROTL32(x[d], 16);                      \
+    x[c] += x[d]; x[b] ^= x[c]; x[b] = ROTL32(x[b], 12);                      \
+    x[a] += x[b]; x[d] ^= x[a]; x[d] = ROTL32(x[d], 8);                       \
+    x[c] += x[d]; x[b] ^= x[c]; x[b] = ROTL32(x[b], 7);                       \
+  }                                                                           \
+  while (0)
+
+
+/* |key| and |nonce| are the little-endian words of the byte strings. */
+static void uv__chacha20_block(const uint32_t key[8],
+                               uint32_t counter,
+                               const uint32_t nonce[3],
+                               unsigned char out[64]) {
+  uint32_t input[16];
+  uint32_t x[16];
+  unsigned int i;
+
+  input[0] = 0x61707865;  /* "expand 32-byte k" */
+  input[1] = 0x3320646e;
+  input[2] = 0x79622d32;
+  input[3] = 0x6b206574;
+  for (i = 0; i < 8; i++)
+    input[4 + i] = key[i];
+  input[12] = counter;
+  input[13] = nonce[0];
+  input[14] = nonce[1];
+  input[15] = nonce[2];
+
+  memcpy(x, input, sizeof(x));
+
+  for (i = 0; i < 10; i++) {
+    QUARTERROUND(x, 0, 4, 8, 12);
+    QUARTERROUND(x, 1, 5, 9, 13);
+    QUARTERROUND(x, 2, 6, 10, 14);
+    QUARTERROUND(x, 3, 7, 11, 15);
+    QUARTERROUND(x, 0, 5, 10, 15);
+    QUARTERROUND(x, 1, 6, 11, 12);
+    QUARTERROUND(x, 2, 7, 8, 13);
+    QUARTERROUND(x, 3, 4, 9, 14);
+  }
+
+  for (i = 0; i < 16; i++) {
+    x[i] += input[i];
+    out[4 * i + 0] = (unsigned char) (x[i] >> 0);
+    out[4 * i + 1] = (unsigned char) (x[i] >> 8);
+    out[4 * i + 2] = (unsigned char) (x[i] >> 16);
+    out[4 * i + 3] = (unsigned char) (x[i] >> 24);
+  }
+}
+
+#endif  /* UV_UNIX_CHACHA20_INL_H_ */
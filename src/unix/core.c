@@ -166,6 +166,12 @@ void uv_close(uv_handle_t* handle, uv_close_cb close_cb) {
      * running. The poll code will call uv__make_close_pending() for us. */
     return;
 
+  case UV_FILE_WRITER:
+    uv__file_writer_close((uv_file_writer_t*)handle);
+    /* Buffered data is flushed and synced first, the writer calls
+     * uv__make_close_pending() once that is done. */
+    return;
+
   case UV_SIGNAL:
     uv__signal_close((uv_signal_t*) handle);
     break;
@@ -264,6 +270,7 @@ static void uv__finish_close(uv_handle_t* handle) {
     case UV_PROCESS:
     case UV_FS_EVENT:
     case UV_FS_POLL:
+    case UV_FILE_WRITER:
     case UV_POLL:
       break;
 
@@ -299,7 +306,18 @@ static void uv__finish_close(uv_handle_t* handle) {
   uv__handle_unref(handle);
   QUEUE_REMOVE(&handle->handle_queue);
 
+  uv__trace(handle->loop,
+            UV_TRACE_CLOSE,
+            handle->type,
+            -1,
+            (uintptr_t) handle);
+
   if (handle->close_cb) {
+    uv__loop_callback(handle->loop,
+                      handle->type,
+                      handle,
+                      handle->close_cb,
+                      -1);
     handle->close_cb(handle);
   }
 }
@@ -313,6 +331,18 @@ static void uv__run_closing_handles(uv_loop_t* loop) {
   loop->closing_handles = NULL;
 
   while (p) {
+    if (uv__run_budget_take(loop)) {
+      /* Out of budget, the rest goes back in front of the ones that the
+       * close callbacks added.
+       */
+      q = p;
+      while (q->next_closing != NULL)
+        q = q->next_closing;
+      q->next_closing = loop->closing_handles;
+      loop->closing_handles = p;
+      break;
+    }
+
     q = p->next_closing;
     uv__finish_close(p);
     p = q;
@@ -346,6 +376,9 @@ int uv_backend_timeout(const uv_loop_t* loop) {
   if (loop->closing_handles)
     return 0;
 
+  if (uv__get_internal_fields(loop)->run_budget == UV__RUN_BUDGET_SPENT)
+    return 0;
+
   return uv__next_timeout(loop);
 }
 
@@ -363,26 +396,43 @@ int uv_loop_alive(const uv_loop_t* loop) {
 
 
 int uv_run(uv_loop_t* loop, uv_run_mode mode) {
+  uint64_t phase;
   int timeout;
   int r;
   int ran_pending;
 
+  uv__run_budget_start(loop, mode);
+  uv__loop_idle(loop, 0);
+
   r = uv__loop_alive(loop);
   if (!r)
     uv__update_time(loop);
 
   while (r != 0 && loop->stop_flag == 0) {
+    phase = 0;
+    if (uv__get_internal_fields(loop)->flags & UV__METRICS_LOOP_PHASES)
+      phase = uv__metrics_loop_start(loop);
+
     uv__update_time(loop);
     uv__run_timers(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_TIMERS, phase);
     ran_pending = uv__run_pending(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_PENDING, phase);
     uv__run_idle(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_IDLE, phase);
     uv__run_prepare(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_PREPARE, phase);
 
     timeout = 0;
     if ((mode == UV_RUN_ONCE && !ran_pending) || mode == UV_RUN_DEFAULT)
       timeout = uv_backend_timeout(loop);
 
-    uv__io_poll(loop, timeout);
+    /* Out of budget, the I/O that's ready waits for the next call. */
+    if (mode != UV_RUN_BUDGET || !uv__run_budget_spent(loop)) {
+      uv__loop_idle(loop, 1);
+      uv__io_poll(loop, timeout);
+      uv__loop_idle(loop, 0);
+    }
 
     /* Run one final update on the provider_idle_time in case uv__io_poll
      * returned because the timeout expired, but no events were received. This
@@ -390,9 +440,12 @@ int uv_run(uv_loop_t* loop, uv_run_mode mode) {
      * the timeout == 0) or was already updated b/c an event was received.
      */
     uv__metrics_update_idle_time(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_POLL, phase);
 
     uv__run_check(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_CHECK, phase);
     uv__run_closing_handles(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_CLOSING, phase);
 
     if (mode == UV_RUN_ONCE) {
       /* UV_RUN_ONCE implies forward progress: at least one callback must have
@@ -405,10 +458,11 @@ int uv_run(uv_loop_t* loop, uv_run_mode mode) {
        */
       uv__update_time(loop);
       uv__run_timers(loop);
+      uv__metrics_phase(loop, UV_METRICS_PHASE_TIMERS, phase);
     }
 
     r = uv__loop_alive(loop);
-    if (mode == UV_RUN_ONCE || mode == UV_RUN_NOWAIT)
+    if (mode != UV_RUN_DEFAULT)
       break;
   }
 
@@ -418,6 +472,7 @@ int uv_run(uv_loop_t* loop, uv_run_mode mode) {
   if (loop->stop_flag != 0)
     loop->stop_flag = 0;
 
+  uv__loop_idle(loop, 1);
   return r;
 }
 
@@ -805,10 +860,18 @@ static int uv__run_pending(uv_loop_t* loop) {
   QUEUE_MOVE(&loop->pending_queue, &pq);
 
   while (!QUEUE_EMPTY(&pq)) {
+    if (uv__run_budget_take(loop)) {
+      /* Out of budget, the rest runs first on the next call. */
+      QUEUE_ADD(&pq, &loop->pending_queue);
+      QUEUE_MOVE(&pq, &loop->pending_queue);
+      break;
+    }
+
     q = QUEUE_HEAD(&pq);
     QUEUE_REMOVE(q);
     QUEUE_INIT(q);
     w = QUEUE_DATA(q, uv__io_t, pending_queue);
+    uv__loop_callback(loop, UV_UNKNOWN_HANDLE, NULL, w->cb, w->fd);
     w->cb(loop, w, POLLOUT);
   }
 
@@ -876,6 +939,12 @@ void uv__io_init(uv__io_t* w, uv__io_cb cb, int fd) {
   w->rcount = 0;
   w->wcount = 0;
 #endif /* defined(UV_HAVE_KQUEUE) */
+
+#if defined(__linux__)
+  QUEUE_INIT(&w->ready_queue);
+  w->ready = 0;
+  w->edge = 0;
+#endif /* defined(__linux__) */
 }
 
 
@@ -888,6 +957,13 @@ void uv__io_start(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
   w->pevents |= events;
   maybe_resize(loop, w->fd + 1);
 
+#if defined(__linux__)
+  if (w->edge != 0) {
+    uv__io_edge_start(loop, w);
+    return;
+  }
+#endif
+
 #if !defined(__sun)
   /* The event ports backend needs to rearm all file descriptors on each and
    * every tick of the event loop but the other backends allow us to
@@ -922,6 +998,12 @@ void uv__io_stop(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
 
   w->pevents &= ~events;
 
+#if defined(__linux__)
+  /* Edge-triggered watchers stay registered until uv__io_close(). */
+  if (w->edge != 0)
+    return;
+#endif
+
   if (w->pevents == 0) {
     QUEUE_REMOVE(&w->watcher_queue);
     QUEUE_INIT(&w->watcher_queue);
@@ -943,6 +1025,11 @@ void uv__io_close(uv_loop_t* loop, uv__io_t* w) {
   uv__io_stop(loop, w, POLLIN | POLLOUT | UV__POLLRDHUP | UV__POLLPRI);
   QUEUE_REMOVE(&w->pending_queue);
 
+#if defined(__linux__)
+  if (w->edge != 0)
+    uv__io_edge_close(loop, w);
+#endif
+
   /* Remove stale events for this file descriptor */
   if (w->fd != -1)
     uv__platform_invalidate_fd(loop, w->fd);
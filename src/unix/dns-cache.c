@@ -0,0 +1,451 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* A process-wide cache of uv_getaddrinfo() results, keyed by host name,
+ * service and hints. Entries are kept in a hash table and, for eviction, in
+ * least recently used order.
+ */
+
+#include "uv.h"
+#include "internal.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <netdb.h>
+
+#define DNS_CACHE_MIN_BUCKETS 16
+
+struct uv__dns_cache_entry {
+  void* lru[2];
+  struct uv__dns_cache_entry* next;  /* In the same bucket. */
+  uint64_t expires;  /* Milliseconds, uv_hrtime() based. */
+  unsigned int hash;
+  int status;  /* 0 or UV_EAI_NONAME. */
+  int refreshing;
+  struct addrinfo* ai;
+  char key[1];
+};
+
+/* A hit for an asynchronous request, delivered from the pending phase of the
+ * next loop iteration.
+ */
+struct uv__dns_cache_hit {
+  uv__io_t io;
+  uv_getaddrinfo_t* req;
+};
+
+static uv_once_t cache_once = UV_ONCE_INIT;
+static uv_mutex_t cache_mutex;
+static uv_dns_cache_options_t cache_options;
+static struct uv__dns_cache_entry** cache_buckets;
+static unsigned int cache_nbuckets;
+static void* cache_lru[2];
+static uv_dns_cache_metrics_t cache_metrics;
+
+
+static void uv__dns_cache_init(void) {
+  if (uv_mutex_init(&cache_mutex))
+    abort();
+
+  QUEUE_INIT(&cache_lru);
+}
+
+
+static uint64_t uv__dns_cache_now(void) {
+  return uv_hrtime() / 1000000;
+}
+
+
+/* Writes the key for |req| to |key|. Returns its length, 0 when the request
+ * is not cacheable.
+ */
+static size_t uv__dns_cache_key(const uv_getaddrinfo_t* req,
+                                char* key,
+                                size_t size) {
+  const struct addrinfo* hints;
+  size_t len;
+  int n;
+
+  if (req->hostname == NULL)
+    return 0;
+
+  /* NULL hints and zeroed hints don't mean the same to getaddrinfo(). */
+  hints = req->hints;
+  if (hints != NULL)
+    n = snprintf(key, size, "%d %d %d %d|%s|",
+                 hints->ai_flags,
+                 hints->ai_family,
+                 hints->ai_socktype,
+                 hints->ai_protocol,
+                 req->service ? req->service : "");
+  else
+    n = snprintf(key, size, "|%s|", req->service ? req->service : "");
+
+  if (n < 0 || (size_t) n >= size)
+    return 0;
+
+  len = n;
+  if (len + strlen(req->hostname) >= size)
+    return 0;
+
+  while (req->hostname[len - n] != '\0') {
+    key[len] = tolower((unsigned char) req->hostname[len - n]);
+    len++;
+  }
+  key[len] = '\0';
+
+  return len;
+}
+
+
+static unsigned int uv__dns_cache_hash(const char* key) {
+  unsigned int h;
+
+  /* FNV-1a. */
+  h = 2166136261u;
+  while (*key != '\0')
+    h = (h ^ (unsigned char) *key++) * 16777619u;
+
+  return h;
+}
+
+
+/* Must be called with cache_mutex held. */
+static struct uv__dns_cache_entry* uv__dns_cache_find(const char* key,
+                                                      unsigned int hash) {
+  struct uv__dns_cache_entry* e;
+
+  if (cache_nbuckets == 0)
+    return NULL;
+
+  for (e = cache_buckets[hash & (cache_nbuckets - 1)]; e != NULL; e = e->next)
+    if (e->hash == hash && strcmp(e->key, key) == 0)
+      return e;
+
+  return NULL;
+}
+
+
+/* Must be called with cache_mutex held. */
+static void uv__dns_cache_remove(struct uv__dns_cache_entry* e) {
+  struct uv__dns_cache_entry** p;
+
+  p = &cache_buckets[e->hash & (cache_nbuckets - 1)];
+  while (*p != e)
+    p = &(*p)->next;
+  *p = e->next;
+
+  QUEUE_REMOVE(&e->lru);
+  cache_metrics.entries--;
+
+  uv_freeaddrinfo(e->ai);
+  uv__free(e);
+}
+
+
+/* Must be called with cache_mutex held. */
+static void uv__dns_cache_clear(void) {
+  QUEUE* q;
+
+  while (!QUEUE_EMPTY(&cache_lru)) {
+    q = QUEUE_HEAD(&cache_lru);
+    uv__dns_cache_remove(QUEUE_DATA(q, struct uv__dns_cache_entry, lru));
+  }
+}
+
+
+int uv_dns_cache_configure(const uv_dns_cache_options_t* options) {
+  struct uv__dns_cache_entry** buckets;
+  unsigned int nbuckets;
+
+  nbuckets = 0;
+  buckets = NULL;
+
+  if (options != NULL && options->max_entries > 0) {
+    if (options->max_entries > (1u << 24))
+      return UV_EINVAL;
+
+    nbuckets = DNS_CACHE_MIN_BUCKETS;
+    while (nbuckets < options->max_entries)
+      nbuckets *= 2;
+
+    buckets = uv__calloc(nbuckets, sizeof(*buckets));
+    if (buckets == NULL)
+      return UV_ENOMEM;
+  }
+
+  uv_once(&cache_once, uv__dns_cache_init);
+  uv_mutex_lock(&cache_mutex);
+
+  uv__dns_cache_clear();
+  uv__free(cache_buckets);
+  cache_buckets = buckets;
+  cache_nbuckets = nbuckets;
+
+  if (buckets != NULL)
+    cache_options = *options;
+  else
+    memset(&cache_options, 0, sizeof(cache_options));
+
+  uv_mutex_unlock(&cache_mutex);
+
+  return 0;
+}
+
+
+void uv_dns_cache_flush(void) {
+  uv_once(&cache_once, uv__dns_cache_init);
+  uv_mutex_lock(&cache_mutex);
+  uv__dns_cache_clear();
+  uv_mutex_unlock(&cache_mutex);
+}
+
+
+void uv_dns_cache_metrics(uv_dns_cache_metrics_t* metrics) {
+  uv_once(&cache_once, uv__dns_cache_init);
+  uv_mutex_lock(&cache_mutex);
+  *metrics = cache_metrics;
+  uv_mutex_unlock(&cache_mutex);
+}
+
+
+void uv__dns_cache_store(const uv_getaddrinfo_t* req,
+                         int status,
+                         const struct addrinfo* ai,
+                         uint64_t ttl) {
+  struct uv__dns_cache_entry* e;
+  struct addrinfo* copy;
+  char key[512];
+  unsigned int hash;
+  size_t len;
+
+  /* Temporary failures are not remembered. */
+  if (status != 0 && status != UV_EAI_NONAME)
+    return;
+
+  if (uv__load_relaxed(&cache_nbuckets) == 0)
+    return;
+
+  len = uv__dns_cache_key(req, key, sizeof(key));
+  if (len == 0)
+    return;
+
+  copy = NULL;
+  if (status == 0 && uv__dns_addrinfo_copy(ai, &copy))
+    return;
+
+  hash = uv__dns_cache_hash(key);
+
+  uv_mutex_lock(&cache_mutex);
+
+  if (status != 0)
+    ttl = cache_options.negative_ttl;
+  else if (ttl > cache_options.ttl)
+    ttl = cache_options.ttl;
+
+  e = uv__dns_cache_find(key, hash);
+  if (e != NULL)
+    uv__dns_cache_remove(e);
+
+  e = NULL;
+  if (ttl > 0 && cache_nbuckets > 0)
+    e = uv__malloc(sizeof(*e) + len);
+
+  if (e == NULL) {
+    uv_mutex_unlock(&cache_mutex);
+    uv_freeaddrinfo(copy);
+    return;
+  }
+
+  memcpy(e->key, key, len + 1);
+  e->hash = hash;
+  e->expires = uv__dns_cache_now() + ttl;
+  e->status = status;
+  e->refreshing = 0;
+  e->ai = copy;
+
+  e->next = cache_buckets[hash & (cache_nbuckets - 1)];
+  cache_buckets[hash & (cache_nbuckets - 1)] = e;
+  QUEUE_INSERT_TAIL(&cache_lru, &e->lru);
+  cache_metrics.entries++;
+
+  if (cache_metrics.entries > cache_options.max_entries) {
+    uv__dns_cache_remove(QUEUE_DATA(QUEUE_HEAD(&cache_lru),
+                                    struct uv__dns_cache_entry,
+                                    lru));
+    cache_metrics.evictions++;
+  }
+
+  uv_mutex_unlock(&cache_mutex);
+}
+
+
+/* Lets the next stale hit on the entry for |req| start a refresh. */
+static void uv__dns_cache_refresh_end(const uv_getaddrinfo_t* req) {
+  struct uv__dns_cache_entry* e;
+  char key[512];
+
+  if (uv__dns_cache_key(req, key, sizeof(key)) == 0)
+    return;
+
+  uv_mutex_lock(&cache_mutex);
+  e = uv__dns_cache_find(key, uv__dns_cache_hash(key));
+  if (e != NULL)
+    e->refreshing = 0;
+  uv_mutex_unlock(&cache_mutex);
+}
+
+
+static void uv__dns_cache_refresh_cb(uv_getaddrinfo_t* req,
+                                     int status,
+                                     struct addrinfo* res) {
+  /* The answer has been stored already, unless there was none. In that case
+   * the stale entry stays until it runs out, maybe the next refresh works.
+   */
+  uv__dns_cache_refresh_end(req);
+  uv_freeaddrinfo(res);
+  uv__free(req);
+}
+
+
+static int uv__dns_cache_refresh(uv_loop_t* loop,
+                                 const uv_getaddrinfo_t* stale) {
+  uv_getaddrinfo_t* req;
+  int err;
+
+  req = uv__malloc(sizeof(*req));
+  if (req == NULL)
+    return UV_ENOMEM;
+
+  err = uv_getaddrinfo(loop,
+                       req,
+                       uv__dns_cache_refresh_cb,
+                       stale->hostname,
+                       stale->service,
+                       stale->hints);
+  if (err)
+    uv__free(req);
+
+  return err;
+}
+
+
+static void uv__dns_cache_hit_cb(uv_loop_t* loop, uv__io_t* w, unsigned int e) {
+  struct uv__dns_cache_hit* hit;
+  uv_getaddrinfo_t* req;
+
+  hit = container_of(w, struct uv__dns_cache_hit, io);
+  req = hit->req;
+  uv__free(hit);
+
+  uv__getaddrinfo_done(&req->work_req, 0);
+}
+
+
+int uv__dns_cache_lookup(uv_loop_t* loop, uv_getaddrinfo_t* req) {
+  struct uv__dns_cache_entry* e;
+  struct uv__dns_cache_hit* hit;
+  struct addrinfo* copy;
+  char key[512];
+  uint64_t now;
+  int refresh;
+  int err;
+
+  if (uv__load_relaxed(&cache_nbuckets) == 0)
+    return UV_ENOSYS;
+
+  /* Refreshes have to get past the entry they are refreshing. */
+  if (req->cb == uv__dns_cache_refresh_cb)
+    return UV_ENOSYS;
+
+  if (uv__dns_cache_key(req, key, sizeof(key)) == 0)
+    return UV_ENOSYS;
+
+  hit = NULL;
+  if (req->cb != NULL) {
+    hit = uv__malloc(sizeof(*hit));
+    if (hit == NULL)
+      return UV_ENOMEM;
+  }
+
+  now = uv__dns_cache_now();
+  refresh = 0;
+  copy = NULL;
+
+  uv_mutex_lock(&cache_mutex);
+
+  e = uv__dns_cache_find(key, uv__dns_cache_hash(key));
+  err = UV_ENOSYS;
+
+  if (e == NULL || (e->status != 0 && now >= e->expires)) {
+    /* Nothing, or an expired negative answer. */
+  } else if (now < e->expires) {
+    err = e->status;
+    if (err == 0)
+      err = uv__dns_addrinfo_copy(e->ai, &copy);
+    if (err == 0)
+      cache_metrics.hits++;
+    else if (err == UV_EAI_NONAME)
+      cache_metrics.negative_hits++;
+  } else if (req->cb != NULL && now - e->expires < cache_options.stale_ttl) {
+    /* Answer with the stale entry while a fresh one is looked up. Callers
+     * that wait for the answer might as well wait for a fresh one.
+     */
+    err = uv__dns_addrinfo_copy(e->ai, &copy);
+    if (err == 0) {
+      cache_metrics.stale_hits++;
+      refresh = !e->refreshing;
+      e->refreshing = 1;
+    }
+  }
+
+  if (err == 0 || err == UV_EAI_NONAME) {
+    QUEUE_REMOVE(&e->lru);
+    QUEUE_INSERT_TAIL(&cache_lru, &e->lru);
+  } else {
+    cache_metrics.misses++;
+  }
+
+  uv_mutex_unlock(&cache_mutex);
+
+  if (err != 0 && err != UV_EAI_NONAME) {
+    uv__free(hit);
+    return UV_ENOSYS;
+  }
+
+  req->addrinfo = copy;
+  req->retcode = err;
+
+  /* Without a refresh in flight the entry would never be refreshed. */
+  if (refresh && uv__dns_cache_refresh(loop, req))
+    uv__dns_cache_refresh_end(req);
+
+  if (hit != NULL) {
+    uv__io_init(&hit->io, uv__dns_cache_hit_cb, -1);
+    hit->req = req;
+    uv__io_feed(loop, &hit->io);
+  }
+
+  return 0;
+}
@@ -0,0 +1,1725 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* A DNS stub resolver that runs on the event loop. Names are looked up in the
+ * hosts file first and then sent as A and AAAA queries to the name servers
+ * from resolv.conf, over UDP and over TCP when the answer is truncated.
+ * Addresses are turned back into names the same way, with PTR queries.
+ */
+
+#include "uv.h"
+#include "internal.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>  /* strcasecmp() */
+
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <netdb.h>
+
+#define DNS_PORT        53
+#define DNS_MAX_SERVERS 3
+#define DNS_MAX_SEARCH  6
+#define DNS_MAX_NAME    255
+#define DNS_MAX_ADDRS   32
+#define DNS_UDP_SIZE    512
+#define DNS_HEADER_SIZE 12
+
+#define DNS_TYPE_A      1
+#define DNS_TYPE_PTR    12
+#define DNS_TYPE_AAAA   28
+#define DNS_CLASS_IN    1
+
+#define DNS_FLAG_QR     0x8000
+#define DNS_FLAG_TC     0x0200
+#define DNS_FLAG_RD     0x0100
+
+#define DNS_RCODE_NOERROR  0
+#define DNS_RCODE_NXDOMAIN 3
+
+/* Outcome of a single lookup. */
+enum {
+  DNS_PENDING,
+  DNS_FOUND,
+  DNS_NODATA,
+  DNS_NXDOMAIN,
+  DNS_FAILED
+};
+
+struct uv__dns_host {
+  char* name;
+  int family;
+  unsigned char addr[16];
+};
+
+struct uv__dns_service {
+  char* name;
+  uint16_t port;
+  int udp;
+};
+
+struct uv__dns {
+  struct sockaddr_storage servers[DNS_MAX_SERVERS];
+  unsigned int nservers;
+  char* search[DNS_MAX_SEARCH];
+  unsigned int nsearch;
+  unsigned int ndots;
+  unsigned int timeout;  /* Milliseconds. */
+  unsigned int attempts;
+  struct uv__dns_host* hosts;
+  unsigned int nhosts;
+  struct uv__dns_service* services;
+  unsigned int nservices;
+};
+
+struct uv__dns_query;
+struct uv__dns_transport;
+
+/* The A or AAAA half of a query, or its PTR lookup. */
+struct uv__dns_lookup {
+  struct uv__dns_query* query;
+  struct uv__dns_transport* transport;
+  uint16_t type;
+  uint16_t id;
+  unsigned int tries;
+  int state;
+  unsigned char packet[2 + DNS_HEADER_SIZE + DNS_MAX_NAME + 2 + 4];
+  size_t packet_len;  /* Without the TCP length prefix. */
+  unsigned char addrs[DNS_MAX_ADDRS][16];
+  unsigned int naddrs;
+  uint32_t ttl;  /* Seconds, the lowest of the answer records. */
+  char canonname[DNS_MAX_NAME + 1];  /* Or the name a PTR record points to. */
+};
+
+/* One attempt at getting an answer from a name server. Closing the handles
+ * takes a loop iteration, so the transport is detached from its lookup and
+ * freed on its own.
+ */
+struct uv__dns_transport {
+  struct uv__dns_lookup* lookup;
+  union {
+    uv_udp_t udp;
+    uv_tcp_t tcp;
+  } handle;
+  uv_timer_t timer;
+  uv_udp_send_t send_req;
+  uv_connect_t connect_req;
+  uv_write_t write_req;
+  int use_tcp;
+  unsigned int handles;
+  unsigned char* buf;
+  size_t len;
+  size_t size;
+};
+
+/* A uv_getaddrinfo() or uv_getnameinfo() request. */
+struct uv__dns_query {
+  uv_req_t* req;
+  uv_loop_t* loop;
+  struct uv__dns* dns;  /* NULL for numeric uv_getnameinfo() requests. */
+  uv_timer_t timer;  /* Delivers results that are known right away. */
+  char name[DNS_MAX_NAME + 1];
+  unsigned int candidate;
+  unsigned int nlookups;
+  struct uv__dns_lookup lookups[2];
+  uint16_t port;
+  int status;
+  int starting;
+  int done;
+};
+
+/* Every address list handed out is one block made here, results from the
+ * libc are copied. uv_freeaddrinfo() releases it with a single free.
+ */
+struct uv__dns_entry {
+  struct sockaddr_storage addr;
+  struct addrinfo ai;
+};
+
+struct uv__dns_result {
+  struct uv__dns_entry entries[1];
+};
+
+static void uv__dns_lookup_start(struct uv__dns_lookup* lookup);
+static void uv__dns_query_next(struct uv__dns_query* query);
+
+
+static void uv__dns_free_config(struct uv__dns* dns) {
+  unsigned int i;
+
+  for (i = 0; i < dns->nsearch; i++)
+    uv__free(dns->search[i]);
+
+  for (i = 0; i < dns->nhosts; i++)
+    uv__free(dns->hosts[i].name);
+
+  for (i = 0; i < dns->nservices; i++)
+    uv__free(dns->services[i].name);
+
+  uv__free(dns->hosts);
+  uv__free(dns->services);
+  uv__free(dns);
+}
+
+
+static int uv__dns_parse_server(const char* s, struct sockaddr_storage* addr) {
+  char host[INET6_ADDRSTRLEN + IF_NAMESIZE + 2];
+  const char* end;
+  const char* colon;
+  unsigned long port;
+  size_t len;
+
+  /* Plain addresses are what resolv.conf has. "1.2.3.4:53" and "[::1]:53"
+   * are accepted too, for servers that don't listen on the DNS port.
+   */
+  port = DNS_PORT;
+  len = strlen(s);
+
+  if (s[0] == '[') {
+    end = strchr(s, ']');
+    if (end == NULL || end[1] != ':')
+      return UV_EINVAL;
+    len = end - (s + 1);
+    s++;
+    colon = end + 1;
+  } else {
+    colon = strchr(s, ':');
+    if (colon != NULL && strchr(colon + 1, ':') != NULL)
+      colon = NULL;  /* IPv6 without a port. */
+    else if (colon != NULL)
+      len = colon - s;
+  }
+
+  if (colon != NULL) {
+    port = strtoul(colon + 1, NULL, 10);
+    if (port == 0 || port > 65535)
+      return UV_EINVAL;
+  }
+
+  if (len >= sizeof(host))
+    return UV_EINVAL;
+
+  memcpy(host, s, len);
+  host[len] = '\0';
+
+  if (uv_ip4_addr(host, port, (struct sockaddr_in*) addr) == 0)
+    return 0;
+
+  return uv_ip6_addr(host, port, (struct sockaddr_in6*) addr);
+}
+
+
+static int uv__dns_add_search(struct uv__dns* dns, const char* domain) {
+  size_t len;
+
+  len = strlen(domain);
+  while (len > 0 && domain[len - 1] == '.')
+    len--;
+
+  if (len == 0 || len >= DNS_MAX_NAME || dns->nsearch == DNS_MAX_SEARCH)
+    return 0;
+
+  dns->search[dns->nsearch] = uv__strndup(domain, len);
+  if (dns->search[dns->nsearch] == NULL)
+    return UV_ENOMEM;
+
+  dns->nsearch++;
+  return 0;
+}
+
+
+static void uv__dns_parse_option(struct uv__dns* dns, const char* option) {
+  unsigned long val;
+
+  if (strncmp(option, "ndots:", 6) == 0) {
+    val = strtoul(option + 6, NULL, 10);
+    dns->ndots = val > 15 ? 15 : val;
+  } else if (strncmp(option, "timeout:", 8) == 0) {
+    val = strtoul(option + 8, NULL, 10);
+    if (val > 30)
+      val = 30;
+    if (val > 0)
+      dns->timeout = val * 1000;
+  } else if (strncmp(option, "attempts:", 9) == 0) {
+    val = strtoul(option + 9, NULL, 10);
+    if (val > 5)
+      val = 5;
+    if (val > 0)
+      dns->attempts = val;
+  }
+}
+
+
+static int uv__dns_read_resolv_conf(struct uv__dns* dns, const char* path) {
+  char line[1024];
+  char* saveptr;
+  char* keyword;
+  char* arg;
+  FILE* fp;
+  int err;
+
+  /* A missing resolv.conf means the defaults, like for the libc. */
+  fp = uv__open_file(path);
+  if (fp == NULL)
+    return errno == ENOENT ? 0 : UV__ERR(errno);
+
+  err = 0;
+  while (err == 0 && fgets(line, sizeof(line), fp) != NULL) {
+    line[strcspn(line, "#;\n")] = '\0';
+
+    keyword = strtok_r(line, " \t", &saveptr);
+    if (keyword == NULL)
+      continue;
+
+    if (strcmp(keyword, "nameserver") == 0) {
+      arg = strtok_r(NULL, " \t", &saveptr);
+      if (arg != NULL && dns->nservers < DNS_MAX_SERVERS)
+        if (uv__dns_parse_server(arg, &dns->servers[dns->nservers]) == 0)
+          dns->nservers++;
+    } else if (strcmp(keyword, "search") == 0 ||
+               strcmp(keyword, "domain") == 0) {
+      /* The last of the two wins. */
+      while (dns->nsearch > 0)
+        uv__free(dns->search[--dns->nsearch]);
+      while (err == 0 && (arg = strtok_r(NULL, " \t", &saveptr)) != NULL)
+        err = uv__dns_add_search(dns, arg);
+    } else if (strcmp(keyword, "options") == 0) {
+      while ((arg = strtok_r(NULL, " \t", &saveptr)) != NULL)
+        uv__dns_parse_option(dns, arg);
+    }
+  }
+
+  fclose(fp);
+  return err;
+}
+
+
+static int uv__dns_read_hosts(struct uv__dns* dns, const char* path) {
+  struct uv__dns_host* hosts;
+  struct uv__dns_host host;
+  unsigned int size;
+  char line[1024];
+  char* saveptr;
+  char* name;
+  char* addr;
+  FILE* fp;
+
+  fp = uv__open_file(path);
+  if (fp == NULL)
+    return errno == ENOENT ? 0 : UV__ERR(errno);
+
+  size = 0;
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    line[strcspn(line, "#\n")] = '\0';
+
+    addr = strtok_r(line, " \t", &saveptr);
+    if (addr == NULL)
+      continue;
+
+    host.family = AF_INET;
+    if (inet_pton(AF_INET, addr, host.addr) != 1) {
+      host.family = AF_INET6;
+      if (inet_pton(AF_INET6, addr, host.addr) != 1)
+        continue;
+    }
+
+    while ((name = strtok_r(NULL, " \t", &saveptr)) != NULL) {
+      if (dns->nhosts == size) {
+        size = size ? size * 2 : 16;
+        /* The array stays as is on failure, uv__dns_free_config() frees
+         * the names in it.
+         */
+        hosts = uv__realloc(dns->hosts, size * sizeof(*hosts));
+        if (hosts == NULL) {
+          fclose(fp);
+          return UV_ENOMEM;
+        }
+        dns->hosts = hosts;
+      }
+
+      host.name = uv__strdup(name);
+      if (host.name == NULL) {
+        fclose(fp);
+        return UV_ENOMEM;
+      }
+
+      dns->hosts[dns->nhosts++] = host;
+    }
+  }
+
+  fclose(fp);
+  return 0;
+}
+
+
+/* Only the port numbers uv_getnameinfo() needs a name for are kept. */
+static int uv__dns_read_services(struct uv__dns* dns, const char* path) {
+  struct uv__dns_service* services;
+  struct uv__dns_service service;
+  unsigned long port;
+  unsigned int size;
+  char line[1024];
+  char* saveptr;
+  char* name;
+  char* proto;
+  char* end;
+  FILE* fp;
+
+  fp = uv__open_file(path);
+  if (fp == NULL)
+    return errno == ENOENT ? 0 : UV__ERR(errno);
+
+  size = 0;
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    line[strcspn(line, "#\n")] = '\0';
+
+    name = strtok_r(line, " \t", &saveptr);
+    proto = strtok_r(NULL, " \t", &saveptr);
+    if (name == NULL || proto == NULL)
+      continue;
+
+    port = strtoul(proto, &end, 10);
+    if (end == proto || *end != '/' || port > 65535)
+      continue;
+
+    service.port = port;
+    if (strcmp(end + 1, "tcp") == 0)
+      service.udp = 0;
+    else if (strcmp(end + 1, "udp") == 0)
+      service.udp = 1;
+    else
+      continue;
+
+    if (dns->nservices == size) {
+      size = size ? size * 2 : 64;
+      services = uv__realloc(dns->services, size * sizeof(*services));
+      if (services == NULL) {
+        fclose(fp);
+        return UV_ENOMEM;
+      }
+      dns->services = services;
+    }
+
+    service.name = uv__strdup(name);
+    if (service.name == NULL) {
+      fclose(fp);
+      return UV_ENOMEM;
+    }
+
+    dns->services[dns->nservices++] = service;
+  }
+
+  fclose(fp);
+  return 0;
+}
+
+
+int uv__dns_configure(uv_loop_t* loop,
+                      const char* resolv_conf,
+                      const char* hosts) {
+  uv__loop_internal_fields_t* lfields;
+  struct uv__dns* dns;
+  int err;
+
+  lfields = uv__get_internal_fields(loop);
+  if (lfields->dns != NULL)
+    return UV_EBUSY;
+
+  dns = uv__calloc(1, sizeof(*dns));
+  if (dns == NULL)
+    return UV_ENOMEM;
+
+  dns->ndots = 1;
+  dns->timeout = 5000;
+  dns->attempts = 2;
+
+  if (resolv_conf == NULL)
+    resolv_conf = "/etc/resolv.conf";
+
+  if (hosts == NULL)
+    hosts = "/etc/hosts";
+
+  err = uv__dns_read_resolv_conf(dns, resolv_conf);
+  if (err == 0)
+    err = uv__dns_read_hosts(dns, hosts);
+  if (err == 0)
+    err = uv__dns_read_services(dns, "/etc/services");
+
+  if (err) {
+    uv__dns_free_config(dns);
+    return err;
+  }
+
+  if (dns->nservers == 0) {
+    uv_ip4_addr("127.0.0.1",
+                DNS_PORT,
+                (struct sockaddr_in*) &dns->servers[dns->nservers++]);
+  }
+
+  lfields->dns = dns;
+  return 0;
+}
+
+
+void uv__dns_loop_close(uv_loop_t* loop) {
+  uv__loop_internal_fields_t* lfields;
+
+  lfields = uv__get_internal_fields(loop);
+  if (lfields->dns == NULL)
+    return;
+
+  uv__dns_free_config(lfields->dns);
+  lfields->dns = NULL;
+}
+
+
+static size_t uv__dns_build_query(unsigned char* buf,
+                                  uint16_t id,
+                                  uint16_t type,
+                                  const char* name) {
+  const char* label;
+  size_t len;
+  size_t n;
+
+  buf[0] = id >> 8;
+  buf[1] = id & 255;
+  buf[2] = DNS_FLAG_RD >> 8;
+  buf[3] = 0;
+  buf[4] = 0;
+  buf[5] = 1;  /* One question. */
+  memset(buf + 6, 0, 6);
+  len = DNS_HEADER_SIZE;
+
+  for (label = name; *label != '\0'; label += n + (label[n] == '.')) {
+    n = strcspn(label, ".");
+    buf[len++] = n;
+    memcpy(buf + len, label, n);
+    len += n;
+  }
+
+  buf[len++] = 0;
+  buf[len++] = type >> 8;
+  buf[len++] = type & 255;
+  buf[len++] = 0;
+  buf[len++] = DNS_CLASS_IN;
+
+  return len;
+}
+
+
+/* Returns the offset just past the name at |off|, or 0 when it's malformed. */
+static size_t uv__dns_skip_name(const unsigned char* p,
+                                size_t len,
+                                size_t off) {
+  while (off < len) {
+    if (p[off] == 0)
+      return off + 1;
+    if ((p[off] & 0xC0) == 0xC0)
+      return off + 2 <= len ? off + 2 : 0;
+    if (p[off] & 0xC0)
+      return 0;
+    off += 1 + p[off];
+  }
+
+  return 0;
+}
+
+
+static int uv__dns_read_name(const unsigned char* p,
+                             size_t len,
+                             size_t off,
+                             char* name) {
+  unsigned int jumps;
+  size_t n;
+  size_t out;
+
+  out = 0;
+  for (jumps = 0; jumps < 32 && off < len; ) {
+    if (p[off] == 0) {
+      name[out > 0 ? out - 1 : 0] = '\0';
+      return 0;
+    }
+
+    if ((p[off] & 0xC0) == 0xC0) {
+      if (off + 1 >= len)
+        return UV_EINVAL;
+      off = ((p[off] & 0x3F) << 8) | p[off + 1];
+      jumps++;
+      continue;
+    }
+
+    n = p[off];
+    if ((n & 0xC0) || off + 1 + n > len || out + n + 1 > DNS_MAX_NAME)
+      return UV_EINVAL;
+
+    memcpy(name + out, p + off + 1, n);
+    out += n;
+    name[out++] = '.';
+    off += 1 + n;
+  }
+
+  return UV_EINVAL;
+}
+
+
+/* Returns UV_EAGAIN when the answer was truncated and UV_EINVAL when it's not
+ * an answer to |lookup|, which is then left alone.
+ */
+static int uv__dns_parse_answer(struct uv__dns_lookup* lookup,
+                                const unsigned char* p,
+                                size_t len) {
+  unsigned int flags;
+  unsigned int rcode;
+  unsigned int qdcount;
+  unsigned int ancount;
+  unsigned int type;
+  unsigned int rdlen;
+  uint32_t ttl;
+  size_t owner;
+  size_t off;
+
+  if (len < DNS_HEADER_SIZE)
+    return UV_EINVAL;
+
+  if (((p[0] << 8) | p[1]) != lookup->id)
+    return UV_EINVAL;
+
+  flags = (p[2] << 8) | p[3];
+  if (!(flags & DNS_FLAG_QR))
+    return UV_EINVAL;
+
+  if (flags & DNS_FLAG_TC)
+    return UV_EAGAIN;
+
+  qdcount = (p[4] << 8) | p[5];
+  ancount = (p[6] << 8) | p[7];
+  rcode = flags & 15;
+
+  if (rcode == DNS_RCODE_NXDOMAIN) {
+    lookup->state = DNS_NXDOMAIN;
+    return 0;
+  }
+
+  /* Server failures and refusals are worth a try at the next server. */
+  if (rcode != DNS_RCODE_NOERROR) {
+    lookup->state = DNS_FAILED;
+    return 0;
+  }
+
+  off = DNS_HEADER_SIZE;
+  while (qdcount-- > 0) {
+    off = uv__dns_skip_name(p, len, off);
+    if (off == 0 || off + 4 > len)
+      return UV_EINVAL;
+    off += 4;
+  }
+
+  lookup->naddrs = 0;
+  lookup->ttl = (uint32_t) -1;
+  while (ancount-- > 0 && lookup->naddrs < DNS_MAX_ADDRS) {
+    owner = off;
+    off = uv__dns_skip_name(p, len, off);
+    if (off == 0 || off + 10 > len)
+      return UV_EINVAL;
+
+    type = (p[off] << 8) | p[off + 1];
+    ttl = ((uint32_t) p[off + 4] << 24) | (p[off + 5] << 16) |
+          (p[off + 6] << 8) | p[off + 7];
+    rdlen = (p[off + 8] << 8) | p[off + 9];
+    off += 10;
+    if (off + rdlen > len)
+      return UV_EINVAL;
+
+    /* The lowest TTL of all records goes, CNAME records along the way
+     * count too. Aliases come as CNAME records before the first address,
+     * the owner of that one is the canonical name.
+     */
+    if (ttl < lookup->ttl)
+      lookup->ttl = ttl;
+
+    if (type == lookup->type && type == DNS_TYPE_PTR) {
+      if (lookup->naddrs == 0 &&
+          uv__dns_read_name(p, len, off, lookup->canonname) == 0)
+        lookup->naddrs = 1;
+    } else if (type == lookup->type &&
+               rdlen == (type == DNS_TYPE_A ? 4u : 16u)) {
+      if (lookup->naddrs == 0)
+        if (uv__dns_read_name(p, len, owner, lookup->canonname))
+          lookup->canonname[0] = '\0';
+      memcpy(lookup->addrs[lookup->naddrs++], p + off, rdlen);
+    }
+
+    off += rdlen;
+  }
+
+  lookup->state = lookup->naddrs > 0 ? DNS_FOUND : DNS_NODATA;
+  return 0;
+}
+
+
+static void uv__dns_transport_close_cb(uv_handle_t* handle) {
+  struct uv__dns_transport* t;
+
+  t = handle->data;
+  if (--t->handles == 0) {
+    uv__free(t->buf);
+    uv__free(t);
+  }
+}
+
+
+static void uv__dns_transport_close(struct uv__dns_transport* t) {
+  if (t->lookup != NULL)
+    t->lookup->transport = NULL;
+
+  t->lookup = NULL;
+  uv_close((uv_handle_t*) &t->handle, uv__dns_transport_close_cb);
+  uv_close((uv_handle_t*) &t->timer, uv__dns_transport_close_cb);
+}
+
+
+static int uv__dns_lookups_done(struct uv__dns_query* query) {
+  unsigned int i;
+
+  for (i = 0; i < query->nlookups; i++)
+    if (query->lookups[i].state == DNS_PENDING)
+      return 0;
+
+  return 1;
+}
+
+
+static void uv__dns_result_add(struct addrinfo* ai,
+                               struct sockaddr_storage* addr,
+                               const struct addrinfo* hints,
+                               int family,
+                               const unsigned char* bytes,
+                               uint16_t port,
+                               int socktype) {
+  struct sockaddr_in6* addr6;
+  struct sockaddr_in* addr4;
+
+  memset(ai, 0, sizeof(*ai));
+  memset(addr, 0, sizeof(*addr));
+  ai->ai_flags = hints ? hints->ai_flags : 0;
+  ai->ai_family = family;
+  ai->ai_socktype = socktype;
+  ai->ai_protocol = hints && hints->ai_protocol ? hints->ai_protocol : 0;
+  ai->ai_addr = (struct sockaddr*) addr;
+
+  if (ai->ai_protocol == 0 && socktype == SOCK_STREAM)
+    ai->ai_protocol = IPPROTO_TCP;
+  else if (ai->ai_protocol == 0 && socktype == SOCK_DGRAM)
+    ai->ai_protocol = IPPROTO_UDP;
+
+  if (family == AF_INET) {
+    addr4 = (struct sockaddr_in*) addr;
+    addr4->sin_family = AF_INET;
+    addr4->sin_port = htons(port);
+    memcpy(&addr4->sin_addr, bytes, 4);
+    ai->ai_addrlen = sizeof(*addr4);
+  } else {
+    addr6 = (struct sockaddr_in6*) addr;
+    addr6->sin6_family = AF_INET6;
+    addr6->sin6_port = htons(port);
+    memcpy(&addr6->sin6_addr, bytes, 16);
+    ai->ai_addrlen = sizeof(*addr6);
+  }
+}
+
+
+/* A block for |n| entries and |extra| bytes after them. */
+static struct uv__dns_result* uv__dns_result_alloc(unsigned int n,
+                                                   size_t extra) {
+  struct uv__dns_result* result;
+
+  return uv__malloc(sizeof(*result) +
+                    (n - 1) * sizeof(result->entries[0]) +
+                    extra);
+}
+
+
+/* Turns the addresses of the lookups into one addrinfo list. IPv4 addresses
+ * go first, like getaddrinfo() does without IPv6 connectivity.
+ */
+static int uv__dns_make_result(struct uv__dns_query* query,
+                               struct addrinfo** res) {
+  static const int socktypes[] = { SOCK_STREAM, SOCK_DGRAM, SOCK_RAW };
+  const struct addrinfo* hints;
+  struct uv__dns_lookup* lookup;
+  struct uv__dns_result* result;
+  struct uv__dns_entry* entry;
+  const char* canonname;
+  unsigned int nsocktypes;
+  unsigned int n;
+  unsigned int i;
+  unsigned int j;
+  unsigned int k;
+  int family;
+
+  hints = ((uv_getaddrinfo_t*) query->req)->hints;
+  nsocktypes = ARRAY_SIZE(socktypes);
+  if (hints != NULL && hints->ai_socktype != 0)
+    nsocktypes = 1;
+
+  n = 0;
+  canonname = NULL;
+  for (i = 0; i < query->nlookups; i++) {
+    n += query->lookups[i].naddrs * nsocktypes;
+    if (canonname == NULL && query->lookups[i].naddrs > 0)
+      canonname = query->lookups[i].canonname;
+  }
+
+  if (n == 0)
+    return UV_EAI_NONAME;
+
+  if (canonname == NULL || canonname[0] == '\0')
+    canonname = query->name;
+
+  result = uv__dns_result_alloc(n, strlen(canonname) + 1);
+  if (result == NULL)
+    return UV_EAI_MEMORY;
+
+  k = 0;
+  for (i = 0; i < query->nlookups; i++) {
+    lookup = &query->lookups[i];
+    family = lookup->type == DNS_TYPE_A ? AF_INET : AF_INET6;
+    for (j = 0; j < lookup->naddrs * nsocktypes; j++) {
+      entry = &result->entries[k];
+      uv__dns_result_add(&entry->ai,
+                         &entry->addr,
+                         hints,
+                         family,
+                         lookup->addrs[j / nsocktypes],
+                         query->port,
+                         nsocktypes == 1 ? hints->ai_socktype
+                                         : socktypes[j % nsocktypes]);
+      entry->ai.ai_next = k + 1 < n ? &result->entries[k + 1].ai : NULL;
+      k++;
+    }
+  }
+
+  if (hints != NULL && (hints->ai_flags & AI_CANONNAME))
+    result->entries[0].ai.ai_canonname =
+        strcpy((char*) &result->entries[n], canonname);
+
+  *res = &result->entries[0].ai;
+  return 0;
+}
+
+
+/* Copies |ai| into one block that uv_freeaddrinfo() knows how to release. */
+int uv__dns_addrinfo_copy(const struct addrinfo* ai, struct addrinfo** res) {
+  const struct addrinfo* p;
+  struct uv__dns_result* result;
+  struct uv__dns_entry* entry;
+  unsigned int n;
+  unsigned int k;
+  size_t extra;
+
+  n = 0;
+  for (p = ai; p != NULL; p = p->ai_next)
+    n++;
+
+  if (n == 0)
+    return UV_EINVAL;
+
+  extra = 0;
+  if (ai->ai_canonname != NULL)
+    extra = strlen(ai->ai_canonname) + 1;
+
+  result = uv__dns_result_alloc(n, extra);
+  if (result == NULL)
+    return UV_ENOMEM;
+
+  for (k = 0, p = ai; p != NULL; k++, p = p->ai_next) {
+    entry = &result->entries[k];
+    entry->ai = *p;
+    if (p->ai_addrlen > sizeof(entry->addr))
+      entry->ai.ai_addrlen = sizeof(entry->addr);
+    entry->ai.ai_addr = (struct sockaddr*) &entry->addr;
+    entry->ai.ai_canonname = NULL;
+    entry->ai.ai_next = k + 1 < n ? &result->entries[k + 1].ai : NULL;
+    memcpy(&entry->addr, p->ai_addr, entry->ai.ai_addrlen);
+  }
+
+  if (ai->ai_canonname != NULL)
+    result->entries[0].ai.ai_canonname =
+        strcpy((char*) &result->entries[n], ai->ai_canonname);
+
+  *res = &result->entries[0].ai;
+  return 0;
+}
+
+
+void uv__dns_freeaddrinfo(struct addrinfo* ai) {
+  struct uv__dns_entry* entry;
+
+  entry = container_of(ai, struct uv__dns_entry, ai);
+  assert(ai->ai_addr == (struct sockaddr*) &entry->addr);
+  uv__free(container_of(entry, struct uv__dns_result, entries));
+}
+
+
+static void uv__dns_query_close_cb(uv_handle_t* handle) {
+  uv__free(handle->data);
+}
+
+
+static void uv__dns_query_timer_cb(uv_timer_t* handle);
+
+
+static void uv__dns_addrinfo_done(struct uv__dns_query* query) {
+  uv_getaddrinfo_t* req;
+  unsigned int i;
+  uint64_t ttl;
+  int err;
+
+  req = (uv_getaddrinfo_t*) query->req;
+  req->dns_query = NULL;
+  if (query->status == UV_ECANCELED) {
+    uv__getaddrinfo_done(&req->work_req, UV_ECANCELED);
+    return;
+  }
+
+  err = query->status;
+  if (err == 0)
+    err = uv__dns_make_result(query, &req->addrinfo);
+
+  /* Addresses from the hosts file live as long as the cache lets them. */
+  ttl = UV__DNS_CACHE_DEFAULT_TTL;
+  for (i = 0; i < query->nlookups; i++)
+    if (query->lookups[i].state == DNS_FOUND)
+      if ((uint64_t) query->lookups[i].ttl * 1000 < ttl)
+        ttl = (uint64_t) query->lookups[i].ttl * 1000;
+
+  uv__dns_cache_store(req, err, req->addrinfo, ttl);
+
+  req->retcode = err;
+  uv__getaddrinfo_done(&req->work_req, 0);
+}
+
+
+static int uv__dns_numeric_host(const struct sockaddr_storage* ss,
+                                char* host,
+                                size_t size) {
+  const struct sockaddr_in6* addr6;
+  const struct sockaddr_in* addr4;
+  char ifname[UV_IF_NAMESIZE];
+  size_t len;
+
+  if (ss->ss_family == AF_INET) {
+    addr4 = (const struct sockaddr_in*) ss;
+    return uv_inet_ntop(AF_INET, &addr4->sin_addr, host, size);
+  }
+
+  addr6 = (const struct sockaddr_in6*) ss;
+  if (uv_inet_ntop(AF_INET6, &addr6->sin6_addr, host, size))
+    return UV_EAI_OVERFLOW;
+
+  if (addr6->sin6_scope_id == 0)
+    return 0;
+
+  /* Link-local scopes are interfaces, like getnameinfo() prints them. */
+  len = strlen(host);
+  if ((IN6_IS_ADDR_LINKLOCAL(&addr6->sin6_addr) ||
+       IN6_IS_ADDR_MC_LINKLOCAL(&addr6->sin6_addr)) &&
+      if_indextoname(addr6->sin6_scope_id, ifname) != NULL)
+    snprintf(host + len, size - len, "%%%s", ifname);
+  else
+    snprintf(host + len, size - len, "%%%u", (unsigned) addr6->sin6_scope_id);
+
+  return 0;
+}
+
+
+static void uv__dns_service_name(struct uv__dns_query* query,
+                                 uv_getnameinfo_t* req) {
+  struct uv__dns_service* service;
+  unsigned int port;
+  unsigned int i;
+  int udp;
+
+  /* Both address families keep the port in the same place. */
+  port = ntohs(((struct sockaddr_in*) &req->storage)->sin_port);
+  udp = (req->flags & NI_DGRAM) != 0;
+
+  if (query->dns != NULL && !(req->flags & NI_NUMERICSERV)) {
+    for (i = 0; i < query->dns->nservices; i++) {
+      service = &query->dns->services[i];
+      if (service->port == port && service->udp == udp) {
+        uv__strscpy(req->service, service->name, sizeof(req->service));
+        return;
+      }
+    }
+  }
+
+  snprintf(req->service, sizeof(req->service), "%u", port);
+}
+
+
+static void uv__dns_nameinfo_done(struct uv__dns_query* query) {
+  uv_getnameinfo_t* req;
+  const char* domain;
+  char* name;
+  size_t dlen;
+  size_t len;
+  int err;
+
+  req = (uv_getnameinfo_t*) query->req;
+  req->dns_query = NULL;
+  if (query->status == UV_ECANCELED) {
+    uv__getnameinfo_done(&req->work_req, UV_ECANCELED);
+    return;
+  }
+
+  err = 0;
+  name = NULL;
+  if (query->nlookups > 0 && query->lookups[0].naddrs > 0)
+    name = query->lookups[0].canonname;
+  else if (query->nlookups > 0 && (req->flags & NI_NAMEREQD))
+    err = query->status ? query->status : UV_EAI_NONAME;
+
+  if (name != NULL && (req->flags & NI_NOFQDN) && query->dns->nsearch > 0) {
+    domain = query->dns->search[0];
+    dlen = strlen(domain);
+    len = strlen(name);
+    if (len > dlen + 1 &&
+        name[len - dlen - 1] == '.' &&
+        strcasecmp(name + len - dlen, domain) == 0)
+      name[len - dlen - 1] = '\0';
+  }
+
+  /* Without a name the address does, unless a name was asked for. */
+  if (err == 0 && name != NULL)
+    uv__strscpy(req->host, name, sizeof(req->host));
+  else if (err == 0)
+    err = uv__dns_numeric_host(&req->storage, req->host, sizeof(req->host));
+
+  if (err == 0)
+    uv__dns_service_name(query, req);
+
+  req->retcode = err;
+  uv__getnameinfo_done(&req->work_req, 0);
+}
+
+
+/* Ends the query with |query->status| and runs the callback. */
+static void uv__dns_query_finish(struct uv__dns_query* query) {
+  unsigned int i;
+
+  query->done = 1;
+
+  for (i = 0; i < query->nlookups; i++)
+    if (query->lookups[i].transport != NULL)
+      uv__dns_transport_close(query->lookups[i].transport);
+
+  /* The callback can't run from inside uv_getaddrinfo(), results that are
+   * known right away are delivered from the next loop iteration.
+   */
+  if (query->starting) {
+    uv_timer_start(&query->timer, uv__dns_query_timer_cb, 0, 0);
+    return;
+  }
+
+  uv_close((uv_handle_t*) &query->timer, uv__dns_query_close_cb);
+
+  if (query->req->type == UV_GETNAMEINFO)
+    uv__dns_nameinfo_done(query);
+  else
+    uv__dns_addrinfo_done(query);
+}
+
+
+static void uv__dns_query_timer_cb(uv_timer_t* handle) {
+  uv__dns_query_finish(handle->data);
+}
+
+
+/* Ends the lookup, and the query when this was the last lookup of the name
+ * being tried.
+ */
+static void uv__dns_lookup_done(struct uv__dns_lookup* lookup, int state) {
+  struct uv__dns_query* query;
+  unsigned int found;
+  unsigned int failed;
+  unsigned int i;
+
+  query = lookup->query;
+  lookup->state = state;
+
+  if (lookup->transport != NULL)
+    uv__dns_transport_close(lookup->transport);
+
+  if (!uv__dns_lookups_done(query))
+    return;
+
+  found = 0;
+  failed = 0;
+  for (i = 0; i < query->nlookups; i++) {
+    found |= query->lookups[i].state == DNS_FOUND;
+    failed |= query->lookups[i].state == DNS_FAILED;
+  }
+
+  if (found) {
+    query->status = 0;
+    uv__dns_query_finish(query);
+  } else if (failed) {
+    query->status = UV_EAI_AGAIN;
+    uv__dns_query_finish(query);
+  } else {
+    query->candidate++;
+    uv__dns_query_next(query);
+  }
+}
+
+
+static void uv__dns_lookup_retry(struct uv__dns_lookup* lookup) {
+  struct uv__dns* dns;
+
+  dns = lookup->query->dns;
+  if (lookup->transport != NULL)
+    uv__dns_transport_close(lookup->transport);
+
+  if (lookup->tries >= dns->attempts * dns->nservers)
+    uv__dns_lookup_done(lookup, DNS_FAILED);
+  else
+    uv__dns_lookup_start(lookup);
+}
+
+
+static void uv__dns_timeout_cb(uv_timer_t* handle) {
+  struct uv__dns_transport* t;
+
+  t = container_of(handle, struct uv__dns_transport, timer);
+  if (t->lookup != NULL)
+    uv__dns_lookup_retry(t->lookup);
+}
+
+
+static void uv__dns_answer(struct uv__dns_transport* t,
+                           const unsigned char* p,
+                           size_t len);
+
+
+static void uv__dns_alloc_cb(uv_handle_t* handle,
+                             size_t suggested_size,
+                             uv_buf_t* buf) {
+  struct uv__dns_transport* t;
+
+  t = handle->data;
+  buf->base = (char*) t->buf + t->len;
+  buf->len = t->size - t->len;
+}
+
+
+static void uv__dns_udp_recv_cb(uv_udp_t* handle,
+                                ssize_t nread,
+                                const uv_buf_t* buf,
+                                const struct sockaddr* addr,
+                                unsigned flags) {
+  struct uv__dns_transport* t;
+
+  t = handle->data;
+  if (t->lookup == NULL || nread == 0)
+    return;
+
+  /* Typically ECONNREFUSED, nobody's listening. */
+  if (nread < 0) {
+    uv__dns_lookup_retry(t->lookup);
+    return;
+  }
+
+  if (flags & UV_UDP_PARTIAL)
+    return;
+
+  uv__dns_answer(t, (const unsigned char*) buf->base, nread);
+}
+
+
+static void uv__dns_udp_send_cb(uv_udp_send_t* req, int status) {
+  struct uv__dns_transport* t;
+
+  t = req->handle->data;
+  if (status != 0 && status != UV_ECANCELED && t->lookup != NULL)
+    uv__dns_lookup_retry(t->lookup);
+}
+
+
+static void uv__dns_tcp_read_cb(uv_stream_t* stream,
+                                ssize_t nread,
+                                const uv_buf_t* buf) {
+  struct uv__dns_transport* t;
+  size_t len;
+
+  t = stream->data;
+  if (t->lookup == NULL || nread == 0)
+    return;
+
+  if (nread < 0) {
+    uv__dns_lookup_retry(t->lookup);
+    return;
+  }
+
+  /* Answers over TCP come with a two byte length. */
+  t->len += nread;
+  if (t->len < 2)
+    return;
+
+  len = (t->buf[0] << 8) | t->buf[1];
+  if (t->len < 2 + len)
+    return;
+
+  uv__dns_answer(t, t->buf + 2, len);
+}
+
+
+static void uv__dns_tcp_write_cb(uv_write_t* req, int status) {
+  struct uv__dns_transport* t;
+
+  t = req->handle->data;
+  if (status != 0 && status != UV_ECANCELED && t->lookup != NULL)
+    uv__dns_lookup_retry(t->lookup);
+}
+
+
+static void uv__dns_tcp_connect_cb(uv_connect_t* req, int status) {
+  struct uv__dns_transport* t;
+  struct uv__dns_lookup* lookup;
+  uv_buf_t buf;
+
+  t = req->handle->data;
+  lookup = t->lookup;
+  if (lookup == NULL || status == UV_ECANCELED)
+    return;
+
+  if (status == 0)
+    status = uv_read_start((uv_stream_t*) &t->handle.tcp,
+                           uv__dns_alloc_cb,
+                           uv__dns_tcp_read_cb);
+
+  if (status == 0) {
+    buf = uv_buf_init((char*) lookup->packet, 2 + lookup->packet_len);
+    status = uv_write(&t->write_req,
+                      (uv_stream_t*) &t->handle.tcp,
+                      &buf,
+                      1,
+                      uv__dns_tcp_write_cb);
+  }
+
+  if (status != 0)
+    uv__dns_lookup_retry(lookup);
+}
+
+
+/* Sends the query of |lookup| to the server that's next in line, over UDP
+ * or over TCP.
+ */
+static int uv__dns_transport_start(struct uv__dns_lookup* lookup,
+                                   unsigned int server,
+                                   int use_tcp) {
+  struct uv__dns_transport* t;
+  struct sockaddr* addr;
+  uv_loop_t* loop;
+  uv_buf_t buf;
+  int err;
+
+  loop = lookup->query->loop;
+  addr = (struct sockaddr*) &lookup->query->dns->servers[server];
+
+  t = uv__calloc(1, sizeof(*t));
+  if (t == NULL)
+    return UV_ENOMEM;
+
+  t->size = use_tcp ? 2 + 65535 : DNS_UDP_SIZE;
+  t->buf = uv__malloc(t->size);
+  if (t->buf == NULL) {
+    uv__free(t);
+    return UV_ENOMEM;
+  }
+
+  if (use_tcp)
+    err = uv_tcp_init(loop, &t->handle.tcp);
+  else
+    err = uv_udp_init(loop, &t->handle.udp);
+
+  if (err) {
+    uv__free(t->buf);
+    uv__free(t);
+    return err;
+  }
+
+  uv_timer_init(loop, &t->timer);
+  t->handle.udp.data = t;
+  t->timer.data = t;
+  t->handle.udp.flags |= UV_HANDLE_INTERNAL;
+  t->timer.flags |= UV_HANDLE_INTERNAL;
+  uv__handle_unref(&t->handle.udp);
+  uv__handle_unref(&t->timer);
+  t->handles = 2;
+  t->use_tcp = use_tcp;
+  t->lookup = lookup;
+  lookup->transport = t;
+
+  if (use_tcp) {
+    err = uv_tcp_connect(&t->connect_req,
+                         &t->handle.tcp,
+                         addr,
+                         uv__dns_tcp_connect_cb);
+  } else {
+    /* A connected socket only sees datagrams from the server. */
+    err = uv_udp_connect(&t->handle.udp, addr);
+    if (err == 0)
+      err = uv_udp_recv_start(&t->handle.udp,
+                              uv__dns_alloc_cb,
+                              uv__dns_udp_recv_cb);
+    if (err == 0) {
+      buf = uv_buf_init((char*) lookup->packet + 2, lookup->packet_len);
+      err = uv_udp_send(&t->send_req,
+                        &t->handle.udp,
+                        &buf,
+                        1,
+                        NULL,
+                        uv__dns_udp_send_cb);
+    }
+  }
+
+  if (err == 0)
+    err = uv_timer_start(&t->timer,
+                         uv__dns_timeout_cb,
+                         lookup->query->dns->timeout,
+                         0);
+
+  if (err)
+    uv__dns_transport_close(t);
+
+  return err;
+}
+
+
+static void uv__dns_answer(struct uv__dns_transport* t,
+                           const unsigned char* p,
+                           size_t len) {
+  struct uv__dns_lookup* lookup;
+  struct uv__dns* dns;
+  unsigned int server;
+  int err;
+
+  lookup = t->lookup;
+  err = uv__dns_parse_answer(lookup, p, len);
+
+  if (err == UV_EINVAL)
+    return;  /* Not for us, keep waiting. */
+
+  if (err == UV_EAGAIN && !t->use_tcp) {
+    /* Truncated, ask the same server again over TCP. */
+    dns = lookup->query->dns;
+    server = (lookup->tries - 1) % dns->nservers;
+    uv__dns_transport_close(t);
+    if (uv__dns_transport_start(lookup, server, 1))
+      uv__dns_lookup_retry(lookup);
+    return;
+  }
+
+  if (err == UV_EAGAIN || lookup->state == DNS_FAILED) {
+    uv__dns_lookup_retry(lookup);
+    return;
+  }
+
+  uv__dns_lookup_done(lookup, lookup->state);
+}
+
+
+static void uv__dns_lookup_start(struct uv__dns_lookup* lookup) {
+  struct uv__dns* dns;
+  unsigned int server;
+
+  dns = lookup->query->dns;
+
+  /* A server failure from the last server doesn't end the query while the
+   * next one is asked.
+   */
+  lookup->state = DNS_PENDING;
+
+  /* Go through the servers in order, then start over. */
+  while (lookup->tries < dns->attempts * dns->nservers) {
+    server = lookup->tries++ % dns->nservers;
+    if (uv__dns_transport_start(lookup, server, 0) == 0)
+      return;
+  }
+
+  uv__dns_lookup_done(lookup, DNS_FAILED);
+}
+
+
+/* Writes the |n|th name to try into |name|. Names with at least ndots dots
+ * are tried as they are first, other names go through the search list
+ * first. Returns non-zero when there are no more names to try.
+ */
+static int uv__dns_candidate(struct uv__dns_query* query,
+                             unsigned int n,
+                             char* name) {
+  struct uv__dns* dns;
+  const char* p;
+  unsigned int ndots;
+  unsigned int nsearch;
+  size_t slen;
+  size_t len;
+
+  dns = query->dns;
+  len = strlen(query->name);
+
+  /* A trailing dot makes the name absolute. */
+  nsearch = dns->nsearch;
+  if (query->name[len - 1] == '.')
+    nsearch = 0;
+
+  if (n > nsearch)
+    return 1;
+
+  for (ndots = 0, p = query->name; *p != '\0'; p++)
+    ndots += *p == '.';
+
+  if (ndots >= dns->ndots) {
+    if (n == 0) {
+      memcpy(name, query->name, len + 1);
+      return 0;
+    }
+    n--;
+  } else if (n == nsearch) {
+    memcpy(name, query->name, len + 1);
+    return 0;
+  }
+
+  slen = strlen(dns->search[n]);
+  if (len + 1 + slen > DNS_MAX_NAME)
+    return 1;
+
+  memcpy(name, query->name, len);
+  name[len] = '.';
+  memcpy(name + len + 1, dns->search[n], slen + 1);
+  return 0;
+}
+
+
+static void uv__dns_query_next(struct uv__dns_query* query) {
+  char name[DNS_MAX_NAME + 1];
+  struct uv__dns_lookup* lookup;
+  uint16_t ids[2];
+  unsigned int i;
+
+  if (uv__dns_candidate(query, query->candidate, name)) {
+    query->status = UV_EAI_NONAME;
+    uv__dns_query_finish(query);
+    return;
+  }
+
+  if (uv_random(NULL, NULL, ids, sizeof(ids), 0, NULL))
+    ids[0] = ids[1] = (uint16_t) uv_hrtime();
+
+  for (i = 0; i < query->nlookups; i++) {
+    lookup = &query->lookups[i];
+    lookup->state = DNS_PENDING;
+    lookup->tries = 0;
+    lookup->naddrs = 0;
+    lookup->canonname[0] = '\0';
+    lookup->id = ids[i];
+    lookup->packet_len = uv__dns_build_query(lookup->packet + 2,
+                                             lookup->id,
+                                             lookup->type,
+                                             name);
+    lookup->packet[0] = lookup->packet_len >> 8;
+    lookup->packet[1] = lookup->packet_len & 255;
+  }
+
+  /* A lookup that fails right away can end the query. */
+  for (i = 0; i < query->nlookups && !query->done; i++)
+    if (query->lookups[i].state == DNS_PENDING)
+      uv__dns_lookup_start(&query->lookups[i]);
+}
+
+
+/* Answers from numeric addresses and the hosts file, returns non-zero when
+ * there's an answer. Numeric addresses of the wrong family are an error.
+ */
+static int uv__dns_local(struct uv__dns_query* query) {
+  struct uv__dns_lookup* lookup;
+  struct uv__dns_host* host;
+  struct uv__dns* dns;
+  unsigned char addr[16];
+  unsigned int i;
+  unsigned int j;
+  int family;
+
+  dns = query->dns;
+
+  family = AF_INET;
+  if (inet_pton(AF_INET, query->name, addr) != 1) {
+    family = AF_INET6;
+    if (inet_pton(AF_INET6, query->name, addr) != 1)
+      family = AF_UNSPEC;
+  }
+
+  if (family != AF_UNSPEC) {
+    query->status = UV_EAI_NONAME;
+    for (i = 0; i < query->nlookups; i++) {
+      lookup = &query->lookups[i];
+      if (family == (lookup->type == DNS_TYPE_A ? AF_INET : AF_INET6)) {
+        memcpy(lookup->addrs[lookup->naddrs++], addr, sizeof(addr));
+        query->status = 0;
+      }
+    }
+    return 1;
+  }
+
+  for (i = 0; i < dns->nhosts; i++) {
+    host = &dns->hosts[i];
+    if (strcasecmp(host->name, query->name) != 0)
+      continue;
+
+    for (j = 0; j < query->nlookups; j++) {
+      lookup = &query->lookups[j];
+      family = lookup->type == DNS_TYPE_A ? AF_INET : AF_INET6;
+      if (family == host->family && lookup->naddrs < DNS_MAX_ADDRS)
+        memcpy(lookup->addrs[lookup->naddrs++], host->addr, 16);
+    }
+  }
+
+  for (i = 0; i < query->nlookups; i++)
+    if (query->lookups[i].naddrs > 0)
+      return 1;
+
+  return 0;
+}
+
+
+static int uv__dns_valid_name(const char* name) {
+  size_t n;
+
+  /* Labels of 1 to 63 characters, optionally followed by a dot. */
+  for (;;) {
+    n = strcspn(name, ".");
+    if (n == 0 || n > 63)
+      return 0;
+    name += n;
+    if (*name == '\0' || *++name == '\0')
+      return 1;
+  }
+}
+
+
+static struct uv__dns_query* uv__dns_query_new(uv_loop_t* loop,
+                                               uv_req_t* req,
+                                               struct uv__dns* dns) {
+  struct uv__dns_query* query;
+
+  query = uv__calloc(1, sizeof(*query));
+  if (query == NULL)
+    return NULL;
+
+  uv_timer_init(loop, &query->timer);
+  query->timer.flags |= UV_HANDLE_INTERNAL;
+  query->timer.data = query;
+  uv__handle_unref(&query->timer);
+
+  query->req = req;
+  query->loop = loop;
+  query->dns = dns;
+  query->lookups[0].query = query;
+  query->lookups[1].query = query;
+
+  return query;
+}
+
+
+int uv__dns_getaddrinfo(uv_loop_t* loop, uv_getaddrinfo_t* req) {
+  const struct addrinfo* hints;
+  struct uv__dns_query* query;
+  struct uv__dns* dns;
+  unsigned long port;
+  size_t len;
+  char* end;
+  int family;
+
+  dns = uv__get_internal_fields(loop)->dns;
+  hints = req->hints;
+
+  if (dns == NULL || req->hostname == NULL)
+    return UV_ENOSYS;
+
+  /* Service names need the services database, leave those to getaddrinfo(). */
+  port = 0;
+  if (req->service != NULL) {
+    port = strtoul(req->service, &end, 10);
+    if (*req->service == '\0' || *end != '\0' || port > 65535)
+      return UV_ENOSYS;
+  }
+
+  family = hints ? hints->ai_family : AF_UNSPEC;
+  if (family != AF_UNSPEC && family != AF_INET && family != AF_INET6)
+    return UV_ENOSYS;
+
+  len = strlen(req->hostname);
+  if (len > DNS_MAX_NAME || !uv__dns_valid_name(req->hostname))
+    return UV_ENOSYS;
+
+  query = uv__dns_query_new(loop, (uv_req_t*) req, dns);
+  if (query == NULL)
+    return UV_ENOMEM;
+
+  query->port = port;
+  memcpy(query->name, req->hostname, len + 1);
+
+  if (family != AF_INET6)
+    query->lookups[query->nlookups++].type = DNS_TYPE_A;
+  if (family != AF_INET)
+    query->lookups[query->nlookups++].type = DNS_TYPE_AAAA;
+
+  req->dns_query = query;
+
+  query->starting = 1;
+  if (uv__dns_local(query)) {
+    uv__dns_query_finish(query);
+  } else if (hints != NULL && (hints->ai_flags & AI_NUMERICHOST)) {
+    query->status = UV_EAI_NONAME;
+    uv__dns_query_finish(query);
+  } else {
+    uv__dns_query_next(query);
+  }
+  query->starting = 0;
+
+  return 0;
+}
+
+
+/* Writes the in-addr.arpa or ip6.arpa name of |ss| to |name|, with a dot at
+ * the end to keep the search list out of it.
+ */
+static void uv__dns_reverse_name(const struct sockaddr_storage* ss,
+                                 char* name) {
+  static const char hex[] = "0123456789abcdef";
+  const unsigned char* a;
+  int i;
+
+  if (ss->ss_family == AF_INET) {
+    a = (const unsigned char*) &((const struct sockaddr_in*) ss)->sin_addr;
+    snprintf(name, DNS_MAX_NAME + 1, "%u.%u.%u.%u.in-addr.arpa.",
+             a[3], a[2], a[1], a[0]);
+    return;
+  }
+
+  a = (const unsigned char*) &((const struct sockaddr_in6*) ss)->sin6_addr;
+  for (i = 15; i >= 0; i--) {
+    *name++ = hex[a[i] & 15];
+    *name++ = '.';
+    *name++ = hex[a[i] >> 4];
+    *name++ = '.';
+  }
+  strcpy(name, "ip6.arpa.");
+}
+
+
+int uv__dns_getnameinfo(uv_loop_t* loop, uv_getnameinfo_t* req) {
+  struct uv__dns_query* query;
+  struct uv__dns_lookup* lookup;
+  struct uv__dns_host* host;
+  struct uv__dns* dns;
+  const void* addr;
+  unsigned int i;
+  size_t len;
+
+  dns = uv__get_internal_fields(loop)->dns;
+
+  /* Numbers only need formatting, that works without a configuration. */
+  if (dns == NULL && (req->flags & (NI_NUMERICHOST | NI_NUMERICSERV)) !=
+                     (NI_NUMERICHOST | NI_NUMERICSERV))
+    return UV_ENOSYS;
+
+  query = uv__dns_query_new(loop, (uv_req_t*) req, dns);
+  if (query == NULL)
+    return UV_ENOMEM;
+
+  req->dns_query = query;
+  query->starting = 1;
+
+  if (req->flags & NI_NUMERICHOST) {
+    uv__dns_query_finish(query);
+    query->starting = 0;
+    return 0;
+  }
+
+  lookup = &query->lookups[0];
+  lookup->type = DNS_TYPE_PTR;
+  query->nlookups = 1;
+
+  if (req->storage.ss_family == AF_INET) {
+    addr = &((struct sockaddr_in*) &req->storage)->sin_addr;
+    len = 4;
+  } else {
+    addr = &((struct sockaddr_in6*) &req->storage)->sin6_addr;
+    len = 16;
+  }
+
+  for (i = 0; i < dns->nhosts; i++) {
+    host = &dns->hosts[i];
+    if (host->family == req->storage.ss_family &&
+        memcmp(host->addr, addr, len) == 0) {
+      uv__strscpy(lookup->canonname, host->name, sizeof(lookup->canonname));
+      lookup->naddrs = 1;
+      break;
+    }
+  }
+
+  if (lookup->naddrs > 0) {
+    uv__dns_query_finish(query);
+  } else {
+    uv__dns_reverse_name(&req->storage, query->name);
+    uv__dns_query_next(query);
+  }
+  query->starting = 0;
+
+  return 0;
+}
+
+
+int uv__dns_cancel(void* dns_query) {
+  struct uv__dns_query* query;
+  unsigned int i;
+
+  query = dns_query;
+  if (query->status == UV_ECANCELED)
+    return UV_EBUSY;
+
+  /* Stop asking, the callback comes from the next loop iteration like it
+   * does for cancelled threadpool work.
+   */
+  for (i = 0; i < query->nlookups; i++)
+    if (query->lookups[i].transport != NULL)
+      uv__dns_transport_close(query->lookups[i].transport);
+
+  query->done = 1;
+  query->status = UV_ECANCELED;
+  uv_timer_start(&query->timer, uv__dns_query_timer_cb, 0, 0);
+  return 0;
+}
@@ -60,6 +60,10 @@
 # include <sys/sendfile.h>
 #endif
 
+#if defined(__linux__)
+# include <linux/falloc.h>
+#endif
+
 #if defined(__APPLE__)
 # include <sys/sysctl.h>
 #elif defined(__linux__) && !defined(FICLONE)
@@ -173,7 +177,7 @@ extern char *mkdtemp(char *template); /* See issue #740 on AIX < 7 */
   do {                                                                        \
     if (cb != NULL) {                                                         \
       uv__req_register(loop, req);                                            \
-      uv__aio_submit(loop, req, uv__fs_done);                                 \
+      uv__aio_submit(loop, req, uv__fs_work, uv__fs_done);                    \
       return 0;                                                               \
     } else {                                                                  \
       uv__fs_work(&req->work_req);                                            \
@@ -243,6 +247,44 @@ UV_UNUSED(static struct timeval uv__fs_to_timeval(double time)) {
   return tv;
 }
 
+static ssize_t uv__fs_fallocate(uv_fs_t* req) {
+#if defined(__linux__)
+  {
+    int mode;
+
+    mode = 0;
+    if (req->flags & UV_FS_FALLOCATE_KEEP_SIZE)
+      mode |= FALLOC_FL_KEEP_SIZE;
+    if (req->flags & UV_FS_FALLOCATE_PUNCH_HOLE)
+      mode |= FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE;
+    if (req->flags & UV_FS_FALLOCATE_ZERO_RANGE)
+      mode |= FALLOC_FL_ZERO_RANGE;
+
+    return fallocate(req->file, mode, req->off, req->len);
+  }
+#elif defined(__FreeBSD__) || defined(__NetBSD__) || defined(__sun)
+  int r;
+
+  if (req->flags != 0) {
+    errno = ENOTSUP;
+    return -1;
+  }
+
+  /* posix_fallocate() returns the error instead of setting errno. */
+  r = posix_fallocate(req->file, req->off, req->len);
+  if (r != 0) {
+    errno = r;
+    return -1;
+  }
+
+  return 0;
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+
 static ssize_t uv__fs_futime(uv_fs_t* req) {
 #if defined(__linux__)                                                        \
     || defined(_AIX71)                                                        \
@@ -1606,6 +1648,7 @@ static void uv__fs_work(struct uv__work* w) {
     X(FCHMOD, fchmod(req->file, req->mode));
     X(FCHOWN, fchown(req->file, req->uid, req->gid));
     X(LCHOWN, lchown(req->path, req->uid, req->gid));
+    X(FALLOCATE, uv__fs_fallocate(req));
     X(FDATASYNC, uv__fs_fdatasync(req));
     X(FSTAT, uv__fs_fstat(req->file, &req->statbuf));
     X(FSYNC, uv__fs_fsync(req));
@@ -1752,10 +1795,39 @@ int uv_fs_lchown(uv_loop_t* loop,
 }
 
 
+int uv_fs_fallocate(uv_loop_t* loop,
+                    uv_fs_t* req,
+                    uv_file file,
+                    int flags,
+                    int64_t off,
+                    int64_t len,
+                    uv_fs_cb cb) {
+  INIT(FALLOCATE);
+
+  if (flags & ~(UV_FS_FALLOCATE_KEEP_SIZE |
+                UV_FS_FALLOCATE_PUNCH_HOLE |
+                UV_FS_FALLOCATE_ZERO_RANGE))
+    return UV_EINVAL;
+
+  if (off < 0 || len <= 0)
+    return UV_EINVAL;
+
+  req->file = file;
+  req->flags = flags;
+  req->off = off;
+  req->len = len;
+  POST;
+}
+
+
 int uv_fs_fdatasync(uv_loop_t* loop, uv_fs_t* req, uv_file file, uv_fs_cb cb) {
   INIT(FDATASYNC);
   req->file = file;
+#if defined(__linux__)
+  AIO_POST;
+#else
   POST;
+#endif
 }
 
 
@@ -1769,7 +1841,11 @@ int uv_fs_fstat(uv_loop_t* loop, uv_fs_t* req, uv_file file, uv_fs_cb cb) {
 int uv_fs_fsync(uv_loop_t* loop, uv_fs_t* req, uv_file file, uv_fs_cb cb) {
   INIT(FSYNC);
   req->file = file;
+#if defined(__linux__)
+  AIO_POST;
+#else
   POST;
+#endif
 }
 
 
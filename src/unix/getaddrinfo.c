@@ -100,15 +100,30 @@ int uv__getaddrinfo_translate_error(int sys_err) {
 
 static void uv__getaddrinfo_work(struct uv__work* w) {
   uv_getaddrinfo_t* req;
+  struct addrinfo* ai;
   int err;
 
   req = container_of(w, uv_getaddrinfo_t, work_req);
-  err = getaddrinfo(req->hostname, req->service, req->hints, &req->addrinfo);
+  req->addrinfo = NULL;
+  err = getaddrinfo(req->hostname, req->service, req->hints, &ai);
   req->retcode = uv__getaddrinfo_translate_error(err);
+
+  /* uv_freeaddrinfo() only knows how to free lists made by libuv. */
+  if (err == 0) {
+    if (uv__dns_addrinfo_copy(ai, &req->addrinfo))
+      req->retcode = UV_EAI_MEMORY;
+    freeaddrinfo(ai);
+  }
+
+  /* getaddrinfo() doesn't tell how long the answer is good for. */
+  uv__dns_cache_store(req,
+                      req->retcode,
+                      req->addrinfo,
+                      UV__DNS_CACHE_DEFAULT_TTL);
 }
 
 
-static void uv__getaddrinfo_done(struct uv__work* w, int status) {
+void uv__getaddrinfo_done(struct uv__work* w, int status) {
   uv_getaddrinfo_t* req;
 
   req = container_of(w, uv_getaddrinfo_t, work_req);
@@ -188,6 +203,7 @@ int uv_getaddrinfo(uv_loop_t* loop,
   req->service = NULL;
   req->hostname = NULL;
   req->retcode = 0;
+  req->dns_query = NULL;
 
   /* order matters, see uv_getaddrinfo_done() */
   len = 0;
@@ -205,7 +221,20 @@ int uv_getaddrinfo(uv_loop_t* loop,
   if (hostname)
     req->hostname = memcpy(buf + len, hostname, hostname_len);
 
+  /* Answers from the cache need no lookup at all. */
+  if (uv__dns_cache_lookup(loop, req) == 0) {
+    if (cb)
+      return 0;
+
+    uv__getaddrinfo_done(&req->work_req, 0);
+    return req->retcode;
+  }
+
   if (cb) {
+    /* The resolver leaves what it can't do to getaddrinfo(). */
+    if (uv__dns_getaddrinfo(loop, req) == 0)
+      return 0;
+
     uv__work_submit(loop,
                     &req->work_req,
                     UV__WORK_SLOW_IO,
@@ -221,8 +250,8 @@ int uv_getaddrinfo(uv_loop_t* loop,
 
 
 void uv_freeaddrinfo(struct addrinfo* ai) {
-  if (ai)
-    freeaddrinfo(ai);
+  if (ai != NULL)
+    uv__dns_freeaddrinfo(ai);
 }
 
 
@@ -52,7 +52,7 @@ static void uv__getnameinfo_work(struct uv__work* w) {
   req->retcode = uv__getaddrinfo_translate_error(err);
 }
 
-static void uv__getnameinfo_done(struct uv__work* w, int status) {
+void uv__getnameinfo_done(struct uv__work* w, int status) {
   uv_getnameinfo_t* req;
   char* host;
   char* service;
@@ -105,8 +105,13 @@ int uv_getnameinfo(uv_loop_t* loop,
   req->type = UV_GETNAMEINFO;
   req->loop = loop;
   req->retcode = 0;
+  req->dns_query = NULL;
 
   if (getnameinfo_cb) {
+    /* Numbers and the loop's own resolver don't need a thread. */
+    if (uv__dns_getnameinfo(loop, req) == 0)
+      return 0;
+
     uv__work_submit(loop,
                     &req->work_req,
                     UV__WORK_SLOW_IO,
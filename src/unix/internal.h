@@ -97,6 +97,32 @@ int uv__pthread_sigmask(int how, const sigset_t* set, sigset_t* oset);
   }                                                                           \
   while (0)
 
+/* Counts a system call the loop made, see uv_metrics_syscalls(). The
+ * atomic one is for calls made on behalf of the loop from other threads.
+ * Built with UV_NO_SYSCALL_COUNTERS, these are nothing.
+ */
+#ifdef UV_NO_SYSCALL_COUNTERS
+#define uv__count_syscall(loop, name)                                         \
+  do {                                                                        \
+  }                                                                           \
+  while (0)
+#define uv__count_syscall_atomic(loop, name)                                  \
+  do {                                                                        \
+  }                                                                           \
+  while (0)
+#else
+#define uv__count_syscall(loop, name)                                         \
+  do {                                                                        \
+    uv__get_loop_metrics(loop)->syscalls.name++;                              \
+  }                                                                           \
+  while (0)
+#define uv__count_syscall_atomic(loop, name)                                  \
+  do {                                                                        \
+    uv__atomic_fetch_add(&uv__get_loop_metrics(loop)->syscalls.name, 1);      \
+  }                                                                           \
+  while (0)
+#endif
+
 /* The __clang__ and __INTEL_COMPILER checks are superfluous because they
  * define __GNUC__. They are here to convey to you, dear reader, that these
  * macros are enabled when compiling with clang or icc.
@@ -134,7 +160,8 @@ typedef struct uv__stream_queued_fds_s uv__stream_queued_fds_t;
 
 /* loop flags */
 enum {
-  UV_LOOP_BLOCK_SIGPROF = 1
+  UV_LOOP_BLOCK_SIGPROF = 1,
+  UV_LOOP_EDGE_TRIGGERED = 2
 };
 
 /* flags of excluding ifaddr */
@@ -206,11 +233,13 @@ void uv__io_poll(uv_loop_t* loop, int timeout); /* in milliseconds or -1 */
 int uv__io_fork(uv_loop_t* loop);
 int uv__fd_exists(uv_loop_t* loop, int fd);
 
+
 /* aio */
 int uv__aio_init(uv_loop_t* loop, uv__aio_t* w, uv__aio_cb aio_cb);
 void uv__aio_close(uv__aio_t* w);
 void uv__aio_submit(uv_loop_t* loop,
                     uv_fs_t* req,
+                    void (*work)(struct uv__work* w),
                     void (*done)(struct uv__work* w, int status));
 void uv__aio_work_done(uv__aio_t* handle);
 int uv__aio_fork(uv_loop_t* loop);
@@ -277,12 +306,38 @@ FILE* uv__open_file(const char* path);
 int uv__getpwuid_r(uv_passwd_t* pwd);
 int uv__search_path(const char* prog, char* buf, size_t* buflen);
 
+/* dns */
+int uv__dns_configure(uv_loop_t* loop,
+                      const char* resolv_conf,
+                      const char* hosts);
+void uv__dns_loop_close(uv_loop_t* loop);
+int uv__dns_getaddrinfo(uv_loop_t* loop, uv_getaddrinfo_t* req);
+int uv__dns_getnameinfo(uv_loop_t* loop, uv_getnameinfo_t* req);
+int uv__dns_cancel(void* dns_query);
+void uv__dns_freeaddrinfo(struct addrinfo* ai);
+int uv__dns_addrinfo_copy(const struct addrinfo* ai, struct addrinfo** res);
+void uv__getaddrinfo_done(struct uv__work* w, int status);
+void uv__getnameinfo_done(struct uv__work* w, int status);
+
+/* dns cache */
+#define UV__DNS_CACHE_DEFAULT_TTL ((uint64_t) -1)
+int uv__dns_cache_lookup(uv_loop_t* loop, uv_getaddrinfo_t* req);
+void uv__dns_cache_store(const uv_getaddrinfo_t* req,
+                         int status,
+                         const struct addrinfo* ai,
+                         uint64_t ttl);
+
 /* random */
 int uv__random_devurandom(void* buf, size_t buflen);
 int uv__random_getrandom(void* buf, size_t buflen);
 int uv__random_getentropy(void* buf, size_t buflen);
 int uv__random_readpath(const char* path, void* buf, size_t buflen);
 int uv__random_sysctl(void* buf, size_t buflen);
+int uv__random_pool_submit(uv_loop_t* loop, uv_random_t* req);
+int uv__random_pool_cancel(uv_random_t* req);
+void uv__random_pool_done(struct uv__work* w, int status);
+void uv__random_loop_fork(uv_loop_t* loop);
+void uv__random_loop_close(uv_loop_t* loop);
 
 #if defined(__APPLE__)
 int uv___stream_fd(const uv_stream_t* handle);
@@ -313,6 +368,23 @@ UV_UNUSED(static void uv__update_time(uv_loop_t* loop)) {
   loop->time = uv__hrtime(UV_CLOCK_FAST) / 1000000;
 }
 
+/* Edge-triggered watchers keep what the kernel reported until the descriptor
+ * would block, the next edge sets it again.
+ */
+#if defined(__linux__)
+UV_UNUSED(static void uv__io_drained(uv__io_t* w, unsigned int events)) {
+  /* Data and the peer's FIN come in one edge, the read that follows the
+   * data returns EOF instead of blocking.
+   */
+  if (w->ready & UV__POLLRDHUP)
+    events &= ~POLLIN;
+
+  w->ready &= ~events;
+}
+#else
+#define uv__io_drained(w, events) ((void) (w))
+#endif
+
 UV_UNUSED(static char* uv__basename_r(const char* path)) {
   char* s;
 
@@ -325,6 +397,28 @@ UV_UNUSED(static char* uv__basename_r(const char* path)) {
 
 #if defined(__linux__)
 int uv__inotify_fork(uv_loop_t* loop, void* old_watchers);
+int uv__epoll_configure_edge(uv_loop_t* loop);
+int uv__epoll_configure_busy_poll(uv_loop_t* loop, unsigned int usec);
+int uv__epoll_configure_batch(uv_loop_t* loop, unsigned int max);
+void uv__io_edge_start(uv_loop_t* loop, uv__io_t* w);
+void uv__io_edge_close(uv_loop_t* loop, uv__io_t* w);
+int uv__io_uring_configure(uv_loop_t* loop);
+int uv__io_uring_configure_streams(uv_loop_t* loop);
+int uv__io_uring_streams(const uv_loop_t* loop);
+void uv__io_uring_recv(uv_loop_t* loop, int fd, uint64_t user_data);
+void uv__io_uring_sendmsg(uv_loop_t* loop,
+                          int fd,
+                          const struct msghdr* msg,
+                          uint64_t user_data);
+void uv__io_uring_accept(uv_loop_t* loop, int fd, uint64_t user_data);
+void uv__io_uring_cancel(uv_loop_t* loop, uint64_t user_data);
+char* uv__io_uring_buf(uv_loop_t* loop, unsigned int bid);
+void uv__io_uring_buf_put(uv_loop_t* loop, unsigned int bid);
+void uv__stream_iou_complete(uv_loop_t* loop,
+                             uint64_t user_data,
+                             int res,
+                             int bid,
+                             int more);
 #endif
 
 typedef int (*uv__peersockfunc)(int, struct sockaddr*, socklen_t*);
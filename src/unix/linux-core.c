@@ -25,6 +25,7 @@
 
 #include "uv.h"
 #include "internal.h"
+#include "linux-syscalls.h"
 
 #include <inttypes.h>
 #include <stdint.h>
@@ -33,9 +34,11 @@
 #include <string.h>
 #include <assert.h>
 #include <errno.h>
+#include <sched.h>
 
 #include <net/if.h>
 #include <sys/epoll.h>
+#include <sys/mman.h>
 #include <sys/param.h>
 #include <sys/prctl.h>
 #include <sys/sysinfo.h>
@@ -82,109 +85,1371 @@ static int read_times(FILE* statfile_fp,
 static void read_speeds(unsigned int numcpus, uv_cpu_info_t* ci);
 static uint64_t read_cpufreq(unsigned int cpunum);
 
+/* The event buffer of uv__io_poll() starts small and grows up to
+ * UV_LOOP_POLL_BATCH_MAX entries while polls fill it.
+ */
+#define UV__POLL_BATCH_MIN 64
+#define UV__POLL_BATCH_DEFAULT 1024
+#define UV__POLL_BATCH_LIMIT (1024 * 1024)
+#define UV__POLL_BATCH_SHRINK 64
+
+/* A uv__io_poll() call that keeps finding a full buffer polls again without
+ * blocking until it has seen this many events, then lets the loop go on to
+ * the timers. Benchmarks suggested 48 polls of 1024 events.
+ */
+#define UV__POLL_EVENTS_PER_CALL (48 * 1024)
+
+/* Edge-triggered watchers are registered once for everything streams wait
+ * for, see uv__io_edge_start().
+ */
+#define UV__EPOLL_EDGE (EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET)
+
+#define UV__IOU_SQ_ENTRIES 256
+#define UV__IOU_CQ_ENTRIES 4096
+
+/* Provided buffers for stream reads with UV_LOOP_IO_URING_STREAMS. */
+#define UV__IOU_BUF_COUNT 64
+#define UV__IOU_BUF_SIZE (64 * 1024)
+#define UV__IOU_BGID 0
+
+/* user_data of the requests whose completions don't matter. */
+#define UV__IOU_IGNORE ((uint64_t) -1)
+
+/* The low bits of user_data tell poll requests (0) from stream requests, see
+ * uv__stream_iou_complete().
+ */
+#define UV__IOU_TAG_MASK 3u
+
+/* The io_uring readiness backend, see uv__io_uring_poll(). */
+struct uv__iou {
+  int ringfd;
+  char* ring;  /* The SQ and CQ rings share a mapping. */
+  size_t ringsize;
+  struct uv__io_uring_sqe* sqes;
+  size_t sqessize;
+  uint32_t* sqhead;
+  uint32_t* sqtail;
+  uint32_t* sqarray;
+  uint32_t sqmask;
+  uint32_t sqentries;
+  uint32_t* cqhead;
+  uint32_t* cqtail;
+  uint32_t cqmask;
+  struct uv__io_uring_cqe* cqes;
+  struct uv__iou_slot* slots;  /* Indexed by file descriptor. */
+  unsigned int nslots;
+  struct uv__io_uring_buf* bufring;  /* NULL without stream requests. */
+  char* bufs;
+  uint16_t buftail;
+  unsigned int ops;  /* Stream requests that haven't completed yet. */
+  /* Completions taken out of a full CQ ring to make room, they are handled
+   * before the ones still in the ring.
+   */
+  struct uv__io_uring_cqe* backlog;
+  unsigned int backlog_head;
+  unsigned int backlog_len;
+  unsigned int backlog_size;
+};
+
+struct uv__iou_slot {
+  uint32_t events;  /* Of the poll request in flight, 0 if there is none. */
+  uint32_t gen;  /* Tells completions of earlier requests apart. */
+};
+
+static unsigned int uv__epoll_repolls(unsigned int size);
+static void uv__iou_delete(struct uv__iou* iou);
+static void uv__iou_drain(uv_loop_t* loop, struct uv__iou* iou);
+static void uv__iou_invalidate(struct uv__iou* iou, int fd);
+
 
 int uv__platform_loop_init(uv_loop_t* loop) {
+  uv__loop_internal_fields_t* lfields;
   int fd;
+
   fd = epoll_create1(O_CLOEXEC);
 
-  /* epoll_create1() can fail either because it's not implemented (old kernel)
-   * or because it doesn't understand the O_CLOEXEC flag.
-   */
-  if (fd == -1 && (errno == ENOSYS || errno == EINVAL)) {
-    fd = epoll_create(256);
+  /* epoll_create1() can fail either because it's not implemented (old kernel)
+   * or because it doesn't understand the O_CLOEXEC flag.
+   */
+  if (fd == -1 && (errno == ENOSYS || errno == EINVAL)) {
+    fd = epoll_create(256);
+
+    if (fd != -1)
+      uv__cloexec(fd, 1);
+  }
+
+  loop->backend_fd = fd;
+  loop->inotify_fd = -1;
+  loop->inotify_watchers = NULL;
+  QUEUE_INIT(&loop->edge_queue);
+
+  if (fd == -1)
+    return UV__ERR(errno);
+
+  /* The maximum is kept across uv_loop_fork(), the buffer starts over. */
+  lfields = uv__get_internal_fields(loop);
+  if (lfields->poll_batch_max == 0)
+    lfields->poll_batch_max = UV__POLL_BATCH_DEFAULT;
+
+  lfields->poll_batch = UV__POLL_BATCH_MIN;
+  lfields->poll_batch_small = 0;
+  lfields->poll_repolls = uv__epoll_repolls(UV__POLL_BATCH_MIN);
+  lfields->poll_events =
+      uv__malloc(UV__POLL_BATCH_MIN * sizeof(struct epoll_event));
+
+  if (lfields->poll_events == NULL) {
+    uv__close(fd);
+    loop->backend_fd = -1;
+    return UV_ENOMEM;
+  }
+
+  return 0;
+}
+
+
+int uv__io_fork(uv_loop_t* loop) {
+  int err;
+  int io_uring;
+  void* old_watchers;
+  unsigned int i;
+  uv__io_t* w;
+
+  /* Reads and writes in flight live in the parent's ring. */
+  if (uv__io_uring_streams(loop))
+    return UV_ENOSYS;
+
+  /* The new epoll set is empty, edge-triggered watchers register again and
+   * the kernel reports their readiness anew.
+   */
+  for (i = 0; i < loop->nwatchers; i++) {
+    w = loop->watchers[i];
+    if (w == NULL || w->edge == 0)
+      continue;
+
+    QUEUE_REMOVE(&w->ready_queue);
+    QUEUE_INIT(&w->ready_queue);
+    w->ready = 0;
+    w->events = 0;
+
+    if (QUEUE_EMPTY(&w->watcher_queue))
+      QUEUE_INSERT_TAIL(&loop->watcher_queue, &w->watcher_queue);
+  }
+
+  old_watchers = loop->inotify_watchers;
+
+  /* The ring is shared with the parent, the child needs one of its own. */
+  io_uring = uv__get_internal_fields(loop)->io_uring != NULL;
+
+  uv__close(loop->backend_fd);
+  loop->backend_fd = -1;
+  uv__platform_loop_delete(loop);
+
+  err = uv__platform_loop_init(loop);
+  if (err)
+    return err;
+
+  if (io_uring) {
+    err = uv__io_uring_configure(loop);
+    if (err)
+      return err;
+  }
+
+  return uv__inotify_fork(loop, old_watchers);
+}
+
+
+void uv__platform_loop_delete(uv_loop_t* loop) {
+  uv__loop_internal_fields_t* lfields;
+
+  lfields = uv__get_internal_fields(loop);
+  if (lfields->io_uring != NULL) {
+    uv__iou_drain(loop, lfields->io_uring);
+    uv__iou_delete(lfields->io_uring);
+    uv__free(lfields->io_uring);
+    lfields->io_uring = NULL;
+  }
+
+  uv__free(lfields->poll_events);
+  lfields->poll_events = NULL;
+
+  if (lfields->poll_stash_nfds != 0) {
+    lfields->poll_stash_nfds = 0;
+    loop->watchers[loop->nwatchers] = NULL;
+    loop->watchers[loop->nwatchers + 1] = NULL;
+  }
+
+  if (loop->inotify_fd == -1) return;
+  uv__io_stop(loop, &loop->inotify_read_watcher, POLLIN);
+  uv__close(loop->inotify_fd);
+  loop->inotify_fd = -1;
+}
+
+
+void uv__platform_invalidate_fd(uv_loop_t* loop, int fd) {
+  struct epoll_event* events;
+  struct epoll_event dummy;
+  struct uv__iou* iou;
+  uintptr_t i;
+  uintptr_t nfds;
+
+  assert(loop->watchers != NULL);
+  assert(fd >= 0);
+
+  iou = uv__get_internal_fields(loop)->io_uring;
+  if (iou != NULL) {
+    uv__iou_invalidate(iou, fd);
+    return;
+  }
+
+  events = (struct epoll_event*) loop->watchers[loop->nwatchers];
+  nfds = (uintptr_t) loop->watchers[loop->nwatchers + 1];
+  if (events != NULL)
+    /* Invalidate events with same file descriptor */
+    for (i = 0; i < nfds; i++)
+      if (events[i].data.fd == fd)
+        events[i].data.fd = -1;
+
+  /* Remove the file descriptor from the epoll.
+   * This avoids a problem where the same file description remains open
+   * in another process, causing repeated junk epoll events.
+   *
+   * We pass in a dummy epoll_event, to work around a bug in old kernels.
+   */
+  if (loop->backend_fd >= 0) {
+    /* Work around a bug in kernels 3.10 to 3.19 where passing a struct that
+     * has the EPOLLWAKEUP flag set generates spurious audit syslog warnings.
+     */
+    memset(&dummy, 0, sizeof(dummy));
+    uv__count_syscall(loop, epoll_ctl);
+    epoll_ctl(loop->backend_fd, EPOLL_CTL_DEL, fd, &dummy);
+  }
+}
+
+
+int uv__io_check_fd(uv_loop_t* loop, int fd) {
+  struct epoll_event e;
+  int rc;
+
+  memset(&e, 0, sizeof(e));
+  e.events = POLLIN;
+  e.data.fd = -1;
+
+  rc = 0;
+  uv__count_syscall(loop, epoll_ctl);
+  if (epoll_ctl(loop->backend_fd, EPOLL_CTL_ADD, fd, &e))
+    if (errno != EEXIST)
+      rc = UV__ERR(errno);
+
+  if (rc == 0) {
+    uv__count_syscall(loop, epoll_ctl);
+    if (epoll_ctl(loop->backend_fd, EPOLL_CTL_DEL, fd, &e))
+      abort();
+  }
+
+  return rc;
+}
+
+
+int uv__epoll_configure_edge(uv_loop_t* loop) {
+  if (uv__get_internal_fields(loop)->io_uring != NULL)
+    return UV_EBUSY;
+
+  if (loop->flags & UV_LOOP_EDGE_TRIGGERED)
+    return UV_EBUSY;
+
+  loop->flags |= UV_LOOP_EDGE_TRIGGERED;
+  return 0;
+}
+
+
+int uv__epoll_configure_busy_poll(uv_loop_t* loop, unsigned int usec) {
+  uv__loop_internal_fields_t* lfields;
+
+  if (usec > 1000000)
+    return UV_EINVAL;
+
+  lfields = uv__get_internal_fields(loop);
+  lfields->busy_poll_max = usec * (uint64_t) 1000;
+  lfields->busy_poll_budget = lfields->busy_poll_max;
+  return 0;
+}
+
+
+int uv__epoll_configure_batch(uv_loop_t* loop, unsigned int max) {
+  if (max < UV__POLL_BATCH_MIN || max > UV__POLL_BATCH_LIMIT)
+    return UV_EINVAL;
+
+  /* A smaller buffer takes effect after the next poll. */
+  uv__get_internal_fields(loop)->poll_batch_max = max;
+  return 0;
+}
+
+
+static unsigned int uv__epoll_repolls(unsigned int size) {
+  if (size >= UV__POLL_EVENTS_PER_CALL)
+    return 1;
+  return UV__POLL_EVENTS_PER_CALL / size;
+}
+
+
+static void uv__epoll_batch_resize(uv_loop_t* loop, unsigned int size) {
+  uv__loop_internal_fields_t* lfields;
+  void* events;
+
+  lfields = uv__get_internal_fields(loop);
+  events = uv__malloc(size * sizeof(struct epoll_event));
+  if (events == NULL)
+    return;  /* Keep the one we have. */
+
+  uv__free(lfields->poll_events);
+  lfields->poll_events = events;
+  lfields->poll_batch = size;
+  lfields->poll_batch_small = 0;
+  lfields->poll_repolls = uv__epoll_repolls(size);
+}
+
+
+/* Size the event buffer after what the last poll returned. A full buffer
+ * means more events are waiting, it doubles. One that was mostly empty
+ * UV__POLL_BATCH_SHRINK times in a row halves, a loop that was busy once
+ * doesn't hold on to a large buffer forever.
+ */
+static void uv__epoll_batch_update(uv_loop_t* loop, int nfds) {
+  uv__loop_internal_fields_t* lfields;
+  unsigned int size;
+
+  lfields = uv__get_internal_fields(loop);
+  size = lfields->poll_batch;
+
+  if (size > lfields->poll_batch_max) {
+    uv__epoll_batch_resize(loop, lfields->poll_batch_max);
+    return;
+  }
+
+  if ((unsigned int) nfds == size) {
+    if (size < lfields->poll_batch_max) {
+      size *= 2;
+      if (size > lfields->poll_batch_max)
+        size = lfields->poll_batch_max;
+      uv__epoll_batch_resize(loop, size);
+    }
+    return;
+  }
+
+  if ((unsigned int) nfds > size / 4 || size == UV__POLL_BATCH_MIN) {
+    lfields->poll_batch_small = 0;
+    return;
+  }
+
+  if (++lfields->poll_batch_small < UV__POLL_BATCH_SHRINK)
+    return;
+
+  size /= 2;
+  if (size < UV__POLL_BATCH_MIN)
+    size = UV__POLL_BATCH_MIN;
+  uv__epoll_batch_resize(loop, size);
+}
+
+
+/* Poll without blocking until events come in, the spin budget is used up or
+ * the timeout expires. Completions of fs requests that go through Linux AIO
+ * show up too, their eventfd is in the epoll set. Returns the number of
+ * events, 0 when the loop has to block after all. Each miss halves the
+ * budget, an idle loop stops spinning soon.
+ */
+static int uv__epoll_busy_poll(uv_loop_t* loop,
+                               struct epoll_event* events,
+                               int maxevents,
+                               int timeout,
+                               uint64_t start) {
+  uv__loop_internal_fields_t* lfields;
+  uint64_t budget;
+  uint64_t now;
+  int nfds;
+
+  lfields = uv__get_internal_fields(loop);
+  budget = lfields->busy_poll_budget;
+  if (timeout > 0 && budget > timeout * (uint64_t) 1000000)
+    budget = timeout * (uint64_t) 1000000;
+
+  do {
+    uv__count_syscall(loop, epoll_wait);
+    nfds = epoll_wait(loop->backend_fd, events, maxevents, 0);
+    now = uv__hrtime(UV_CLOCK_PRECISE);
+    if (nfds == -1 && errno != EINTR)
+      break;  /* Let uv__io_poll() deal with it. */
+
+    /* Whatever is going to produce the events may be waiting for this CPU,
+     * it's free to go when nothing else wants to run.
+     */
+    if (nfds <= 0)
+      sched_yield();
+  } while (nfds <= 0 && now - start < budget);
+
+  uv__get_loop_metrics(loop)->busy_poll_time += now - start;
+
+  if (nfds > 0)
+    return nfds;
+
+  /* Spinning for less than a system call takes isn't worth it. */
+  lfields->busy_poll_budget /= 2;
+  if (lfields->busy_poll_budget < 1000)
+    lfields->busy_poll_budget = 0;
+
+  return 0;
+}
+
+
+/* The loop waited |gap| nanoseconds for events. Had it spun that long it
+ * would have saved the wakeup, so let the next poll spin twice that.
+ */
+static void uv__epoll_busy_poll_update(uv_loop_t* loop, uint64_t gap) {
+  uv__loop_internal_fields_t* lfields;
+
+  lfields = uv__get_internal_fields(loop);
+  if (gap > lfields->busy_poll_max)
+    return;
+
+  gap *= 2;
+  if (gap > lfields->busy_poll_max)
+    gap = lfields->busy_poll_max;
+
+  if (gap > lfields->busy_poll_budget)
+    lfields->busy_poll_budget = gap;
+}
+
+
+/* Queue the watcher for uv__io_edge_run() when the kernel already reported
+ * what it waits for. Errors and hangups are remembered too, they don't come
+ * again once reported.
+ */
+static void uv__io_edge_ready(uv_loop_t* loop, uv__io_t* w) {
+  if (w->pevents == 0)
+    return;
+
+  if ((w->ready & (w->pevents | POLLERR | POLLHUP)) == 0)
+    return;
+
+  if (QUEUE_EMPTY(&w->ready_queue))
+    QUEUE_INSERT_TAIL(&loop->edge_queue, &w->ready_queue);
+}
+
+
+/* Edge-triggered watchers are added to the epoll set once, for reads and
+ * writes both. uv__io_stop() only clears pevents and the events that come in
+ * meanwhile are kept in w->ready, that saves an epoll_ctl() call every time
+ * a stream starts or stops waiting for POLLOUT.
+ */
+void uv__io_edge_start(uv_loop_t* loop, uv__io_t* w) {
+  uv__io_t* old;
+
+  /* Handles can share a descriptor, stdio for one. When the one that has it
+   * doesn't wait for anything it gives way and registers again later.
+   */
+  old = loop->watchers[w->fd];
+  if (old != NULL && old != w && old->edge != 0 && old->pevents == 0) {
+    uv__io_edge_close(loop, old);
+    old = NULL;
+  }
+
+  if (w->events == 0 && QUEUE_EMPTY(&w->watcher_queue))
+    QUEUE_INSERT_TAIL(&loop->watcher_queue, &w->watcher_queue);
+
+  if (old == NULL) {
+    loop->watchers[w->fd] = w;
+    loop->nfds++;
+  }
+
+  uv__io_edge_ready(loop, w);
+}
+
+
+void uv__io_edge_close(uv_loop_t* loop, uv__io_t* w) {
+  QUEUE_REMOVE(&w->watcher_queue);
+  QUEUE_INIT(&w->watcher_queue);
+  QUEUE_REMOVE(&w->ready_queue);
+  QUEUE_INIT(&w->ready_queue);
+  w->events = 0;
+  w->ready = 0;
+
+  if (w->fd == -1 || (unsigned) w->fd >= loop->nwatchers)
+    return;
+
+  if (loop->watchers[w->fd] == w) {
+    assert(loop->nfds > 0);
+    loop->watchers[w->fd] = NULL;
+    loop->nfds--;
+  }
+}
+
+
+/* Run the watchers that stopped before the descriptor would block. The
+ * kernel doesn't report them again so this is what rearms them. Each one
+ * runs once per call, watchers that still have work left queue up for the
+ * next loop iteration and don't starve the others.
+ */
+static int uv__io_edge_run(uv_loop_t* loop) {
+  unsigned int events;
+  QUEUE queue;
+  QUEUE* q;
+  uv__io_t* w;
+  int nevents;
+  int fd;
+
+  nevents = 0;
+  QUEUE_MOVE(&loop->edge_queue, &queue);
+
+  while (!QUEUE_EMPTY(&queue)) {
+    q = QUEUE_HEAD(&queue);
+    QUEUE_REMOVE(q);
+    QUEUE_INIT(q);
+
+    w = QUEUE_DATA(q, uv__io_t, ready_queue);
+    if (w->pevents == 0)
+      continue;
+
+    events = w->ready & (w->pevents | POLLERR | POLLHUP);
+    if (events == 0)
+      continue;
+
+    /* Out of budget, it keeps its place for the next call. */
+    if (uv__run_budget_take(loop)) {
+      QUEUE_INSERT_TAIL(&loop->edge_queue, q);
+      continue;
+    }
+
+    /* See the note on the epoll quirk in uv__io_poll(). */
+    if (events == POLLERR || events == POLLHUP)
+      events |= w->pevents & (POLLIN | POLLOUT);
+
+    fd = w->fd;
+    uv__metrics_update_idle_time(loop);
+    uv__trace(loop, UV_TRACE_IO, UV_UNKNOWN_HANDLE, fd, events);
+    uv__loop_callback(loop, UV_UNKNOWN_HANDLE, NULL, w->cb, fd);
+    w->cb(loop, w, events);
+    nevents++;
+
+    if (loop->watchers[fd] == w)
+      uv__io_edge_ready(loop, w);
+  }
+
+  return nevents;
+}
+
+
+static void uv__iou_delete(struct uv__iou* iou) {
+  if (iou->bufring != NULL)
+    munmap(iou->bufring, UV__IOU_BUF_COUNT * sizeof(*iou->bufring));
+
+  uv__free(iou->bufs);
+  uv__free(iou->backlog);
+
+  if (iou->sqes != NULL)
+    munmap(iou->sqes, iou->sqessize);
+
+  if (iou->ring != NULL)
+    munmap(iou->ring, iou->ringsize);
+
+  if (iou->ringfd != -1)
+    uv__close(iou->ringfd);
+
+  uv__free(iou->slots);
+}
+
+
+static int uv__iou_init(struct uv__iou* iou) {
+  struct uv__io_uring_params params;
+  size_t cqsize;
+  void* p;
+  int err;
+
+  memset(iou, 0, sizeof(*iou));
+  memset(&params, 0, sizeof(params));
+  params.flags = UV__IORING_SETUP_CQSIZE | UV__IORING_SETUP_CLAMP;
+  params.cq_entries = UV__IOU_CQ_ENTRIES;
+
+  iou->ringfd = uv__io_uring_setup(UV__IOU_SQ_ENTRIES, &params);
+  if (iou->ringfd == -1)
+    return UV__ERR(errno);
+
+  /* The extended io_uring_enter() arguments (timeouts, signal masks) arrived
+   * in 5.11, together with everything else used here.
+   */
+  err = UV_ENOSYS;
+  if (!(params.features & UV__IORING_FEAT_SINGLE_MMAP) ||
+      !(params.features & UV__IORING_FEAT_NODROP) ||
+      !(params.features & UV__IORING_FEAT_EXT_ARG))
+    goto fail;
+
+  err = uv__cloexec(iou->ringfd, 1);
+  if (err)
+    goto fail;
+
+  iou->ringsize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  cqsize = params.cq_off.cqes +
+           params.cq_entries * sizeof(struct uv__io_uring_cqe);
+  if (iou->ringsize < cqsize)
+    iou->ringsize = cqsize;
+
+  p = mmap(NULL,
+           iou->ringsize,
+           PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_POPULATE,
+           iou->ringfd,
+           UV__IORING_OFF_SQ_RING);
+  if (p == MAP_FAILED) {
+    err = UV__ERR(errno);
+    goto fail;
+  }
+  iou->ring = p;
+
+  iou->sqessize = params.sq_entries * sizeof(struct uv__io_uring_sqe);
+  p = mmap(NULL,
+           iou->sqessize,
+           PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_POPULATE,
+           iou->ringfd,
+           UV__IORING_OFF_SQES);
+  if (p == MAP_FAILED) {
+    err = UV__ERR(errno);
+    goto fail;
+  }
+  iou->sqes = p;
+
+  iou->sqhead = (uint32_t*) (iou->ring + params.sq_off.head);
+  iou->sqtail = (uint32_t*) (iou->ring + params.sq_off.tail);
+  iou->sqarray = (uint32_t*) (iou->ring + params.sq_off.array);
+  iou->sqmask = *(uint32_t*) (iou->ring + params.sq_off.ring_mask);
+  iou->sqentries = params.sq_entries;
+  iou->cqhead = (uint32_t*) (iou->ring + params.cq_off.head);
+  iou->cqtail = (uint32_t*) (iou->ring + params.cq_off.tail);
+  iou->cqmask = *(uint32_t*) (iou->ring + params.cq_off.ring_mask);
+  iou->cqes = (struct uv__io_uring_cqe*) (iou->ring + params.cq_off.cqes);
+
+  return 0;
+
+fail:
+  uv__iou_delete(iou);
+  memset(iou, 0, sizeof(*iou));
+  iou->ringfd = -1;
+  return err;
+}
+
+
+static int uv__iou_cqe_stale(const struct uv__iou* iou,
+                             const struct uv__io_uring_cqe* cqe) {
+  unsigned int fd;
+
+  if (cqe->user_data == UV__IOU_IGNORE)
+    return 1;
+
+  if (cqe->user_data & UV__IOU_TAG_MASK)
+    return 0;
+
+  fd = (uint32_t) cqe->user_data >> 2;
+  return fd >= iou->nslots ||
+         iou->slots[fd].gen != (uint32_t) (cqe->user_data >> 32);
+}
+
+
+/* Empties the CQ ring so the kernel can flush the completions it is holding
+ * back. Stale ones are dropped, the others go to the backlog. Returns zero
+ * if the ring was empty already.
+ */
+static int uv__iou_reap(struct uv__iou* iou) {
+  struct uv__io_uring_cqe* backlog;
+  struct uv__io_uring_cqe* cqe;
+  unsigned int size;
+  uint32_t head;
+  uint32_t tail;
+
+  head = *iou->cqhead;
+  tail = uv__atomic_load(iou->cqtail);
+  if (head == tail)
+    return 0;
+
+  for (; head != tail; head++) {
+    cqe = &iou->cqes[head & iou->cqmask];
+    if (uv__iou_cqe_stale(iou, cqe))
+      continue;
+
+    if (iou->backlog_len == iou->backlog_size) {
+      size = iou->backlog_size ? 2 * iou->backlog_size : 64;
+      backlog = uv__realloc(iou->backlog, size * sizeof(*backlog));
+      if (backlog == NULL)
+        abort();
+      iou->backlog = backlog;
+      iou->backlog_size = size;
+    }
+
+    iou->backlog[iou->backlog_len++] = *cqe;
+  }
+
+  uv__atomic_store(iou->cqhead, head);
+  return 1;
+}
+
+
+/* The oldest completion that hasn't been handled yet, NULL if there is
+ * none. uv__iou_next_cqe() consumes it.
+ */
+static struct uv__io_uring_cqe* uv__iou_peek_cqe(struct uv__iou* iou) {
+  uint32_t head;
+
+  if (iou->backlog_head < iou->backlog_len)
+    return &iou->backlog[iou->backlog_head];
+
+  head = *iou->cqhead;
+  if (head == uv__atomic_load(iou->cqtail))
+    return NULL;
+
+  return &iou->cqes[head & iou->cqmask];
+}
+
+
+static void uv__iou_next_cqe(struct uv__iou* iou) {
+  if (iou->backlog_head < iou->backlog_len) {
+    if (++iou->backlog_head == iou->backlog_len)
+      iou->backlog_head = iou->backlog_len = 0;
+    return;
+  }
+
+  uv__atomic_store(iou->cqhead, *iou->cqhead + 1);
+}
+
+
+/* Hand the queued requests to the kernel. The kernel refuses new requests
+ * while it is holding back completions that don't fit in the CQ ring
+ * (EBUSY) or when it is short on memory (EAGAIN). Make room in the ring and
+ * try again; if that isn't possible the requests stay queued and go out with
+ * the next uv__io_uring_poll(). Returns the number of requests still queued.
+ */
+static uint32_t uv__iou_submit(struct uv__iou* iou) {
+  uint32_t pending;
+  int rc;
+
+  for (;;) {
+    pending = *iou->sqtail - uv__atomic_load(iou->sqhead);
+    if (pending == 0)
+      return 0;
+
+    rc = uv__io_uring_enter(iou->ringfd, pending, 0, 0, NULL, 0);
+    if (rc != -1 || errno == EINTR)
+      continue;
+
+    if (errno != EBUSY && errno != EAGAIN)
+      abort();
+
+    if (!uv__iou_reap(iou))
+      return pending;
+  }
+}
+
+
+static struct uv__io_uring_sqe* uv__iou_get_sqe(struct uv__iou* iou) {
+  struct uv__io_uring_sqe* sqe;
+  uint32_t tail;
+  uint32_t slot;
+
+  /* There is nothing left to reap when the kernel still won't take the
+   * entries, and no slot to hand out.
+   */
+  tail = *iou->sqtail;
+  if (tail - uv__atomic_load(iou->sqhead) == iou->sqentries)
+    if (uv__iou_submit(iou) == iou->sqentries)
+      abort();
+
+  /* Without SQPOLL the kernel only looks at the ring in io_uring_enter(), it
+   * doesn't matter that the tail moves before the entry is filled in.
+   */
+  slot = tail & iou->sqmask;
+  sqe = &iou->sqes[slot];
+  memset(sqe, 0, sizeof(*sqe));
+  iou->sqarray[slot] = slot;
+  uv__atomic_store(iou->sqtail, tail + 1);
+
+  return sqe;
+}
+
+
+static struct uv__iou_slot* uv__iou_slot(struct uv__iou* iou, int fd) {
+  struct uv__iou_slot* slots;
+  unsigned int nslots;
+
+  if ((unsigned int) fd < iou->nslots)
+    return &iou->slots[fd];
+
+  nslots = iou->nslots ? iou->nslots : 64;
+  while (nslots <= (unsigned int) fd)
+    nslots *= 2;
+
+  slots = uv__realloc(iou->slots, nslots * sizeof(*slots));
+  if (slots == NULL)
+    abort();
+
+  memset(slots + iou->nslots, 0, (nslots - iou->nslots) * sizeof(*slots));
+  iou->slots = slots;
+  iou->nslots = nslots;
+
+  return &iou->slots[fd];
+}
+
+
+static uint64_t uv__iou_user_data(const struct uv__iou_slot* slot, int fd) {
+  return (uint64_t) slot->gen << 32 | (uint32_t) fd << 2;
+}
+
+
+static void uv__iou_poll_remove(struct uv__iou* iou,
+                                struct uv__iou_slot* slot,
+                                int fd) {
+  struct uv__io_uring_sqe* sqe;
+
+  if (slot->events != 0) {
+    sqe = uv__iou_get_sqe(iou);
+    sqe->opcode = UV__IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = uv__iou_user_data(slot, fd);
+    sqe->user_data = UV__IOU_IGNORE;
+    slot->events = 0;
+  }
+
+  /* Completions that are already in the ring are stale now. */
+  slot->gen++;
+}
+
+
+static void uv__iou_poll_add(struct uv__iou* iou, int fd, uint32_t events) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__iou_slot* slot;
+
+  slot = uv__iou_slot(iou, fd);
+  if (slot->events == events)
+    return;
+
+  uv__iou_poll_remove(iou, slot, fd);
+
+  sqe = uv__iou_get_sqe(iou);
+  sqe->opcode = UV__IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->op_flags = events;
+  sqe->user_data = uv__iou_user_data(slot, fd);
+  slot->events = events;
+}
+
+
+static void uv__iou_invalidate(struct uv__iou* iou, int fd) {
+  struct uv__iou_slot* slot;
+
+  if ((unsigned int) fd >= iou->nslots)
+    return;
+
+  slot = &iou->slots[fd];
+  if (slot->events == 0) {
+    slot->gen++;
+    return;
+  }
+
+  /* A poll request keeps the file open, cancel it before the descriptor is
+   * closed rather than on the next loop iteration.
+   */
+  uv__iou_poll_remove(iou, slot, fd);
+  uv__iou_submit(iou);
+}
+
+
+static void uv__iou_buf_put(struct uv__iou* iou, unsigned int bid) {
+  struct uv__io_uring_buf* buf;
+
+  buf = &iou->bufring[iou->buftail & (UV__IOU_BUF_COUNT - 1)];
+  buf->addr = (uintptr_t) (iou->bufs + bid * UV__IOU_BUF_SIZE);
+  buf->len = UV__IOU_BUF_SIZE;
+  buf->bid = bid;
+
+  /* The tail of the ring is the resv field of the first entry. */
+  iou->buftail++;
+  uv__atomic_store(&iou->bufring[0].resv, iou->buftail);
+}
+
+
+static int uv__iou_bufs_init(struct uv__iou* iou) {
+  struct uv__io_uring_buf_reg reg;
+  unsigned int i;
+  size_t size;
+  void* p;
+  int err;
+
+  /* The ring must be page aligned. */
+  size = UV__IOU_BUF_COUNT * sizeof(*iou->bufring);
+  p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED)
+    return UV__ERR(errno);
+
+  iou->bufs = uv__malloc(UV__IOU_BUF_COUNT * UV__IOU_BUF_SIZE);
+  if (iou->bufs == NULL) {
+    munmap(p, size);
+    return UV_ENOMEM;
+  }
+
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = (uintptr_t) p;
+  reg.ring_entries = UV__IOU_BUF_COUNT;
+  reg.bgid = UV__IOU_BGID;
+
+  if (uv__io_uring_register(iou->ringfd, UV__IORING_REGISTER_PBUF_RING, &reg, 1)) {
+    /* Kernels before 5.19 don't know the opcode. */
+    err = errno == EINVAL ? UV_ENOSYS : UV__ERR(errno);
+    uv__free(iou->bufs);
+    iou->bufs = NULL;
+    munmap(p, size);
+    return err;
+  }
+
+  iou->bufring = p;
+  for (i = 0; i < UV__IOU_BUF_COUNT; i++)
+    uv__iou_buf_put(iou, i);
+
+  return 0;
+}
+
 
-    if (fd != -1)
-      uv__cloexec(fd, 1);
+/* Hands the completions of stream requests to stream.c. */
+static void uv__iou_complete(uv_loop_t* loop,
+                             struct uv__iou* iou,
+                             uint64_t user_data,
+                             int32_t res,
+                             uint32_t flags) {
+  int more;
+  int bid;
+
+  /* A multishot request stays in flight until its last completion. */
+  more = !!(flags & UV__IORING_CQE_F_MORE);
+  if (!more) {
+    assert(iou->ops > 0);
+    iou->ops--;
   }
 
-  loop->backend_fd = fd;
-  loop->inotify_fd = -1;
-  loop->inotify_watchers = NULL;
+  bid = -1;
+  if (flags & UV__IORING_CQE_F_BUFFER)
+    bid = flags >> UV__IORING_CQE_BUFFER_SHIFT;
 
-  if (fd == -1)
-    return UV__ERR(errno);
+  uv__stream_iou_complete(loop, user_data, res, bid, more);
+}
 
-  return 0;
+
+/* Closed streams cancel their requests, wait for the completions before the
+ * ring goes away so the requests can release their memory.
+ */
+static void uv__iou_drain(uv_loop_t* loop, struct uv__iou* iou) {
+  struct uv__io_uring_cqe* cqe;
+  uint64_t user_data;
+  uint32_t flags;
+  int32_t res;
+  int rc;
+
+  for (;;) {
+    /* The backlog can hold completions the kernel won't report again. */
+    while ((cqe = uv__iou_peek_cqe(iou)) != NULL) {
+      user_data = cqe->user_data;
+      res = cqe->res;
+      flags = cqe->flags;
+      uv__iou_next_cqe(iou);
+
+      if (user_data != UV__IOU_IGNORE && (user_data & UV__IOU_TAG_MASK))
+        uv__iou_complete(loop, iou, user_data, res, flags);
+    }
+
+    if (iou->ops == 0)
+      return;
+
+    rc = uv__io_uring_enter(iou->ringfd,
+                            *iou->sqtail - uv__atomic_load(iou->sqhead),
+                            1,
+                            UV__IORING_ENTER_GETEVENTS,
+                            NULL,
+                            0);
+    if (rc == -1 && errno != EINTR && errno != EBUSY && errno != EAGAIN)
+      abort();
+  }
 }
 
 
-int uv__io_fork(uv_loop_t* loop) {
-  int err;
-  void* old_watchers;
+static struct uv__io_uring_sqe* uv__iou_get_op_sqe(uv_loop_t* loop,
+                                                   int opcode,
+                                                   int fd,
+                                                   uint64_t user_data) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__iou* iou;
 
-  old_watchers = loop->inotify_watchers;
+  iou = uv__get_internal_fields(loop)->io_uring;
+  assert(user_data & UV__IOU_TAG_MASK);
 
-  uv__close(loop->backend_fd);
-  loop->backend_fd = -1;
-  uv__platform_loop_delete(loop);
+  sqe = uv__iou_get_sqe(iou);
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->user_data = user_data;
+  iou->ops++;
 
-  err = uv__platform_loop_init(loop);
-  if (err)
-    return err;
+  return sqe;
+}
 
-  return uv__inotify_fork(loop, old_watchers);
+
+void uv__io_uring_recv(uv_loop_t* loop, int fd, uint64_t user_data) {
+  struct uv__io_uring_sqe* sqe;
+
+  /* The kernel picks a buffer once data is there, an idle connection
+   * doesn't tie one up.
+   */
+  sqe = uv__iou_get_op_sqe(loop, UV__IORING_OP_RECV, fd, user_data);
+  sqe->flags = UV__IOSQE_BUFFER_SELECT;
+  sqe->buf_index = UV__IOU_BGID;
 }
 
 
-void uv__platform_loop_delete(uv_loop_t* loop) {
-  if (loop->inotify_fd == -1) return;
-  uv__io_stop(loop, &loop->inotify_read_watcher, POLLIN);
-  uv__close(loop->inotify_fd);
-  loop->inotify_fd = -1;
+void uv__io_uring_sendmsg(uv_loop_t* loop,
+                          int fd,
+                          const struct msghdr* msg,
+                          uint64_t user_data) {
+  struct uv__io_uring_sqe* sqe;
+
+  sqe = uv__iou_get_op_sqe(loop, UV__IORING_OP_SENDMSG, fd, user_data);
+  sqe->addr = (uintptr_t) msg;
+  sqe->len = 1;
 }
 
 
-void uv__platform_invalidate_fd(uv_loop_t* loop, int fd) {
-  struct epoll_event* events;
-  struct epoll_event dummy;
-  uintptr_t i;
-  uintptr_t nfds;
+void uv__io_uring_accept(uv_loop_t* loop, int fd, uint64_t user_data) {
+  struct uv__io_uring_sqe* sqe;
 
-  assert(loop->watchers != NULL);
-  assert(fd >= 0);
+  sqe = uv__iou_get_op_sqe(loop, UV__IORING_OP_ACCEPT, fd, user_data);
+  sqe->ioprio = UV__IORING_ACCEPT_MULTISHOT;
+  sqe->op_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+}
 
-  events = (struct epoll_event*) loop->watchers[loop->nwatchers];
-  nfds = (uintptr_t) loop->watchers[loop->nwatchers + 1];
-  if (events != NULL)
-    /* Invalidate events with same file descriptor */
-    for (i = 0; i < nfds; i++)
-      if (events[i].data.fd == fd)
-        events[i].data.fd = -1;
 
-  /* Remove the file descriptor from the epoll.
-   * This avoids a problem where the same file description remains open
-   * in another process, causing repeated junk epoll events.
-   *
-   * We pass in a dummy epoll_event, to work around a bug in old kernels.
+void uv__io_uring_cancel(uv_loop_t* loop, uint64_t user_data) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__iou* iou;
+
+  iou = uv__get_internal_fields(loop)->io_uring;
+  sqe = uv__iou_get_sqe(iou);
+  sqe->opcode = UV__IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = user_data;
+  sqe->user_data = UV__IOU_IGNORE;
+
+  /* Don't wait for the next loop iteration, the caller is about to close the
+   * file descriptor or hand the buffers back to the user.
    */
-  if (loop->backend_fd >= 0) {
-    /* Work around a bug in kernels 3.10 to 3.19 where passing a struct that
-     * has the EPOLLWAKEUP flag set generates spurious audit syslog warnings.
-     */
-    memset(&dummy, 0, sizeof(dummy));
-    epoll_ctl(loop->backend_fd, EPOLL_CTL_DEL, fd, &dummy);
+  uv__iou_submit(iou);
+}
+
+
+char* uv__io_uring_buf(uv_loop_t* loop, unsigned int bid) {
+  struct uv__iou* iou;
+
+  iou = uv__get_internal_fields(loop)->io_uring;
+  assert(bid < UV__IOU_BUF_COUNT);
+
+  return iou->bufs + bid * UV__IOU_BUF_SIZE;
+}
+
+
+void uv__io_uring_buf_put(uv_loop_t* loop, unsigned int bid) {
+  assert(bid < UV__IOU_BUF_COUNT);
+  uv__iou_buf_put(uv__get_internal_fields(loop)->io_uring, bid);
+}
+
+
+int uv__io_uring_streams(const uv_loop_t* loop) {
+  struct uv__iou* iou;
+
+  iou = uv__get_internal_fields(loop)->io_uring;
+  return iou != NULL && iou->bufring != NULL;
+}
+
+
+int uv__io_uring_configure_streams(uv_loop_t* loop) {
+  uv__loop_internal_fields_t* lfields;
+  int err;
+
+  lfields = uv__get_internal_fields(loop);
+  if (lfields->io_uring == NULL) {
+    err = uv__io_uring_configure(loop);
+    if (err)
+      return err;
   }
+
+  if (uv__io_uring_streams(loop))
+    return UV_EBUSY;
+
+  return uv__iou_bufs_init(lfields->io_uring);
 }
 
 
-int uv__io_check_fd(uv_loop_t* loop, int fd) {
+int uv__io_uring_configure(uv_loop_t* loop) {
+  uv__loop_internal_fields_t* lfields;
   struct epoll_event e;
-  int rc;
+  struct uv__iou* iou;
+  unsigned int i;
+  uv__io_t* w;
+  int epfd;
+  int err;
+
+  lfields = uv__get_internal_fields(loop);
+  if (lfields->io_uring != NULL)
+    return UV_EBUSY;
+
+  /* Edge-triggered watchers expect epoll. */
+  if (loop->flags & UV_LOOP_EDGE_TRIGGERED)
+    return UV_EBUSY;
+
+  iou = uv__malloc(sizeof(*iou));
+  if (iou == NULL)
+    return UV_ENOMEM;
+
+  err = uv__iou_init(iou);
+  if (err) {
+    uv__free(iou);
+    return err;
+  }
+
+  /* Swap in an epoll set that holds just the ring. uv_backend_fd() keeps its
+   * value and becomes readable when completions arrive, the registrations
+   * of the watchers go away.
+   */
+  epfd = epoll_create1(O_CLOEXEC);
+  if (epfd == -1)
+    goto fail;
 
   memset(&e, 0, sizeof(e));
   e.events = POLLIN;
   e.data.fd = -1;
+  if (epoll_ctl(epfd, EPOLL_CTL_ADD, iou->ringfd, &e) ||
+      uv__dup3(epfd, loop->backend_fd, O_CLOEXEC) == -1) {
+    uv__close(epfd);
+    goto fail;
+  }
 
-  rc = 0;
-  if (epoll_ctl(loop->backend_fd, EPOLL_CTL_ADD, fd, &e))
-    if (errno != EEXIST)
-      rc = UV__ERR(errno);
+  uv__close(epfd);
+  lfields->io_uring = iou;
 
-  if (rc == 0)
-    if (epoll_ctl(loop->backend_fd, EPOLL_CTL_DEL, fd, &e))
+  for (i = 0; i < loop->nwatchers; i++) {
+    w = loop->watchers[i];
+    if (w == NULL)
+      continue;
+
+    w->events = 0;
+    if (QUEUE_EMPTY(&w->watcher_queue))
+      QUEUE_INSERT_TAIL(&loop->watcher_queue, &w->watcher_queue);
+  }
+
+  return 0;
+
+fail:
+  err = UV__ERR(errno);
+  uv__iou_delete(iou);
+  uv__free(iou);
+  return err;
+}
+
+
+/* Readiness notifications through io_uring. Interest changes are queued as
+ * one-shot IORING_OP_POLL_ADD requests and submitted by the same
+ * io_uring_enter() call that waits for completions. A watcher is polled again
+ * after every event, that keeps the level-triggered semantics of epoll.
+ */
+static void uv__io_uring_poll(uv_loop_t* loop, struct uv__iou* iou, int timeout) {
+  struct uv__io_uring_getevents_arg arg;
+  struct uv__io_uring_cqe* cqe;
+  struct {
+    int64_t tv_sec;
+    long long tv_nsec;
+  } ts;
+  uv__io_t* w;
+  sigset_t sigset;
+  uint64_t user_data;
+  uint64_t base;
+  uint32_t cqe_flags;
+  uint32_t gen;
+  int32_t res;
+  unsigned int flags;
+  unsigned int events;
+  QUEUE* q;
+  int have_signals;
+  int real_timeout;
+  int user_timeout;
+  int reset_timeout;
+  int nevents;
+  int fd;
+  int rc;
+
+  memset(&arg, 0, sizeof(arg));
+  if (loop->flags & UV_LOOP_BLOCK_SIGPROF) {
+    sigemptyset(&sigset);
+    sigaddset(&sigset, SIGPROF);
+    arg.sigmask = (uint64_t) (uintptr_t) &sigset;
+    arg.sigmask_sz = _NSIG / 8;
+  }
+
+  assert(timeout >= -1);
+  base = loop->time;
+  real_timeout = timeout;
+
+  if (uv__get_internal_fields(loop)->flags & UV_METRICS_IDLE_TIME) {
+    reset_timeout = 1;
+    user_timeout = timeout;
+    timeout = 0;
+  } else {
+    reset_timeout = 0;
+  }
+
+  for (;;) {
+    while (!QUEUE_EMPTY(&loop->watcher_queue)) {
+      q = QUEUE_HEAD(&loop->watcher_queue);
+      QUEUE_REMOVE(q);
+      QUEUE_INIT(q);
+
+      w = QUEUE_DATA(q, uv__io_t, watcher_queue);
+      assert(w->pevents != 0);
+      assert(w->fd >= 0);
+      assert(w->fd < (int) loop->nwatchers);
+
+      uv__iou_poll_add(iou, w->fd, w->pevents);
+      w->events = w->pevents;
+    }
+
+    if (timeout != 0)
+      uv__metrics_set_provider_entry_time(loop);
+
+    arg.ts = 0;
+    if (timeout > 0) {
+      ts.tv_sec = timeout / 1000;
+      ts.tv_nsec = (timeout % 1000) * 1000000LL;
+      arg.ts = (uint64_t) (uintptr_t) &ts;
+    }
+
+    uv__trace(loop,
+              UV_TRACE_POLL_ENTER,
+              UV_UNKNOWN_HANDLE,
+              iou->ringfd,
+              timeout);
+
+    /* Don't wait with completions in the backlog. */
+    flags = UV__IORING_ENTER_GETEVENTS | UV__IORING_ENTER_EXT_ARG;
+    rc = uv__io_uring_enter(iou->ringfd,
+                            *iou->sqtail - uv__atomic_load(iou->sqhead),
+                            timeout != 0 && iou->backlog_len == 0,
+                            flags,
+                            &arg,
+                            sizeof(arg));
+
+    if (rc == -1 && errno != ETIME && errno != EINTR && errno != EBUSY)
       abort();
 
-  return rc;
+    SAVE_ERRNO(uv__update_time(loop));
+    SAVE_ERRNO(uv__trace(loop,
+                         UV_TRACE_POLL_EXIT,
+                         UV_UNKNOWN_HANDLE,
+                         iou->ringfd,
+                         uv__atomic_load(iou->cqtail) - *iou->cqhead));
+
+    have_signals = 0;
+    nevents = 0;
+
+    while ((cqe = uv__iou_peek_cqe(iou)) != NULL) {
+      user_data = cqe->user_data;
+      res = cqe->res;
+      cqe_flags = cqe->flags;
+
+      /* Out of budget, the completion stays where it is for the next call. */
+      if (user_data != UV__IOU_IGNORE && uv__run_budget_take(loop))
+        break;
+
+      uv__iou_next_cqe(iou);
+
+      if (user_data == UV__IOU_IGNORE)
+        continue;
+
+      if (user_data & UV__IOU_TAG_MASK) {
+        uv__metrics_update_idle_time(loop);
+        uv__loop_callback(loop, UV_UNKNOWN_HANDLE, NULL, NULL, -1);
+        uv__iou_complete(loop, iou, user_data, res, cqe_flags);
+        nevents++;
+        continue;
+      }
+
+      fd = (int) ((uint32_t) user_data >> 2);
+      gen = (uint32_t) (user_data >> 32);
+      events = res < 0 ? POLLERR : (unsigned int) res;
+      if ((unsigned int) fd >= iou->nslots || iou->slots[fd].gen != gen)
+        continue;  /* Cancelled, or the descriptor was closed. */
+
+      iou->slots[fd].events = 0;
+
+      if ((unsigned int) fd >= loop->nwatchers)
+        continue;
+
+      w = loop->watchers[fd];
+      if (w == NULL)
+        continue;  /* Stopped, nothing to rearm. */
+
+      if (QUEUE_EMPTY(&w->watcher_queue))
+        QUEUE_INSERT_TAIL(&loop->watcher_queue, &w->watcher_queue);
+
+      /* Same filtering as for epoll, see uv__io_poll(). */
+      events &= w->pevents | POLLERR | POLLHUP;
+      if (events == POLLERR || events == POLLHUP)
+        events |= w->pevents & (POLLIN | POLLOUT | UV__POLLRDHUP | UV__POLLPRI);
+
+      if (events == 0)
+        continue;
+
+      if (w == &loop->signal_io_watcher) {
+        have_signals = 1;
+      } else {
+        uv__metrics_update_idle_time(loop);
+        uv__trace(loop, UV_TRACE_IO, UV_UNKNOWN_HANDLE, fd, events);
+        uv__loop_callback(loop, UV_UNKNOWN_HANDLE, NULL, w->cb, fd);
+        w->cb(loop, w, events);
+      }
+
+      nevents++;
+    }
+
+    if (reset_timeout != 0) {
+      timeout = user_timeout;
+      reset_timeout = 0;
+      if (nevents == 0 && !have_signals)
+        continue;
+    }
+
+    if (have_signals != 0) {
+      uv__metrics_update_idle_time(loop);
+      uv__loop_callback(loop,
+                        UV_UNKNOWN_HANDLE,
+                        NULL,
+                        loop->signal_io_watcher.cb,
+                        loop->signal_io_watcher.fd);
+      loop->signal_io_watcher.cb(loop, &loop->signal_io_watcher, POLLIN);
+      return;  /* Event loop should cycle now so don't poll again. */
+    }
+
+    if (nevents != 0)
+      return;
+
+    if (timeout == 0)
+      return;
+
+    if (timeout == -1)
+      continue;
+
+    real_timeout -= (loop->time - base);
+    if (real_timeout <= 0)
+      return;
+
+    timeout = real_timeout;
+  }
 }
 
 
@@ -202,7 +1467,8 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
   static int no_epoll_wait_cached;
   int no_epoll_pwait;
   int no_epoll_wait;
-  struct epoll_event events[1024];
+  uv__loop_internal_fields_t* lfields;
+  struct epoll_event* events;
   struct epoll_event* pe;
   struct epoll_event e;
   int real_timeout;
@@ -213,19 +1479,33 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
   uint64_t base;
   int have_signals;
   int nevents;
-  int count;
+  int maxevents;
+  int budget;
+  int full;
   int nfds;
   int fd;
   int op;
   int i;
   int user_timeout;
   int reset_timeout;
-
-  if (loop->nfds == 0) {
+  int buffered;
+  int leftover;
+  int first;
+  uint64_t poll_start;
+  struct uv__iou* iou;
+
+  /* Stream requests don't show up in nfds. */
+  iou = uv__get_internal_fields(loop)->io_uring;
+  if (loop->nfds == 0 && (iou == NULL || iou->ops == 0)) {
     assert(QUEUE_EMPTY(&loop->watcher_queue));
     return;
   }
 
+  if (iou != NULL) {
+    uv__io_uring_poll(loop, iou, timeout);
+    return;
+  }
+
   memset(&e, 0, sizeof(e));
 
   while (!QUEUE_EMPTY(&loop->watcher_queue)) {
@@ -234,21 +1514,33 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
     QUEUE_INIT(q);
 
     w = QUEUE_DATA(q, uv__io_t, watcher_queue);
-    assert(w->pevents != 0);
+    assert(w->pevents != 0 || w->edge != 0);
     assert(w->fd >= 0);
     assert(w->fd < (int) loop->nwatchers);
 
     e.events = w->pevents;
     e.data.fd = w->fd;
 
+    if (w->edge != 0)
+      e.events = UV__EPOLL_EDGE;
+
     if (w->events == 0)
       op = EPOLL_CTL_ADD;
     else
       op = EPOLL_CTL_MOD;
 
-    /* XXX Future optimization: do EPOLL_CTL_MOD lazily if we stop watching
-     * events, skip the syscall and squelch the events after epoll_wait().
+    /* w->events is what the kernel has. When the watcher wants no more than
+     * that, stopping POLLOUT after a write for one, leave the kernel alone.
+     * The events that aren't wanted anymore are squelched after epoll_wait()
+     * and the mask is narrowed then, should they come in.
      */
+    if (op == EPOLL_CTL_MOD && w->edge == 0 &&
+        (w->pevents & ~w->events) == 0) {
+      uv__get_loop_metrics(loop)->epoll_ctl_elided++;
+      continue;
+    }
+
+    uv__count_syscall(loop, epoll_ctl);
     if (epoll_ctl(loop->backend_fd, op, w->fd, &e)) {
       if (errno != EEXIST)
         abort();
@@ -256,13 +1548,20 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
       assert(op == EPOLL_CTL_ADD);
 
       /* We've reactivated a file descriptor that's been watched before. */
+      uv__count_syscall(loop, epoll_ctl);
       if (epoll_ctl(loop->backend_fd, EPOLL_CTL_MOD, w->fd, &e))
         abort();
     }
 
-    w->events = w->pevents;
+    w->events = e.events;
   }
 
+  /* Watchers that were left with work to do must not wait for an edge that
+   * isn't coming, nor wait in epoll_wait() behind them.
+   */
+  if (uv__io_edge_run(loop) != 0 || !QUEUE_EMPTY(&loop->edge_queue))
+    timeout = 0;
+
   sigmask = 0;
   if (loop->flags & UV_LOOP_BLOCK_SIGPROF) {
     sigemptyset(&sigset);
@@ -272,8 +1571,47 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
 
   assert(timeout >= -1);
   base = loop->time;
-  count = 48; /* Benchmarks suggest this gives the best throughput. */
+  budget = UV__POLL_EVENTS_PER_CALL;
   real_timeout = timeout;
+  lfields = uv__get_internal_fields(loop);
+  events = lfields->poll_events;
+  maxevents = lfields->poll_batch;
+
+  /* Events that the last uv_run(UV_RUN_BUDGET) call had no budget for go
+   * first. Polling again would report them in the same order, the ones at
+   * the back would never get their turn.
+   */
+  buffered = 0;
+  leftover = 0;
+  first = 0;
+  if (lfields->poll_stash_nfds != 0) {
+    buffered = lfields->poll_stash_nfds;
+    leftover = 1;
+    first = lfields->poll_stash;
+    lfields->poll_stash_nfds = 0;
+    timeout = 0;
+  }
+
+  /* Spin for a bit before blocking, the wakeup from epoll_wait() is what
+   * dominates the latency of a loop that gets a steady stream of events.
+   */
+  poll_start = 0;
+  if (timeout != 0 && lfields->busy_poll_max != 0) {
+    poll_start = uv__hrtime(UV_CLOCK_PRECISE);
+    if (lfields->busy_poll_budget != 0) {
+      buffered = uv__epoll_busy_poll(loop,
+                                     events,
+                                     maxevents,
+                                     timeout,
+                                     poll_start);
+      SAVE_ERRNO(uv__update_time(loop));
+      if (timeout > 0) {
+        timeout = real_timeout - (loop->time - base);
+        if (timeout < 0)
+          timeout = 0;
+      }
+    }
+  }
 
   if (uv__get_internal_fields(loop)->flags & UV_METRICS_IDLE_TIME) {
     reset_timeout = 1;
@@ -293,10 +1631,14 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
   no_epoll_wait = uv__load_relaxed(&no_epoll_wait_cached);
 
   for (;;) {
+    /* The event buffer may have been resized after the last round. */
+    events = lfields->poll_events;
+    maxevents = lfields->poll_batch;
+
     /* Only need to set the provider_entry_time if timeout != 0. The function
      * will return early if the loop isn't configured with UV_METRICS_IDLE_TIME.
      */
-    if (timeout != 0)
+    if (timeout != 0 && buffered == 0)
       uv__metrics_set_provider_entry_time(loop);
 
     /* See the comment for max_safe_timeout for an explanation of why
@@ -309,10 +1651,21 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
       if (pthread_sigmask(SIG_BLOCK, &sigset, NULL))
         abort();
 
-    if (no_epoll_wait != 0 || (sigmask != 0 && no_epoll_pwait == 0)) {
+    uv__trace(loop,
+              UV_TRACE_POLL_ENTER,
+              UV_UNKNOWN_HANDLE,
+              loop->backend_fd,
+              buffered != 0 ? 0 : timeout);
+
+    if (buffered != 0) {
+      /* Events that came in while spinning or were left over. */
+      nfds = buffered;
+      buffered = 0;
+    } else if (no_epoll_wait != 0 || (sigmask != 0 && no_epoll_pwait == 0)) {
+      uv__count_syscall(loop, epoll_wait);
       nfds = epoll_pwait(loop->backend_fd,
                          events,
-                         ARRAY_SIZE(events),
+                         maxevents,
                          timeout,
                          &sigset);
       if (nfds == -1 && errno == ENOSYS) {
@@ -320,9 +1673,10 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
         no_epoll_pwait = 1;
       }
     } else {
+      uv__count_syscall(loop, epoll_wait);
       nfds = epoll_wait(loop->backend_fd,
                         events,
-                        ARRAY_SIZE(events),
+                        maxevents,
                         timeout);
       if (nfds == -1 && errno == ENOSYS) {
         uv__store_relaxed(&no_epoll_wait_cached, 1);
@@ -339,10 +1693,23 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
      * operating system didn't reschedule our process while in the syscall.
      */
     SAVE_ERRNO(uv__update_time(loop));
+    SAVE_ERRNO(uv__trace(loop,
+                         UV_TRACE_POLL_EXIT,
+                         UV_UNKNOWN_HANDLE,
+                         loop->backend_fd,
+                         nfds > 0 ? nfds : 0));
+
+    if (poll_start != 0 && nfds > 0) {
+      uv__epoll_busy_poll_update(loop,
+                                 uv__hrtime(UV_CLOCK_PRECISE) - poll_start);
+      poll_start = 0;
+    }
 
     if (nfds == 0) {
       assert(timeout != -1);
 
+      uv__epoll_batch_update(loop, 0);
+
       if (reset_timeout != 0) {
         timeout = user_timeout;
         reset_timeout = 0;
@@ -401,7 +1768,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
       loop->watchers[loop->nwatchers + 1] = (void*) (uintptr_t) nfds;
     }
 
-    for (i = 0; i < nfds; i++) {
+    for (i = first; i < nfds; i++) {
       pe = events + i;
       fd = pe->data.fd;
 
@@ -420,10 +1787,47 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
          * Ignore all errors because we may be racing with another thread
          * when the file descriptor is closed.
          */
+        uv__count_syscall(loop, epoll_ctl);
         epoll_ctl(loop->backend_fd, EPOLL_CTL_DEL, fd, pe);
         continue;
       }
 
+      /* Out of budget, the rest waits in the buffer for the next call. */
+      if (uv__run_budget_take(loop)) {
+        lfields->poll_stash = i;
+        lfields->poll_stash_nfds = nfds;
+        break;
+      }
+
+      /* Edge-triggered watchers keep what the kernel reported until it's
+       * used up, uv__io_edge_run() hands it over when they start again.
+       */
+      if (w->edge != 0) {
+        w->ready |= pe->events;
+        pe->events = w->ready;
+        if (w->pevents == 0)
+          continue;
+      }
+
+      /* The kernel reported something the watcher stopped waiting for and
+       * will keep doing so, level-triggered as it is. Catch up on the
+       * epoll_ctl() call that was skipped. A watcher that changed its mind
+       * in an earlier callback is still queued, this call stands in for the
+       * one it waits for.
+       */
+      if (w->edge == 0 && (pe->events & w->events & ~w->pevents) != 0) {
+        e.events = w->pevents;
+        e.data.fd = fd;
+        uv__count_syscall(loop, epoll_ctl);
+        if (epoll_ctl(loop->backend_fd, EPOLL_CTL_MOD, fd, &e) == 0) {
+          if (QUEUE_EMPTY(&w->watcher_queue))
+            uv__get_loop_metrics(loop)->epoll_ctl_elided--;
+          QUEUE_REMOVE(&w->watcher_queue);
+          QUEUE_INIT(&w->watcher_queue);
+          w->events = e.events;
+        }
+      }
+
       /* Give users only events they're interested in. Prevents spurious
        * callbacks when previous callback invocation in this loop has stopped
        * the current watcher. Also, filters out events that users has not
@@ -458,7 +1862,12 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
           have_signals = 1;
         } else {
           uv__metrics_update_idle_time(loop);
+          uv__trace(loop, UV_TRACE_IO, UV_UNKNOWN_HANDLE, fd, pe->events);
+          uv__loop_callback(loop, UV_UNKNOWN_HANDLE, NULL, w->cb, fd);
           w->cb(loop, w, pe->events);
+
+          if (loop->watchers[fd] == w && w->edge != 0)
+            uv__io_edge_ready(loop, w);
         }
 
         nevents++;
@@ -472,17 +1881,38 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
 
     if (have_signals != 0) {
       uv__metrics_update_idle_time(loop);
+      uv__loop_callback(loop,
+                        UV_UNKNOWN_HANDLE,
+                        NULL,
+                        loop->signal_io_watcher.cb,
+                        loop->signal_io_watcher.fd);
       loop->signal_io_watcher.cb(loop, &loop->signal_io_watcher, POLLIN);
     }
 
+    /* loop->watchers keeps pointing at the events that are left, so that
+     * uv__platform_invalidate_fd() still sees them.
+     */
+    if (lfields->poll_stash_nfds != 0)
+      return;
+
     loop->watchers[loop->nwatchers] = NULL;
     loop->watchers[loop->nwatchers + 1] = NULL;
 
+    /* Nothing points into the event buffer anymore, it can be resized.
+     * Leftovers are the tail of an earlier poll, there may be more where
+     * they came from.
+     */
+    full = nfds == maxevents || leftover != 0;
+    leftover = 0;
+    first = 0;
+    budget -= nfds;
+    uv__epoll_batch_update(loop, nfds);
+
     if (have_signals != 0)
       return;  /* Event loop should cycle now so don't poll again. */
 
     if (nevents != 0) {
-      if (nfds == ARRAY_SIZE(events) && --count != 0) {
+      if (full && budget > 0) {
         /* Poll for more events but don't block this time. */
         timeout = 0;
         continue;
@@ -61,6 +61,121 @@ struct uv__statx {
   uint64_t unused1[14];
 };
 
+/* The io_uring ABI, <linux/io_uring.h> isn't available everywhere. */
+#define UV__IORING_OP_POLL_ADD 6
+#define UV__IORING_OP_POLL_REMOVE 7
+#define UV__IORING_OP_SENDMSG 9
+#define UV__IORING_OP_ACCEPT 13
+#define UV__IORING_OP_ASYNC_CANCEL 14
+#define UV__IORING_OP_RECV 27
+
+#define UV__IOSQE_BUFFER_SELECT 32u
+
+#define UV__IORING_ACCEPT_MULTISHOT 1u
+
+#define UV__IORING_CQE_F_BUFFER 1u
+#define UV__IORING_CQE_F_MORE 2u
+#define UV__IORING_CQE_BUFFER_SHIFT 16
+
+#define UV__IORING_REGISTER_PBUF_RING 22
+
+#define UV__IORING_ENTER_GETEVENTS 1u
+#define UV__IORING_ENTER_EXT_ARG 8u
+
+#define UV__IORING_SETUP_CQSIZE 8u
+#define UV__IORING_SETUP_CLAMP 16u
+
+#define UV__IORING_FEAT_SINGLE_MMAP 1u
+#define UV__IORING_FEAT_NODROP 2u
+#define UV__IORING_FEAT_EXT_ARG 256u
+
+#define UV__IORING_OFF_SQ_RING 0ull
+#define UV__IORING_OFF_SQES 0x10000000ull
+
+struct uv__io_uring_sqe {
+  uint8_t opcode;
+  uint8_t flags;
+  uint16_t ioprio;
+  int32_t fd;
+  uint64_t off;
+  uint64_t addr;
+  uint32_t len;
+  uint32_t op_flags;  /* poll32_events, msg_flags, accept_flags. */
+  uint64_t user_data;
+  uint16_t buf_index;  /* buf_group with IOSQE_BUFFER_SELECT. */
+  uint16_t personality;
+  int32_t file_index;
+  uint64_t pad[2];
+};
+
+struct uv__io_uring_cqe {
+  uint64_t user_data;
+  int32_t res;
+  uint32_t flags;
+};
+
+struct uv__io_sqring_offsets {
+  uint32_t head;
+  uint32_t tail;
+  uint32_t ring_mask;
+  uint32_t ring_entries;
+  uint32_t flags;
+  uint32_t dropped;
+  uint32_t array;
+  uint32_t reserved0;
+  uint64_t reserved1;
+};
+
+struct uv__io_cqring_offsets {
+  uint32_t head;
+  uint32_t tail;
+  uint32_t ring_mask;
+  uint32_t ring_entries;
+  uint32_t overflow;
+  uint32_t cqes;
+  uint32_t flags;
+  uint32_t reserved0;
+  uint64_t reserved1;
+};
+
+struct uv__io_uring_params {
+  uint32_t sq_entries;
+  uint32_t cq_entries;
+  uint32_t flags;
+  uint32_t sq_thread_cpu;
+  uint32_t sq_thread_idle;
+  uint32_t features;
+  uint32_t wq_fd;
+  uint32_t reserved[3];
+  struct uv__io_sqring_offsets sq_off;
+  struct uv__io_cqring_offsets cq_off;
+};
+
+/* A provided buffer ring is an array of these, the tail of the ring overlays
+ * the resv field of the first entry.
+ */
+struct uv__io_uring_buf {
+  uint64_t addr;
+  uint32_t len;
+  uint16_t bid;
+  uint16_t resv;
+};
+
+struct uv__io_uring_buf_reg {
+  uint64_t ring_addr;
+  uint32_t ring_entries;
+  uint16_t bgid;
+  uint16_t flags;
+  uint64_t resv[3];
+};
+
+struct uv__io_uring_getevents_arg {
+  uint64_t sigmask;
+  uint32_t sigmask_sz;
+  uint32_t pad;
+  uint64_t ts;
+};
+
 ssize_t uv__preadv(int fd, const struct iovec *iov, int iovcnt, int64_t offset);
 ssize_t uv__pwritev(int fd, const struct iovec *iov, int iovcnt, int64_t offset);
 int uv__dup3(int oldfd, int newfd, int flags);
@@ -77,5 +192,16 @@ int uv__statx(int dirfd,
               unsigned int mask,
               struct uv__statx* statxbuf);
 ssize_t uv__getrandom(void* buf, size_t buflen, unsigned flags);
+int uv__io_uring_setup(unsigned int entries, struct uv__io_uring_params* params);
+int uv__io_uring_enter(int fd,
+                       unsigned int to_submit,
+                       unsigned int min_complete,
+                       unsigned int flags,
+                       const void* arg,
+                       size_t argsz);
+int uv__io_uring_register(int fd,
+                          unsigned int opcode,
+                          void* arg,
+                          unsigned int nargs);
 
 #endif /* UV_LINUX_SYSCALL_H_ */
@@ -55,6 +55,7 @@
       h = QUEUE_DATA(q, uv_##name##_t, queue);                                \
       QUEUE_REMOVE(q);                                                        \
       QUEUE_INSERT_TAIL(&loop->name##_handles, q);                            \
+      uv__loop_callback(loop, UV_##type, h, h->name##_cb, -1);                \
       h->name##_cb(h);                                                        \
     }                                                                         \
   }                                                                           \
@@ -160,16 +160,23 @@ int uv_loop_fork(uv_loop_t* loop) {
     return err;
 #endif
 
+  uv__threadpool_loop_fork(loop);
+  uv__random_loop_fork(loop);
+  uv__watchdog_loop_fork(loop);
+
   /* Rearm all the watchers that aren't re-queued by the above. */
   for (i = 0; i < loop->nwatchers; i++) {
     w = loop->watchers[i];
     if (w == NULL)
       continue;
 
-    if (w->pevents != 0 && QUEUE_EMPTY(&w->watcher_queue)) {
-      w->events = 0; /* Force re-registration in uv__io_poll. */
+    if (w->pevents == 0)
+      continue;
+
+    /* Force re-registration in uv__io_poll, queued watchers included. */
+    w->events = 0;
+    if (QUEUE_EMPTY(&w->watcher_queue))
       QUEUE_INSERT_TAIL(&loop->watcher_queue, &w->watcher_queue);
-    }
   }
 
   return 0;
@@ -183,6 +190,8 @@ void uv__loop_close(uv_loop_t* loop) {
   uv__aio_close(&loop->wq_aio);
 #endif
 
+  uv__dns_loop_close(loop);
+  uv__random_loop_close(loop);
   uv__signal_loop_cleanup(loop);
   uv__platform_loop_delete(loop);
   uv__async_stop(loop);
@@ -198,7 +207,8 @@ void uv__loop_close(uv_loop_t* loop) {
   }
 
   uv_mutex_lock(&loop->wq_mutex);
-  assert(QUEUE_EMPTY(&loop->wq) && "thread pool work queue not empty!");
+  assert(uv__get_internal_fields(loop)->work_completed == NULL &&
+         "thread pool work queue not empty!");
   assert(!uv__has_active_reqs(loop));
   uv_mutex_unlock(&loop->wq_mutex);
   uv_mutex_destroy(&loop->wq_mutex);
@@ -235,6 +245,67 @@ int uv__loop_configure(uv_loop_t* loop, uv_loop_option option, va_list ap) {
     return 0;
   }
 
+  if (option == UV_LOOP_NATIVE_DNS) {
+    const char* resolv_conf;
+    const char* hosts;
+
+    resolv_conf = va_arg(ap, const char*);
+    hosts = va_arg(ap, const char*);
+    return uv__dns_configure(loop, resolv_conf, hosts);
+  }
+
+  if (option == UV_LOOP_USE_IO_URING) {
+#if defined(__linux__)
+    return uv__io_uring_configure(loop);
+#else
+    return UV_ENOSYS;
+#endif
+  }
+
+  if (option == UV_LOOP_IO_URING_STREAMS) {
+#if defined(__linux__)
+    return uv__io_uring_configure_streams(loop);
+#else
+    return UV_ENOSYS;
+#endif
+  }
+
+  if (option == UV_LOOP_EPOLL_EDGE_TRIGGERED) {
+#if defined(__linux__)
+    return uv__epoll_configure_edge(loop);
+#else
+    return UV_ENOSYS;
+#endif
+  }
+
+  if (option == UV_LOOP_BUSY_POLL) {
+#if defined(__linux__)
+    return uv__epoll_configure_busy_poll(loop, va_arg(ap, unsigned int));
+#else
+    return UV_ENOSYS;
+#endif
+  }
+
+  if (option == UV_LOOP_POLL_BATCH_MAX) {
+#if defined(__linux__)
+    return uv__epoll_configure_batch(loop, va_arg(ap, unsigned int));
+#else
+    return UV_ENOSYS;
+#endif
+  }
+
+  if (option == UV_METRICS_LOOP_PHASES)
+    return uv__metrics_phases_enable(loop);
+
+  if (option == UV_LOOP_TRACE)
+    return uv__trace_configure(loop, va_arg(ap, unsigned int));
+
+  if (option == UV_LOOP_RUN_BUDGET) {
+    lfields->run_budget_time = va_arg(ap, unsigned int) * (uint64_t) 1000;
+    lfields->run_budget_callbacks = va_arg(ap, unsigned int);
+    return 0;
+  }
+
   if (option != UV_LOOP_BLOCK_SIGNAL)
     return UV_ENOSYS;
 
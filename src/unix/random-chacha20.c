@@ -0,0 +1,282 @@
+/* Copyright libuv contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Per-loop ChaCha20 keystream for asynchronous uv_random() requests.
+ *
+ * The generator follows the "fast key erasure" construction: every refill
+ * produces UV__RANDOM_BLOCKS blocks of keystream, the first 32 bytes become
+ * the key for the next refill and are wiped, and handed out bytes are wiped
+ * from the buffer as well. Whoever reads the loop's memory later can't
+ * reconstruct output that was already returned.
+ */
+
+#include "uv.h"
+#include "internal.h"
+#include "chacha20-inl.h"
+
+#include <errno.h>
+#include <string.h>
+
+#if defined(__linux__)
+# include "linux-syscalls.h"
+# ifndef GRND_NONBLOCK
+#  define GRND_NONBLOCK 1
+# endif
+#endif
+
+#define UV__RANDOM_BLOCKS 16
+#define UV__RANDOM_KEYLEN 32
+
+/* Mix fresh entropy into the key after this much output or this much time. */
+#define UV__RANDOM_RESEED_BYTES (1024 * 1024)
+#define UV__RANDOM_RESEED_MS (5 * 60 * 1000)
+
+struct uv__random_pool {
+  uint32_t key[UV__RANDOM_KEYLEN / 4];
+  unsigned char buf[64 * UV__RANDOM_BLOCKS];
+  size_t avail;  /* Unused bytes at the end of buf. */
+  uint64_t output;  /* Bytes produced since the last reseed. */
+  uint64_t seeded_at;
+  int seeded;
+  uv__io_t io;
+  void* pending[2];
+};
+
+/* The key never repeats, a zero nonce is fine. */
+static const uint32_t zero_nonce[3];
+
+
+/* Like uv__random() but never blocks, it fails with UV_EAGAIN when the
+ * kernel's pool isn't initialized yet.
+ */
+static int uv__random_pool_entropy(void* buf, size_t buflen) {
+#if defined(__linux__)
+  ssize_t n;
+
+  do
+    n = uv__getrandom(buf, buflen, GRND_NONBLOCK);
+  while (n == -1 && errno == EINTR);
+
+  if (n == (ssize_t) buflen)
+    return 0;
+
+  if (n != -1)
+    return UV_EIO;
+
+  if (errno != ENOSYS)
+    return UV__ERR(errno);
+#endif
+
+  return uv__random_devurandom(buf, buflen);
+}
+
+
+static int uv__random_pool_seed(uv_loop_t* loop, struct uv__random_pool* p) {
+  uint32_t entropy[UV__RANDOM_KEYLEN / 4];
+  unsigned int i;
+  int err;
+
+  err = uv__random_pool_entropy(entropy, sizeof(entropy));
+  if (err)
+    return err;
+
+  /* XOR rather than replace, a reseed never makes the key weaker. */
+  for (i = 0; i < ARRAY_SIZE(entropy); i++)
+    p->key[i] ^= entropy[i];
+
+  memset(entropy, 0, sizeof(entropy));
+  memset(p->buf, 0, sizeof(p->buf));
+  p->avail = 0;
+  p->output = 0;
+  p->seeded_at = loop->time;
+  p->seeded = 1;
+
+  return 0;
+}
+
+
+static void uv__random_pool_refill(struct uv__random_pool* p) {
+  uint32_t i;
+
+  for (i = 0; i < UV__RANDOM_BLOCKS; i++)
+    uv__chacha20_block(p->key, i, zero_nonce, p->buf + 64 * i);
+
+  memcpy(p->key, p->buf, UV__RANDOM_KEYLEN);
+  memset(p->buf, 0, UV__RANDOM_KEYLEN);
+  p->avail = sizeof(p->buf) - UV__RANDOM_KEYLEN;
+}
+
+
+static void uv__random_pool_fill(struct uv__random_pool* p,
+                                 void* buf,
+                                 size_t buflen) {
+  unsigned char* out;
+  unsigned char* src;
+  size_t n;
+
+  out = buf;
+  p->output += buflen;
+
+  while (buflen > 0) {
+    if (p->avail == 0)
+      uv__random_pool_refill(p);
+
+    n = p->avail;
+    if (n > buflen)
+      n = buflen;
+
+    src = p->buf + sizeof(p->buf) - p->avail;
+    memcpy(out, src, n);
+    memset(src, 0, n);
+
+    p->avail -= n;
+    out += n;
+    buflen -= n;
+  }
+}
+
+
+/* Completes a request that is served from the pool. It is never handed to
+ * the threadpool, having it in work_req.done is what tells uv_cancel() that
+ * the request is queued here.
+ */
+void uv__random_pool_done(struct uv__work* w, int status) {
+  struct uv__random_pool* p;
+  uv_random_t* req;
+  uv_loop_t* loop;
+
+  req = container_of(w, uv_random_t, work_req);
+  loop = req->loop;
+  p = uv__get_internal_fields(loop)->random;
+  uv__req_unregister(loop, req);
+
+  if (req->status == 0 && !p->seeded)
+    req->status = uv__random_pool_seed(loop, p);
+
+  if (req->status == 0) {
+    if (p->output >= UV__RANDOM_RESEED_BYTES ||
+        loop->time - p->seeded_at >= UV__RANDOM_RESEED_MS) {
+      /* Keep going with the current key if the kernel has nothing now, the
+       * next request tries again.
+       */
+      uv__random_pool_seed(loop, p);
+    }
+
+    uv__random_pool_fill(p, req->buf, req->buflen);
+  }
+
+  req->cb(req, req->status, req->buf, req->buflen);
+}
+
+
+static void uv__random_pool_io(uv_loop_t* loop, uv__io_t* w, unsigned int e) {
+  struct uv__random_pool* p;
+  QUEUE queue;
+  QUEUE* q;
+
+  p = container_of(w, struct uv__random_pool, io);
+
+  /* Requests made from the callbacks wait for the next loop iteration. */
+  QUEUE_MOVE(&p->pending, &queue);
+
+  while (!QUEUE_EMPTY(&queue)) {
+    q = QUEUE_HEAD(&queue);
+    QUEUE_REMOVE(q);
+    QUEUE_INIT(q);
+
+    uv__random_pool_done(container_of(q, struct uv__work, wq), 0);
+  }
+}
+
+
+int uv__random_pool_submit(uv_loop_t* loop, uv_random_t* req) {
+  uv__loop_internal_fields_t* lfields;
+  struct uv__random_pool* p;
+  int err;
+
+  lfields = uv__get_internal_fields(loop);
+  p = lfields->random;
+
+  if (p == NULL) {
+    p = uv__calloc(1, sizeof(*p));
+    if (p == NULL)
+      return UV_ENOMEM;
+
+    uv__io_init(&p->io, uv__random_pool_io, -1);
+    QUEUE_INIT(&p->pending);
+    lfields->random = p;
+  }
+
+  if (!p->seeded) {
+    err = uv__random_pool_seed(loop, p);
+    if (err)
+      return err;
+  }
+
+  req->work_req.work = NULL;
+  req->work_req.done = uv__random_pool_done;
+  req->work_req.loop = loop;
+  QUEUE_INSERT_TAIL(&p->pending, &req->work_req.wq);
+  uv__io_feed(loop, &p->io);
+
+  return 0;
+}
+
+
+int uv__random_pool_cancel(uv_random_t* req) {
+  if (QUEUE_EMPTY(&req->work_req.wq) || req->status != 0)
+    return UV_EBUSY;
+
+  req->status = UV_ECANCELED;
+  return 0;
+}
+
+
+void uv__random_loop_fork(uv_loop_t* loop) {
+  struct uv__random_pool* p;
+
+  /* The child would hand out the same bytes as the parent, start over with
+   * a fresh seed.
+   */
+  p = uv__get_internal_fields(loop)->random;
+  if (p == NULL)
+    return;
+
+  memset(p->key, 0, sizeof(p->key));
+  memset(p->buf, 0, sizeof(p->buf));
+  p->avail = 0;
+  p->seeded = 0;
+}
+
+
+void uv__random_loop_close(uv_loop_t* loop) {
+  uv__loop_internal_fields_t* lfields;
+  struct uv__random_pool* p;
+
+  lfields = uv__get_internal_fields(loop);
+  p = lfields->random;
+  if (p == NULL)
+    return;
+
+  memset(p, 0, sizeof(*p));
+  uv__free(p);
+  lfields->random = NULL;
+}
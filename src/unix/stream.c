@@ -35,6 +35,10 @@
 #include <unistd.h>
 #include <limits.h> /* IOV_MAX */
 
+#if defined(__linux__)
+# include <sys/stat.h>
+#endif
+
 #if defined(__APPLE__)
 # include <sys/event.h>
 # include <sys/time.h>
@@ -80,6 +84,23 @@ static void uv__read(uv_stream_t* stream);
 static void uv__stream_io(uv_loop_t* loop, uv__io_t* w, unsigned int events);
 static void uv__write_callbacks(uv_stream_t* stream);
 static size_t uv__write_req_size(uv_write_t* req);
+static void uv__stream_eof(uv_stream_t* stream, const uv_buf_t* buf);
+#if defined(__linux__)
+static void uv__stream_edge_open(uv_stream_t* stream, int fd);
+static void uv__stream_iou_open(uv_stream_t* stream, int fd);
+static void uv__stream_iou_close(uv_stream_t* stream);
+static void uv__stream_iou_destroy(uv_stream_t* stream);
+static void uv__stream_iou_io(uv_stream_t* stream);
+static void uv__stream_iou_accept_io(uv_stream_t* stream);
+static void uv__stream_iou_accepted(uv_stream_t* stream);
+static void uv__stream_iou_listen(uv_stream_t* stream);
+static void uv__stream_iou_read_start(uv_stream_t* stream);
+static void uv__stream_iou_read_stop(uv_stream_t* stream);
+static void uv__stream_iou_write(uv_stream_t* stream, int direct);
+static int uv__stream_iou_try_write(uv_stream_t* stream,
+                                    const uv_buf_t bufs[],
+                                    unsigned int nbufs);
+#endif
 
 
 void uv__stream_init(uv_loop_t* loop,
@@ -116,6 +137,10 @@ void uv__stream_init(uv_loop_t* loop,
   stream->select = NULL;
 #endif /* defined(__APPLE_) */
 
+#if defined(__linux__)
+  stream->iou = NULL;
+#endif
+
   uv__io_init(&stream->io_watcher, uv__stream_io, -1);
 }
 
@@ -436,6 +461,11 @@ int uv__stream_open(uv_stream_t* stream, int fd, int flags) {
 
   stream->io_watcher.fd = fd;
 
+#if defined(__linux__)
+  uv__stream_iou_open(stream, fd);
+  uv__stream_edge_open(stream, fd);
+#endif
+
   return 0;
 }
 
@@ -480,6 +510,10 @@ void uv__stream_destroy(uv_stream_t* stream) {
   }
 
   assert(stream->write_queue_size == 0);
+
+#if defined(__linux__)
+  uv__stream_iou_destroy(stream);
+#endif
 }
 
 
@@ -530,6 +564,15 @@ void uv__server_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
   int err;
 
   stream = container_of(w, uv_stream_t, io_watcher);
+
+#if defined(__linux__)
+  /* Only reached through uv__io_feed(), connections come from the ring. */
+  if (stream->iou != NULL) {
+    uv__stream_iou_accept_io(stream);
+    return;
+  }
+#endif
+
   assert(events & POLLIN);
   assert(stream->accepted_fd == -1);
   assert(!(stream->flags & UV_HANDLE_CLOSING));
@@ -547,18 +590,23 @@ void uv__server_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
       return;
 #endif /* defined(UV_HAVE_KQUEUE) */
 
+    uv__count_syscall(stream->loop, accept);
     err = uv__accept(uv__stream_fd(stream));
     if (err < 0) {
-      if (err == UV_EAGAIN || err == UV__ERR(EWOULDBLOCK))
+      if (err == UV_EAGAIN || err == UV__ERR(EWOULDBLOCK)) {
+        uv__io_drained(w, POLLIN);
         return;  /* Not an error. */
+      }
 
       if (err == UV_ECONNABORTED)
         continue;  /* Ignore. Nothing we can do about that. */
 
       if (err == UV_EMFILE || err == UV_ENFILE) {
         err = uv__emfile_trick(loop, uv__stream_fd(stream));
-        if (err == UV_EAGAIN || err == UV__ERR(EWOULDBLOCK))
+        if (err == UV_EAGAIN || err == UV__ERR(EWOULDBLOCK)) {
+          uv__io_drained(w, POLLIN);
           break;
+        }
       }
 
       stream->connection_cb(stream, err);
@@ -646,6 +694,13 @@ done:
     }
   } else {
     server->accepted_fd = -1;
+#if defined(__linux__)
+    if (server->iou != NULL) {
+      if (err == 0)
+        uv__stream_iou_accepted(server);
+      return err;
+    }
+#endif
     if (err == 0)
       uv__io_start(server->loop, &server->io_watcher, POLLIN);
   }
@@ -672,6 +727,11 @@ int uv_listen(uv_stream_t* stream, int backlog, uv_connection_cb cb) {
   if (err == 0)
     uv__handle_start(stream);
 
+#if defined(__linux__)
+  if (err == 0 && stream->iou != NULL)
+    uv__stream_iou_listen(stream);
+#endif
+
   return err;
 }
 
@@ -799,6 +859,615 @@ static int uv__handle_fd(uv_handle_t* handle) {
   }
 }
 
+#if defined(__linux__)
+
+/* Completion-based I/O for TCP and pipe streams on loops configured with
+ * UV_LOOP_IO_URING_STREAMS.
+ *
+ * Reads are IORING_OP_RECV requests that take a buffer from the loop's
+ * provided buffer ring once data arrives; the data is copied to the buffers
+ * from alloc_cb and the ring buffer goes back right away. Writes are
+ * IORING_OP_SENDMSG requests, one per stream at a time to keep the order.
+ * A listening socket takes connections with one multishot IORING_OP_ACCEPT.
+ *
+ * The state lives apart from the stream because the kernel may still hold
+ * on to it after the stream is closed, until the cancelled requests complete.
+ */
+
+#define UV__STREAM_IOU_RECV 1
+#define UV__STREAM_IOU_SEND 2
+#define UV__STREAM_IOU_ACCEPT 3
+#define UV__STREAM_IOU_MASK 3
+
+#define UV__STREAM_IOU_IOVMAX 64
+
+/* Connections accepted ahead of uv_accept(). The multishot request is
+ * cancelled when this many are waiting and resubmitted once they're taken.
+ * Completions that were posted before the cancellation still add to it.
+ */
+#define UV__STREAM_IOU_BACKLOG 64
+
+struct uv__stream_iou {
+  uv_stream_t* stream;  /* NULL once the stream is destroyed. */
+  struct msghdr msg;
+  struct iovec iov[UV__STREAM_IOU_IOVMAX];
+  char* rbase;  /* Received data that wasn't handed to read_cb yet. */
+  size_t rlen;
+  int rbid;  /* Ring buffer that holds rbase, -1 if none. */
+  int* fds;
+  unsigned int nfds;
+  unsigned int fds_size;
+  int recv_active;
+  int send_active;
+  int accept_active;
+};
+
+
+static uint64_t uv__stream_iou_data(struct uv__stream_iou* iou, int kind) {
+  return (uint64_t) (uintptr_t) iou | kind;
+}
+
+
+/* TCP streams and pipes that are sockets, the ones whose reads and writes
+ * don't need any care beyond what the socket does.
+ */
+static int uv__stream_plain_socket(uv_stream_t* stream, int fd) {
+  struct stat s;
+
+  if (stream->flags & UV_HANDLE_BLOCKING_WRITES)
+    return 0;
+
+  if (stream->type == UV_TCP)
+    return 1;
+
+  if (stream->type != UV_NAMED_PIPE)
+    return 0;
+
+  /* File descriptors passed over IPC pipes travel in ancillary data. */
+  if (((uv_pipe_t*) stream)->ipc)
+    return 0;
+
+  return fstat(fd, &s) == 0 && S_ISSOCK(s.st_mode);
+}
+
+
+/* Streams opened after UV_LOOP_EPOLL_EDGE_TRIGGERED was set wait for events
+ * with EPOLLET. The watcher must not be registered yet.
+ */
+static void uv__stream_edge_open(uv_stream_t* stream, int fd) {
+  uv__io_t* w;
+
+  w = &stream->io_watcher;
+  if (!(stream->loop->flags & UV_LOOP_EDGE_TRIGGERED))
+    return;
+
+  if (stream->iou != NULL || w->edge != 0 || w->pevents != 0 || w->events != 0)
+    return;
+
+  if (uv__stream_plain_socket(stream, fd))
+    w->edge = 1;
+}
+
+
+static void uv__stream_iou_open(uv_stream_t* stream, int fd) {
+  struct uv__stream_iou* iou;
+
+  if (stream->iou != NULL || !uv__io_uring_streams(stream->loop))
+    return;
+
+  if (!uv__stream_plain_socket(stream, fd))
+    return;
+
+  /* Without memory the stream simply stays readiness-based. */
+  iou = uv__calloc(1, sizeof(*iou));
+  if (iou == NULL)
+    return;
+
+  iou->stream = stream;
+  iou->rbid = -1;
+  stream->iou = iou;
+}
+
+
+static void uv__stream_iou_recv(uv_stream_t* stream) {
+  struct uv__stream_iou* iou;
+
+  /* Reads start once connected, the connect error comes first. */
+  iou = stream->iou;
+  if (iou->recv_active || iou->rlen > 0 || stream->connect_req != NULL)
+    return;
+
+  iou->recv_active = 1;
+  uv__io_uring_recv(stream->loop,
+                    uv__stream_fd(stream),
+                    uv__stream_iou_data(iou, UV__STREAM_IOU_RECV));
+}
+
+
+/* Hands the received data to read_cb in as many pieces as alloc_cb asks for,
+ * then asks for more.
+ */
+static void uv__stream_iou_read(uv_stream_t* stream) {
+  struct uv__stream_iou* iou;
+  uv_buf_t buf;
+  size_t n;
+
+  iou = stream->iou;
+
+  while (iou->rlen > 0 && (stream->flags & UV_HANDLE_READING)) {
+    buf = uv_buf_init(NULL, 0);
+    stream->alloc_cb((uv_handle_t*) stream, 64 * 1024, &buf);
+    if (buf.base == NULL || buf.len == 0) {
+      /* User indicates it can't or won't handle the read. */
+      stream->read_cb(stream, UV_ENOBUFS, &buf);
+      if (stream->flags & UV_HANDLE_READING)
+        uv__io_feed(stream->loop, &stream->io_watcher);  /* Try again. */
+      return;
+    }
+
+    n = iou->rlen < buf.len ? iou->rlen : buf.len;
+    memcpy(buf.base, iou->rbase, n);
+    iou->rbase += n;
+    iou->rlen -= n;
+
+    if (iou->rlen == 0) {
+      uv__io_uring_buf_put(stream->loop, iou->rbid);
+      iou->rbid = -1;
+    }
+
+    stream->read_cb(stream, n, &buf);
+  }
+
+  if ((stream->flags & UV_HANDLE_READING) && uv__stream_fd(stream) != -1)
+    uv__stream_iou_recv(stream);
+}
+
+
+static void uv__stream_iou_recv_done(uv_stream_t* stream, int res, int bid) {
+  struct uv__stream_iou* iou;
+  uv_buf_t buf;
+
+  iou = stream->iou;
+  buf = uv_buf_init(NULL, 0);
+
+  if (res > 0) {
+    assert(bid >= 0);
+    assert(iou->rbid == -1);
+    iou->rbid = bid;
+    iou->rbase = uv__io_uring_buf(stream->loop, bid);
+    iou->rlen = res;
+    uv__stream_iou_read(stream);
+    return;
+  }
+
+  if (bid >= 0)
+    uv__io_uring_buf_put(stream->loop, bid);
+
+  /* Stopped in the meantime. An EOF or error shows up again when reading
+   * restarts.
+   */
+  if (!(stream->flags & UV_HANDLE_READING))
+    return;
+
+  if (res == UV_ECANCELED) {
+    uv__stream_iou_recv(stream);  /* Restarted before the cancel landed. */
+    return;
+  }
+
+  if (res == UV_ENOBUFS) {
+    /* Every ring buffer is in use, try again on the next loop iteration. */
+    uv__io_feed(stream->loop, &stream->io_watcher);
+    return;
+  }
+
+  if (res == 0) {
+    uv__stream_eof(stream, &buf);
+    return;
+  }
+
+  /* Error. User should call uv_close(). */
+  stream->read_cb(stream, res, &buf);
+  if (stream->flags & UV_HANDLE_READING) {
+    stream->flags &= ~UV_HANDLE_READING;
+    if (!uv__io_active(&stream->io_watcher, POLLOUT))
+      uv__handle_stop(stream);
+  }
+}
+
+
+static void uv__stream_iou_read_start(uv_stream_t* stream) {
+  /* Data that was received before the last uv_read_stop() goes first. It's
+   * delivered from the loop, not from within uv_read_start().
+   */
+  if (((struct uv__stream_iou*) stream->iou)->rlen > 0)
+    uv__io_feed(stream->loop, &stream->io_watcher);
+  else
+    uv__stream_iou_recv(stream);
+}
+
+
+static void uv__stream_iou_read_stop(uv_stream_t* stream) {
+  struct uv__stream_iou* iou;
+
+  /* Data that arrives before the cancellation is kept for the next
+   * uv_read_start().
+   */
+  iou = stream->iou;
+  if (iou->recv_active)
+    uv__io_uring_cancel(stream->loop,
+                        uv__stream_iou_data(iou, UV__STREAM_IOU_RECV));
+}
+
+
+/* With `direct` set the first request is tried with a plain write first, the
+ * way uv__write() does it, so that a write to an idle stream takes effect
+ * before uv_write() returns. The rest goes into a sendmsg request.
+ */
+static void uv__stream_iou_write(uv_stream_t* stream, int direct) {
+  struct uv__stream_iou* iou;
+  uv_write_t* req;
+  unsigned int iovcnt;
+  unsigned int n;
+  ssize_t r;
+  QUEUE* q;
+
+  iou = stream->iou;
+  if (iou->send_active || QUEUE_EMPTY(&stream->write_queue))
+    return;
+
+  if (direct) {
+    req = QUEUE_DATA(QUEUE_HEAD(&stream->write_queue), uv_write_t, queue);
+    n = req->nbufs - req->write_index;
+    if (n > (unsigned int) uv__getiovmax())
+      n = uv__getiovmax();
+
+    do {
+      uv__count_syscall(stream->loop, write);
+      r = uv__writev(uv__stream_fd(stream),
+                     (struct iovec*) (req->bufs + req->write_index),
+                     n);
+    } while (r == -1 && errno == EINTR);
+
+    if (r == -1 && !IS_TRANSIENT_WRITE_ERROR(errno, 0)) {
+      req->error = UV__ERR(errno);
+      uv__write_req_finish(req);
+      if (!(stream->flags & UV_HANDLE_READING))
+        uv__handle_stop(stream);
+      return;
+    }
+
+    if (r >= 0 && uv__write_req_update(stream, req, r)) {
+      uv__write_req_finish(req);
+      if (QUEUE_EMPTY(&stream->write_queue))
+        return;
+    }
+  }
+
+  /* Gather the queued requests into one message. The uv_buf_t arrays belong
+   * to the requests, the kernel works on a copy.
+   */
+  assert(sizeof(uv_buf_t) == sizeof(struct iovec));
+  iovcnt = 0;
+  QUEUE_FOREACH(q, &stream->write_queue) {
+    req = QUEUE_DATA(q, uv_write_t, queue);
+    assert(req->handle == stream);
+    assert(req->send_handle == NULL);
+
+    n = req->nbufs - req->write_index;
+    if (n > ARRAY_SIZE(iou->iov) - iovcnt)
+      n = ARRAY_SIZE(iou->iov) - iovcnt;
+    memcpy(iou->iov + iovcnt,
+           req->bufs + req->write_index,
+           n * sizeof(iou->iov[0]));
+    iovcnt += n;
+
+    if (iovcnt == ARRAY_SIZE(iou->iov))
+      break;
+  }
+
+  memset(&iou->msg, 0, sizeof(iou->msg));
+  iou->msg.msg_iov = iou->iov;
+  iou->msg.msg_iovlen = iovcnt;
+
+  iou->send_active = 1;
+  uv__io_uring_sendmsg(stream->loop,
+                       uv__stream_fd(stream),
+                       &iou->msg,
+                       uv__stream_iou_data(iou, UV__STREAM_IOU_SEND));
+}
+
+
+static void uv__stream_iou_send_done(uv_stream_t* stream, int res) {
+  uv_write_t* req;
+  size_t size;
+
+  assert(!QUEUE_EMPTY(&stream->write_queue));
+  req = QUEUE_DATA(QUEUE_HEAD(&stream->write_queue), uv_write_t, queue);
+
+  if (res < 0) {
+    /* Like uv__write(), the requests behind this one wait for the next
+     * uv_write().
+     */
+    req->error = res;
+    uv__write_req_finish(req);
+    if (!(stream->flags & UV_HANDLE_READING))
+      uv__handle_stop(stream);
+    return;
+  }
+
+  /* Spread what was sent over the requests in the message. */
+  for (;;) {
+    size = uv__write_req_size(req);
+    if (size > (size_t) res) {
+      uv__write_req_update(stream, req, res);
+      break;
+    }
+
+    stream->write_queue_size -= size;
+    res -= size;
+    uv__write_req_finish(req);
+
+    if (QUEUE_EMPTY(&stream->write_queue))
+      break;
+
+    req = QUEUE_DATA(QUEUE_HEAD(&stream->write_queue), uv_write_t, queue);
+    if (res == 0)
+      break;
+  }
+
+  uv__stream_iou_write(stream, 0);
+}
+
+
+static int uv__stream_iou_try_write(uv_stream_t* stream,
+                                    const uv_buf_t bufs[],
+                                    unsigned int nbufs) {
+  ssize_t n;
+  int iovmax;
+
+  /* Nothing is in flight, write directly. */
+  iovmax = uv__getiovmax();
+  if (nbufs > (unsigned int) iovmax)
+    nbufs = iovmax;
+
+  do {
+    uv__count_syscall(stream->loop, write);
+    n = uv__writev(uv__stream_fd(stream), (struct iovec*) bufs, nbufs);
+  } while (n == -1 && errno == EINTR);
+
+  if (n == -1)
+    return UV__ERR(errno);
+
+  return n;
+}
+
+
+static void uv__stream_iou_accept(uv_stream_t* stream) {
+  struct uv__stream_iou* iou;
+
+  iou = stream->iou;
+  if (iou->accept_active || iou->nfds >= UV__STREAM_IOU_BACKLOG)
+    return;
+
+  iou->accept_active = 1;
+  uv__io_uring_accept(stream->loop,
+                      uv__stream_fd(stream),
+                      uv__stream_iou_data(iou, UV__STREAM_IOU_ACCEPT));
+}
+
+
+static void uv__stream_iou_listen(uv_stream_t* stream) {
+  /* The listen functions started the readiness watcher. */
+  uv__io_stop(stream->loop, &stream->io_watcher, POLLIN);
+  uv__stream_iou_accept(stream);
+}
+
+
+/* Hands out the accepted connections for as long as connection_cb takes
+ * them.
+ */
+static void uv__stream_iou_accept_io(uv_stream_t* stream) {
+  struct uv__stream_iou* iou;
+
+  iou = stream->iou;
+
+  while (iou->nfds > 0 &&
+         stream->accepted_fd == -1 &&
+         !uv__is_closing(stream)) {
+    stream->accepted_fd = iou->fds[0];
+    iou->nfds--;
+    memmove(iou->fds, iou->fds + 1, iou->nfds * sizeof(iou->fds[0]));
+    stream->connection_cb(stream, 0);
+  }
+
+  if (!uv__is_closing(stream))
+    uv__stream_iou_accept(stream);
+}
+
+
+static void uv__stream_iou_accepted(uv_stream_t* stream) {
+  struct uv__stream_iou* iou;
+
+  iou = stream->iou;
+  if (iou->nfds > 0)
+    uv__io_feed(stream->loop, &stream->io_watcher);
+  else
+    uv__stream_iou_accept(stream);
+}
+
+
+static int uv__stream_iou_queue_fd(struct uv__stream_iou* iou, int fd) {
+  unsigned int size;
+  int* fds;
+
+  if (iou->nfds == iou->fds_size) {
+    size = iou->fds_size ? 2 * iou->fds_size : 8;
+    fds = uv__realloc(iou->fds, size * sizeof(*fds));
+    if (fds == NULL)
+      return UV_ENOMEM;
+
+    iou->fds = fds;
+    iou->fds_size = size;
+  }
+
+  iou->fds[iou->nfds++] = fd;
+  return 0;
+}
+
+
+static void uv__stream_iou_accept_done(uv_stream_t* stream, int res) {
+  struct uv__stream_iou* iou;
+  int err;
+
+  iou = stream->iou;
+
+  if (res >= 0) {
+    err = uv__stream_iou_queue_fd(iou, res);
+    if (err) {
+      uv__close(res);
+      stream->connection_cb(stream, err);
+      if (uv__is_closing(stream))
+        return;
+    }
+
+    if (iou->nfds == UV__STREAM_IOU_BACKLOG && iou->accept_active)
+      uv__io_uring_cancel(stream->loop,
+                          uv__stream_iou_data(iou, UV__STREAM_IOU_ACCEPT));
+  } else if (res != UV_ECANCELED && res != UV_ECONNABORTED) {
+    err = res;
+    if (err == UV_EMFILE || err == UV_ENFILE)
+      err = uv__emfile_trick(stream->loop, uv__stream_fd(stream));
+
+    if (err != UV_EAGAIN && err != UV__ERR(EWOULDBLOCK))
+      stream->connection_cb(stream, err);
+
+    if (uv__is_closing(stream))
+      return;
+  }
+
+  uv__stream_iou_accept_io(stream);
+}
+
+
+void uv__stream_iou_complete(uv_loop_t* loop,
+                             uint64_t user_data,
+                             int res,
+                             int bid,
+                             int more) {
+  struct uv__stream_iou* iou;
+  uv_stream_t* stream;
+  int kind;
+
+  iou = (struct uv__stream_iou*) (uintptr_t) (user_data & ~UV__STREAM_IOU_MASK);
+  kind = user_data & UV__STREAM_IOU_MASK;
+  stream = iou->stream;
+
+  if (kind == UV__STREAM_IOU_RECV)
+    iou->recv_active = 0;
+  else if (kind == UV__STREAM_IOU_SEND)
+    iou->send_active = 0;
+  else if (!more)
+    iou->accept_active = 0;
+
+  if (stream == NULL || uv__is_closing(stream)) {
+    if (bid >= 0)
+      uv__io_uring_buf_put(loop, bid);
+
+    if (kind == UV__STREAM_IOU_ACCEPT && res >= 0)
+      uv__close(res);
+
+    if (stream == NULL &&
+        !iou->recv_active &&
+        !iou->send_active &&
+        !iou->accept_active) {
+      uv__free(iou->fds);
+      uv__free(iou);
+    }
+
+    return;
+  }
+
+  if (kind == UV__STREAM_IOU_RECV)
+    uv__stream_iou_recv_done(stream, res, bid);
+  else if (kind == UV__STREAM_IOU_SEND)
+    uv__stream_iou_send_done(stream, res);
+  else
+    uv__stream_iou_accept_done(stream, res);
+
+  /* Write callbacks run right away, like after a write in uv__stream_io(). */
+  if (kind == UV__STREAM_IOU_SEND) {
+    uv__write_callbacks(stream);
+    if (QUEUE_EMPTY(&stream->write_queue))
+      uv__drain(stream);
+  }
+}
+
+
+static void uv__stream_iou_io(uv_stream_t* stream) {
+  /* Connects and uv_shutdown() still wait for POLLOUT, otherwise this is
+   * uv__io_feed() after a completion.
+   */
+  uv__io_stop(stream->loop, &stream->io_watcher, POLLOUT);
+
+  uv__stream_iou_read(stream);
+  if (uv__stream_fd(stream) == -1)
+    return;  /* read_cb closed stream. */
+
+  uv__stream_iou_write(stream, 0);
+  uv__write_callbacks(stream);
+
+  /* Write queue drained. */
+  if (QUEUE_EMPTY(&stream->write_queue))
+    uv__drain(stream);
+}
+
+
+static void uv__stream_iou_close(uv_stream_t* stream) {
+  struct uv__stream_iou* iou;
+
+  /* A request holds a reference to the file, cancel them before the file
+   * descriptor is closed. uv_read_stop() took care of the read already.
+   */
+  iou = stream->iou;
+  if (iou->send_active)
+    uv__io_uring_cancel(stream->loop,
+                        uv__stream_iou_data(iou, UV__STREAM_IOU_SEND));
+
+  if (iou->accept_active)
+    uv__io_uring_cancel(stream->loop,
+                        uv__stream_iou_data(iou, UV__STREAM_IOU_ACCEPT));
+
+  if (iou->rbid != -1) {
+    uv__io_uring_buf_put(stream->loop, iou->rbid);
+    iou->rbid = -1;
+    iou->rlen = 0;
+  }
+
+  while (iou->nfds > 0)
+    uv__close(iou->fds[--iou->nfds]);
+}
+
+
+static void uv__stream_iou_destroy(uv_stream_t* stream) {
+  struct uv__stream_iou* iou;
+
+  iou = stream->iou;
+  if (iou == NULL)
+    return;
+
+  stream->iou = NULL;
+  iou->stream = NULL;
+
+  /* Otherwise the last completion frees it. */
+  if (!iou->recv_active && !iou->send_active && !iou->accept_active) {
+    uv__free(iou->fds);
+    uv__free(iou);
+  }
+}
+
+#endif  /* defined(__linux__) */
+
+
 static void uv__write(uv_stream_t* stream) {
   struct iovec* iov;
   QUEUE* q;
@@ -806,8 +1475,16 @@ static void uv__write(uv_stream_t* stream) {
   int iovmax;
   int iovcnt;
   ssize_t n;
+  int full;
   int err;
 
+#if defined(__linux__)
+  if (stream->iou != NULL) {
+    uv__stream_iou_write(stream, 1);
+    return;
+  }
+#endif
+
 start:
 
   assert(uv__stream_fd(stream) >= 0);
@@ -879,17 +1556,19 @@ start:
       *pi = fd_to_send;
     }
 
-    do
+    do {
+      uv__count_syscall(stream->loop, write);
       n = sendmsg(uv__stream_fd(stream), &msg, 0);
-    while (n == -1 && RETRY_ON_WRITE_ERROR(errno));
+    } while (n == -1 && RETRY_ON_WRITE_ERROR(errno));
 
     /* Ensure the handle isn't sent again in case this is a partial write. */
     if (n >= 0)
       req->send_handle = NULL;
   } else {
-    do
+    do {
+      uv__count_syscall(stream->loop, write);
       n = uv__writev(uv__stream_fd(stream), iov, iovcnt);
-    while (n == -1 && RETRY_ON_WRITE_ERROR(errno));
+    } while (n == -1 && RETRY_ON_WRITE_ERROR(errno));
   }
 
   if (n == -1 && !IS_TRANSIENT_WRITE_ERROR(errno, req->send_handle)) {
@@ -897,6 +1576,15 @@ start:
     goto error;
   }
 
+  /* The socket buffer is full when the kernel took less than the whole
+   * request, POLLOUT takes a new edge then. Not so when the request had more
+   * than iovmax buffers and writev() was given only part of it.
+   */
+  if (n == -1)
+    full = errno == EAGAIN || errno == EWOULDBLOCK;
+  else
+    full = iovcnt == (int) (req->nbufs - req->write_index);
+
   if (n >= 0 && uv__write_req_update(stream, req, n)) {
     uv__write_req_finish(req);
     return;  /* TODO(bnoordhuis) Start trying to write the next request. */
@@ -906,6 +1594,9 @@ start:
   if (stream->flags & UV_HANDLE_BLOCKING_WRITES)
     goto start;
 
+  if (full)
+    uv__io_drained(&stream->io_watcher, POLLOUT);
+
   /* We're not done. */
   uv__io_start(stream->loop, &stream->io_watcher, POLLOUT);
 
@@ -948,6 +1639,12 @@ static void uv__write_callbacks(uv_stream_t* stream) {
       req->bufs = NULL;
     }
 
+    uv__trace(stream->loop,
+              UV_TRACE_WRITE,
+              stream->type,
+              uv__stream_fd(stream),
+              (int64_t) req->error);
+
     /* NOTE: call callback AFTER freeing the request data. */
     if (req->cb)
       req->cb(req, req->error);
@@ -1125,7 +1822,8 @@ static void uv__read(uv_stream_t* stream) {
   stream->flags &= ~UV_HANDLE_READ_PARTIAL;
 
   /* Prevent loop starvation when the data comes in as fast as (or faster than)
-   * we can read it. XXX Need to rearm fd if we switch to edge-triggered I/O.
+   * we can read it. Edge-triggered watchers that still have data left are
+   * run again by the next loop iteration, see uv__io_edge_run().
    */
   count = 32;
 
@@ -1152,6 +1850,7 @@ static void uv__read(uv_stream_t* stream) {
 
     if (!is_ipc) {
       do {
+        uv__count_syscall(stream->loop, read);
         nread = read(uv__stream_fd(stream), buf.base, buf.len);
       }
       while (nread < 0 && errno == EINTR);
@@ -1167,6 +1866,7 @@ static void uv__read(uv_stream_t* stream) {
       msg.msg_control = cmsg_space;
 
       do {
+        uv__count_syscall(stream->loop, read);
         nread = uv__recvmsg(uv__stream_fd(stream), &msg, 0);
       }
       while (nread < 0 && errno == EINTR);
@@ -1176,6 +1876,7 @@ static void uv__read(uv_stream_t* stream) {
       /* Error */
       if (errno == EAGAIN || errno == EWOULDBLOCK) {
         /* Wait for the next one. */
+        uv__io_drained(&stream->io_watcher, POLLIN);
         if (stream->flags & UV_HANDLE_READING) {
           uv__io_start(stream->loop, &stream->io_watcher, POLLIN);
           uv__stream_osx_interrupt_select(stream);
@@ -1225,6 +1926,7 @@ static void uv__read(uv_stream_t* stream) {
         msg.msg_iov = (struct iovec*) &blankbuf;
         nread = 0;
         do {
+          uv__count_syscall(stream->loop, read);
           nread = uv__recvmsg(uv__stream_fd(stream), &msg, 0);
           err = uv__stream_recv_cmsg(stream, &msg);
           if (err != 0) {
@@ -1236,9 +1938,15 @@ static void uv__read(uv_stream_t* stream) {
         msg.msg_iov = old;
       }
 #endif
+      /* Return if we didn't fill the buffer, there is no more data to read.
+       * Anything that arrives later is a new edge. Tell before read_cb, it
+       * may start reading again.
+       */
+      if (nread < buflen)
+        uv__io_drained(&stream->io_watcher, POLLIN);
+
       stream->read_cb(stream, nread, &buf);
 
-      /* Return if we didn't fill the buffer, there is no more data to read. */
       if (nread < buflen) {
         stream->flags |= UV_HANDLE_READ_PARTIAL;
         return;
@@ -1301,6 +2009,13 @@ static void uv__stream_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
 
   assert(uv__stream_fd(stream) >= 0);
 
+#if defined(__linux__)
+  if (stream->iou != NULL) {
+    uv__stream_iou_io(stream);
+    return;
+  }
+#endif
+
   /* Ignore POLLHUP here. Even if it's set, there may still be data to read. */
   if (events & (POLLIN | POLLERR | POLLHUP))
     uv__read(stream);
@@ -1387,6 +2102,11 @@ static void uv__stream_connect(uv_stream_t* stream) {
     uv__stream_flush_write_queue(stream, UV_ECANCELED);
     uv__write_callbacks(stream);
   }
+#if defined(__linux__)
+  else if (stream->iou != NULL) {
+    uv__stream_iou_io(stream);
+  }
+#endif
 }
 
 
@@ -1471,6 +2191,11 @@ int uv_write2(uv_write_t* req,
   else if (empty_queue) {
     uv__write(stream);
   }
+#if defined(__linux__)
+  else if (stream->iou != NULL) {
+    uv__write(stream);  /* Unless a request is in flight already. */
+  }
+#endif
   else {
     /*
      * blocking streams should never have anything in the queue.
@@ -1517,6 +2242,11 @@ int uv_try_write(uv_stream_t* stream,
   if (stream->connect_req != NULL || stream->write_queue_size != 0)
     return UV_EAGAIN;
 
+#if defined(__linux__)
+  if (stream->iou != NULL)
+    return uv__stream_iou_try_write(stream, bufs, nbufs);
+#endif
+
   has_pollout = uv__io_active(&stream->io_watcher, POLLOUT);
 
   r = uv_write(&req, stream, bufs, nbufs, uv_try_write_cb);
@@ -1579,6 +2309,14 @@ int uv_read_start(uv_stream_t* stream,
   stream->read_cb = read_cb;
   stream->alloc_cb = alloc_cb;
 
+#if defined(__linux__)
+  if (stream->iou != NULL) {
+    uv__stream_iou_read_start(stream);
+    uv__handle_start(stream);
+    return 0;
+  }
+#endif
+
   uv__io_start(stream->loop, &stream->io_watcher, POLLIN);
   uv__handle_start(stream);
   uv__stream_osx_interrupt_select(stream);
@@ -1597,6 +2335,11 @@ int uv_read_stop(uv_stream_t* stream) {
     uv__handle_stop(stream);
   uv__stream_osx_interrupt_select(stream);
 
+#if defined(__linux__)
+  if (stream->iou != NULL)
+    uv__stream_iou_read_stop(stream);
+#endif
+
   stream->read_cb = NULL;
   stream->alloc_cb = NULL;
   return 0;
@@ -1660,6 +2403,11 @@ void uv__stream_close(uv_stream_t* handle) {
   uv__handle_stop(handle);
   handle->flags &= ~(UV_HANDLE_READABLE | UV_HANDLE_WRITABLE);
 
+#if defined(__linux__)
+  if (handle->iou != NULL)
+    uv__stream_iou_close(handle);
+#endif
+
   if (handle->io_watcher.fd != -1) {
     /* Don't close stdio file descriptors.  Nothing good comes from it. */
     if (handle->io_watcher.fd > STDERR_FILENO)
@@ -252,6 +252,7 @@ int uv__tcp_connect(uv_connect_t* req,
   uv__req_init(handle->loop, req, UV_CONNECT);
   req->cb = cb;
   req->handle = (uv_stream_t*) handle;
+  req->race = NULL;
   QUEUE_INIT(&req->queue);
   handle->connect_req = req;
 
@@ -264,6 +265,312 @@ int uv__tcp_connect(uv_connect_t* req,
 }
 
 
+/* RFC 8305 "Connection Attempt Delay", the time to wait for an attempt to
+ * succeed before starting the next one in parallel.
+ */
+#define UV__TCP_ATTEMPT_DELAY 250
+
+struct uv__tcp_race;
+
+struct uv__tcp_attempt {
+  uv__io_t io;  /* io.fd is -1 when the attempt isn't in progress. */
+  struct uv__tcp_race* race;
+  struct sockaddr_storage addr;
+};
+
+struct uv__tcp_race {
+  uv_connect_t* req;
+  uv_tcp_t* handle;
+  uv_timer_t timer;
+  unsigned int naddrs;
+  unsigned int next;  /* Next address to try. */
+  unsigned int active;  /* Attempts in progress. */
+  int error;  /* Why the last attempt failed. */
+  struct uv__tcp_attempt attempts[1];
+};
+
+
+static unsigned int uv__tcp_race_addrlen(const struct sockaddr* addr) {
+  if (addr->sa_family == AF_INET6)
+    return sizeof(struct sockaddr_in6);
+  return sizeof(struct sockaddr_in);
+}
+
+
+static int uv__tcp_race_usable(const struct addrinfo* ai, int family) {
+  if (ai->ai_family != family || ai->ai_addr == NULL)
+    return 0;
+
+  if (ai->ai_socktype != 0 && ai->ai_socktype != SOCK_STREAM)
+    return 0;
+
+  return ai->ai_addrlen >= uv__tcp_race_addrlen(ai->ai_addr);
+}
+
+
+static void uv__tcp_race_add(struct uv__tcp_race* race,
+                             const struct sockaddr* addr) {
+  struct uv__tcp_attempt* a;
+  unsigned int len;
+  unsigned int i;
+
+  /* getaddrinfo() returns an address once for every socket type. */
+  len = uv__tcp_race_addrlen(addr);
+  for (i = 0; i < race->naddrs; i++)
+    if (0 == memcmp(&race->attempts[i].addr, addr, len))
+      return;
+
+  a = &race->attempts[race->naddrs++];
+  a->io.fd = -1;
+  a->race = race;
+  memcpy(&a->addr, addr, len);
+}
+
+
+/* Order the addresses the way RFC 8305 tries them: alternate between the
+ * families, starting with the one of the first address.
+ */
+static void uv__tcp_race_sort(struct uv__tcp_race* race,
+                              const struct addrinfo* ai) {
+  const struct addrinfo* next[2];
+  const struct addrinfo* p;
+  int families[2];
+  int f;
+
+  for (p = ai; p != NULL; p = p->ai_next)
+    if (uv__tcp_race_usable(p, AF_INET) || uv__tcp_race_usable(p, AF_INET6))
+      break;
+
+  families[0] = p != NULL && p->ai_family == AF_INET6 ? AF_INET6 : AF_INET;
+  families[1] = families[0] == AF_INET6 ? AF_INET : AF_INET6;
+  next[0] = ai;
+  next[1] = ai;
+
+  for (f = 0; next[0] != NULL || next[1] != NULL; f ^= 1) {
+    while (next[f] != NULL && !uv__tcp_race_usable(next[f], families[f]))
+      next[f] = next[f]->ai_next;
+
+    if (next[f] != NULL) {
+      uv__tcp_race_add(race, next[f]->ai_addr);
+      next[f] = next[f]->ai_next;
+    }
+  }
+}
+
+
+static void uv__tcp_race_close_cb(uv_handle_t* handle) {
+  uv__free(handle->data);
+}
+
+
+/* Close the attempts that are still in progress and free the race. */
+static void uv__tcp_race_stop(struct uv__tcp_race* race) {
+  struct uv__tcp_attempt* a;
+  unsigned int i;
+
+  for (i = 0; i < race->next; i++) {
+    a = &race->attempts[i];
+    if (a->io.fd == -1)
+      continue;
+
+    uv__io_close(race->handle->loop, &a->io);
+    uv__close(a->io.fd);
+    a->io.fd = -1;
+  }
+
+  race->req->race = NULL;
+  uv_close((uv_handle_t*) &race->timer, uv__tcp_race_close_cb);
+}
+
+
+static void uv__tcp_race_finish(struct uv__tcp_race* race, int status) {
+  uv_connect_t* req;
+  uv_tcp_t* handle;
+
+  req = race->req;
+  handle = race->handle;
+  uv__tcp_race_stop(race);
+
+  handle->connect_req = NULL;
+  uv__req_unregister(handle->loop, req);
+
+  if (req->cb)
+    req->cb(req, status);
+}
+
+
+static void uv__tcp_race_won(struct uv__tcp_attempt* a) {
+  uv_tcp_t* handle;
+  int err;
+  int fd;
+
+  handle = a->race->handle;
+  fd = a->io.fd;
+  uv__io_close(handle->loop, &a->io);
+  a->io.fd = -1;
+
+  err = uv__stream_open((uv_stream_t*) handle,
+                        fd,
+                        UV_HANDLE_READABLE | UV_HANDLE_WRITABLE);
+  if (err)
+    uv__close(fd);
+
+  uv__tcp_race_finish(a->race, err);
+}
+
+
+static void uv__tcp_race_timer_cb(uv_timer_t* timer);
+static void uv__tcp_race_io(uv_loop_t* loop, uv__io_t* w, unsigned int e);
+
+
+/* Start the next attempt. When there is none, report the last error once
+ * the attempts in progress have failed too.
+ */
+static void uv__tcp_race_next(struct uv__tcp_race* race) {
+  struct uv__tcp_attempt* a;
+  uv_loop_t* loop;
+  int fd;
+  int r;
+
+  loop = race->handle->loop;
+
+  while (race->next < race->naddrs) {
+    a = &race->attempts[race->next++];
+
+    fd = uv__socket(a->addr.ss_family, SOCK_STREAM, 0);
+    if (fd < 0) {
+      race->error = fd;
+      continue;
+    }
+
+    do {
+      errno = 0;
+      r = connect(fd,
+                  (const struct sockaddr*) &a->addr,
+                  uv__tcp_race_addrlen((const struct sockaddr*) &a->addr));
+    } while (r == -1 && errno == EINTR);
+
+    /* Immediate successes are reported from the watcher too, the callback
+     * can't run before uv_tcp_connect_addrinfo() returns.
+     */
+    if (r == -1 && errno != 0 && errno != EINPROGRESS) {
+      race->error = UV__ERR(errno);
+      uv__close(fd);
+      continue;
+    }
+
+    uv__io_init(&a->io, uv__tcp_race_io, fd);
+    uv__io_start(loop, &a->io, POLLOUT);
+    race->active++;
+    uv_timer_start(&race->timer,
+                   uv__tcp_race_timer_cb,
+                   UV__TCP_ATTEMPT_DELAY,
+                   0);
+    return;
+  }
+
+  if (race->active == 0)
+    uv_timer_start(&race->timer, uv__tcp_race_timer_cb, 0, 0);
+}
+
+
+static void uv__tcp_race_timer_cb(uv_timer_t* timer) {
+  struct uv__tcp_race* race;
+
+  race = timer->data;
+
+  if (race->next < race->naddrs)
+    uv__tcp_race_next(race);
+  else if (race->active == 0)
+    uv__tcp_race_finish(race, race->error);
+}
+
+
+static void uv__tcp_race_io(uv_loop_t* loop, uv__io_t* w, unsigned int e) {
+  struct uv__tcp_attempt* a;
+  socklen_t errorsize;
+  int error;
+
+  a = container_of(w, struct uv__tcp_attempt, io);
+
+  errorsize = sizeof(error);
+  error = 0;
+  getsockopt(a->io.fd, SOL_SOCKET, SO_ERROR, &error, &errorsize);
+
+  if (error == EINPROGRESS)
+    return;
+
+  if (error == 0) {
+    uv__tcp_race_won(a);
+    return;
+  }
+
+  uv__io_close(loop, &a->io);
+  uv__close(a->io.fd);
+  a->io.fd = -1;
+  a->race->active--;
+  a->race->error = UV__ERR(error);
+
+  /* Don't wait for the delay to run out, a failed attempt makes room for
+   * the next one right away.
+   */
+  uv__tcp_race_next(a->race);
+}
+
+
+int uv_tcp_connect_addrinfo(uv_connect_t* req,
+                            uv_tcp_t* handle,
+                            const struct addrinfo* ai,
+                            uv_connect_cb cb) {
+  struct uv__tcp_race* race;
+  const struct addrinfo* p;
+  unsigned int n;
+
+  if (handle->type != UV_TCP || uv__stream_fd(handle) != -1)
+    return UV_EINVAL;
+
+  if (handle->connect_req != NULL)
+    return UV_EALREADY;
+
+  for (n = 0, p = ai; p != NULL; p = p->ai_next)
+    n++;
+
+  race = uv__malloc(sizeof(*race) + n * sizeof(race->attempts[0]));
+  if (race == NULL)
+    return UV_ENOMEM;
+
+  race->naddrs = 0;
+  uv__tcp_race_sort(race, ai);
+
+  if (race->naddrs == 0) {
+    uv__free(race);
+    return UV_EINVAL;
+  }
+
+  race->req = req;
+  race->handle = handle;
+  race->next = 0;
+  race->active = 0;
+  race->error = UV_ECONNREFUSED;
+
+  uv_timer_init(handle->loop, &race->timer);
+  race->timer.flags |= UV_HANDLE_INTERNAL;
+  race->timer.data = race;
+  uv__handle_unref(&race->timer);
+
+  uv__req_init(handle->loop, req, UV_CONNECT);
+  req->cb = cb;
+  req->handle = (uv_stream_t*) handle;
+  req->race = race;
+  QUEUE_INIT(&req->queue);
+  handle->connect_req = req;
+
+  uv__tcp_race_next(race);
+
+  return 0;
+}
+
+
 int uv_tcp_open(uv_tcp_t* handle, uv_os_sock_t sock) {
   int err;
 
@@ -457,5 +764,9 @@ int uv_tcp_simultaneous_accepts(uv_tcp_t* handle, int enable) {
 
 
 void uv__tcp_close(uv_tcp_t* handle) {
+  /* The connect request itself is cancelled when the handle is destroyed. */
+  if (handle->connect_req != NULL && handle->connect_req->race != NULL)
+    uv__tcp_race_stop(handle->connect_req->race);
+
   uv__stream_close((uv_stream_t*)handle);
 }
@@ -749,13 +749,72 @@ int uv_loop_configure(uv_loop_t* loop, uv_loop_option option, ...) {
 
   va_start(ap, option);
   /* Any platform-agnostic options should be handled here. */
-  err = uv__loop_configure(loop, option, ap);
+  if (option == UV_LOOP_THREADPOOL_SIZE)
+    err = uv__threadpool_loop_configure(loop, va_arg(ap, unsigned int));
+  else if (option == UV_METRICS_THREADPOOL)
+    err = uv__threadpool_metrics_enable(loop);
+  else
+    err = uv__loop_configure(loop, option, ap);
   va_end(ap);
 
   return err;
 }
 
 
+void uv__run_budget_start(uv_loop_t* loop, uv_run_mode mode) {
+  uv__loop_internal_fields_t* lfields;
+
+  lfields = uv__get_internal_fields(loop);
+  if (mode != UV_RUN_BUDGET) {
+    lfields->run_budget = UV__RUN_BUDGET_OFF;
+    return;
+  }
+
+  lfields->run_budget = UV__RUN_BUDGET_ON;
+  lfields->run_callbacks = 0;
+  lfields->run_deadline = 0;
+  if (lfields->run_budget_time != 0)
+    lfields->run_deadline = uv_hrtime() + lfields->run_budget_time;
+}
+
+
+/* Once spent the budget stays spent, what's left over waits for the next
+ * call. The first callback always runs so that every call makes progress.
+ */
+int uv__run_budget_spent(uv_loop_t* loop) {
+  uv__loop_internal_fields_t* lfields;
+
+  lfields = uv__get_internal_fields(loop);
+  if (lfields->run_budget != UV__RUN_BUDGET_ON)
+    return lfields->run_budget == UV__RUN_BUDGET_SPENT;
+
+  if (lfields->run_callbacks == 0)
+    return 0;
+
+  if (lfields->run_budget_callbacks != 0 &&
+      lfields->run_callbacks >= lfields->run_budget_callbacks) {
+    lfields->run_budget = UV__RUN_BUDGET_SPENT;
+    return 1;
+  }
+
+  if (lfields->run_deadline != 0 && uv_hrtime() >= lfields->run_deadline) {
+    lfields->run_budget = UV__RUN_BUDGET_SPENT;
+    return 1;
+  }
+
+  return 0;
+}
+
+
+int uv__run_budget_charge(uv_loop_t* loop) {
+  if (uv__run_budget_spent(loop))
+    return 1;
+
+  uv__get_internal_fields(loop)->run_callbacks++;
+  return 0;
+}
+
+
 static uv_loop_t default_loop_struct;
 static uv_loop_t* default_loop_ptr;
 
@@ -804,6 +863,9 @@ int uv_loop_close(uv_loop_t* loop) {
       return UV_EBUSY;
   }
 
+  uv__watchdog_loop_close(loop);
+  uv__trace_loop_close(loop);
+  uv__threadpool_loop_close(loop);
   uv__loop_close(loop);
 
 #ifndef NDEBUG
@@ -926,3 +988,169 @@ uint64_t uv_metrics_idle_time(uv_loop_t* loop) {
     idle_time += uv_hrtime() - entry_time;
   return idle_time;
 }
+
+
+static unsigned int uv__metrics_bucket(uint64_t val) {
+  unsigned int n;
+
+  for (n = 0; val != 0 && n < UV_METRICS_HISTOGRAM_SIZE - 1; n++)
+    val >>= 1;
+
+  return n;
+}
+
+
+/* The poll phase doesn't count the time the loop was blocked in the event
+ * provider, UV_METRICS_LOOP_PHASES turns on UV_METRICS_IDLE_TIME for that.
+ */
+int uv__metrics_phases_enable(uv_loop_t* loop) {
+  uv__loop_metrics_t* loop_metrics;
+
+  loop_metrics = uv__get_loop_metrics(loop);
+  loop_metrics->phase_idle_time = loop_metrics->provider_idle_time;
+  uv__get_internal_fields(loop)->flags |=
+      UV_METRICS_IDLE_TIME | UV__METRICS_LOOP_PHASES;
+
+  return 0;
+}
+
+
+uint64_t uv__metrics_loop_start(uv_loop_t* loop) {
+  uv__loop_metrics_t* loop_metrics;
+
+  loop_metrics = uv__get_loop_metrics(loop);
+  loop_metrics->phase_loop_time = 0;
+  loop_metrics->phase_callbacks = 0;
+  loop_metrics->callback_start = 0;
+
+  return uv_hrtime();
+}
+
+
+static void uv__metrics_callback_end(uv__loop_metrics_t* loop_metrics,
+                                     uint64_t now) {
+  uint64_t elapsed;
+
+  if (loop_metrics->callback_start == 0)
+    return;
+
+  elapsed = now - loop_metrics->callback_start;
+  loop_metrics->callback_start = 0;
+
+  if (elapsed > loop_metrics->phases.max_callback_time)
+    loop_metrics->phases.max_callback_time = elapsed;
+
+  loop_metrics->phases.callback_histogram[uv__metrics_bucket(elapsed / 1000)]++;
+}
+
+
+void uv__metrics_callback_start(uv_loop_t* loop) {
+  uv__loop_metrics_t* loop_metrics;
+  uint64_t now;
+
+  loop_metrics = uv__get_loop_metrics(loop);
+  now = uv_hrtime();
+  uv__metrics_callback_end(loop_metrics, now);
+  loop_metrics->callback_start = now;
+  loop_metrics->phase_callbacks++;
+  loop_metrics->phases.callbacks++;
+}
+
+
+/* Returns the time the phase ended, which is when the next one starts. */
+uint64_t uv__metrics_phase_end(uv_loop_t* loop,
+                               uv_metrics_phase phase,
+                               uint64_t start) {
+  uv__loop_metrics_t* loop_metrics;
+  uv_metrics_t* phases;
+  uint64_t elapsed;
+  uint64_t idle;
+  uint64_t now;
+
+  loop_metrics = uv__get_loop_metrics(loop);
+  phases = &loop_metrics->phases;
+  now = uv_hrtime();
+  uv__metrics_callback_end(loop_metrics, now);
+  elapsed = now - start;
+
+  /* The loop thread is the only one that writes provider_idle_time, it can
+   * read it without taking the lock.
+   */
+  if (phase == UV_METRICS_PHASE_POLL) {
+    idle = loop_metrics->provider_idle_time - loop_metrics->phase_idle_time;
+    loop_metrics->phase_idle_time = loop_metrics->provider_idle_time;
+    elapsed = elapsed > idle ? elapsed - idle : 0;
+    phases->events += loop_metrics->phase_callbacks;
+    phases->events_histogram[
+        uv__metrics_bucket(loop_metrics->phase_callbacks)]++;
+  }
+
+  loop_metrics->phase_callbacks = 0;
+  phases->phase_time[phase] += elapsed;
+  loop_metrics->phase_loop_time += elapsed;
+
+  if (phase == UV_METRICS_PHASE_CLOSING) {
+    phases->loop_count++;
+    phases->loop_histogram[
+        uv__metrics_bucket(loop_metrics->phase_loop_time / 1000)]++;
+    loop_metrics->phase_loop_time = 0;
+  }
+
+  return now;
+}
+
+
+int uv_metrics_info(const uv_loop_t* loop, uv_metrics_t* metrics) {
+  if (metrics == NULL)
+    return UV_EINVAL;
+
+  *metrics = uv__get_loop_metrics(loop)->phases;
+  return 0;
+}
+
+
+int uv_metrics_syscalls(const uv_loop_t* loop,
+                        uv_metrics_syscalls_t* syscalls) {
+#if defined(_WIN32) || defined(UV_NO_SYSCALL_COUNTERS)
+  return UV_ENOSYS;
+#else
+  const uv__loop_metrics_t* loop_metrics;
+
+  if (syscalls == NULL)
+    return UV_EINVAL;
+
+  loop_metrics = uv__get_loop_metrics(loop);
+  *syscalls = loop_metrics->syscalls;
+
+  /* Senders on other threads count the wakeups. */
+  syscalls->eventfd_write =
+      uv__atomic_load((uint64_t*) &loop_metrics->syscalls.eventfd_write);
+
+  return 0;
+#endif
+}
+
+
+uint64_t uv_metrics_epoll_ctl_elided(const uv_loop_t* loop) {
+  return uv__get_loop_metrics(loop)->epoll_ctl_elided;
+}
+
+
+uint64_t uv_metrics_busy_poll_time(const uv_loop_t* loop) {
+  return uv__get_loop_metrics(loop)->busy_poll_time;
+}
+
+
+int uv_metrics_poll_batch(const uv_loop_t* loop,
+                          unsigned int* size,
+                          unsigned int* repolls) {
+  const uv__loop_internal_fields_t* lfields;
+
+  lfields = uv__get_internal_fields(loop);
+  if (lfields->poll_batch == 0)
+    return UV_ENOSYS;
+
+  *size = lfields->poll_batch;
+  *repolls = lfields->poll_repolls;
+  return 0;
+}
@@ -68,6 +68,38 @@ extern int snprintf(char*, size_t, const char*, ...);
 #define uv__store_relaxed(p, v) do *p = v; while (0)
 #endif
 
+/* Sequentially consistent counterparts, for counters shared between the loop
+ * and the threadpool.
+ */
+#if defined(__GNUC__) && (__GNUC__ > 4 || __GNUC__ == 4 && __GNUC_MINOR__ >= 7)
+#define uv__atomic_load(p) __atomic_load_n(p, __ATOMIC_SEQ_CST)
+#define uv__atomic_store(p, v) __atomic_store_n(p, v, __ATOMIC_SEQ_CST)
+#define uv__atomic_fetch_add(p, v) __atomic_fetch_add(p, v, __ATOMIC_SEQ_CST)
+#define uv__atomic_load_ptr(p) __atomic_load_n(p, __ATOMIC_SEQ_CST)
+#define uv__atomic_exchange(p, v) __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST)
+#define uv__atomic_cas(p, o, n) __sync_bool_compare_and_swap(p, o, n)
+#elif defined(_MSC_VER)
+#define uv__atomic_load(p) InterlockedOr((LONG volatile*) (p), 0)
+#define uv__atomic_store(p, v) InterlockedExchange((LONG volatile*) (p), (v))
+#define uv__atomic_fetch_add(p, v)                                            \
+  InterlockedExchangeAdd((LONG volatile*) (p), (v))
+#define uv__atomic_load_ptr(p)                                                \
+  InterlockedCompareExchangePointer((PVOID volatile*) (p), NULL, NULL)
+#define uv__atomic_exchange(p, v)                                             \
+  InterlockedExchangePointer((PVOID volatile*) (p), (v))
+#define uv__atomic_cas(p, o, n)                                               \
+  (InterlockedCompareExchangePointer((PVOID volatile*) (p), (n), (o)) == (o))
+#else
+#define uv__atomic_load(p) __sync_fetch_and_add(p, 0)
+#define uv__atomic_store(p, v)                                                \
+  do { __sync_synchronize(); *(p) = (v); __sync_synchronize(); } while (0)
+#define uv__atomic_fetch_add(p, v) __sync_fetch_and_add(p, v)
+#define uv__atomic_load_ptr(p) __sync_val_compare_and_swap(p, NULL, NULL)
+#define uv__atomic_exchange(p, v)                                             \
+  (__sync_synchronize(), __sync_lock_test_and_set(p, v))
+#define uv__atomic_cas(p, o, n) __sync_bool_compare_and_swap(p, o, n)
+#endif
+
 /* Handle flags. Some flags are specific to Windows or UNIX. */
 enum {
   /* Used by all handles. */
@@ -186,12 +218,14 @@ int uv__udp_recv_stop(uv_udp_t* handle);
 
 void uv__fs_poll_close(uv_fs_poll_t* handle);
 
+void uv__file_writer_close(uv_file_writer_t* handle);
+
 int uv__getaddrinfo_translate_error(int sys_err);    /* EAI_* error. */
 
 enum uv__work_kind {
-  UV__WORK_CPU,
-  UV__WORK_FAST_IO,
-  UV__WORK_SLOW_IO
+  UV__WORK_CPU = UV_WORK_CPU,
+  UV__WORK_FAST_IO = UV_WORK_FAST_IO,
+  UV__WORK_SLOW_IO = UV_WORK_SLOW_IO
 };
 
 void uv__work_submit(uv_loop_t* loop,
@@ -205,6 +239,7 @@ void uv__work_done(uv_async_t* handle);
 // Linux AIO
 void uv__aio_submit(uv_loop_t* loop,
                     uv_fs_t* req,
+                    void (*work)(struct uv__work* w),
                     void (*done)(struct uv__work* w, int status));
 
 void uv__aio_work_done(uv__aio_t* handle);
@@ -224,6 +259,12 @@ void uv__timer_close(uv_timer_t* handle);
 void uv__process_title_cleanup(void);
 void uv__signal_cleanup(void);
 void uv__threadpool_cleanup(void);
+int uv__threadpool_loop_configure(uv_loop_t* loop, unsigned int nthreads);
+int uv__threadpool_metrics_enable(uv_loop_t* loop);
+void uv__threadpool_loop_close(uv_loop_t* loop);
+#ifndef _WIN32
+void uv__threadpool_loop_fork(uv_loop_t* loop);
+#endif
 
 #define uv__has_active_reqs(loop)                                             \
   ((loop)->active_reqs.count > 0)
@@ -358,18 +399,153 @@ void* uv__reallocf(void* ptr, size_t size);
 typedef struct uv__loop_metrics_s uv__loop_metrics_t;
 typedef struct uv__loop_internal_fields_s uv__loop_internal_fields_t;
 
+/* Set by UV_METRICS_LOOP_PHASES, next to UV_METRICS_IDLE_TIME. */
+#define UV__METRICS_LOOP_PHASES 0x100
+
 struct uv__loop_metrics_s {
   uint64_t provider_entry_time;
   uint64_t provider_idle_time;
+  uint64_t epoll_ctl_elided;  /* Loop thread only. */
+  uint64_t busy_poll_time;  /* Loop thread only. */
+  uv_metrics_t phases;  /* Loop thread only. */
+  uint64_t phase_loop_time;  /* This iteration so far. */
+  uint64_t phase_idle_time;  /* provider_idle_time at the end of the last
+                                poll phase. */
+  uint64_t phase_callbacks;  /* Run in the current phase. */
+  uint64_t callback_start;  /* Of the callback that's running, or 0. */
+  uv_metrics_syscalls_t syscalls;  /* Loop thread only, but eventfd_write. */
   uv_mutex_t lock;
 };
 
 void uv__metrics_update_idle_time(uv_loop_t* loop);
 void uv__metrics_set_provider_entry_time(uv_loop_t* loop);
 
+int uv__metrics_phases_enable(uv_loop_t* loop);
+uint64_t uv__metrics_loop_start(uv_loop_t* loop);
+uint64_t uv__metrics_phase_end(uv_loop_t* loop,
+                               uv_metrics_phase phase,
+                               uint64_t start);
+void uv__metrics_callback_start(uv_loop_t* loop);
+
+/* With UV_METRICS_LOOP_PHASES, |t| is when the loop iteration started, see
+ * uv__metrics_loop_start(). It's 0 otherwise and this is a no-op.
+ */
+#define uv__metrics_phase(loop, phase, t)                                     \
+  do {                                                                        \
+    if ((t) != 0)                                                             \
+      (t) = uv__metrics_phase_end((loop), (phase), (t));                      \
+  }                                                                           \
+  while (0)
+
+/* Set while the loop has a watchdog, see uv_loop_watchdog_start(). */
+#define UV__LOOP_WATCHDOG 0x200
+
+void uv__watchdog_beat(uv_loop_t* loop,
+                       uv_handle_type type,
+                       void* handle,
+                       void (*cb)(void),
+                       int fd);
+void uv__watchdog_idle(uv_loop_t* loop, int idle);
+void uv__watchdog_loop_close(uv_loop_t* loop);
+void uv__watchdog_loop_fork(uv_loop_t* loop);
+
+/* Before each callback the loop runs. Callbacks are timed from one to the
+ * next, the last one of a phase until the end of the phase. The watchdog
+ * is told which callback it is, |fd| is -1 for the ones that aren't I/O.
+ */
+#define uv__loop_callback(loop, type, handle, cb, fd)                         \
+  do {                                                                        \
+    unsigned int flags_ = uv__get_internal_fields(loop)->flags;               \
+    if (flags_ & UV__METRICS_LOOP_PHASES)                                     \
+      uv__metrics_callback_start(loop);                                       \
+    if (flags_ & UV__LOOP_WATCHDOG)                                           \
+      uv__watchdog_beat((loop),                                               \
+                        (type),                                               \
+                        (handle),                                             \
+                        (void (*)(void)) (cb),                                \
+                        (fd));                                                \
+  }                                                                           \
+  while (0)
+
+/* Blocked for I/O or out of uv_run(), not stalled however long it takes. */
+#define uv__loop_idle(loop, idle)                                             \
+  do {                                                                        \
+    if (uv__get_internal_fields(loop)->flags & UV__LOOP_WATCHDOG)             \
+      uv__watchdog_idle((loop), (idle));                                      \
+  }                                                                           \
+  while (0)
+
+int uv__trace_configure(uv_loop_t* loop, unsigned int records);
+void uv__trace_record(uv_loop_t* loop,
+                      uv_trace_event event,
+                      int type,
+                      int fd,
+                      uint64_t arg);
+void uv__trace_loop_close(uv_loop_t* loop);
+
+/* Records a loop event with UV_LOOP_TRACE. Built with UV_NO_TRACE, there's
+ * no trace and this is nothing.
+ */
+#ifdef UV_NO_TRACE
+#define uv__trace(loop, event, type, fd, arg)                                 \
+  do {                                                                        \
+  }                                                                           \
+  while (0)
+#else
+#define uv__trace(loop, event, type, fd, arg)                                 \
+  do {                                                                        \
+    if (uv__get_internal_fields(loop)->trace != NULL)                         \
+      uv__trace_record((loop), (event), (type), (fd), (uint64_t) (arg));      \
+  }                                                                           \
+  while (0)
+#endif
+
+enum {
+  UV__RUN_BUDGET_OFF = 0,
+  UV__RUN_BUDGET_ON,  /* In uv_run(UV_RUN_BUDGET). */
+  UV__RUN_BUDGET_SPENT  /* Ran out, until the next uv_run() call. */
+};
+
+void uv__run_budget_start(uv_loop_t* loop, uv_run_mode mode);
+int uv__run_budget_spent(uv_loop_t* loop);
+int uv__run_budget_charge(uv_loop_t* loop);
+
+/* Non-zero when uv_run(UV_RUN_BUDGET) has no budget left for another
+ * callback, the callback must not run then. Otherwise counts the callback
+ * against the budget. Cheap in the other modes.
+ */
+#define uv__run_budget_take(loop)                                             \
+  (uv__get_internal_fields(loop)->run_budget != UV__RUN_BUDGET_OFF &&         \
+   uv__run_budget_charge(loop) != 0)
+
 struct uv__loop_internal_fields_s {
   unsigned int flags;
   uv__loop_metrics_t loop_metrics;
+  void* fs_poll_registry;  /* Shared timer and heap of all polled paths. */
+  void* dns;  /* Resolver configuration with UV_LOOP_NATIVE_DNS. */
+  void* random;  /* Keystream for asynchronous uv_random() requests. */
+  void* io_uring;  /* Readiness backend with UV_LOOP_USE_IO_URING. */
+  uint64_t busy_poll_max;  /* Nanoseconds, 0 unless UV_LOOP_BUSY_POLL. */
+  uint64_t busy_poll_budget;  /* Nanoseconds to spin on the next poll. */
+  void* poll_events;  /* Event buffer of uv__io_poll(). */
+  unsigned int poll_batch;  /* Its size, adapts to the events per poll. */
+  unsigned int poll_batch_max;  /* UV_LOOP_POLL_BATCH_MAX. */
+  unsigned int poll_batch_small;  /* Polls in a row that used little of it. */
+  unsigned int poll_repolls;  /* Most polls per uv__io_poll() call. */
+  unsigned int poll_stash;  /* First event in the buffer not run yet. */
+  unsigned int poll_stash_nfds;  /* Events in the buffer, 0 if none left. */
+  uint64_t run_budget_time;  /* UV_LOOP_RUN_BUDGET, nanoseconds. */
+  uint64_t run_deadline;  /* When uv_run(UV_RUN_BUDGET) stops, 0 if never. */
+  unsigned int run_budget_callbacks;  /* UV_LOOP_RUN_BUDGET. */
+  unsigned int run_callbacks;  /* Run so far by uv_run(UV_RUN_BUDGET). */
+  int run_budget;  /* UV__RUN_BUDGET_OFF, _ON or _SPENT. */
+  void* watchdog;  /* uv_loop_watchdog_start(), kept until the loop closes. */
+  void* trace;  /* Ring of loop events with UV_LOOP_TRACE, or NULL. */
+  struct uv__executor* executor;  /* Private threadpool, NULL for the global
+                                     one. */
+  struct uv__work* work_completed;  /* Lock-free list of finished work. */
+  int work_draining;
+  uv_async_t* async_pending;  /* Lock-free stack of sent handles. */
 };
 
 #endif /* UV_COMMON_H_ */
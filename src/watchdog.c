@@ -0,0 +1,296 @@
+/* Copyright libuv contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "uv-common.h"
+
+/* The loop thread doesn't read the clock or take a lock for the watchdog.
+ * It stores the callback it's about to run and bumps a counter, that's all.
+ * The watchdog thread wakes up four times per threshold and takes a counter
+ * that hasn't moved since it first saw it, a threshold ago, for a stall. The
+ * elapsed time it reports is short by up to a quarter of the threshold.
+ *
+ * The stores are relaxed. The counter is read again after the callback, a
+ * counter that hasn't moved for that long was bumped after the callback was
+ * stored.
+ */
+struct uv__watchdog {
+  /* Written by the loop thread. */
+  unsigned long beat;
+  int idle;
+  int type;
+  int fd;
+  void* handle;
+  void (*callback)(void);
+
+  /* Protected by |mutex|. */
+  uv_loop_t* loop;
+  uv_thread_t thread;
+  uv_mutex_t mutex;
+  uv_cond_t cond;
+  uv_stall_cb cb;
+  uint64_t threshold;  /* Nanoseconds. */
+  int stop;
+  unsigned int nstalls;  /* Ever seen, the last UV_WATCHDOG_STALLS are kept. */
+  uv_stall_t stalls[UV_WATCHDOG_STALLS];
+};
+
+
+static struct uv__watchdog* uv__watchdog(const uv_loop_t* loop) {
+  return (struct uv__watchdog*) uv__get_internal_fields(loop)->watchdog;
+}
+
+
+void uv__watchdog_beat(uv_loop_t* loop,
+                       uv_handle_type type,
+                       void* handle,
+                       void (*cb)(void),
+                       int fd) {
+  struct uv__watchdog* wd;
+
+  wd = uv__watchdog(loop);
+  uv__store_relaxed(&wd->type, (int) type);
+  uv__store_relaxed(&wd->handle, handle);
+  uv__store_relaxed(&wd->callback, cb);
+  uv__store_relaxed(&wd->fd, fd);
+  uv__store_relaxed(&wd->idle, 0);
+  uv__store_relaxed(&wd->beat, wd->beat + 1);
+}
+
+
+void uv__watchdog_idle(uv_loop_t* loop, int idle) {
+  struct uv__watchdog* wd;
+
+  wd = uv__watchdog(loop);
+  uv__store_relaxed(&wd->idle, idle);
+  uv__store_relaxed(&wd->beat, wd->beat + 1);
+}
+
+
+#ifndef _WIN32
+static void uv__watchdog_run(void* arg) {
+  struct uv__watchdog* wd;
+  unsigned long beat;
+  unsigned long last;
+  uv_stall_t stall;
+  uv_stall_cb cb;
+  uint64_t since;
+  uint64_t now;
+  int reported;
+
+  wd = arg;
+  last = uv__load_relaxed(&wd->beat);
+  since = uv_hrtime();
+  reported = 0;
+
+  uv_mutex_lock(&wd->mutex);
+
+  while (!wd->stop) {
+    uv_cond_timedwait(&wd->cond, &wd->mutex, wd->threshold / 4);
+    if (wd->stop)
+      break;
+
+    now = uv_hrtime();
+    beat = uv__load_relaxed(&wd->beat);
+
+    if (beat != last || uv__load_relaxed(&wd->idle)) {
+      last = beat;
+      since = now;
+      reported = 0;
+      continue;
+    }
+
+    /* Once per stall. */
+    if (reported || now - since < wd->threshold)
+      continue;
+
+    stall.type = (uv_handle_type) uv__load_relaxed(&wd->type);
+    stall.handle = uv__load_relaxed(&wd->handle);
+    stall.callback = uv__load_relaxed(&wd->callback);
+    stall.fd = uv__load_relaxed(&wd->fd);
+    stall.elapsed = now - since;
+    stall.time = now;
+
+    /* The loop moved on while the callback was being read. */
+    if (uv__load_relaxed(&wd->beat) != beat)
+      continue;
+
+    wd->stalls[wd->nstalls++ % UV_WATCHDOG_STALLS] = stall;
+    reported = 1;
+
+    cb = wd->cb;
+    if (cb != NULL) {
+      uv_mutex_unlock(&wd->mutex);
+      cb(wd->loop, &stall);
+      uv_mutex_lock(&wd->mutex);
+    }
+  }
+
+  uv_mutex_unlock(&wd->mutex);
+}
+#endif
+
+
+int uv_loop_watchdog_start(uv_loop_t* loop,
+                           uint64_t threshold,
+                           uv_stall_cb cb) {
+#ifdef _WIN32
+  /* uv_run() doesn't tell the watchdog which callback it runs. */
+  return UV_ENOSYS;
+#else
+  uv__loop_internal_fields_t* lfields;
+  struct uv__watchdog* wd;
+  int err;
+
+  if (threshold == 0)
+    return UV_EINVAL;
+
+  lfields = uv__get_internal_fields(loop);
+  if (lfields->flags & UV__LOOP_WATCHDOG)
+    return UV_EBUSY;
+
+  wd = lfields->watchdog;
+  if (wd == NULL) {
+    wd = uv__calloc(1, sizeof(*wd));
+    if (wd == NULL)
+      return UV_ENOMEM;
+
+    err = uv_mutex_init(&wd->mutex);
+    if (err) {
+      uv__free(wd);
+      return err;
+    }
+
+    err = uv_cond_init(&wd->cond);
+    if (err) {
+      uv_mutex_destroy(&wd->mutex);
+      uv__free(wd);
+      return err;
+    }
+
+    wd->loop = loop;
+    lfields->watchdog = wd;
+  }
+
+  /* The loop isn't stalled until it runs a callback. */
+  wd->idle = 1;
+  wd->stop = 0;
+  wd->cb = cb;
+  wd->threshold = threshold * 1000000;
+
+  err = uv_thread_create(&wd->thread, uv__watchdog_run, wd);
+  if (err)
+    return err;
+
+  lfields->flags |= UV__LOOP_WATCHDOG;
+  return 0;
+#endif
+}
+
+
+int uv_loop_watchdog_stop(uv_loop_t* loop) {
+  uv__loop_internal_fields_t* lfields;
+  struct uv__watchdog* wd;
+
+  lfields = uv__get_internal_fields(loop);
+  if (!(lfields->flags & UV__LOOP_WATCHDOG))
+    return 0;
+
+  wd = lfields->watchdog;
+  uv_mutex_lock(&wd->mutex);
+  wd->stop = 1;
+  uv_cond_signal(&wd->cond);
+  uv_mutex_unlock(&wd->mutex);
+
+  /* Waits for the stall callback too, if it's running. */
+  uv_thread_join(&wd->thread);
+  lfields->flags &= ~UV__LOOP_WATCHDOG;
+
+  return 0;
+}
+
+
+int uv_loop_watchdog_stalls(const uv_loop_t* loop,
+                            uv_stall_t* stalls,
+                            unsigned int* count) {
+  struct uv__watchdog* wd;
+  unsigned int first;
+  unsigned int n;
+  unsigned int i;
+
+  if (stalls == NULL || count == NULL)
+    return UV_EINVAL;
+
+  wd = uv__watchdog(loop);
+  if (wd == NULL) {
+    *count = 0;
+    return 0;
+  }
+
+  uv_mutex_lock(&wd->mutex);
+
+  n = wd->nstalls;
+  if (n > UV_WATCHDOG_STALLS)
+    n = UV_WATCHDOG_STALLS;
+  if (n > *count)
+    n = *count;
+
+  /* Oldest first. */
+  first = wd->nstalls - n;
+  for (i = 0; i < n; i++)
+    stalls[i] = wd->stalls[(first + i) % UV_WATCHDOG_STALLS];
+
+  uv_mutex_unlock(&wd->mutex);
+
+  *count = n;
+  return 0;
+}
+
+
+void uv__watchdog_loop_close(uv_loop_t* loop) {
+  uv__loop_internal_fields_t* lfields;
+  struct uv__watchdog* wd;
+
+  uv_loop_watchdog_stop(loop);
+
+  lfields = uv__get_internal_fields(loop);
+  wd = lfields->watchdog;
+  if (wd == NULL)
+    return;
+
+  uv_cond_destroy(&wd->cond);
+  uv_mutex_destroy(&wd->mutex);
+  uv__free(wd);
+  lfields->watchdog = NULL;
+}
+
+
+/* The thread isn't there in the child and it may have held the lock when the
+ * process forked. Start over without it.
+ */
+void uv__watchdog_loop_fork(uv_loop_t* loop) {
+  uv__loop_internal_fields_t* lfields;
+
+  lfields = uv__get_internal_fields(loop);
+  uv__free(lfields->watchdog);
+  lfields->watchdog = NULL;
+  lfields->flags &= ~UV__LOOP_WATCHDOG;
+}
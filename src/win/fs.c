@@ -3281,6 +3281,13 @@ int uv_fs_ftruncate(uv_loop_t* loop, uv_fs_t* req, uv_file fd,
 }
 
 
+int uv_fs_fallocate(uv_loop_t* loop, uv_fs_t* req, uv_file fd, int flags,
+    int64_t offset, int64_t length, uv_fs_cb cb) {
+  INIT(UV_FS_FALLOCATE);
+  return UV_ENOSYS;
+}
+
+
 int uv_fs_copyfile(uv_loop_t* loop,
                    uv_fs_t* req,
                    const char* path,
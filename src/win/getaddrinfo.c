@@ -241,6 +241,20 @@ void uv_freeaddrinfo(struct addrinfo* ai) {
 }
 
 
+int uv_dns_cache_configure(const uv_dns_cache_options_t* options) {
+  return UV_ENOSYS;
+}
+
+
+void uv_dns_cache_flush(void) {
+}
+
+
+void uv_dns_cache_metrics(uv_dns_cache_metrics_t* metrics) {
+  memset(metrics, 0, sizeof(*metrics));
+}
+
+
 /*
  * Entry point for getaddrinfo
  * we convert the UTF-8 strings to UNICODE
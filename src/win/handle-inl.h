@@ -156,6 +156,10 @@ INLINE static void uv_process_endgames(uv_loop_t* loop) {
         uv__fs_poll_endgame(loop, (uv_fs_poll_t*) handle);
         break;
 
+      case UV_FILE_WRITER:
+        uv__file_writer_endgame(loop, (uv_file_writer_t*) handle);
+        break;
+
       default:
         assert(0);
         break;
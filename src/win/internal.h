@@ -261,6 +261,12 @@ void uv_fs_event_endgame(uv_loop_t* loop, uv_fs_event_t* handle);
 void uv__fs_poll_endgame(uv_loop_t* loop, uv_fs_poll_t* handle);
 
 
+/*
+ * Buffered file writer.
+ */
+void uv__file_writer_endgame(uv_loop_t* loop, uv_file_writer_t* handle);
+
+
 /*
  * Utilities.
  */
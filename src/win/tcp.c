@@ -1571,3 +1571,11 @@ int uv__tcp_connect(uv_connect_t* req,
 
   return 0;
 }
+
+
+int uv_tcp_connect_addrinfo(uv_connect_t* req,
+                            uv_tcp_t* handle,
+                            const struct addrinfo* ai,
+                            uv_connect_cb cb) {
+  return UV_ENOSYS;
+}
@@ -0,0 +1,137 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "task.h"
+#include "uv.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FILE_NAME  "benchmark_fs_fallocate"
+#define CHUNK_SIZE (64 * 1024)
+#define NUM_CHUNKS 1024  /* 64 MB total. */
+#define SYNC_EVERY 64
+
+static char chunk[CHUNK_SIZE];
+static uv_fs_t write_req;
+static uv_fs_t sync_req;
+static uv_buf_t iov;
+static uv_file file;
+static int chunks_left;
+static int64_t offset;
+
+static void append_next(void);
+
+
+static void sync_cb(uv_fs_t* req) {
+  ASSERT(req->result == 0);
+  uv_fs_req_cleanup(req);
+  append_next();
+}
+
+
+static void write_cb(uv_fs_t* req) {
+  ASSERT(req->result == CHUNK_SIZE);
+  uv_fs_req_cleanup(req);
+  offset += CHUNK_SIZE;
+
+  /* Segment writers sync regularly, that's where extending the file hurts. */
+  if (--chunks_left % SYNC_EVERY == 0)
+    ASSERT(0 == uv_fs_fdatasync(uv_default_loop(), &sync_req, file, sync_cb));
+  else
+    append_next();
+}
+
+
+static void append_next(void) {
+  if (chunks_left == 0)
+    return;
+
+  iov = uv_buf_init(chunk, sizeof(chunk));
+  ASSERT(0 == uv_fs_write(uv_default_loop(), &write_req, file, &iov, 1,
+                          offset, write_cb));
+}
+
+
+static void fallocate_cb(uv_fs_t* req) {
+  ASSERT(req->result == 0);
+  uv_fs_req_cleanup(req);
+  append_next();
+}
+
+
+static void append_bench(int preallocate) {
+  uint64_t before;
+  uint64_t after;
+  uv_fs_t req;
+  int r;
+
+  unlink(FILE_NAME);
+  r = uv_fs_open(NULL, &req, FILE_NAME, O_WRONLY | O_CREAT | O_TRUNC,
+                 S_IWUSR | S_IRUSR, NULL);
+  ASSERT(r >= 0);
+  file = r;
+  uv_fs_req_cleanup(&req);
+
+  chunks_left = NUM_CHUNKS;
+  offset = 0;
+
+  before = uv_hrtime();
+
+  if (preallocate) {
+    r = uv_fs_fallocate(uv_default_loop(),
+                        &req,
+                        file,
+                        UV_FS_FALLOCATE_KEEP_SIZE,
+                        0,
+                        (int64_t) CHUNK_SIZE * NUM_CHUNKS,
+                        fallocate_cb);
+    ASSERT(r == 0);
+  } else {
+    append_next();
+  }
+
+  uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+
+  after = uv_hrtime();
+
+  printf("%s MB appended (%s): %.2fs (%s MB/s)\n",
+         fmt((double) CHUNK_SIZE * NUM_CHUNKS / (1024 * 1024)),
+         preallocate ? "preallocated" : "extending",
+         (after - before) / 1e9,
+         fmt(((double) CHUNK_SIZE * NUM_CHUNKS / (1024 * 1024)) /
+             ((after - before) / 1e9)));
+  fflush(stdout);
+
+  uv_fs_close(NULL, &req, file, NULL);
+  uv_fs_req_cleanup(&req);
+  unlink(FILE_NAME);
+}
+
+
+BENCHMARK_IMPL(fs_append_prealloc) {
+  memset(chunk, 'x', sizeof(chunk));
+  append_bench(0);
+  append_bench(1);
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
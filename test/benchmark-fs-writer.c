@@ -0,0 +1,180 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "task.h"
+#include "uv.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FILE_NAME           "benchmark_fs_writer"
+#define NUM_LINES           (200 * 1000)
+#define MAX_CONCURRENT_REQS 32
+
+struct write_req {
+  uv_fs_t fs_req;
+  uv_buf_t buf;
+};
+
+static char line[] =
+    "2021-01-01T00:00:00.000Z INFO request handled status=200 time=0.42ms\n";
+static struct write_req reqs[MAX_CONCURRENT_REQS];
+static uv_file_writer_t writer;
+static uv_file file;
+static int64_t offset;
+static int lines_left;
+
+
+static uv_file open_file(void) {
+  uv_fs_t req;
+  int r;
+
+  unlink(FILE_NAME);
+  r = uv_fs_open(NULL, &req, FILE_NAME, O_WRONLY | O_CREAT | O_TRUNC,
+                 S_IWUSR | S_IRUSR, NULL);
+  ASSERT(r >= 0);
+  uv_fs_req_cleanup(&req);
+  return r;
+}
+
+
+static void close_file(void) {
+  uv_fs_t req;
+
+  uv_fs_close(NULL, &req, file, NULL);
+  uv_fs_req_cleanup(&req);
+  unlink(FILE_NAME);
+}
+
+
+static void report(const char* name, uint64_t before, uint64_t after) {
+  printf("%s lines (%s): %.2fs (%s/s)\n",
+         fmt(1.0 * NUM_LINES),
+         name,
+         (after - before) / 1e9,
+         fmt((1.0 * NUM_LINES) / ((after - before) / 1e9)));
+  fflush(stdout);
+}
+
+
+static void fs_write_cb(uv_fs_t* fs_req) {
+  struct write_req* req;
+  int r;
+
+  req = container_of(fs_req, struct write_req, fs_req);
+  ASSERT(fs_req->result == (ssize_t) sizeof(line) - 1);
+  uv_fs_req_cleanup(fs_req);
+
+  if (lines_left == 0)
+    return;
+
+  lines_left--;
+  r = uv_fs_write(uv_default_loop(), fs_req, file, &req->buf, 1, offset,
+                  fs_write_cb);
+  ASSERT(r == 0);
+  offset += req->buf.len;
+}
+
+
+static void fs_write_bench(void) {
+  uint64_t before;
+  uint64_t after;
+  uv_fs_t req;
+  int i;
+
+  file = open_file();
+  offset = 0;
+  lines_left = NUM_LINES;
+
+  before = uv_hrtime();
+
+  for (i = 0; i < MAX_CONCURRENT_REQS; i++) {
+    reqs[i].buf = uv_buf_init(line, sizeof(line) - 1);
+    lines_left--;
+    ASSERT(0 == uv_fs_write(uv_default_loop(), &reqs[i].fs_req, file,
+                            &reqs[i].buf, 1, offset, fs_write_cb));
+    offset += reqs[i].buf.len;
+  }
+
+  uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+  ASSERT(0 == uv_fs_fdatasync(NULL, &req, file, NULL));
+  uv_fs_req_cleanup(&req);
+
+  after = uv_hrtime();
+  report("uv_fs_write", before, after);
+  close_file();
+}
+
+
+static void writer_close_cb(uv_handle_t* handle) {
+  ASSERT(0 == uv_file_writer_get_buffered_size(&writer));
+}
+
+
+static void writer_fill(uv_file_writer_t* handle, int status) {
+  uv_buf_t buf;
+  int r;
+
+  ASSERT(status == 0);
+  buf = uv_buf_init(line, sizeof(line) - 1);
+
+  while (lines_left > 0) {
+    r = uv_file_writer_write(handle, &buf, 1, writer_fill);
+    if (r == UV_EAGAIN)
+      return;
+    ASSERT(r == 0);
+    lines_left--;
+  }
+
+  uv_close((uv_handle_t*) handle, writer_close_cb);
+}
+
+
+static void file_writer_bench(void) {
+  uint64_t before;
+  uint64_t after;
+
+  file = open_file();
+  lines_left = NUM_LINES;
+
+  before = uv_hrtime();
+
+  ASSERT(0 == uv_file_writer_init(uv_default_loop(), &writer, file, 0));
+  writer_fill(&writer, 0);
+  uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+
+  after = uv_hrtime();
+  report("uv_file_writer", before, after);
+  close_file();
+}
+
+
+/* Appends short log lines to a file, once as individual uv_fs_write() calls
+ * with a bounded number of requests in flight and once through a buffered
+ * uv_file_writer_t. Both variants end with the data synced to disk.
+ */
+BENCHMARK_IMPL(fs_write_log_append) {
+  fs_write_bench();
+  file_writer_bench();
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
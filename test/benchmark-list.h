@@ -23,16 +23,29 @@ BENCHMARK_DECLARE (sizes)
 BENCHMARK_DECLARE (loop_count)
 BENCHMARK_DECLARE (loop_count_timed)
 BENCHMARK_DECLARE (ping_pongs)
+BENCHMARK_DECLARE (ping_pongs_io_uring)
+BENCHMARK_DECLARE (ping_latency)
+BENCHMARK_DECLARE (ping_latency_busy_poll)
 BENCHMARK_DECLARE (ping_udp)
 BENCHMARK_DECLARE (tcp_write_batch)
 BENCHMARK_DECLARE (tcp4_pound_100)
 BENCHMARK_DECLARE (tcp4_pound_1000)
+BENCHMARK_DECLARE (tcp4_pound_100_io_uring)
+BENCHMARK_DECLARE (tcp4_pound_1000_io_uring)
 BENCHMARK_DECLARE (pipe_pound_100)
 BENCHMARK_DECLARE (pipe_pound_1000)
 BENCHMARK_DECLARE (tcp_pump100_client)
 BENCHMARK_DECLARE (tcp_pump1_client)
 BENCHMARK_DECLARE (pipe_pump100_client)
 BENCHMARK_DECLARE (pipe_pump1_client)
+BENCHMARK_DECLARE (tcp_pump100_client_io_uring)
+BENCHMARK_DECLARE (tcp_pump1_client_io_uring)
+BENCHMARK_DECLARE (pipe_pump100_client_io_uring)
+BENCHMARK_DECLARE (pipe_pump1_client_io_uring)
+BENCHMARK_DECLARE (tcp_pump100_client_edge)
+BENCHMARK_DECLARE (tcp_pump1_client_edge)
+BENCHMARK_DECLARE (pipe_pump100_client_edge)
+BENCHMARK_DECLARE (pipe_pump1_client_edge)
 
 BENCHMARK_DECLARE (tcp_multi_accept2)
 BENCHMARK_DECLARE (tcp_multi_accept4)
@@ -63,7 +76,9 @@ BENCHMARK_DECLARE (udp_timed_pummel_100v1000)
 BENCHMARK_DECLARE (udp_timed_pummel_1000v1000)
 
 BENCHMARK_DECLARE (getaddrinfo)
+BENCHMARK_DECLARE (fs_append_prealloc)
 BENCHMARK_DECLARE (fs_stat)
+BENCHMARK_DECLARE (fs_write_log_append)
 BENCHMARK_DECLARE (async1)
 BENCHMARK_DECLARE (async2)
 BENCHMARK_DECLARE (async4)
@@ -75,11 +90,26 @@ BENCHMARK_DECLARE (async_pummel_8)
 BENCHMARK_DECLARE (spawn)
 BENCHMARK_DECLARE (thread_create)
 BENCHMARK_DECLARE (million_async)
+BENCHMARK_DECLARE (million_async_one)
 BENCHMARK_DECLARE (million_timers)
+BENCHMARK_DECLARE (poll_batch_4k)
+BENCHMARK_DECLARE (poll_batch_4k_max8k)
+BENCHMARK_DECLARE (queue_work_scaling)
+BENCHMARK_DECLARE (queue_work_tiny)
+BENCHMARK_DECLARE (queue_work_tiny_metrics)
+BENCHMARK_DECLARE (queue_work_cold_start)
+BENCHMARK_DECLARE (queue_work_priority)
+BENCHMARK_DECLARE (random_async_small)
+BENCHMARK_DECLARE (random_sync_small)
 HELPER_DECLARE    (tcp4_blackhole_server)
 HELPER_DECLARE    (tcp_pump_server)
 HELPER_DECLARE    (pipe_pump_server)
+HELPER_DECLARE    (tcp_pump_server_io_uring)
+HELPER_DECLARE    (pipe_pump_server_io_uring)
+HELPER_DECLARE    (tcp_pump_server_edge)
+HELPER_DECLARE    (pipe_pump_server_edge)
 HELPER_DECLARE    (tcp4_echo_server)
+HELPER_DECLARE    (tcp4_echo_server_busy_poll)
 HELPER_DECLARE    (pipe_echo_server)
 HELPER_DECLARE    (dns_server)
 
@@ -91,6 +121,15 @@ TASK_LIST_START
   BENCHMARK_ENTRY  (ping_pongs)
   BENCHMARK_HELPER (ping_pongs, tcp4_echo_server)
 
+  BENCHMARK_ENTRY  (ping_pongs_io_uring)
+  BENCHMARK_HELPER (ping_pongs_io_uring, tcp4_echo_server)
+
+  BENCHMARK_ENTRY  (ping_latency)
+  BENCHMARK_HELPER (ping_latency, tcp4_echo_server)
+
+  BENCHMARK_ENTRY  (ping_latency_busy_poll)
+  BENCHMARK_HELPER (ping_latency_busy_poll, tcp4_echo_server_busy_poll)
+
   BENCHMARK_ENTRY  (tcp_write_batch)
   BENCHMARK_HELPER (tcp_write_batch, tcp4_blackhole_server)
 
@@ -100,18 +139,48 @@ TASK_LIST_START
   BENCHMARK_ENTRY  (tcp_pump1_client)
   BENCHMARK_HELPER (tcp_pump1_client, tcp_pump_server)
 
+  BENCHMARK_ENTRY  (tcp_pump100_client_io_uring)
+  BENCHMARK_HELPER (tcp_pump100_client_io_uring, tcp_pump_server_io_uring)
+
+  BENCHMARK_ENTRY  (tcp_pump1_client_io_uring)
+  BENCHMARK_HELPER (tcp_pump1_client_io_uring, tcp_pump_server_io_uring)
+
+  BENCHMARK_ENTRY  (tcp_pump100_client_edge)
+  BENCHMARK_HELPER (tcp_pump100_client_edge, tcp_pump_server_edge)
+
+  BENCHMARK_ENTRY  (tcp_pump1_client_edge)
+  BENCHMARK_HELPER (tcp_pump1_client_edge, tcp_pump_server_edge)
+
   BENCHMARK_ENTRY  (tcp4_pound_100)
   BENCHMARK_HELPER (tcp4_pound_100, tcp4_echo_server)
 
   BENCHMARK_ENTRY  (tcp4_pound_1000)
   BENCHMARK_HELPER (tcp4_pound_1000, tcp4_echo_server)
 
+  BENCHMARK_ENTRY  (tcp4_pound_100_io_uring)
+  BENCHMARK_HELPER (tcp4_pound_100_io_uring, tcp4_echo_server)
+
+  BENCHMARK_ENTRY  (tcp4_pound_1000_io_uring)
+  BENCHMARK_HELPER (tcp4_pound_1000_io_uring, tcp4_echo_server)
+
   BENCHMARK_ENTRY  (pipe_pump100_client)
   BENCHMARK_HELPER (pipe_pump100_client, pipe_pump_server)
 
   BENCHMARK_ENTRY  (pipe_pump1_client)
   BENCHMARK_HELPER (pipe_pump1_client, pipe_pump_server)
 
+  BENCHMARK_ENTRY  (pipe_pump100_client_io_uring)
+  BENCHMARK_HELPER (pipe_pump100_client_io_uring, pipe_pump_server_io_uring)
+
+  BENCHMARK_ENTRY  (pipe_pump1_client_io_uring)
+  BENCHMARK_HELPER (pipe_pump1_client_io_uring, pipe_pump_server_io_uring)
+
+  BENCHMARK_ENTRY  (pipe_pump100_client_edge)
+  BENCHMARK_HELPER (pipe_pump100_client_edge, pipe_pump_server_edge)
+
+  BENCHMARK_ENTRY  (pipe_pump1_client_edge)
+  BENCHMARK_HELPER (pipe_pump1_client_edge, pipe_pump_server_edge)
+
   BENCHMARK_ENTRY  (pipe_pound_100)
   BENCHMARK_HELPER (pipe_pound_100, pipe_echo_server)
 
@@ -146,7 +215,9 @@ TASK_LIST_START
 
   BENCHMARK_ENTRY  (getaddrinfo)
 
+  BENCHMARK_ENTRY  (fs_append_prealloc)
   BENCHMARK_ENTRY  (fs_stat)
+  BENCHMARK_ENTRY  (fs_write_log_append)
 
   BENCHMARK_ENTRY  (async1)
   BENCHMARK_ENTRY  (async2)
@@ -160,5 +231,15 @@ TASK_LIST_START
   BENCHMARK_ENTRY  (spawn)
   BENCHMARK_ENTRY  (thread_create)
   BENCHMARK_ENTRY  (million_async)
+  BENCHMARK_ENTRY  (million_async_one)
   BENCHMARK_ENTRY  (million_timers)
+  BENCHMARK_ENTRY  (poll_batch_4k)
+  BENCHMARK_ENTRY  (poll_batch_4k_max8k)
+  BENCHMARK_ENTRY  (queue_work_scaling)
+  BENCHMARK_ENTRY  (queue_work_tiny)
+  BENCHMARK_ENTRY  (queue_work_tiny_metrics)
+  BENCHMARK_ENTRY  (queue_work_cold_start)
+  BENCHMARK_ENTRY  (queue_work_priority)
+  BENCHMARK_ENTRY  (random_async_small)
+  BENCHMARK_ENTRY  (random_sync_small)
 TASK_LIST_END
@@ -28,6 +28,12 @@
 /* Run the benchmark for this many ms */
 #define TIME 5000
 
+/* Round trips timed by the latency benchmarks, the rest isn't. */
+#define MAX_SAMPLES (1 << 20)
+
+/* Spin budget of the busy polling client and server, in microseconds. */
+#define BUSY_POLL_USEC 200
+
 
 typedef struct {
   int pongs;
@@ -50,7 +56,11 @@ static uv_loop_t* loop;
 static buf_t* buf_freelist = NULL;
 static int pinger_shutdown_cb_called;
 static int completed_pingers = 0;
+static const char* benchmark_name;
 static int64_t start_time;
+static uint64_t* samples;
+static unsigned int nsamples;
+static uint64_t ping_time;
 
 
 static void buf_alloc(uv_handle_t* tcp, size_t size, uv_buf_t* buf) {
@@ -76,11 +86,69 @@ static void buf_free(const uv_buf_t* buf) {
 }
 
 
+static int compare_samples(const void* a, const void* b) {
+  uint64_t x;
+  uint64_t y;
+
+  x = *(const uint64_t*) a;
+  y = *(const uint64_t*) b;
+  return x < y ? -1 : x > y;
+}
+
+
+static double percentile(double p) {
+  return samples[(unsigned int) (p * (nsamples - 1))] / 1e3;
+}
+
+
+static void print_latency(void) {
+  ASSERT(nsamples > 0);
+  qsort(samples, nsamples, sizeof(samples[0]), compare_samples);
+  fprintf(stderr,
+          "%s: p50 %.1f us, p90 %.1f us, p99 %.1f us, p99.9 %.1f us, "
+          "max %.1f us, %.0f ms spent spinning\n",
+          benchmark_name,
+          percentile(0.5),
+          percentile(0.9),
+          percentile(0.99),
+          percentile(0.999),
+          samples[nsamples - 1] / 1e3,
+          uv_metrics_busy_poll_time(loop) / 1e6);
+}
+
+
+static void print_syscalls(int pongs) {
+  uv_metrics_syscalls_t syscalls;
+  uint64_t total;
+
+  if (pongs == 0 || uv_metrics_syscalls(loop, &syscalls) != 0)
+    return;
+
+  total = syscalls.epoll_wait + syscalls.epoll_ctl + syscalls.read +
+          syscalls.write + syscalls.eventfd_read + syscalls.eventfd_write;
+  fprintf(stderr,
+          "%s: %.2f syscalls per roundtrip, %.2f epoll_wait, %.2f epoll_ctl, "
+          "%.2f read, %.2f write\n",
+          benchmark_name,
+          (double) total / pongs,
+          (double) syscalls.epoll_wait / pongs,
+          (double) syscalls.epoll_ctl / pongs,
+          (double) syscalls.read / pongs,
+          (double) syscalls.write / pongs);
+}
+
+
 static void pinger_close_cb(uv_handle_t* handle) {
   pinger_t* pinger;
 
   pinger = (pinger_t*)handle->data;
-  fprintf(stderr, "ping_pongs: %d roundtrips/s\n", (1000 * pinger->pongs) / TIME);
+  fprintf(stderr,
+          "%s: %d roundtrips/s\n",
+          benchmark_name,
+          (1000 * pinger->pongs) / TIME);
+  if (samples != NULL)
+    print_latency();
+  print_syscalls(pinger->pongs);
   fflush(stderr);
 
   free(pinger);
@@ -102,6 +170,9 @@ static void pinger_write_ping(pinger_t* pinger) {
 
   buf = uv_buf_init(PING, sizeof(PING) - 1);
 
+  if (samples != NULL)
+    ping_time = uv_hrtime();
+
   req = malloc(sizeof *req);
   if (uv_write(req, (uv_stream_t*) &pinger->tcp, &buf, 1, pinger_write_cb)) {
     FATAL("uv_write failed");
@@ -148,6 +219,8 @@ static void pinger_read_cb(uv_stream_t* tcp,
     pinger->state = (pinger->state + 1) % (sizeof(PING) - 1);
     if (pinger->state == 0) {
       pinger->pongs++;
+      if (samples != NULL && nsamples < MAX_SAMPLES)
+        samples[nsamples++] = uv_hrtime() - ping_time;
       if (uv_now(loop) - start_time > TIME) {
         uv_shutdown(&pinger->shutdown_req,
                     (uv_stream_t*) tcp,
@@ -206,9 +279,34 @@ static void pinger_new(void) {
 }
 
 
-BENCHMARK_IMPL(ping_pongs) {
+static int run_ping_pongs(const char* name,
+                          int use_io_uring,
+                          int latency,
+                          int busy_poll) {
+  int r;
+
+  benchmark_name = name;
   loop = uv_default_loop();
 
+  if (use_io_uring) {
+    r = uv_loop_configure(loop, UV_LOOP_USE_IO_URING);
+    if (r == UV_ENOSYS)
+      RETURN_SKIP("io_uring is not available.");
+    ASSERT(r == 0);
+  }
+
+  if (busy_poll) {
+    r = uv_loop_configure(loop, UV_LOOP_BUSY_POLL, BUSY_POLL_USEC);
+    if (r == UV_ENOSYS)
+      RETURN_SKIP("Busy polling is not available.");
+    ASSERT(r == 0);
+  }
+
+  if (latency) {
+    samples = malloc(MAX_SAMPLES * sizeof(samples[0]));
+    ASSERT_NOT_NULL(samples);
+  }
+
   start_time = uv_now(loop);
 
   pinger_new();
@@ -216,6 +314,29 @@ BENCHMARK_IMPL(ping_pongs) {
 
   ASSERT(completed_pingers == 1);
 
+  free(samples);
+  samples = NULL;
+
   MAKE_VALGRIND_HAPPY();
   return 0;
 }
+
+
+BENCHMARK_IMPL(ping_pongs) {
+  return run_ping_pongs("ping_pongs", 0, 0, 0);
+}
+
+
+BENCHMARK_IMPL(ping_pongs_io_uring) {
+  return run_ping_pongs("ping_pongs_io_uring", 1, 0, 0);
+}
+
+
+BENCHMARK_IMPL(ping_latency) {
+  return run_ping_pongs("ping_latency", 0, 1, 0);
+}
+
+
+BENCHMARK_IMPL(ping_latency_busy_poll) {
+  return run_ping_pongs("ping_latency_busy_poll", 0, 1, 1);
+}
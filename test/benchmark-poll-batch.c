@@ -0,0 +1,142 @@
+/* Copyright libuv contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef _WIN32
+# include <unistd.h>
+# include <sys/socket.h>
+#endif
+
+/* Descriptors that are readable all the time, every loop iteration finds
+ * them all ready.
+ */
+#define NUM_READY 4096
+#define NUM_ROUNDS 2000
+
+#ifndef _WIN32
+static uv_poll_t* polls;
+static uv_check_t check;
+static int (*fds)[2];
+static int rounds;
+static uint64_t events;
+
+
+static void ready_cb(uv_poll_t* handle, int status, int revents) {
+  events++;
+}
+
+
+static void check_cb(uv_check_t* handle) {
+  int i;
+
+  if (++rounds < NUM_ROUNDS)
+    return;
+
+  uv_close((uv_handle_t*) handle, NULL);
+  for (i = 0; i < NUM_READY; i++)
+    uv_close((uv_handle_t*) &polls[i], NULL);
+}
+
+
+static int run_poll_batch(const char* name, unsigned int batch_max) {
+  unsigned int repolls;
+  unsigned int size;
+  uv_loop_t* loop;
+  uint64_t start;
+  uint64_t elapsed;
+  int r;
+  int i;
+
+  loop = uv_default_loop();
+
+  if (batch_max != 0) {
+    r = uv_loop_configure(loop, UV_LOOP_POLL_BATCH_MAX, batch_max);
+    if (r == UV_ENOSYS)
+      RETURN_SKIP("UV_LOOP_POLL_BATCH_MAX is not available.");
+    ASSERT(r == 0);
+  }
+
+  polls = malloc(NUM_READY * sizeof(polls[0]));
+  fds = malloc(NUM_READY * sizeof(fds[0]));
+  ASSERT_NOT_NULL(polls);
+  ASSERT_NOT_NULL(fds);
+
+  for (i = 0; i < NUM_READY; i++) {
+    ASSERT(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds[i]));
+    ASSERT(1 == write(fds[i][1], "!", 1));
+    ASSERT(0 == uv_poll_init(loop, &polls[i], fds[i][0]));
+    ASSERT(0 == uv_poll_start(&polls[i], UV_READABLE, ready_cb));
+  }
+
+  ASSERT(0 == uv_check_init(loop, &check));
+  ASSERT(0 == uv_check_start(&check, check_cb));
+
+  start = uv_hrtime();
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  elapsed = uv_hrtime() - start;
+
+  r = uv_metrics_poll_batch(loop, &size, &repolls);
+  if (r != 0)
+    size = repolls = 0;
+
+  fprintf(stderr,
+          "%s: %.0f events/s, batch of %u, up to %u polls per iteration\n",
+          name,
+          events / (elapsed / 1e9),
+          size,
+          repolls);
+  fflush(stderr);
+
+  for (i = 0; i < NUM_READY; i++) {
+    ASSERT(0 == close(fds[i][0]));
+    ASSERT(0 == close(fds[i][1]));
+  }
+
+  free(polls);
+  free(fds);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+#endif
+
+
+BENCHMARK_IMPL(poll_batch_4k) {
+#ifdef _WIN32
+  RETURN_SKIP("No socketpair on windows");
+#else
+  return run_poll_batch("poll_batch_4k", 0);
+#endif
+}
+
+
+BENCHMARK_IMPL(poll_batch_4k_max8k) {
+#ifdef _WIN32
+  RETURN_SKIP("No socketpair on windows");
+#else
+  return run_poll_batch("poll_batch_4k_max8k", 8192);
+#endif
+}
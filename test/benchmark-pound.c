@@ -269,6 +269,7 @@ static int pipe_do_connect(int num, make_connect_fn make_connect, void* arg) {
 
 
 static int pound_it(int concurrency,
+                    int use_io_uring,
                     const char* type,
                     setup_fn do_setup,
                     connect_fn do_connect,
@@ -313,6 +314,7 @@ static int pound_it(int concurrency,
 
 BENCHMARK_IMPL(tcp4_pound_100) {
   return pound_it(100,
+                  0,
                   "tcp",
                   tcp_do_setup,
                   tcp_do_connect,
@@ -323,6 +325,7 @@ BENCHMARK_IMPL(tcp4_pound_100) {
 
 BENCHMARK_IMPL(tcp4_pound_1000) {
   return pound_it(1000,
+                  0,
                   "tcp",
                   tcp_do_setup,
                   tcp_do_connect,
@@ -331,8 +334,31 @@ BENCHMARK_IMPL(tcp4_pound_1000) {
 }
 
 
+BENCHMARK_IMPL(tcp4_pound_100_io_uring) {
+  return pound_it(100,
+                  1,
+                  "tcp-io_uring",
+                  tcp_do_setup,
+                  tcp_do_connect,
+                  tcp_make_connect,
+                  NULL);
+}
+
+
+BENCHMARK_IMPL(tcp4_pound_1000_io_uring) {
+  return pound_it(1000,
+                  1,
+                  "tcp-io_uring",
+                  tcp_do_setup,
+                  tcp_do_connect,
+                  tcp_make_connect,
+                  NULL);
+}
+
+
 BENCHMARK_IMPL(pipe_pound_100) {
   return pound_it(100,
+                  0,
                   "pipe",
                   pipe_do_setup,
                   pipe_do_connect,
@@ -343,6 +369,7 @@ BENCHMARK_IMPL(pipe_pound_100) {
 
 BENCHMARK_IMPL(pipe_pound_1000) {
   return pound_it(1000,
+                  0,
                   "pipe",
                   pipe_do_setup,
                   pipe_do_connect,
@@ -72,6 +72,8 @@ static char write_buffer[WRITE_BUFFER_SIZE];
 #define MAX_WRITE_HANDLES 1000
 
 static stream_type type;
+static int use_io_uring;
+static int use_edge;
 
 static uv_tcp_t tcp_write_handles[MAX_WRITE_HANDLES];
 static uv_pipe_t pipe_write_handles[MAX_WRITE_HANDLES];
@@ -79,6 +81,15 @@ static uv_pipe_t pipe_write_handles[MAX_WRITE_HANDLES];
 static uv_timer_t timer_handle;
 
 
+static const char* mode_suffix(void) {
+  if (use_io_uring)
+    return "_io_uring";
+  if (use_edge)
+    return "_edge";
+  return "";
+}
+
+
 static double gbit(int64_t bytes, int64_t passed_ms) {
   double gbits = ((double)bytes / (1024 * 1024 * 1024)) * 8;
   return gbits / ((double)passed_ms / 1000);
@@ -102,9 +113,10 @@ static void show_stats(uv_timer_t* handle) {
     uv_update_time(loop);
     diff = uv_now(loop) - start_time;
 
-    fprintf(stderr, "%s_pump%d_client: %.1f gbit/s\n",
+    fprintf(stderr, "%s_pump%d_client%s: %.1f gbit/s\n",
             type == TCP ? "tcp" : "pipe",
             write_sockets,
+            mode_suffix(),
             gbit(nsent_total, diff));
     fflush(stderr);
 
@@ -130,9 +142,10 @@ static void read_show_stats(void) {
   uv_update_time(loop);
   diff = uv_now(loop) - start_time;
 
-  fprintf(stderr, "%s_pump%d_server: %.1f gbit/s\n",
+  fprintf(stderr, "%s_pump%d_server%s: %.1f gbit/s\n",
           type == TCP ? "tcp" : "pipe",
           max_read_sockets,
+          mode_suffix(),
           gbit(nrecv_total, diff));
   fflush(stderr);
 }
@@ -373,11 +386,30 @@ static void buf_free(const uv_buf_t* buf) {
 }
 
 
+/* Moves the streams of the default loop to the io_uring data path or to
+ * edge-triggered epoll.
+ */
+static int configure_loop(void) {
+  int r;
+
+  if (use_io_uring)
+    r = uv_loop_configure(uv_default_loop(), UV_LOOP_IO_URING_STREAMS);
+  else if (use_edge)
+    r = uv_loop_configure(uv_default_loop(), UV_LOOP_EPOLL_EDGE_TRIGGERED);
+  else
+    return 0;
+
+  ASSERT(r == 0 || r == UV_ENOSYS);
+  return r;
+}
+
+
 HELPER_IMPL(tcp_pump_server) {
   int r;
 
   type = TCP;
   loop = uv_default_loop();
+  configure_loop();
 
   ASSERT(0 == uv_ip4_addr("0.0.0.0", TEST_PORT, &listen_addr));
 
@@ -401,6 +433,7 @@ HELPER_IMPL(pipe_pump_server) {
   type = PIPE;
 
   loop = uv_default_loop();
+  configure_loop();
 
   /* Server */
   server = (uv_stream_t*)&pipeServer;
@@ -418,6 +451,30 @@ HELPER_IMPL(pipe_pump_server) {
 }
 
 
+HELPER_IMPL(tcp_pump_server_io_uring) {
+  use_io_uring = 1;
+  return run_helper_tcp_pump_server();
+}
+
+
+HELPER_IMPL(pipe_pump_server_io_uring) {
+  use_io_uring = 1;
+  return run_helper_pipe_pump_server();
+}
+
+
+HELPER_IMPL(tcp_pump_server_edge) {
+  use_edge = 1;
+  return run_helper_tcp_pump_server();
+}
+
+
+HELPER_IMPL(pipe_pump_server_edge) {
+  use_edge = 1;
+  return run_helper_pipe_pump_server();
+}
+
+
 static void tcp_pump(int n) {
   ASSERT(n <= MAX_WRITE_HANDLES);
   TARGET_CONNECTIONS = n;
@@ -474,3 +531,75 @@ BENCHMARK_IMPL(pipe_pump1_client) {
   pipe_pump(1);
   return 0;
 }
+
+
+BENCHMARK_IMPL(tcp_pump100_client_io_uring) {
+  use_io_uring = 1;
+  if (configure_loop() == UV_ENOSYS)
+    RETURN_SKIP("io_uring provided buffer rings are not available.");
+  tcp_pump(100);
+  return 0;
+}
+
+
+BENCHMARK_IMPL(tcp_pump1_client_io_uring) {
+  use_io_uring = 1;
+  if (configure_loop() == UV_ENOSYS)
+    RETURN_SKIP("io_uring provided buffer rings are not available.");
+  tcp_pump(1);
+  return 0;
+}
+
+
+BENCHMARK_IMPL(pipe_pump100_client_io_uring) {
+  use_io_uring = 1;
+  if (configure_loop() == UV_ENOSYS)
+    RETURN_SKIP("io_uring provided buffer rings are not available.");
+  pipe_pump(100);
+  return 0;
+}
+
+
+BENCHMARK_IMPL(pipe_pump1_client_io_uring) {
+  use_io_uring = 1;
+  if (configure_loop() == UV_ENOSYS)
+    RETURN_SKIP("io_uring provided buffer rings are not available.");
+  pipe_pump(1);
+  return 0;
+}
+
+
+BENCHMARK_IMPL(tcp_pump100_client_edge) {
+  use_edge = 1;
+  if (configure_loop() == UV_ENOSYS)
+    RETURN_SKIP("Edge-triggered epoll is Linux only.");
+  tcp_pump(100);
+  return 0;
+}
+
+
+BENCHMARK_IMPL(tcp_pump1_client_edge) {
+  use_edge = 1;
+  if (configure_loop() == UV_ENOSYS)
+    RETURN_SKIP("Edge-triggered epoll is Linux only.");
+  tcp_pump(1);
+  return 0;
+}
+
+
+BENCHMARK_IMPL(pipe_pump100_client_edge) {
+  use_edge = 1;
+  if (configure_loop() == UV_ENOSYS)
+    RETURN_SKIP("Edge-triggered epoll is Linux only.");
+  pipe_pump(100);
+  return 0;
+}
+
+
+BENCHMARK_IMPL(pipe_pump1_client_edge) {
+  use_edge = 1;
+  if (configure_loop() == UV_ENOSYS)
+    RETURN_SKIP("Edge-triggered epoll is Linux only.");
+  pipe_pump(1);
+  return 0;
+}
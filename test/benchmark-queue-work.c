@@ -0,0 +1,302 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include "task.h"
+#include "uv.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_WORK_ITEMS  20000
+#define WORK_ITERATIONS 20000  /* Roughly 10-20 us of CPU per item. */
+#define NUM_TINY_ITEMS  (1000 * 1000)
+#define TINY_IN_FLIGHT  1024
+
+static uv_work_t reqs[NUM_WORK_ITEMS];
+static volatile unsigned int sink;
+static unsigned int done_count;
+static unsigned int tiny_submitted;
+
+
+static void work_cb(uv_work_t* req) {
+  unsigned int acc;
+  unsigned int i;
+
+  acc = (unsigned int) (uintptr_t) req;
+  for (i = 0; i < WORK_ITERATIONS; i++)
+    acc = acc * 1103515245 + 12345;
+
+  sink = acc;
+}
+
+
+static void after_work_cb(uv_work_t* req, int status) {
+  ASSERT(status == 0);
+  done_count++;
+}
+
+
+static void queue_work_run(unsigned int nthreads) {
+  uv_loop_t loop;
+  uint64_t before;
+  uint64_t after;
+  double secs;
+  unsigned int i;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_THREADPOOL_SIZE, nthreads));
+  done_count = 0;
+
+  before = uv_hrtime();
+
+  for (i = 0; i < NUM_WORK_ITEMS; i++)
+    ASSERT(0 == uv_queue_work(&loop, reqs + i, work_cb, after_work_cb));
+
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+
+  after = uv_hrtime();
+  ASSERT(done_count == NUM_WORK_ITEMS);
+
+  secs = (after - before) / 1e9;
+  printf("%u threads: %s work items in %.2fs (%s/s)\n",
+         nthreads,
+         fmt(1.0 * NUM_WORK_ITEMS),
+         secs,
+         fmt(NUM_WORK_ITEMS / secs));
+  fflush(stdout);
+
+  ASSERT(0 == uv_loop_close(&loop));
+}
+
+
+/* Throughput of short CPU-bound work items with a growing number of threads.
+ * Every run gets a private threadpool of that size, so the numbers aren't
+ * skewed by threads left over from a previous run.
+ */
+BENCHMARK_IMPL(queue_work_scaling) {
+  uv_cpu_info_t* cpus;
+  unsigned int n;
+  int ncpus;
+
+  ASSERT(0 == uv_cpu_info(&cpus, &ncpus));
+  uv_free_cpu_info(cpus, ncpus);
+  printf("%d cpus available\n", ncpus);
+
+  for (n = 1; n <= 64; n *= 2)
+    queue_work_run(n);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static void tiny_work_cb(uv_work_t* req) {
+}
+
+
+static void tiny_after_work_cb(uv_work_t* req, int status) {
+  ASSERT(status == 0);
+  done_count++;
+
+  if (tiny_submitted == NUM_TINY_ITEMS)
+    return;
+
+  tiny_submitted++;
+  ASSERT(0 == uv_queue_work(req->loop, req, tiny_work_cb, tiny_after_work_cb));
+}
+
+
+static void queue_work_tiny_run(uv_loop_t* loop, const char* name) {
+  uint64_t before;
+  uint64_t after;
+  double secs;
+  unsigned int i;
+
+  done_count = 0;
+  tiny_submitted = 0;
+
+  before = uv_hrtime();
+
+  for (i = 0; i < TINY_IN_FLIGHT; i++) {
+    tiny_submitted++;
+    ASSERT(0 == uv_queue_work(loop, reqs + i, tiny_work_cb, tiny_after_work_cb));
+  }
+
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+
+  after = uv_hrtime();
+  ASSERT(done_count == NUM_TINY_ITEMS);
+
+  secs = (after - before) / 1e9;
+  printf("%s tiny work items (%s) in %.2fs (%s/s)\n",
+         fmt(1.0 * NUM_TINY_ITEMS),
+         name,
+         secs,
+         fmt(NUM_TINY_ITEMS / secs));
+  fflush(stdout);
+}
+
+
+/* Work items that do nothing, what's measured is the cost of handing work to
+ * the threadpool and the completion back to the loop.
+ */
+BENCHMARK_IMPL(queue_work_tiny) {
+  queue_work_tiny_run(uv_default_loop(), "no metrics");
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+/* Same as queue_work_tiny but with threadpool metrics enabled, the difference
+ * between the two is what collecting them costs.
+ */
+BENCHMARK_IMPL(queue_work_tiny_metrics) {
+  uv_threadpool_work_metrics_t metrics;
+
+  ASSERT(0 == uv_loop_configure(uv_default_loop(), UV_METRICS_THREADPOOL));
+  queue_work_tiny_run(uv_default_loop(), "metrics");
+
+  ASSERT(0 == uv_threadpool_work_metrics(uv_default_loop(),
+                                         UV_WORK_CPU,
+                                         &metrics));
+  ASSERT(metrics.completed == NUM_TINY_ITEMS);
+  printf("average wait %.1f us, average run %.1f us\n",
+         metrics.wait_time / 1e3 / metrics.completed,
+         metrics.run_time / 1e3 / metrics.completed);
+  fflush(stdout);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static uint64_t first_item_latency(uv_loop_t* loop) {
+  uv_work_t req;
+  uint64_t before;
+
+  done_count = 0;
+  before = uv_hrtime();
+  ASSERT(0 == uv_queue_work(loop, &req, tiny_work_cb, after_work_cb));
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(done_count == 1);
+
+  return uv_hrtime() - before;
+}
+
+
+/* Latency of a single work item on a private threadpool without any threads,
+ * with a thread that's waiting for work and after all threads have retired
+ * again, i.e. what lazy thread creation costs the first caller.
+ */
+BENCHMARK_IMPL(queue_work_cold_start) {
+  uv_threadpool_metrics_t metrics;
+  uv_loop_t loop;
+  uint64_t cold;
+  uint64_t warm;
+  uint64_t retired;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_THREADPOOL_SIZE, 4));
+  ASSERT(0 == uv_threadpool_set_limits(&loop, 0, 4, 10));
+
+  cold = first_item_latency(&loop);
+  warm = first_item_latency(&loop);
+
+  do {
+    uv_sleep(20);
+    ASSERT(0 == uv_threadpool_metrics(&loop, &metrics));
+  } while (metrics.threads > 0);
+
+  retired = first_item_latency(&loop);
+
+  printf("first work item: %.1f us cold, %.1f us warm, %.1f us after retire\n",
+         cold / 1e3,
+         warm / 1e3,
+         retired / 1e3);
+  fflush(stdout);
+
+  ASSERT(0 == uv_loop_close(&loop));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static uint64_t urgent_done_at;
+
+
+static void urgent_after_work_cb(uv_work_t* req, int status) {
+  ASSERT(status == 0);
+  urgent_done_at = uv_hrtime();
+}
+
+
+static void queue_work_priority_run(uv_work_priority priority) {
+  uv_work_t urgent_req;
+  uv_loop_t loop;
+  uint64_t before;
+  unsigned int i;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_THREADPOOL_SIZE, 4));
+  done_count = 0;
+
+  /* Background work that takes a while to get through... */
+  for (i = 0; i < NUM_WORK_ITEMS; i++)
+    ASSERT(0 == uv_queue_work_priority(&loop,
+                                       reqs + i,
+                                       UV_WORK_PRIORITY_LOW,
+                                       0,
+                                       work_cb,
+                                       after_work_cb));
+
+  /* ...and the one item somebody is waiting for. */
+  before = uv_hrtime();
+  ASSERT(0 == uv_queue_work_priority(&loop,
+                                     &urgent_req,
+                                     priority,
+                                     0,
+                                     work_cb,
+                                     urgent_after_work_cb));
+
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(done_count == NUM_WORK_ITEMS);
+
+  printf("%s work item behind %s low priority items: %.2f ms\n",
+         priority == UV_WORK_PRIORITY_HIGH ? "high priority" : "low priority",
+         fmt(1.0 * NUM_WORK_ITEMS),
+         (urgent_done_at - before) / 1e6);
+  fflush(stdout);
+
+  ASSERT(0 == uv_loop_close(&loop));
+}
+
+
+/* Time until a single item submitted behind a backlog of low priority work
+ * completes, once queued with the same priority and once with high priority.
+ */
+BENCHMARK_IMPL(queue_work_priority) {
+  queue_work_priority_run(UV_WORK_PRIORITY_LOW);
+  queue_work_priority_run(UV_WORK_PRIORITY_HIGH);
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
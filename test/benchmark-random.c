@@ -0,0 +1,105 @@
+/* Copyright libuv contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#define CONCURRENT_CALLS 64
+#define TOTAL_CALLS 1000000
+#define REQUEST_SIZE 16
+
+static uv_random_t reqs[CONCURRENT_CALLS];
+static char bufs[CONCURRENT_CALLS][REQUEST_SIZE];
+static int calls_initiated;
+static int calls_completed;
+
+
+static void random_initiate(uv_loop_t* loop, int i);
+
+
+static void random_cb(uv_random_t* req, int status, void* buf, size_t len) {
+  ASSERT(status == 0);
+  calls_completed++;
+
+  if (calls_initiated < TOTAL_CALLS)
+    random_initiate(req->loop, req - reqs);
+}
+
+
+static void random_initiate(uv_loop_t* loop, int i) {
+  calls_initiated++;
+  ASSERT(0 == uv_random(loop,
+                        &reqs[i],
+                        bufs[i],
+                        sizeof(bufs[i]),
+                        0,
+                        random_cb));
+}
+
+
+/* Many small requests, served from the loop's keystream. */
+BENCHMARK_IMPL(random_async_small) {
+  uv_loop_t* loop;
+  uint64_t start;
+  uint64_t end;
+  int i;
+
+  loop = uv_default_loop();
+  start = uv_hrtime();
+
+  for (i = 0; i < CONCURRENT_CALLS; i++)
+    random_initiate(loop, i);
+
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  end = uv_hrtime();
+
+  ASSERT(calls_completed == TOTAL_CALLS);
+
+  fprintf(stderr, "random_async_small: %.0f req/s\n",
+          TOTAL_CALLS / ((end - start) / 1e9));
+  fflush(stderr);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+/* The same requests as direct getrandom() calls, one system call each. */
+BENCHMARK_IMPL(random_sync_small) {
+  char buf[REQUEST_SIZE];
+  uint64_t start;
+  uint64_t end;
+  int i;
+
+  start = uv_hrtime();
+
+  for (i = 0; i < TOTAL_CALLS; i++)
+    ASSERT(0 == uv_random(NULL, NULL, buf, sizeof(buf), 0, NULL));
+
+  end = uv_hrtime();
+
+  fprintf(stderr, "random_sync_small: %.0f req/s\n",
+          TOTAL_CALLS / ((end - start) / 1e9));
+  fflush(stderr);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
@@ -371,6 +371,25 @@ HELPER_IMPL(tcp4_echo_server) {
 }
 
 
+HELPER_IMPL(tcp4_echo_server_busy_poll) {
+  int r;
+
+  loop = uv_default_loop();
+
+  /* Same budget as the client in benchmark-ping-pongs.c. */
+  r = uv_loop_configure(loop, UV_LOOP_BUSY_POLL, 200u);
+  if (r != 0 && r != UV_ENOSYS)
+    return 1;
+
+  if (tcp4_echo_start(TEST_PORT))
+    return 1;
+
+  notify_parent_process();
+  uv_run(loop, UV_RUN_DEFAULT);
+  return 0;
+}
+
+
 HELPER_IMPL(tcp6_echo_server) {
   loop = uv_default_loop();
 
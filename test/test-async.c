@@ -132,3 +132,43 @@ TEST_IMPL(async) {
   MAKE_VALGRIND_HAPPY();
   return 0;
 }
+
+
+static uv_async_t pending[4];
+static int pending_order[4];
+static int pending_cb_called;
+
+
+static void pending_cb(uv_async_t* handle) {
+  pending_order[pending_cb_called++] = (int) (handle - pending);
+
+  /* Still pending, it's closed before its callback runs. */
+  if (handle == &pending[0])
+    uv_close((uv_handle_t*) &pending[2], NULL);
+
+  uv_close((uv_handle_t*) handle, NULL);
+}
+
+
+TEST_IMPL(async_pending_close) {
+  uv_loop_t* loop;
+  int i;
+
+  loop = uv_default_loop();
+  for (i = 0; i < 4; i++) {
+    ASSERT(0 == uv_async_init(loop, &pending[i], pending_cb));
+    ASSERT(0 == uv_async_send(&pending[i]));
+  }
+
+  /* Coalesced with the first send. */
+  ASSERT(0 == uv_async_send(&pending[3]));
+  uv_close((uv_handle_t*) &pending[1], NULL);
+
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT_EQ(pending_cb_called, 2);
+  ASSERT_EQ(pending_order[0], 0);
+  ASSERT_EQ(pending_order[1], 3);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
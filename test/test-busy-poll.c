@@ -0,0 +1,206 @@
+/* Copyright libuv contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#ifdef __linux__
+
+#include <unistd.h>
+#include <sys/socket.h>
+
+#define IDLE_TIMERS 20
+#define IDLE_TIMEOUT 10  /* ms */
+#define IDLE_BUDGET 5000  /* us */
+#define ACTIVE_PINGS 2000
+#define ACTIVE_GAP 200  /* us */
+#define ACTIVE_BUDGET 10000  /* us */
+
+static uv_loop_t loop;
+static uv_timer_t timer;
+static uv_pipe_t pipe_handle;
+static char read_buf[64];
+static uv_sem_t pings_sem;
+static uint64_t spin_before;
+static uint64_t idle_before;
+static int timer_cb_called;
+static int bytes_read;
+
+
+static void close_timer_cb(uv_timer_t* handle) {
+  uv_close((uv_handle_t*) handle, NULL);
+}
+
+
+TEST_IMPL(busy_poll_configure) {
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(UV_EINVAL == uv_loop_configure(&loop, UV_LOOP_BUSY_POLL, 1000001u));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_BUSY_POLL, 50u));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_BUSY_POLL, 0u));
+
+  /* Turned off again, nothing to spin for. */
+  ASSERT(0 == uv_timer_init(&loop, &timer));
+  ASSERT(0 == uv_timer_start(&timer, close_timer_cb, 10, 0));
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(0 == uv_metrics_busy_poll_time(&loop));
+
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+
+static void idle_timer_cb(uv_timer_t* handle) {
+  if (++timer_cb_called == IDLE_TIMERS)
+    uv_close((uv_handle_t*) handle, NULL);
+}
+
+
+TEST_IMPL(busy_poll_idle_backoff) {
+  uint64_t spin;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_BUSY_POLL, IDLE_BUDGET));
+  ASSERT(0 == uv_timer_init(&loop, &timer));
+  ASSERT(0 == uv_timer_start(&timer,
+                             idle_timer_cb,
+                             IDLE_TIMEOUT,
+                             IDLE_TIMEOUT));
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(IDLE_TIMERS == timer_cb_called);
+
+  /* The first poll spins for the whole budget and misses, each miss after
+   * that halves the budget. A loop that spun every time would come to
+   * IDLE_TIMERS * IDLE_BUDGET.
+   */
+  spin = uv_metrics_busy_poll_time(&loop);
+  ASSERT_GE(spin, (uint64_t) IDLE_BUDGET * 1000);
+  ASSERT_LT(spin, (uint64_t) IDLE_TIMERS * IDLE_BUDGET * 1000 / 2);
+
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+
+/* By now the loop has stopped spinning, see busy_poll_idle_backoff. */
+static void start_pings_cb(uv_timer_t* handle) {
+  if (++timer_cb_called < IDLE_TIMERS)
+    return;
+
+  uv_close((uv_handle_t*) handle, NULL);
+  spin_before = uv_metrics_busy_poll_time(handle->loop);
+  idle_before = uv_metrics_idle_time(handle->loop);
+  uv_sem_post(&pings_sem);
+}
+
+
+static void pinger(void* arg) {
+  int fd;
+  int i;
+
+  fd = *(int*) arg;
+  uv_sem_wait(&pings_sem);
+  for (i = 0; i < ACTIVE_PINGS; i++) {
+    ASSERT(1 == write(fd, "!", 1));
+    usleep(ACTIVE_GAP);
+  }
+
+  ASSERT(0 == close(fd));
+}
+
+
+static void alloc_cb(uv_handle_t* handle, size_t size, uv_buf_t* buf) {
+  buf->base = read_buf;
+  buf->len = sizeof(read_buf);
+}
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf) {
+  if (nread == UV_EOF) {
+    uv_close((uv_handle_t*) stream, NULL);
+    return;
+  }
+
+  ASSERT(nread >= 0);
+  bytes_read += nread;
+}
+
+
+TEST_IMPL(busy_poll_active) {
+  uv_thread_t thread;
+  uint64_t spin;
+  uint64_t idle;
+  int fds[2];
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_configure(&loop, UV_METRICS_IDLE_TIME));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_BUSY_POLL, ACTIVE_BUDGET));
+  ASSERT(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  ASSERT(0 == uv_pipe_init(&loop, &pipe_handle, 0));
+  ASSERT(0 == uv_pipe_open(&pipe_handle, fds[0]));
+  ASSERT(0 == uv_read_start((uv_stream_t*) &pipe_handle, alloc_cb, read_cb));
+  ASSERT(0 == uv_timer_init(&loop, &timer));
+  ASSERT(0 == uv_timer_start(&timer,
+                             start_pings_cb,
+                             IDLE_TIMEOUT,
+                             IDLE_TIMEOUT));
+  ASSERT(0 == uv_sem_init(&pings_sem, 0));
+  ASSERT(0 == uv_thread_create(&thread, pinger, &fds[1]));
+
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(0 == uv_thread_join(&thread));
+  ASSERT(ACTIVE_PINGS == bytes_read);
+
+  uv_sem_destroy(&pings_sem);
+
+  /* The pings come in well within the budget. The loop picks up spinning
+   * again after the first few, catches the rest that way and hardly ever
+   * sleeps in epoll_wait().
+   */
+  spin = uv_metrics_busy_poll_time(&loop) - spin_before;
+  idle = uv_metrics_idle_time(&loop) - idle_before;
+  ASSERT_GT(spin, 0);
+  ASSERT_GT(spin, idle);
+
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+#else
+
+TEST_IMPL(busy_poll_configure) {
+  uv_loop_t loop;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(UV_ENOSYS == uv_loop_configure(&loop, UV_LOOP_BUSY_POLL, 50u));
+  ASSERT(0 == uv_metrics_busy_poll_time(&loop));
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+TEST_IMPL(busy_poll_idle_backoff) {
+  RETURN_SKIP("Busy polling is Linux only.");
+}
+
+TEST_IMPL(busy_poll_active) {
+  RETURN_SKIP("Busy polling is Linux only.");
+}
+
+#endif  /* __linux__ */
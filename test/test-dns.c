@@ -0,0 +1,1002 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <string.h>
+
+#ifndef _WIN32
+
+#define RESOLV_CONF "test_dns_resolv.conf"
+#define HOSTS_FILE "test_dns_hosts"
+
+/* A stub name server that knows a handful of names, on the same loop as the
+ * resolver. "big.test" doesn't fit in a UDP answer and "slow.test" and
+ * 10.0.0.9 are never answered. The AAAA query of "flaky.test" is a server
+ * failure, only the backup server on the second port answers it.
+ */
+static uv_udp_t udp_server;
+static uv_udp_t udp_backup;
+static uv_tcp_t tcp_server;
+struct stub_conn {
+  uv_tcp_t handle;
+  unsigned char buf[1024];
+  size_t len;
+};
+
+static struct stub_conn tcp_conns[4];
+static unsigned int tcp_nconns;
+static unsigned int udp_queries;
+static unsigned int backup_queries;
+static int flaky_failed;
+static unsigned int tcp_queries;
+static char last_query[256];
+
+static uv_getaddrinfo_t reqs[8];
+static unsigned int callbacks;
+
+
+static void write_file(const char* path, const char* data) {
+  uv_fs_t req;
+  uv_buf_t buf;
+  uv_file fd;
+
+  fd = uv_fs_open(NULL, &req, path, O_WRONLY | O_CREAT | O_TRUNC,
+                  S_IWUSR | S_IRUSR, NULL);
+  ASSERT(fd >= 0);
+  uv_fs_req_cleanup(&req);
+
+  buf = uv_buf_init((char*) data, strlen(data));
+  ASSERT((int) buf.len == uv_fs_write(NULL, &req, fd, &buf, 1, -1, NULL));
+  uv_fs_req_cleanup(&req);
+
+  ASSERT(0 == uv_fs_close(NULL, &req, fd, NULL));
+  uv_fs_req_cleanup(&req);
+}
+
+
+static size_t add_answer(unsigned char* p,
+                         size_t len,
+                         unsigned int type,
+                         const void* rdata,
+                         unsigned int rdlen) {
+  static const unsigned char rr[] = {
+    0xc0, 0x0c,  /* The name in the question. */
+    0, 0,        /* Type. */
+    0, 1,        /* Class IN. */
+    0, 0, 1, 44, /* TTL 300. */
+    0, 0         /* Data length. */
+  };
+
+  memcpy(p + len, rr, sizeof(rr));
+  p[len + 3] = type;
+  p[len + 11] = rdlen;
+  memcpy(p + len + sizeof(rr), rdata, rdlen);
+  p[7]++;  /* One more answer. */
+
+  return len + sizeof(rr) + rdlen;
+}
+
+
+static size_t add_ptr_answer(unsigned char* p, size_t len, const char* name) {
+  unsigned char rdata[256];
+  size_t rdlen;
+  size_t n;
+
+  for (rdlen = 0; *name != '\0'; name += n + (name[n] == '.')) {
+    n = strcspn(name, ".");
+    rdata[rdlen++] = n;
+    memcpy(rdata + rdlen, name, n);
+    rdlen += n;
+  }
+  rdata[rdlen++] = 0;
+
+  return add_answer(p, len, 12, rdata, rdlen);
+}
+
+
+/* Returns the size of the answer in |p|, 0 for no answer. */
+static size_t make_answer(const unsigned char* q,
+                          size_t qlen,
+                          unsigned char* p,
+                          int tcp,
+                          int backup) {
+  unsigned char addr[16];
+  unsigned int type;
+  unsigned int i;
+  size_t off;
+  size_t out;
+  size_t len;
+
+  ASSERT(qlen > 12);
+  off = 12;
+  out = 0;
+  while (q[off] != 0) {
+    ASSERT(off + 1 + q[off] < qlen);
+    memcpy(last_query + out, q + off + 1, q[off]);
+    out += q[off];
+    last_query[out++] = '.';
+    off += 1 + q[off];
+  }
+  last_query[out > 0 ? out - 1 : 0] = '\0';
+  type = (q[off + 1] << 8) | q[off + 2];
+  len = off + 5;
+
+  if (strcmp(last_query, "slow.test") == 0 ||
+      strcmp(last_query, "9.0.0.10.in-addr.arpa") == 0)
+    return 0;
+
+  memcpy(p, q, len);
+  p[2] = 0x81;  /* Answer, recursion desired. */
+  p[3] = 0x80;  /* Recursion available. */
+  memset(p + 6, 0, 6);
+
+  if (strcmp(last_query, "flaky.test") == 0 && type == 28 && !backup) {
+    p[3] |= 2;  /* SERVFAIL. */
+  } else if (strcmp(last_query, "example.test") == 0 ||
+             strcmp(last_query, "flaky.test") == 0) {
+    if (type == 1) {
+      ASSERT(1 == inet_pton(AF_INET, "10.0.0.1", addr));
+      len = add_answer(p, len, type, addr, 4);
+    } else {
+      ASSERT(1 == inet_pton(AF_INET6, "2001:db8::1", addr));
+      len = add_answer(p, len, type, addr, 16);
+    }
+  } else if (strcmp(last_query, "www.corp.test") == 0) {
+    if (type == 1) {
+      ASSERT(1 == inet_pton(AF_INET, "10.0.0.2", addr));
+      len = add_answer(p, len, type, addr, 4);
+    }
+  } else if (strcmp(last_query, "1.0.0.10.in-addr.arpa") == 0 ||
+             strcmp(last_query, "1.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0."
+                                "0.0.0.8.b.d.0.1.0.0.2.ip6.arpa") == 0) {
+    len = add_ptr_answer(p, len, "example.test");
+  } else if (strcmp(last_query, "3.0.0.10.in-addr.arpa") == 0) {
+    len = add_ptr_answer(p, len, "www.corp.test");
+  } else if (strcmp(last_query, "big.test") == 0) {
+    if (!tcp) {
+      p[2] |= 0x02;  /* Truncated. */
+    } else if (type == 1) {
+      for (i = 0; i < 20; i++) {
+        addr[0] = 10;
+        addr[1] = 0;
+        addr[2] = 1;
+        addr[3] = i;
+        len = add_answer(p, len, type, addr, 4);
+      }
+    }
+  } else {
+    p[3] |= 3;  /* NXDOMAIN. */
+  }
+
+  return len;
+}
+
+
+static void server_alloc_cb(uv_handle_t* handle,
+                            size_t suggested_size,
+                            uv_buf_t* buf) {
+  static char slab[512];
+  struct stub_conn* conn;
+
+  if (handle->type == UV_TCP) {
+    conn = handle->data;
+    buf->base = (char*) conn->buf + conn->len;
+    buf->len = sizeof(conn->buf) - conn->len;
+  } else {
+    buf->base = slab;
+    buf->len = sizeof(slab);
+  }
+}
+
+
+static void server_recv_cb(uv_udp_t* handle,
+                           ssize_t nread,
+                           const uv_buf_t* buf,
+                           const struct sockaddr* addr,
+                           unsigned flags) {
+  static unsigned char answer[512];
+  static unsigned char held[512];
+  static struct sockaddr_storage held_addr;
+  static size_t held_len;
+  uv_buf_t sndbuf;
+  size_t len;
+  int backup;
+  int flaky;
+
+  if (nread <= 0)
+    return;
+
+  backup = handle == &udp_backup;
+  if (backup)
+    backup_queries++;
+  else
+    udp_queries++;
+
+  len = make_answer((unsigned char*) buf->base, nread, answer, 0, backup);
+  if (len == 0)
+    return;
+
+  /* The A answer of "flaky.test" waits for the AAAA server failure, the
+   * resolver sees the failure first.
+   */
+  flaky = !backup && strcmp(last_query, "flaky.test") == 0;
+  if (flaky && answer[3] == 0x80 && !flaky_failed) {
+    memcpy(held, answer, len);
+    memcpy(&held_addr, addr, sizeof(struct sockaddr_in));
+    held_len = len;
+    return;
+  }
+
+  sndbuf = uv_buf_init((char*) answer, len);
+  ASSERT((int) len == uv_udp_try_send(handle, &sndbuf, 1, addr));
+
+  if (flaky && answer[3] != 0x80)
+    flaky_failed = 1;
+
+  if (flaky && held_len > 0) {
+    sndbuf = uv_buf_init((char*) held, held_len);
+    ASSERT((int) held_len == uv_udp_try_send(handle,
+                                             &sndbuf,
+                                             1,
+                                             (struct sockaddr*) &held_addr));
+    held_len = 0;
+  }
+}
+
+
+static void server_write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+  free(req);
+}
+
+
+static void server_read_cb(uv_stream_t* stream,
+                           ssize_t nread,
+                           const uv_buf_t* buf) {
+  static unsigned char answer[2 + 1024];
+  struct stub_conn* conn;
+  uv_write_t* req;
+  uv_buf_t sndbuf;
+  size_t qlen;
+  size_t len;
+
+  if (nread < 0) {
+    uv_close((uv_handle_t*) stream, NULL);
+    return;
+  }
+
+  conn = stream->data;
+  conn->len += nread;
+  if (conn->len < 2)
+    return;
+
+  qlen = (conn->buf[0] << 8) | conn->buf[1];
+  if (conn->len < 2 + qlen)
+    return;
+
+  tcp_queries++;
+  len = make_answer(conn->buf + 2, qlen, answer + 2, 1, 0);
+  answer[0] = len >> 8;
+  answer[1] = len & 255;
+  conn->len = 0;
+
+  req = malloc(sizeof(*req));
+  ASSERT_NOT_NULL(req);
+  sndbuf = uv_buf_init((char*) answer, 2 + len);
+  ASSERT(0 == uv_write(req, stream, &sndbuf, 1, server_write_cb));
+}
+
+
+static void server_connection_cb(uv_stream_t* server, int status) {
+  struct stub_conn* conn;
+
+  ASSERT(status == 0);
+  ASSERT(tcp_nconns < ARRAY_SIZE(tcp_conns));
+  conn = &tcp_conns[tcp_nconns++];
+  conn->len = 0;
+
+  ASSERT(0 == uv_tcp_init(server->loop, &conn->handle));
+  conn->handle.data = conn;
+  ASSERT(0 == uv_accept(server, (uv_stream_t*) &conn->handle));
+  ASSERT(0 == uv_read_start((uv_stream_t*) &conn->handle,
+                            server_alloc_cb,
+                            server_read_cb));
+}
+
+
+static void server_start(uv_loop_t* loop) {
+  struct sockaddr_in addr;
+
+  ASSERT(0 == uv_ip4_addr("127.0.0.1", TEST_PORT, &addr));
+  ASSERT(0 == uv_udp_init(loop, &udp_server));
+  ASSERT(0 == uv_udp_bind(&udp_server, (const struct sockaddr*) &addr, 0));
+  ASSERT(0 == uv_udp_recv_start(&udp_server, server_alloc_cb, server_recv_cb));
+  ASSERT(0 == uv_tcp_init(loop, &tcp_server));
+  ASSERT(0 == uv_tcp_bind(&tcp_server, (const struct sockaddr*) &addr, 0));
+  ASSERT(0 == uv_listen((uv_stream_t*) &tcp_server, 1, server_connection_cb));
+
+  ASSERT(0 == uv_ip4_addr("127.0.0.1", TEST_PORT_2, &addr));
+  ASSERT(0 == uv_udp_init(loop, &udp_backup));
+  ASSERT(0 == uv_udp_bind(&udp_backup, (const struct sockaddr*) &addr, 0));
+  ASSERT(0 == uv_udp_recv_start(&udp_backup, server_alloc_cb, server_recv_cb));
+
+  udp_queries = 0;
+  backup_queries = 0;
+  flaky_failed = 0;
+  tcp_queries = 0;
+  tcp_nconns = 0;
+  callbacks = 0;
+}
+
+
+static void server_stop(void) {
+  uv_close((uv_handle_t*) &udp_server, NULL);
+  uv_close((uv_handle_t*) &tcp_server, NULL);
+  uv_close((uv_handle_t*) &udp_backup, NULL);
+}
+
+
+/* The backup server goes second when |backup| is set. */
+static void config_write(int backup) {
+  char resolv_conf[256];
+  int n;
+
+  n = snprintf(resolv_conf,
+               sizeof(resolv_conf),
+               "# Test configuration.\n"
+               "nameserver 127.0.0.1:%d\n",
+               TEST_PORT);
+  if (backup)
+    n += snprintf(resolv_conf + n,
+                  sizeof(resolv_conf) - n,
+                  "nameserver 127.0.0.1:%d\n",
+                  TEST_PORT_2);
+  snprintf(resolv_conf + n,
+           sizeof(resolv_conf) - n,
+           "search corp.test\n"
+           "options ndots:1 timeout:1 attempts:1\n");
+  write_file(RESOLV_CONF, resolv_conf);
+  write_file(HOSTS_FILE, "10.1.2.3 myhost.test myalias\n::1 myhost.test\n");
+}
+
+
+static void config_remove(void) {
+  unlink(RESOLV_CONF);
+  unlink(HOSTS_FILE);
+}
+
+
+static const char* ai_addr_str(const struct addrinfo* ai) {
+  static char buf[INET6_ADDRSTRLEN];
+
+  if (ai->ai_family == AF_INET)
+    uv_ip4_name((const struct sockaddr_in*) ai->ai_addr, buf, sizeof(buf));
+  else
+    uv_ip6_name((const struct sockaddr_in6*) ai->ai_addr, buf, sizeof(buf));
+
+  return buf;
+}
+
+
+static void example_cb(uv_getaddrinfo_t* req, int status, struct addrinfo* res) {
+  ASSERT(status == 0);
+  ASSERT_NOT_NULL(res);
+  ASSERT(res->ai_family == AF_INET);
+  ASSERT(res->ai_socktype == SOCK_STREAM);
+  ASSERT(res->ai_protocol == IPPROTO_TCP);
+  ASSERT(0 == strcmp(ai_addr_str(res), "10.0.0.1"));
+  ASSERT(80 == ntohs(((struct sockaddr_in*) res->ai_addr)->sin_port));
+  ASSERT(0 == strcmp(res->ai_canonname, "example.test"));
+  ASSERT_NOT_NULL(res->ai_next);
+  ASSERT(res->ai_next->ai_family == AF_INET6);
+  ASSERT(0 == strcmp(ai_addr_str(res->ai_next), "2001:db8::1"));
+  ASSERT_NULL(res->ai_next->ai_next);
+  uv_freeaddrinfo(res);
+  callbacks++;
+}
+
+
+static void hosts_cb(uv_getaddrinfo_t* req, int status, struct addrinfo* res) {
+  ASSERT(status == 0);
+  ASSERT_NOT_NULL(res);
+  ASSERT(res->ai_family == AF_INET);
+  ASSERT(0 == strcmp(ai_addr_str(res), "10.1.2.3"));
+  ASSERT_NULL(res->ai_next);
+  uv_freeaddrinfo(res);
+  callbacks++;
+}
+
+
+static void search_cb(uv_getaddrinfo_t* req, int status, struct addrinfo* res) {
+  ASSERT(status == 0);
+  ASSERT_NOT_NULL(res);
+  ASSERT(0 == strcmp(ai_addr_str(res), "10.0.0.2"));
+  /* Only the A record exists. */
+  ASSERT_NULL(res->ai_next);
+  uv_freeaddrinfo(res);
+  callbacks++;
+}
+
+
+static void nxdomain_cb(uv_getaddrinfo_t* req,
+                        int status,
+                        struct addrinfo* res) {
+  ASSERT(status == UV_EAI_NONAME);
+  ASSERT_NULL(res);
+  callbacks++;
+}
+
+
+static void big_cb(uv_getaddrinfo_t* req, int status, struct addrinfo* res) {
+  struct addrinfo* ai;
+  unsigned int n;
+
+  ASSERT(status == 0);
+  for (n = 0, ai = res; ai != NULL; ai = ai->ai_next)
+    n++;
+  ASSERT(n == 20);
+  uv_freeaddrinfo(res);
+  callbacks++;
+}
+
+
+static void numeric_cb(uv_getaddrinfo_t* req, int status, struct addrinfo* res) {
+  ASSERT(status == 0);
+  ASSERT_NOT_NULL(res);
+  ASSERT(0 == strcmp(ai_addr_str(res), "1.2.3.4"));
+  ASSERT_NULL(res->ai_next);
+  uv_freeaddrinfo(res);
+  callbacks++;
+}
+
+
+TEST_IMPL(dns_resolve) {
+  struct addrinfo hints;
+  uv_loop_t loop;
+
+  config_write(0);
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_configure(&loop,
+                                UV_LOOP_NATIVE_DNS,
+                                RESOLV_CONF,
+                                HOSTS_FILE));
+  ASSERT(UV_EBUSY == uv_loop_configure(&loop,
+                                       UV_LOOP_NATIVE_DNS,
+                                       RESOLV_CONF,
+                                       HOSTS_FILE));
+  server_start(&loop);
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_CANONNAME;
+  ASSERT(0 == uv_getaddrinfo(&loop, reqs, example_cb, "example.test", "80",
+                             &hints));
+
+  hints.ai_flags = 0;
+  hints.ai_family = AF_INET;
+  ASSERT(0 == uv_getaddrinfo(&loop, reqs + 1, hosts_cb, "myalias", NULL,
+                             &hints));
+  ASSERT(0 == uv_getaddrinfo(&loop, reqs + 2, numeric_cb, "1.2.3.4", NULL,
+                             &hints));
+
+  /* No dots, the search domain goes first. */
+  hints.ai_family = AF_UNSPEC;
+  ASSERT(0 == uv_getaddrinfo(&loop, reqs + 3, search_cb, "www", NULL,
+                             &hints));
+  ASSERT(0 == uv_getaddrinfo(&loop, reqs + 4, nxdomain_cb, "missing.test",
+                             NULL, &hints));
+  ASSERT(0 == uv_getaddrinfo(&loop, reqs + 5, big_cb, "big.test", NULL,
+                             &hints));
+
+  /* Nothing is answered from inside uv_getaddrinfo(). */
+  ASSERT(callbacks == 0);
+
+  while (callbacks < 6)
+    ASSERT(0 != uv_run(&loop, UV_RUN_ONCE));
+
+  /* example.test, www.corp.test and big.test took an A and an AAAA query,
+   * missing.test two of each for itself and with the search domain.
+   */
+  ASSERT(udp_queries == 2 + 2 + 4 + 2);
+  ASSERT(tcp_queries == 2);
+
+  server_stop();
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(0 == uv_loop_close(&loop));
+  config_remove();
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static void timeout_cb(uv_getaddrinfo_t* req, int status, struct addrinfo* res) {
+  ASSERT(status == UV_EAI_AGAIN);
+  ASSERT_NULL(res);
+  callbacks++;
+}
+
+
+static void cancel_cb(uv_getaddrinfo_t* req, int status, struct addrinfo* res) {
+  ASSERT(status == UV_EAI_CANCELED);
+  ASSERT_NULL(res);
+  callbacks++;
+}
+
+
+TEST_IMPL(dns_timeout_cancel) {
+  uv_loop_t loop;
+  uint64_t before;
+
+  config_write(0);
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_configure(&loop,
+                                UV_LOOP_NATIVE_DNS,
+                                RESOLV_CONF,
+                                HOSTS_FILE));
+  server_start(&loop);
+
+  ASSERT(0 == uv_getaddrinfo(&loop, reqs, timeout_cb, "slow.test", NULL,
+                             NULL));
+  ASSERT(0 == uv_getaddrinfo(&loop, reqs + 1, cancel_cb, "slow.test", NULL,
+                             NULL));
+  ASSERT(0 == uv_cancel((uv_req_t*) (reqs + 1)));
+  ASSERT(UV_EBUSY == uv_cancel((uv_req_t*) (reqs + 1)));
+
+  before = uv_hrtime();
+  while (callbacks < 2)
+    ASSERT(0 != uv_run(&loop, UV_RUN_ONCE));
+
+  /* One attempt at the one server with a timeout of a second. */
+  ASSERT(uv_hrtime() - before >= 900 * 1000 * 1000);
+
+  server_stop();
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(0 == uv_loop_close(&loop));
+  config_remove();
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static void failover_cb(uv_getaddrinfo_t* req,
+                        int status,
+                        struct addrinfo* res) {
+  ASSERT(status == 0);
+  ASSERT_NOT_NULL(res);
+  ASSERT(res->ai_family == AF_INET);
+  ASSERT(0 == strcmp(ai_addr_str(res), "10.0.0.1"));
+  ASSERT_NOT_NULL(res->ai_next);
+  ASSERT(res->ai_next->ai_family == AF_INET6);
+  ASSERT(0 == strcmp(ai_addr_str(res->ai_next), "2001:db8::1"));
+  ASSERT_NULL(res->ai_next->ai_next);
+  uv_freeaddrinfo(res);
+  callbacks++;
+}
+
+
+TEST_IMPL(dns_failover) {
+  struct addrinfo hints;
+  uv_loop_t loop;
+
+  config_write(1);
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_configure(&loop,
+                                UV_LOOP_NATIVE_DNS,
+                                RESOLV_CONF,
+                                HOSTS_FILE));
+  server_start(&loop);
+
+  /* The A answer comes after the AAAA server failure. The query waits for
+   * the backup server to answer the AAAA query again.
+   */
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_socktype = SOCK_STREAM;
+  ASSERT(0 == uv_getaddrinfo(&loop, reqs, failover_cb, "flaky.test", NULL,
+                             &hints));
+
+  while (callbacks < 1)
+    ASSERT(0 != uv_run(&loop, UV_RUN_ONCE));
+
+  ASSERT(udp_queries == 2);
+  ASSERT_EQ(backup_queries, 1);
+
+  server_stop();
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(0 == uv_loop_close(&loop));
+  config_remove();
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static int cache_status;
+static unsigned int cache_naddrs;
+
+
+static void cache_cb(uv_getaddrinfo_t* req, int status, struct addrinfo* res) {
+  struct addrinfo* ai;
+
+  cache_status = status;
+  cache_naddrs = 0;
+  for (ai = res; ai != NULL; ai = ai->ai_next)
+    cache_naddrs++;
+
+  uv_freeaddrinfo(res);
+  callbacks++;
+}
+
+
+static void cache_resolve(uv_loop_t* loop, const char* name) {
+  struct addrinfo hints;
+  unsigned int n;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_socktype = SOCK_STREAM;
+
+  n = callbacks;
+  ASSERT(0 == uv_getaddrinfo(loop, reqs, cache_cb, name, NULL, &hints));
+  ASSERT(callbacks == n);
+
+  while (callbacks == n)
+    uv_run(loop, UV_RUN_ONCE);
+}
+
+
+TEST_IMPL(dns_cache) {
+  uv_dns_cache_options_t options;
+  uv_dns_cache_metrics_t metrics;
+  struct addrinfo hints;
+  uv_getaddrinfo_t req;
+  uv_loop_t loop;
+
+  config_write(0);
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_configure(&loop,
+                                UV_LOOP_NATIVE_DNS,
+                                RESOLV_CONF,
+                                HOSTS_FILE));
+  server_start(&loop);
+
+  memset(&options, 0, sizeof(options));
+  options.max_entries = 2;
+  options.ttl = 60 * 1000;
+  options.negative_ttl = 60 * 1000;
+  ASSERT(0 == uv_dns_cache_configure(&options));
+
+  cache_resolve(&loop, "example.test");
+  ASSERT(cache_status == 0);
+  ASSERT(cache_naddrs == 2);
+  ASSERT(udp_queries == 2);
+
+  /* Names are not case sensitive. */
+  cache_resolve(&loop, "EXAMPLE.test");
+  ASSERT(cache_status == 0);
+  ASSERT(cache_naddrs == 2);
+  ASSERT(udp_queries == 2);
+
+  /* Hits are complete already, there's nothing left to cancel. */
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_socktype = SOCK_STREAM;
+  ASSERT(0 == uv_getaddrinfo(&loop, reqs, cache_cb, "example.test", NULL,
+                             &hints));
+  ASSERT(UV_EBUSY == uv_cancel((uv_req_t*) reqs));
+  while (callbacks < 3)
+    ASSERT(0 != uv_run(&loop, UV_RUN_ONCE));
+  ASSERT(cache_status == 0);
+
+  cache_resolve(&loop, "missing.test");
+  ASSERT(cache_status == UV_EAI_NONAME);
+  ASSERT(udp_queries == 6);
+  cache_resolve(&loop, "missing.test");
+  ASSERT(cache_status == UV_EAI_NONAME);
+  ASSERT(udp_queries == 6);
+
+  /* Synchronous requests are answered from the cache too. */
+  ASSERT(UV_EAI_NONAME == uv_getaddrinfo(&loop, &req, NULL, "missing.test",
+                                         NULL, &hints));
+  ASSERT(udp_queries == 6);
+
+  /* One entry too many, example.test was used least recently. */
+  cache_resolve(&loop, "www.corp.test");
+  ASSERT(udp_queries == 8);
+  cache_resolve(&loop, "example.test");
+  ASSERT(udp_queries == 10);
+
+  uv_dns_cache_metrics(&metrics);
+  ASSERT(metrics.hits == 2);
+  ASSERT(metrics.negative_hits == 2);
+  ASSERT(metrics.stale_hits == 0);
+  ASSERT(metrics.misses == 4);
+  ASSERT(metrics.evictions == 2);
+  ASSERT(metrics.entries == 2);
+
+  uv_dns_cache_flush();
+  uv_dns_cache_metrics(&metrics);
+  ASSERT(metrics.entries == 0);
+  cache_resolve(&loop, "example.test");
+  ASSERT(udp_queries == 12);
+
+  ASSERT(0 == uv_dns_cache_configure(NULL));
+  cache_resolve(&loop, "example.test");
+  ASSERT(udp_queries == 14);
+  uv_dns_cache_metrics(&metrics);
+  ASSERT(metrics.entries == 0);
+
+  server_stop();
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(0 == uv_loop_close(&loop));
+  config_remove();
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+TEST_IMPL(dns_cache_threadpool) {
+  uv_dns_cache_options_t options;
+  uv_dns_cache_metrics_t metrics;
+
+  memset(&options, 0, sizeof(options));
+  options.max_entries = 16;
+  options.ttl = 60 * 1000;
+  ASSERT(0 == uv_dns_cache_configure(&options));
+
+  /* getaddrinfo() answers are kept for as long as the options allow. */
+  cache_resolve(uv_default_loop(), "localhost");
+  ASSERT(cache_status == 0);
+  cache_resolve(uv_default_loop(), "localhost");
+  ASSERT(cache_status == 0);
+
+  uv_dns_cache_metrics(&metrics);
+  ASSERT(metrics.hits == 1);
+  ASSERT(metrics.misses == 1);
+  ASSERT(metrics.entries == 1);
+
+  ASSERT(0 == uv_dns_cache_configure(NULL));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+TEST_IMPL(dns_cache_stale) {
+  uv_dns_cache_options_t options;
+  uv_dns_cache_metrics_t metrics;
+  uv_loop_t loop;
+
+  config_write(0);
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_configure(&loop,
+                                UV_LOOP_NATIVE_DNS,
+                                RESOLV_CONF,
+                                HOSTS_FILE));
+  server_start(&loop);
+
+  /* The answers say 300 seconds, the options cut that down. */
+  memset(&options, 0, sizeof(options));
+  options.max_entries = 16;
+  options.ttl = 100;
+  options.stale_ttl = 60 * 1000;
+  ASSERT(0 == uv_dns_cache_configure(&options));
+
+  cache_resolve(&loop, "example.test");
+  ASSERT(udp_queries == 2);
+  uv_sleep(150);
+
+  /* The stale answer comes right away and a refresh goes out. */
+  cache_resolve(&loop, "example.test");
+  ASSERT(cache_status == 0);
+  ASSERT(cache_naddrs == 2);
+  while (loop.active_reqs.count > 0)
+    ASSERT(0 != uv_run(&loop, UV_RUN_ONCE));
+  ASSERT(udp_queries == 4);
+
+  cache_resolve(&loop, "example.test");
+  ASSERT(udp_queries == 4);
+
+  uv_dns_cache_metrics(&metrics);
+  ASSERT(metrics.hits == 1);
+  ASSERT(metrics.stale_hits == 1);
+  ASSERT(metrics.misses == 1);
+
+  ASSERT(0 == uv_dns_cache_configure(NULL));
+  server_stop();
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(0 == uv_loop_close(&loop));
+  config_remove();
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static uv_getnameinfo_t ni_req;
+static int ni_status;
+static char ni_host[256];
+static char ni_service[32];
+
+
+static void nameinfo_cb(uv_getnameinfo_t* req,
+                        int status,
+                        const char* hostname,
+                        const char* service) {
+  ni_status = status;
+  ni_host[0] = '\0';
+  ni_service[0] = '\0';
+
+  if (status == 0) {
+    ASSERT(strlen(hostname) < sizeof(ni_host));
+    ASSERT(strlen(service) < sizeof(ni_service));
+    strcpy(ni_host, hostname);
+    strcpy(ni_service, service);
+  }
+
+  callbacks++;
+}
+
+
+static void nameinfo(uv_loop_t* loop, const char* ip, int port, int flags) {
+  struct sockaddr_in6 addr6;
+  struct sockaddr_in addr4;
+  struct sockaddr* addr;
+  unsigned int n;
+
+  if (uv_ip4_addr(ip, port, &addr4) == 0) {
+    addr = (struct sockaddr*) &addr4;
+  } else {
+    ASSERT(0 == uv_ip6_addr(ip, port, &addr6));
+    addr = (struct sockaddr*) &addr6;
+  }
+
+  n = callbacks;
+  ASSERT(0 == uv_getnameinfo(loop, &ni_req, nameinfo_cb, addr, flags));
+  ASSERT(callbacks == n);
+
+  while (callbacks == n)
+    uv_run(loop, UV_RUN_ONCE);
+}
+
+
+TEST_IMPL(dns_getnameinfo) {
+  struct sockaddr_in addr;
+  uv_getnameinfo_t req;
+  uv_loop_t loop;
+
+  /* Numbers don't need a resolver or a thread. */
+  nameinfo(uv_default_loop(), "127.0.0.1", 80, NI_NUMERICHOST | NI_NUMERICSERV);
+  ASSERT(ni_status == 0);
+  ASSERT(0 == strcmp(ni_host, "127.0.0.1"));
+  ASSERT(0 == strcmp(ni_service, "80"));
+
+  config_write(0);
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_configure(&loop,
+                                UV_LOOP_NATIVE_DNS,
+                                RESOLV_CONF,
+                                HOSTS_FILE));
+  server_start(&loop);
+
+  /* Service names come from the same file getnameinfo() reads. */
+  ASSERT(0 == uv_ip4_addr("10.0.0.1", 80, &addr));
+  ASSERT(0 == uv_getnameinfo(&loop,
+                             &req,
+                             NULL,
+                             (const struct sockaddr*) &addr,
+                             NI_NUMERICHOST));
+  nameinfo(&loop, "10.0.0.1", 80, 0);
+  ASSERT(ni_status == 0);
+  ASSERT(0 == strcmp(ni_host, "example.test"));
+  ASSERT(0 == strcmp(ni_service, req.service));
+  ASSERT(udp_queries == 1);
+
+  nameinfo(&loop, "2001:db8::1", 443, NI_NUMERICSERV);
+  ASSERT(ni_status == 0);
+  ASSERT(0 == strcmp(ni_host, "example.test"));
+  ASSERT(0 == strcmp(ni_service, "443"));
+  ASSERT(udp_queries == 2);
+
+  nameinfo(&loop, "10.0.0.3", 0, NI_NOFQDN);
+  ASSERT(ni_status == 0);
+  ASSERT(0 == strcmp(ni_host, "www"));
+  ASSERT(udp_queries == 3);
+
+  /* The hosts file goes first. */
+  nameinfo(&loop, "10.1.2.3", 0, 0);
+  ASSERT(ni_status == 0);
+  ASSERT(0 == strcmp(ni_host, "myhost.test"));
+  ASSERT(udp_queries == 3);
+
+  /* Addresses without a name stand for themselves, unless a name is
+   * required.
+   */
+  nameinfo(&loop, "10.0.0.2", 0, 0);
+  ASSERT(ni_status == 0);
+  ASSERT(0 == strcmp(ni_host, "10.0.0.2"));
+  ASSERT(udp_queries == 4);
+  nameinfo(&loop, "10.0.0.2", 0, NI_NAMEREQD);
+  ASSERT(ni_status == UV_EAI_NONAME);
+  ASSERT(udp_queries == 5);
+
+  nameinfo(&loop, "10.0.0.1", 0, NI_NUMERICHOST);
+  ASSERT(0 == strcmp(ni_host, "10.0.0.1"));
+  ASSERT(udp_queries == 5);
+
+  ASSERT(0 == uv_ip4_addr("10.0.0.9", 0, &addr));
+  ASSERT(0 == uv_getnameinfo(&loop,
+                             &ni_req,
+                             nameinfo_cb,
+                             (const struct sockaddr*) &addr,
+                             0));
+  ASSERT(0 == uv_cancel((uv_req_t*) &ni_req));
+  while (ni_status != UV_EAI_CANCELED)
+    ASSERT(0 != uv_run(&loop, UV_RUN_ONCE));
+
+  server_stop();
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(0 == uv_loop_close(&loop));
+  config_remove();
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+#else
+
+TEST_IMPL(dns_resolve) {
+  RETURN_SKIP("The native resolver is not available on Windows.");
+}
+
+
+TEST_IMPL(dns_timeout_cancel) {
+  RETURN_SKIP("The native resolver is not available on Windows.");
+}
+
+
+TEST_IMPL(dns_failover) {
+  RETURN_SKIP("The native resolver is not available on Windows.");
+}
+
+
+TEST_IMPL(dns_cache) {
+  RETURN_SKIP("The DNS cache is not available on Windows.");
+}
+
+
+TEST_IMPL(dns_cache_threadpool) {
+  RETURN_SKIP("The DNS cache is not available on Windows.");
+}
+
+
+TEST_IMPL(dns_cache_stale) {
+  RETURN_SKIP("The DNS cache is not available on Windows.");
+}
+
+
+TEST_IMPL(dns_getnameinfo) {
+  RETURN_SKIP("The native resolver is not available on Windows.");
+}
+
+#endif  /* !_WIN32 */
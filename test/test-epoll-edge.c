@@ -0,0 +1,361 @@
+/* Copyright libuv contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#ifdef __linux__
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#define STOP_START_BYTES (128 * 1024)
+#define SMALL_READS_BYTES (64 * 1024)
+#define SMALL_READ_SIZE 16
+#define WRITE_CHUNK (64 * 1024)
+#define WRITE_CHUNKS 64
+
+static uv_loop_t loop;
+static uv_tcp_t server;
+static uv_tcp_t client;
+static uv_tcp_t accepted;
+static uv_connect_t connect_req;
+static uv_pipe_t pipes[2];
+static uv_write_t write_reqs[WRITE_CHUNKS];
+static uv_shutdown_t shutdown_req;
+static uv_timer_t timer;
+static uv_idle_t idle;
+static char read_buf[4096];
+static char* data;
+static size_t nread_total;
+static int write_cb_called;
+static int eof_cb_called;
+static int idle_cb_called;
+
+
+static void edge_loop_init(void) {
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_EPOLL_EDGE_TRIGGERED));
+}
+
+
+static void alloc_cb(uv_handle_t* handle, size_t size, uv_buf_t* buf) {
+  buf->base = read_buf;
+  buf->len = sizeof(read_buf);
+}
+
+
+static void small_alloc_cb(uv_handle_t* handle, size_t size, uv_buf_t* buf) {
+  buf->base = read_buf;
+  buf->len = SMALL_READ_SIZE;
+}
+
+
+static void close_cb(uv_handle_t* handle) {
+}
+
+
+TEST_IMPL(epoll_edge_configure) {
+  int r;
+
+  edge_loop_init();
+  ASSERT(UV_EBUSY == uv_loop_configure(&loop, UV_LOOP_EPOLL_EDGE_TRIGGERED));
+  ASSERT(UV_EBUSY == uv_loop_configure(&loop, UV_LOOP_USE_IO_URING));
+  ASSERT(0 == uv_loop_close(&loop));
+
+  /* And the other way around, when the kernel has io_uring at all. */
+  ASSERT(0 == uv_loop_init(&loop));
+  r = uv_loop_configure(&loop, UV_LOOP_USE_IO_URING);
+  ASSERT(r == 0 || r == UV_ENOSYS);
+  if (r == 0)
+    ASSERT(UV_EBUSY == uv_loop_configure(&loop,
+                                         UV_LOOP_EPOLL_EDGE_TRIGGERED));
+  ASSERT(0 == uv_loop_close(&loop));
+
+  return 0;
+}
+
+
+static void restart_read(uv_timer_t* handle);
+
+
+static void stop_start_read_cb(uv_stream_t* stream,
+                               ssize_t nread,
+                               const uv_buf_t* buf) {
+  if (nread == UV_EOF) {
+    eof_cb_called++;
+    uv_close((uv_handle_t*) stream, close_cb);
+    uv_close((uv_handle_t*) &timer, close_cb);
+    return;
+  }
+
+  ASSERT(nread >= 0);
+  if (nread == 0)
+    return;
+
+  ASSERT(0 == memcmp(buf->base, data + nread_total, nread));
+  nread_total += nread;
+
+  /* Whatever is left in the socket must be there when reading starts again,
+   * the kernel won't report it twice.
+   */
+  ASSERT(0 == uv_read_stop(stream));
+  ASSERT(0 == uv_timer_start(&timer, restart_read, 1, 0));
+}
+
+
+static void restart_read(uv_timer_t* handle) {
+  ASSERT(0 == uv_read_start((uv_stream_t*) &client,
+                            alloc_cb,
+                            stop_start_read_cb));
+}
+
+
+static void stop_start_write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+  write_cb_called++;
+  uv_close((uv_handle_t*) &accepted, close_cb);
+  uv_close((uv_handle_t*) &server, close_cb);
+}
+
+
+static void stop_start_connection_cb(uv_stream_t* handle, int status) {
+  uv_buf_t buf;
+
+  ASSERT(status == 0);
+  ASSERT(0 == uv_tcp_init(&loop, &accepted));
+  ASSERT(0 == uv_accept(handle, (uv_stream_t*) &accepted));
+
+  buf = uv_buf_init(data, STOP_START_BYTES);
+  ASSERT(0 == uv_write(&write_reqs[0],
+                       (uv_stream_t*) &accepted,
+                       &buf,
+                       1,
+                       stop_start_write_cb));
+}
+
+
+static void stop_start_connect_cb(uv_connect_t* req, int status) {
+  ASSERT(status == 0);
+  restart_read(NULL);
+}
+
+
+TEST_IMPL(epoll_edge_read_stop_start) {
+  struct sockaddr_in addr;
+  size_t i;
+
+  edge_loop_init();
+
+  data = malloc(STOP_START_BYTES);
+  ASSERT_NOT_NULL(data);
+  for (i = 0; i < STOP_START_BYTES; i++)
+    data[i] = (char) (i * 7);
+
+  ASSERT(0 == uv_ip4_addr("127.0.0.1", TEST_PORT, &addr));
+  ASSERT(0 == uv_tcp_init(&loop, &server));
+  ASSERT(0 == uv_tcp_bind(&server, (const struct sockaddr*) &addr, 0));
+  ASSERT(0 == uv_listen((uv_stream_t*) &server, 1, stop_start_connection_cb));
+
+  ASSERT(0 == uv_timer_init(&loop, &timer));
+  ASSERT(0 == uv_tcp_init(&loop, &client));
+  ASSERT(0 == uv_tcp_connect(&connect_req,
+                             &client,
+                             (const struct sockaddr*) &addr,
+                             stop_start_connect_cb));
+
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(nread_total == STOP_START_BYTES);
+  ASSERT(write_cb_called == 1);
+  ASSERT(eof_cb_called == 1);
+
+  free(data);
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+
+static void idle_cb(uv_idle_t* handle) {
+  idle_cb_called++;
+}
+
+
+static void small_read_cb(uv_stream_t* stream,
+                          ssize_t nread,
+                          const uv_buf_t* buf) {
+  if (nread == UV_EOF) {
+    eof_cb_called++;
+    uv_close((uv_handle_t*) stream, close_cb);
+    uv_close((uv_handle_t*) &idle, close_cb);
+    return;
+  }
+
+  ASSERT(nread >= 0);
+  nread_total += nread;
+}
+
+
+TEST_IMPL(epoll_edge_read_starvation) {
+  int fds[2];
+  char* buf;
+
+  edge_loop_init();
+
+  /* Everything is in the socket before the loop runs, there's only the one
+   * edge. Reads of 16 bytes stop after 32 of them so it takes many loop
+   * iterations to get it all.
+   */
+  ASSERT(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  buf = calloc(1, SMALL_READS_BYTES);
+  ASSERT_NOT_NULL(buf);
+  ASSERT(SMALL_READS_BYTES == write(fds[1], buf, SMALL_READS_BYTES));
+  ASSERT(0 == shutdown(fds[1], SHUT_WR));
+  free(buf);
+
+  ASSERT(0 == uv_idle_init(&loop, &idle));
+  ASSERT(0 == uv_idle_start(&idle, idle_cb));
+  ASSERT(0 == uv_pipe_init(&loop, &pipes[0], 0));
+  ASSERT(0 == uv_pipe_open(&pipes[0], fds[0]));
+  ASSERT(0 == uv_read_start((uv_stream_t*) &pipes[0],
+                            small_alloc_cb,
+                            small_read_cb));
+
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(nread_total == SMALL_READS_BYTES);
+  ASSERT(eof_cb_called == 1);
+
+  /* Other handles ran in between. */
+  ASSERT(idle_cb_called >= SMALL_READS_BYTES / SMALL_READ_SIZE / 32);
+
+  ASSERT(0 == close(fds[1]));
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+
+static void full_write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+  write_cb_called++;
+}
+
+
+static void full_shutdown_cb(uv_shutdown_t* req, int status) {
+  ASSERT(status == 0);
+  ASSERT(write_cb_called == WRITE_CHUNKS);
+  uv_close((uv_handle_t*) req->handle, close_cb);
+}
+
+
+static void full_read_cb(uv_stream_t* stream,
+                         ssize_t nread,
+                         const uv_buf_t* buf) {
+  ssize_t i;
+
+  if (nread == UV_EOF) {
+    eof_cb_called++;
+    uv_close((uv_handle_t*) stream, close_cb);
+    return;
+  }
+
+  ASSERT(nread >= 0);
+  for (i = 0; i < nread; i++)
+    ASSERT(buf->base[i] == data[(nread_total + i) % WRITE_CHUNK]);
+  nread_total += nread;
+}
+
+
+static void full_timer_cb(uv_timer_t* handle) {
+  ASSERT(0 == uv_read_start((uv_stream_t*) &pipes[1], alloc_cb, full_read_cb));
+  uv_close((uv_handle_t*) handle, close_cb);
+}
+
+
+TEST_IMPL(epoll_edge_write_full) {
+  uv_buf_t buf;
+  int fds[2];
+  int i;
+
+  edge_loop_init();
+
+  data = malloc(WRITE_CHUNK);
+  ASSERT_NOT_NULL(data);
+  for (i = 0; i < WRITE_CHUNK; i++)
+    data[i] = (char) (i * 13);
+
+  ASSERT(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  ASSERT(0 == uv_pipe_init(&loop, &pipes[0], 0));
+  ASSERT(0 == uv_pipe_open(&pipes[0], fds[0]));
+  ASSERT(0 == uv_pipe_init(&loop, &pipes[1], 0));
+  ASSERT(0 == uv_pipe_open(&pipes[1], fds[1]));
+
+  /* Much more than the socket holds, the writes wait for POLLOUT until the
+   * other end starts reading.
+   */
+  buf = uv_buf_init(data, WRITE_CHUNK);
+  for (i = 0; i < WRITE_CHUNKS; i++)
+    ASSERT(0 == uv_write(&write_reqs[i],
+                         (uv_stream_t*) &pipes[0],
+                         &buf,
+                         1,
+                         full_write_cb));
+  ASSERT(uv_stream_get_write_queue_size((uv_stream_t*) &pipes[0]) > 0);
+  ASSERT(0 == uv_shutdown(&shutdown_req,
+                          (uv_stream_t*) &pipes[0],
+                          full_shutdown_cb));
+
+  ASSERT(0 == uv_timer_init(&loop, &timer));
+  ASSERT(0 == uv_timer_start(&timer, full_timer_cb, 10, 0));
+
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(write_cb_called == WRITE_CHUNKS);
+  ASSERT(nread_total == (size_t) WRITE_CHUNK * WRITE_CHUNKS);
+  ASSERT(eof_cb_called == 1);
+
+  free(data);
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+#else
+
+TEST_IMPL(epoll_edge_configure) {
+  uv_loop_t loop;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(UV_ENOSYS == uv_loop_configure(&loop, UV_LOOP_EPOLL_EDGE_TRIGGERED));
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+TEST_IMPL(epoll_edge_read_stop_start) {
+  RETURN_SKIP("epoll is Linux only.");
+}
+
+TEST_IMPL(epoll_edge_read_starvation) {
+  RETURN_SKIP("epoll is Linux only.");
+}
+
+TEST_IMPL(epoll_edge_write_full) {
+  RETURN_SKIP("epoll is Linux only.");
+}
+
+#endif  /* __linux__ */
@@ -347,6 +347,55 @@ TEST_IMPL(fork_signal_to_child_closed) {
 }
 
 
+static void random_cb(uv_random_t* req, int status, void* buf, size_t len) {
+  ASSERT(status == 0);
+}
+
+
+static void run_random(uv_loop_t* loop, char* buf, size_t len) {
+  uv_random_t req;
+
+  ASSERT(0 == uv_random(loop, &req, buf, len, 0, random_cb));
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+}
+
+
+TEST_IMPL(fork_random) {
+  /* The child doesn't hand out the parent's keystream. */
+  char parent_buf[32];
+  char child_buf[32];
+  int fd[2];
+  pid_t child_pid;
+
+  /* Seed the default loop's generator before forking. */
+  run_random(uv_default_loop(), parent_buf, sizeof(parent_buf));
+
+  ASSERT(0 == pipe(fd));
+  child_pid = fork();
+  ASSERT(child_pid != -1);
+
+  if (child_pid != 0) {
+    /* parent */
+    ASSERT(0 == close(fd[1]));
+    run_random(uv_default_loop(), parent_buf, sizeof(parent_buf));
+    ASSERT(sizeof(child_buf) == read(fd[0], child_buf, sizeof(child_buf)));
+    ASSERT(0 != memcmp(parent_buf, child_buf, sizeof(child_buf)));
+    ASSERT(0 == close(fd[0]));
+    assert_wait_child(child_pid);
+  } else {
+    /* child */
+    ASSERT(0 == close(fd[0]));
+    ASSERT(0 == uv_loop_fork(uv_default_loop()));
+    run_random(uv_default_loop(), child_buf, sizeof(child_buf));
+    ASSERT(sizeof(child_buf) == write(fd[1], child_buf, sizeof(child_buf)));
+    ASSERT(0 == close(fd[1]));
+  }
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
 static void create_file(const char* name) {
   int r;
   uv_file file;
@@ -298,3 +298,52 @@ TEST_IMPL(fs_poll_close_request_stop_when_active) {
   MAKE_VALGRIND_HAPPY();
   return 0;
 }
+
+
+static uv_fs_poll_t many_handles[256];
+static int many_cb_called;
+
+
+static void poll_cb_many(uv_fs_poll_t* handle,
+                         int status,
+                         const uv_stat_t* prev,
+                         const uv_stat_t* curr) {
+  ASSERT(status == UV_ENOENT);
+  ASSERT(handle->data == NULL);
+  handle->data = handle;  /* Only one callback per handle. */
+
+  if (++many_cb_called == ARRAY_SIZE(many_handles))
+    for (handle = many_handles; handle < many_handles + ARRAY_SIZE(many_handles);
+         handle++)
+      uv_close((uv_handle_t*) handle, close_cb);
+}
+
+
+TEST_IMPL(fs_poll_many) {
+  char path[64];
+  unsigned int i;
+
+  loop = uv_default_loop();
+
+  /* All paths are served by a single shared timer, stop some of them from
+   * under it to exercise removal from the middle of the schedule.
+   */
+  for (i = 0; i < ARRAY_SIZE(many_handles); i++) {
+    snprintf(path, sizeof(path), "%s_%u", FIXTURE, i);
+    ASSERT(0 == uv_fs_poll_init(loop, &many_handles[i]));
+    many_handles[i].data = NULL;
+    ASSERT(0 == uv_fs_poll_start(&many_handles[i], poll_cb_many, path, 10));
+  }
+
+  for (i = 0; i < ARRAY_SIZE(many_handles); i += 7) {
+    ASSERT(0 == uv_fs_poll_stop(&many_handles[i]));
+    ASSERT(0 == uv_fs_poll_start(&many_handles[i], poll_cb_many, "no_such", 5));
+  }
+
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(many_cb_called == ARRAY_SIZE(many_handles));
+  ASSERT(close_cb_called == ARRAY_SIZE(many_handles));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
@@ -0,0 +1,258 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <string.h>
+
+#define FILE_NAME "test_file_writer"
+#define LINE "0123456789abcdef"
+
+static uv_file_writer_t writer;
+static uv_timer_t check_timer;
+static int close_cb_called;
+static int flush_cb_called;
+static int drain_cb_called;
+static int check_cb_called;
+static int lines_written;
+
+
+static uv_file open_file(int flags) {
+  uv_fs_t req;
+  int r;
+
+  unlink(FILE_NAME);
+  r = uv_fs_open(NULL, &req, FILE_NAME, O_WRONLY | O_CREAT | flags,
+                 S_IWUSR | S_IRUSR, NULL);
+  ASSERT(r >= 0);
+  uv_fs_req_cleanup(&req);
+  return r;
+}
+
+
+static int64_t file_size(void) {
+  uv_fs_t req;
+  int64_t size;
+
+  ASSERT(0 == uv_fs_stat(NULL, &req, FILE_NAME, NULL));
+  size = req.statbuf.st_size;
+  uv_fs_req_cleanup(&req);
+  return size;
+}
+
+
+static void check_contents(int nlines) {
+  char buf[sizeof(LINE) - 1];
+  uv_fs_t req;
+  uv_buf_t iov;
+  uv_file file;
+  int i;
+  int r;
+
+  ASSERT(file_size() == (int64_t) (nlines * (sizeof(LINE) - 1)));
+
+  r = uv_fs_open(NULL, &req, FILE_NAME, O_RDONLY, 0, NULL);
+  ASSERT(r >= 0);
+  file = r;
+  uv_fs_req_cleanup(&req);
+
+  iov = uv_buf_init(buf, sizeof(buf));
+  for (i = 0; i < nlines; i++) {
+    r = uv_fs_read(NULL, &req, file, &iov, 1, -1, NULL);
+    ASSERT(r == sizeof(buf));
+    ASSERT(0 == memcmp(buf, LINE, sizeof(buf)));
+    uv_fs_req_cleanup(&req);
+  }
+
+  uv_fs_close(NULL, &req, file, NULL);
+  uv_fs_req_cleanup(&req);
+}
+
+
+static int write_line(uv_file_writer_cb drain_cb) {
+  uv_buf_t buf;
+  int r;
+
+  buf = uv_buf_init(LINE, sizeof(LINE) - 1);
+  r = uv_file_writer_write(&writer, &buf, 1, drain_cb);
+  if (r == 0)
+    lines_written++;
+  return r;
+}
+
+
+static void close_cb(uv_handle_t* handle) {
+  ASSERT(handle == (uv_handle_t*) &writer);
+  close_cb_called++;
+}
+
+
+static void flush_cb(uv_file_writer_t* handle, int status) {
+  ASSERT(handle == &writer);
+  ASSERT(status == 0);
+  ASSERT(0 == uv_file_writer_get_buffered_size(handle));
+  check_contents(lines_written);
+  flush_cb_called++;
+  uv_close((uv_handle_t*) handle, close_cb);
+}
+
+
+static void drain_cb(uv_file_writer_t* handle, int status) {
+  ASSERT(handle == &writer);
+  ASSERT(status == 0);
+  drain_cb_called++;
+
+  while (lines_written < 1000)
+    if (write_line(drain_cb) == UV_EAGAIN)
+      return;
+
+  ASSERT(0 == uv_file_writer_flush(handle, flush_cb));
+}
+
+
+static void check_cb(uv_timer_t* handle) {
+  /* Data sits below the size threshold, only the delay can have pushed it
+   * out.
+   */
+  check_contents(lines_written);
+  check_cb_called++;
+  uv_close((uv_handle_t*) &writer, close_cb);
+}
+
+
+TEST_IMPL(fs_writer_basic) {
+  uv_fs_t req;
+  uv_file file;
+  int i;
+
+  file = open_file(O_TRUNC);
+  lines_written = 0;
+
+  ASSERT(0 == uv_file_writer_init(uv_default_loop(), &writer, file, 0));
+  ASSERT(0 == uv_file_writer_set_thresholds(&writer, 1024, 1000, 64 * 1024));
+
+  for (i = 0; i < 1000; i++)
+    ASSERT(0 == write_line(NULL));
+
+  /* Buffered, not written yet. */
+  ASSERT(uv_file_writer_get_buffered_size(&writer) > 0);
+  ASSERT(uv_is_active((uv_handle_t*) &writer));
+
+  /* Closing flushes whatever is left and syncs it. */
+  uv_close((uv_handle_t*) &writer, close_cb);
+  ASSERT(UV_EINVAL == write_line(NULL));
+  ASSERT(0 == uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+  ASSERT(1 == close_cb_called);
+  check_contents(1000);
+
+  uv_fs_close(NULL, &req, file, NULL);
+  uv_fs_req_cleanup(&req);
+  unlink(FILE_NAME);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+TEST_IMPL(fs_writer_flush) {
+  uv_fs_t req;
+  uv_file file;
+  int i;
+
+  file = open_file(O_TRUNC);
+  lines_written = 0;
+
+  /* Start at the end of what's already in the file. */
+  ASSERT(0 == uv_file_writer_init(uv_default_loop(), &writer, file, -1));
+
+  for (i = 0; i < 10; i++)
+    ASSERT(0 == write_line(NULL));
+
+  ASSERT(0 == uv_file_writer_flush(&writer, flush_cb));
+  ASSERT(UV_EBUSY == uv_file_writer_flush(&writer, flush_cb));
+  ASSERT(0 == uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+  ASSERT(1 == flush_cb_called);
+  ASSERT(1 == close_cb_called);
+
+  uv_fs_close(NULL, &req, file, NULL);
+  uv_fs_req_cleanup(&req);
+  unlink(FILE_NAME);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+TEST_IMPL(fs_writer_backpressure) {
+  uv_fs_t req;
+  uv_file file;
+
+  file = open_file(O_TRUNC);
+  lines_written = 0;
+
+  ASSERT(0 == uv_file_writer_init(uv_default_loop(), &writer, file, 0));
+  ASSERT(0 == uv_file_writer_set_thresholds(&writer, 64, 0, 256));
+
+  while (write_line(drain_cb) == 0)
+    ASSERT(uv_file_writer_get_buffered_size(&writer) <= 256);
+
+  ASSERT(lines_written < 1000);
+  ASSERT(0 == uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+  ASSERT(drain_cb_called > 0);
+  ASSERT(1 == flush_cb_called);
+  ASSERT(1 == close_cb_called);
+  ASSERT(1000 == lines_written);
+
+  uv_fs_close(NULL, &req, file, NULL);
+  uv_fs_req_cleanup(&req);
+  unlink(FILE_NAME);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+TEST_IMPL(fs_writer_delay) {
+  uv_fs_t req;
+  uv_file file;
+
+  file = open_file(O_TRUNC);
+  lines_written = 0;
+
+  ASSERT(0 == uv_file_writer_init(uv_default_loop(), &writer, file, 0));
+  ASSERT(0 == uv_file_writer_set_thresholds(&writer, 4096, 10, 8192));
+  ASSERT(0 == write_line(NULL));
+  ASSERT(0 == write_line(NULL));
+
+  ASSERT(0 == uv_timer_init(uv_default_loop(), &check_timer));
+  ASSERT(0 == uv_timer_start(&check_timer, check_cb, 100, 0));
+  ASSERT(0 == uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+  ASSERT(1 == check_cb_called);
+  ASSERT(1 == close_cb_called);
+
+  uv_fs_close(NULL, &req, file, NULL);
+  uv_fs_req_cleanup(&req);
+  unlink(FILE_NAME);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
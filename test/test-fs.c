@@ -76,6 +76,7 @@ static int stat_cb_count;
 static int rename_cb_count;
 static int fsync_cb_count;
 static int fdatasync_cb_count;
+static int fs_write_alotof_bufs_async_cb_count;
 static int ftruncate_cb_count;
 static int sendfile_cb_count;
 static int fstat_cb_count;
@@ -3358,6 +3359,126 @@ TEST_IMPL(fs_write_alotof_bufs) {
 }
 
 
+static void fs_write_alotof_bufs_async_write_cb(uv_fs_t* req) {
+  int r;
+  ASSERT(req == &write_req);
+  ASSERT(req->fs_type == UV_FS_WRITE);
+  ASSERT(req->result >= 0);
+  fs_write_alotof_bufs_async_cb_count++;
+  uv_fs_req_cleanup(req);
+
+  r = uv_fs_fdatasync(loop, &fdatasync_req, open_req1.result, NULL);
+  ASSERT(r == 0);
+  uv_fs_req_cleanup(&fdatasync_req);
+}
+
+
+static void fs_write_alotof_bufs_async(int add_flags) {
+  size_t iovcount;
+  size_t iovmax;
+  uv_buf_t* iovs;
+  char* buffer;
+  size_t index;
+  int cb_count;
+  int r;
+
+  iovcount = 54321;
+
+  /* Setup. */
+  unlink("test_file");
+
+  loop = uv_default_loop();
+
+  iovs = malloc(sizeof(*iovs) * iovcount);
+  ASSERT(iovs != NULL);
+  iovmax = uv_test_getiovmax();
+
+  r = uv_fs_open(NULL,
+                 &open_req1,
+                 "test_file",
+                 O_RDWR | O_CREAT | add_flags,
+                 S_IWUSR | S_IRUSR,
+                 NULL);
+  ASSERT(r >= 0);
+  ASSERT(open_req1.result >= 0);
+  uv_fs_req_cleanup(&open_req1);
+
+  for (index = 0; index < iovcount; ++index)
+    iovs[index] = uv_buf_init(test_buf, sizeof(test_buf));
+
+  cb_count = fs_write_alotof_bufs_async_cb_count;
+  r = uv_fs_write(loop,
+                  &write_req,
+                  open_req1.result,
+                  iovs,
+                  iovcount,
+                  -1,
+                  fs_write_alotof_bufs_async_write_cb);
+  ASSERT(r == 0);
+  uv_run(loop, UV_RUN_DEFAULT);
+  ASSERT(fs_write_alotof_bufs_async_cb_count == cb_count + 1);
+  ASSERT((size_t)write_req.result == sizeof(test_buf) * iovcount);
+  uv_fs_req_cleanup(&write_req);
+
+  r = uv_fs_close(NULL, &close_req, open_req1.result, NULL);
+  ASSERT(r == 0);
+  ASSERT(close_req.result == 0);
+  uv_fs_req_cleanup(&close_req);
+
+  /* Read the strings back to separate buffers. */
+  buffer = malloc(sizeof(test_buf) * iovcount);
+  ASSERT(buffer != NULL);
+
+  for (index = 0; index < iovcount; ++index)
+    iovs[index] =
+        uv_buf_init(buffer + index * sizeof(test_buf), sizeof(test_buf));
+
+  r = uv_fs_open(NULL, &open_req1, "test_file", O_RDONLY | add_flags, 0, NULL);
+  ASSERT(r >= 0);
+  ASSERT(open_req1.result >= 0);
+  uv_fs_req_cleanup(&open_req1);
+
+  r = uv_fs_read(NULL, &read_req, open_req1.result, iovs, iovcount, -1, NULL);
+  if (iovcount > iovmax) iovcount = iovmax;
+  ASSERT(r >= 0);
+  ASSERT((size_t)read_req.result == sizeof(test_buf) * iovcount);
+
+  for (index = 0; index < iovcount; ++index)
+    ASSERT(strncmp(buffer + index * sizeof(test_buf),
+                   test_buf,
+                   sizeof(test_buf)) == 0);
+
+  uv_fs_req_cleanup(&read_req);
+  free(buffer);
+
+  ASSERT(lseek(open_req1.result, write_req.result, SEEK_SET) ==
+         write_req.result);
+  iov = uv_buf_init(buf, sizeof(buf));
+  r = uv_fs_read(NULL, &read_req, open_req1.result, &iov, 1, -1, NULL);
+  ASSERT(r == 0);
+  ASSERT(read_req.result == 0);
+  uv_fs_req_cleanup(&read_req);
+
+  r = uv_fs_close(NULL, &close_req, open_req1.result, NULL);
+  ASSERT(r == 0);
+  ASSERT(close_req.result == 0);
+  uv_fs_req_cleanup(&close_req);
+
+  /* Cleanup */
+  unlink("test_file");
+  free(iovs);
+}
+
+
+TEST_IMPL(fs_write_alotof_bufs_async) {
+  fs_write_alotof_bufs_async(0);
+  fs_write_alotof_bufs_async(UV_FS_O_FILEMAP);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
 static void fs_write_alotof_bufs_with_offset(int add_flags) {
   size_t iovcount;
   size_t iovmax;
@@ -4023,6 +4144,125 @@ TEST_IMPL(fs_file_pos_append) {
 }
 #endif
 
+static int fallocate_cb_count;
+
+static void fallocate_cb(uv_fs_t* req) {
+  ASSERT(req->fs_type == UV_FS_FALLOCATE);
+  fallocate_cb_count++;
+}
+
+
+static int fallocate_async(uv_file file, int flags, int64_t off, int64_t len) {
+  uv_fs_t req;
+  int count;
+  int r;
+
+  count = fallocate_cb_count;
+  r = uv_fs_fallocate(loop, &req, file, flags, off, len, fallocate_cb);
+  ASSERT(r == 0);
+  ASSERT(fallocate_cb_count == count);  /* Never called synchronously. */
+  uv_run(loop, UV_RUN_DEFAULT);
+  ASSERT(fallocate_cb_count == count + 1);
+  r = req.result;
+  uv_fs_req_cleanup(&req);
+  return r;
+}
+
+
+static int64_t fallocate_file_size(uv_file file) {
+  uv_fs_t req;
+  int64_t size;
+  int r;
+
+  r = uv_fs_fstat(NULL, &req, file, NULL);
+  ASSERT(r == 0);
+  size = req.statbuf.st_size;
+  uv_fs_req_cleanup(&req);
+  return size;
+}
+
+
+TEST_IMPL(fs_fallocate) {
+  char data[64];
+  char zeroes[16];
+  uv_file file;
+  uv_fs_t req;
+  int r;
+
+  unlink("test_file");
+  loop = uv_default_loop();
+
+  r = uv_fs_open(NULL, &req, "test_file", O_RDWR | O_CREAT | O_TRUNC,
+                 S_IWUSR | S_IRUSR, NULL);
+  ASSERT(r >= 0);
+  file = r;
+  uv_fs_req_cleanup(&req);
+
+#ifdef _WIN32
+  ASSERT(UV_ENOSYS == uv_fs_fallocate(NULL, &req, file, 0, 0, 1, NULL));
+  uv_fs_close(NULL, &req, file, NULL);
+  uv_fs_req_cleanup(&req);
+  unlink("test_file");
+  RETURN_SKIP("fallocate is not supported on Windows");
+#endif
+
+  r = uv_fs_fallocate(NULL, &req, file, 0x100, 0, 1, NULL);
+  ASSERT(r == UV_EINVAL);
+  r = uv_fs_fallocate(NULL, &req, file, 0, 0, 0, NULL);
+  ASSERT(r == UV_EINVAL);
+
+  memset(data, 'a', sizeof(data));
+  iov = uv_buf_init(data, sizeof(data));
+  r = uv_fs_write(NULL, &req, file, &iov, 1, 0, NULL);
+  ASSERT(r == sizeof(data));
+  uv_fs_req_cleanup(&req);
+
+  /* Plain preallocation extends the file. */
+  r = fallocate_async(file, 0, 0, 4096);
+  if (r == UV_ENOTSUP || r == UV_ENOSYS)
+    RETURN_SKIP("fallocate not supported by this file system");
+  ASSERT(r == 0);
+  ASSERT(fallocate_file_size(file) == 4096);
+
+  /* Keep-size allocates past the end without changing the size. */
+  ASSERT(0 == fallocate_async(file, UV_FS_FALLOCATE_KEEP_SIZE, 4096, 4096));
+  ASSERT(fallocate_file_size(file) == 4096);
+
+  /* The sync version works as well. */
+  r = uv_fs_fallocate(NULL, &req, file, 0, 0, 8192, NULL);
+  ASSERT(r == 0);
+  uv_fs_req_cleanup(&req);
+  ASSERT(fallocate_file_size(file) == 8192);
+
+  /* Punching a hole zeroes the data and leaves the size alone. */
+  r = fallocate_async(file, UV_FS_FALLOCATE_PUNCH_HOLE, 0, 4096);
+  if (r != UV_ENOTSUP) {
+    ASSERT(r == 0);
+    ASSERT(fallocate_file_size(file) == 8192);
+    memset(zeroes, 0, sizeof(zeroes));
+    iov = uv_buf_init(buf, sizeof(zeroes));
+    r = uv_fs_read(NULL, &req, file, &iov, 1, 0, NULL);
+    ASSERT(r == sizeof(zeroes));
+    ASSERT(0 == memcmp(buf, zeroes, sizeof(zeroes)));
+    uv_fs_req_cleanup(&req);
+  }
+
+  /* Zero range may extend the file. */
+  r = fallocate_async(file, UV_FS_FALLOCATE_ZERO_RANGE, 8192, 4096);
+  if (r != UV_ENOTSUP) {
+    ASSERT(r == 0);
+    ASSERT(fallocate_file_size(file) == 12288);
+  }
+
+  uv_fs_close(NULL, &req, file, NULL);
+  uv_fs_req_cleanup(&req);
+  unlink("test_file");
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
 TEST_IMPL(fs_null_req) {
   /* Verify that all fs functions return UV_EINVAL when the request is NULL. */
   int r;
@@ -4096,6 +4336,9 @@ TEST_IMPL(fs_null_req) {
   r = uv_fs_ftruncate(NULL, NULL, 0, 0, NULL);
   ASSERT(r == UV_EINVAL);
 
+  r = uv_fs_fallocate(NULL, NULL, 0, 0, 0, 1, NULL);
+  ASSERT(r == UV_EINVAL);
+
   r = uv_fs_copyfile(NULL, NULL, NULL, NULL, 0, NULL);
   ASSERT(r == UV_EINVAL);
 
@@ -33,6 +33,9 @@ TEST_IMPL(handle_type_name) {
   ASSERT(strcmp(uv_handle_type_name(UV_NAMED_PIPE), "pipe") == 0);
   ASSERT(strcmp(uv_handle_type_name(UV_UDP), "udp") == 0);
   ASSERT(strcmp(uv_handle_type_name(UV_FILE), "file") == 0);
+  ASSERT(strcmp(uv_handle_type_name(UV_FILE_WRITER), "file_writer") == 0);
+  /* Newer handle types come after UV_FILE, its value doesn't change. */
+  ASSERT(UV_FILE == UV_SIGNAL + 1);
   ASSERT(uv_handle_type_name(UV_HANDLE_TYPE_MAX) == NULL);
   ASSERT(uv_handle_type_name(UV_HANDLE_TYPE_MAX + 1) == NULL);
   ASSERT(uv_handle_type_name(UV_UNKNOWN_HANDLE) == NULL);
@@ -0,0 +1,758 @@
+/* Copyright libuv contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#ifdef __linux__
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#define ROUNDS 100
+#define ECHO_BYTES (1024 * 1024)
+#define ECHO_CHUNK 4096
+#define BACKLOG_CONNS 3
+#define CLOSE_MANY 2500  /* Two completions each overflow the 4096 entry CQ. */
+
+static uv_loop_t loop;
+static uv_tcp_t server;
+static uv_tcp_t client;
+static uv_tcp_t accepted;
+static uv_connect_t connect_req;
+static uv_poll_t poll_handle;
+static char read_buf[64];
+static int pongs;
+static int poll_cb_called;
+static uv_pipe_t pipes[2];
+static uv_tcp_t conns[BACKLOG_CONNS];
+static uv_connect_t conn_reqs[BACKLOG_CONNS];
+static uv_write_t big_write_req;
+static uv_shutdown_t shutdown_req;
+static uv_shutdown_t server_shutdown_req;
+static uv_timer_t timer;
+static char* echo_data;
+static size_t echo_read;
+static int eof_cb_called;
+static int accepted_count;
+static int write_cb_called;
+
+
+static int io_uring_loop_init(void) {
+  int r;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  r = uv_loop_configure(&loop, UV_LOOP_USE_IO_URING);
+  if (r == 0)
+    ASSERT(UV_EBUSY == uv_loop_configure(&loop, UV_LOOP_USE_IO_URING));
+
+  return r;
+}
+
+
+static void alloc_cb(uv_handle_t* handle, size_t size, uv_buf_t* buf) {
+  buf->base = read_buf;
+  buf->len = sizeof(read_buf);
+}
+
+
+static void write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+  free(req);
+}
+
+
+static void send_ping(uv_stream_t* stream) {
+  uv_write_t* req;
+  uv_buf_t buf;
+
+  req = malloc(sizeof(*req));
+  ASSERT_NOT_NULL(req);
+  buf = uv_buf_init("PING", 4);
+  ASSERT(0 == uv_write(req, stream, &buf, 1, write_cb));
+}
+
+
+static void close_all(void) {
+  uv_close((uv_handle_t*) &client, NULL);
+  uv_close((uv_handle_t*) &accepted, NULL);
+  uv_close((uv_handle_t*) &server, NULL);
+}
+
+
+static void echo_read_cb(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf) {
+  if (nread <= 0)
+    return;
+
+  /* Each ping is answered before the next one goes out. */
+  ASSERT(nread == 4);
+
+  if (stream == (uv_stream_t*) &accepted) {
+    send_ping(stream);
+    return;
+  }
+
+  if (++pongs == ROUNDS)
+    close_all();
+  else
+    send_ping(stream);
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  ASSERT(status == 0);
+  ASSERT(0 == uv_read_start((uv_stream_t*) &client, alloc_cb, echo_read_cb));
+  send_ping((uv_stream_t*) &client);
+}
+
+
+static void connection_cb(uv_stream_t* handle, int status) {
+  ASSERT(status == 0);
+  ASSERT(0 == uv_tcp_init(&loop, &accepted));
+  ASSERT(0 == uv_accept(handle, (uv_stream_t*) &accepted));
+  ASSERT(0 == uv_read_start((uv_stream_t*) &accepted, alloc_cb, echo_read_cb));
+}
+
+
+TEST_IMPL(io_uring_tcp_ping_pong) {
+  struct sockaddr_in addr;
+  int backend_fd;
+  int r;
+
+  ASSERT(0 == uv_ip4_addr("127.0.0.1", TEST_PORT, &addr));
+
+  /* The listener is started before the switch and moves over with it. */
+  ASSERT(0 == uv_loop_init(&loop));
+  backend_fd = uv_backend_fd(&loop);
+  ASSERT(0 == uv_tcp_init(&loop, &server));
+  ASSERT(0 == uv_tcp_bind(&server, (const struct sockaddr*) &addr, 0));
+  ASSERT(0 == uv_listen((uv_stream_t*) &server, 1, connection_cb));
+
+  r = uv_loop_configure(&loop, UV_LOOP_USE_IO_URING);
+  if (r == UV_ENOSYS) {
+    uv_close((uv_handle_t*) &server, NULL);
+    ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+    ASSERT(0 == uv_loop_close(&loop));
+    RETURN_SKIP("io_uring is not available.");
+  }
+  ASSERT(r == 0);
+  ASSERT(backend_fd == uv_backend_fd(&loop));
+
+  ASSERT(0 == uv_tcp_init(&loop, &client));
+  ASSERT(0 == uv_tcp_connect(&connect_req,
+                             &client,
+                             (const struct sockaddr*) &addr,
+                             connect_cb));
+
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(pongs == ROUNDS);
+
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+
+static void level_poll_cb(uv_poll_t* handle, int status, int events) {
+  int fd;
+
+  ASSERT(status == 0);
+  ASSERT(0 == uv_fileno((uv_handle_t*) handle, &fd));
+  poll_cb_called++;
+
+  if (poll_cb_called < 3) {
+    /* The data is left unread, the descriptor must be reported again. */
+    ASSERT(events == UV_READABLE);
+    return;
+  }
+
+  if (poll_cb_called == 3) {
+    ASSERT(events == UV_READABLE);
+    ASSERT(1 == read(fd, read_buf, sizeof(read_buf)));
+    ASSERT(0 == uv_poll_start(handle, UV_WRITABLE, level_poll_cb));
+    return;
+  }
+
+  ASSERT(poll_cb_called == 4);
+  ASSERT(events == UV_WRITABLE);
+  uv_close((uv_handle_t*) handle, NULL);
+}
+
+
+TEST_IMPL(io_uring_poll_level_triggered) {
+  int fds[2];
+  int r;
+
+  r = io_uring_loop_init();
+  if (r == UV_ENOSYS) {
+    ASSERT(0 == uv_loop_close(&loop));
+    RETURN_SKIP("io_uring is not available.");
+  }
+  ASSERT(r == 0);
+
+  ASSERT(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  ASSERT(1 == write(fds[1], "x", 1));
+
+  ASSERT(0 == uv_poll_init(&loop, &poll_handle, fds[0]));
+  ASSERT(0 == uv_poll_start(&poll_handle, UV_READABLE, level_poll_cb));
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(poll_cb_called == 4);
+
+  ASSERT(0 == close(fds[0]));
+  ASSERT(0 == close(fds[1]));
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+
+static void fail_poll_cb(uv_poll_t* handle, int status, int events) {
+  ASSERT(0 && "fail_poll_cb should not have been called");
+}
+
+
+static void reuse_poll_cb(uv_poll_t* handle, int status, int events) {
+  ASSERT(status == 0);
+  ASSERT(events == UV_READABLE);
+  poll_cb_called++;
+  uv_close((uv_handle_t*) handle, NULL);
+}
+
+
+TEST_IMPL(io_uring_poll_fd_reuse) {
+  uv_poll_t stale_handle;
+  int fds[2];
+  int other[2];
+  int r;
+
+  r = io_uring_loop_init();
+  if (r == UV_ENOSYS) {
+    ASSERT(0 == uv_loop_close(&loop));
+    RETURN_SKIP("io_uring is not available.");
+  }
+  ASSERT(r == 0);
+
+  /* A poll request that is submitted and then stopped with the descriptor
+   * closed must not deliver anything for the next file with the same number.
+   */
+  ASSERT(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  ASSERT(0 == uv_poll_init(&loop, &stale_handle, fds[0]));
+  ASSERT(0 == uv_poll_start(&stale_handle, UV_READABLE, fail_poll_cb));
+  ASSERT(0 != uv_run(&loop, UV_RUN_NOWAIT));
+  uv_close((uv_handle_t*) &stale_handle, NULL);
+  ASSERT(0 == close(fds[0]));
+  ASSERT(0 == close(fds[1]));
+
+  ASSERT(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, other));
+  ASSERT(other[0] == fds[0]);
+  ASSERT(0 == uv_poll_init(&loop, &poll_handle, other[0]));
+  ASSERT(0 == uv_poll_start(&poll_handle, UV_READABLE, reuse_poll_cb));
+  ASSERT(1 == write(other[1], "x", 1));
+
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(poll_cb_called == 1);
+
+  ASSERT(0 == close(other[0]));
+  ASSERT(0 == close(other[1]));
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+
+TEST_IMPL(io_uring_poll_close_many) {
+  struct rlimit lim;
+  uv_poll_t* handles;
+  int* fds;
+  int i;
+  int r;
+
+  ASSERT(0 == getrlimit(RLIMIT_NOFILE, &lim));
+  if (lim.rlim_cur < 2 * CLOSE_MANY + 64) {
+    lim.rlim_cur = lim.rlim_max;
+    if (lim.rlim_cur < 2 * CLOSE_MANY + 64 || setrlimit(RLIMIT_NOFILE, &lim))
+      RETURN_SKIP("Not enough file descriptors.");
+  }
+
+  r = io_uring_loop_init();
+  if (r == UV_ENOSYS) {
+    ASSERT(0 == uv_loop_close(&loop));
+    RETURN_SKIP("io_uring is not available.");
+  }
+  ASSERT(r == 0);
+
+  handles = malloc(CLOSE_MANY * sizeof(*handles));
+  fds = malloc(2 * CLOSE_MANY * sizeof(*fds));
+  ASSERT_NOT_NULL(handles);
+  ASSERT_NOT_NULL(fds);
+
+  for (i = 0; i < CLOSE_MANY; i++) {
+    ASSERT(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds + 2 * i));
+    ASSERT(0 == uv_poll_init(&loop, handles + i, fds[2 * i]));
+    ASSERT(0 == uv_poll_start(handles + i, UV_READABLE, fail_poll_cb));
+  }
+  ASSERT(0 != uv_run(&loop, UV_RUN_NOWAIT));
+
+  /* Every close cancels its poll request right away, without reaping the
+   * completions in between.
+   */
+  for (i = 0; i < CLOSE_MANY; i++) {
+    uv_close((uv_handle_t*) (handles + i), NULL);
+    ASSERT(0 == close(fds[2 * i]));
+    ASSERT(0 == close(fds[2 * i + 1]));
+  }
+
+  ASSERT(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  ASSERT(0 == uv_poll_init(&loop, &poll_handle, fds[0]));
+  ASSERT(0 == uv_poll_start(&poll_handle, UV_READABLE, reuse_poll_cb));
+  ASSERT(1 == write(fds[1], "x", 1));
+
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(poll_cb_called == 1);
+
+  ASSERT(0 == close(fds[0]));
+  ASSERT(0 == close(fds[1]));
+  ASSERT(0 == uv_loop_close(&loop));
+  free(handles);
+  free(fds);
+  return 0;
+}
+
+
+TEST_IMPL(io_uring_fork) {
+  int fds[2];
+  pid_t pid;
+  int status;
+  int r;
+
+  r = io_uring_loop_init();
+  if (r == UV_ENOSYS) {
+    ASSERT(0 == uv_loop_close(&loop));
+    RETURN_SKIP("io_uring is not available.");
+  }
+  ASSERT(r == 0);
+
+  ASSERT(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  ASSERT(0 == uv_poll_init(&loop, &poll_handle, fds[0]));
+  ASSERT(0 == uv_poll_start(&poll_handle, UV_READABLE, reuse_poll_cb));
+  ASSERT(0 != uv_run(&loop, UV_RUN_NOWAIT));
+
+  pid = fork();
+  ASSERT(pid != -1);
+
+  if (pid == 0) {
+    /* The child gets a ring of its own, the watcher moves over to it. */
+    ASSERT(0 == uv_loop_fork(&loop));
+    ASSERT(1 == write(fds[1], "x", 1));
+    ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+    ASSERT(poll_cb_called == 1);
+    ASSERT(0 == uv_loop_close(&loop));
+    exit(0);
+  }
+
+  ASSERT(pid == waitpid(pid, &status, 0));
+  ASSERT(WIFEXITED(status));
+  ASSERT(0 == WEXITSTATUS(status));
+
+  /* The byte the child wrote is still there for the parent. */
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(poll_cb_called == 1);
+
+  ASSERT(0 == close(fds[0]));
+  ASSERT(0 == close(fds[1]));
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+
+static int io_uring_streams_init(void) {
+  int r;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  r = uv_loop_configure(&loop, UV_LOOP_IO_URING_STREAMS);
+  if (r == 0)
+    ASSERT(UV_EBUSY == uv_loop_configure(&loop, UV_LOOP_IO_URING_STREAMS));
+
+  return r;
+}
+
+
+static void small_alloc_cb(uv_handle_t* handle, size_t size, uv_buf_t* buf) {
+  /* Much smaller than the kernel buffers, they're handed out in pieces. */
+  buf->base = read_buf;
+  buf->len = 7;
+}
+
+
+static void echo_server_write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+  free(req->data);
+  free(req);
+}
+
+
+static void echo_server_shutdown_cb(uv_shutdown_t* req, int status) {
+  ASSERT(status == 0);
+  uv_close((uv_handle_t*) req->handle, NULL);
+}
+
+
+static void echo_server_read_cb(uv_stream_t* stream,
+                                ssize_t nread,
+                                const uv_buf_t* buf) {
+  uv_write_t* req;
+  uv_buf_t copy;
+
+  if (nread == UV_EOF) {
+    /* Once the echoes are written. */
+    eof_cb_called++;
+    ASSERT(0 == uv_shutdown(&server_shutdown_req,
+                            stream,
+                            echo_server_shutdown_cb));
+    return;
+  }
+
+  ASSERT(nread > 0);
+  req = malloc(sizeof(*req));
+  ASSERT_NOT_NULL(req);
+  copy = uv_buf_init(malloc(nread), nread);
+  ASSERT_NOT_NULL(copy.base);
+  memcpy(copy.base, buf->base, nread);
+  req->data = copy.base;
+  ASSERT(0 == uv_write(req, stream, &copy, 1, echo_server_write_cb));
+}
+
+
+static void echo_connection_cb(uv_stream_t* handle, int status) {
+  ASSERT(status == 0);
+  ASSERT(0 == uv_tcp_init(&loop, &accepted));
+  ASSERT(0 == uv_accept(handle, (uv_stream_t*) &accepted));
+  ASSERT(0 == uv_read_start((uv_stream_t*) &accepted,
+                            small_alloc_cb,
+                            echo_server_read_cb));
+  uv_close((uv_handle_t*) handle, NULL);
+}
+
+
+static void echo_client_read_cb(uv_stream_t* stream,
+                                ssize_t nread,
+                                const uv_buf_t* buf) {
+  if (nread == UV_EOF) {
+    ASSERT(echo_read == ECHO_BYTES);
+    eof_cb_called++;
+    uv_close((uv_handle_t*) stream, NULL);
+    return;
+  }
+
+  ASSERT(nread > 0);
+  ASSERT(echo_read + nread <= ECHO_BYTES);
+  ASSERT(0 == memcmp(buf->base, echo_data + echo_read, nread));
+  echo_read += nread;
+}
+
+
+static void big_write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+  write_cb_called++;
+}
+
+
+static void shutdown_cb(uv_shutdown_t* req, int status) {
+  ASSERT(status == 0);
+}
+
+
+static void echo_connect_cb(uv_connect_t* req, int status) {
+  uv_buf_t bufs[ECHO_BYTES / ECHO_CHUNK];
+  size_t i;
+
+  ASSERT(status == 0);
+
+  /* More buffers than fit in one sendmsg request. */
+  for (i = 0; i < ARRAY_SIZE(bufs); i++)
+    bufs[i] = uv_buf_init(echo_data + i * ECHO_CHUNK, ECHO_CHUNK);
+
+  ASSERT(0 == uv_write(&big_write_req,
+                       req->handle,
+                       bufs,
+                       ARRAY_SIZE(bufs),
+                       big_write_cb));
+  ASSERT(0 == uv_shutdown(&shutdown_req, req->handle, shutdown_cb));
+}
+
+
+TEST_IMPL(io_uring_streams_echo) {
+  struct sockaddr_in addr;
+  size_t i;
+  int r;
+
+  r = io_uring_streams_init();
+  if (r == UV_ENOSYS) {
+    ASSERT(0 == uv_loop_close(&loop));
+    RETURN_SKIP("io_uring provided buffer rings are not available.");
+  }
+  ASSERT(r == 0);
+
+  echo_data = malloc(ECHO_BYTES);
+  ASSERT_NOT_NULL(echo_data);
+  for (i = 0; i < ECHO_BYTES; i++)
+    echo_data[i] = i % 251;
+
+  ASSERT(0 == uv_ip4_addr("127.0.0.1", TEST_PORT, &addr));
+  ASSERT(0 == uv_tcp_init(&loop, &server));
+  ASSERT(0 == uv_tcp_bind(&server, (const struct sockaddr*) &addr, 0));
+  ASSERT(0 == uv_listen((uv_stream_t*) &server, 1, echo_connection_cb));
+
+  /* Reading starts while the connection is still being established. */
+  ASSERT(0 == uv_tcp_init(&loop, &client));
+  ASSERT(0 == uv_tcp_connect(&connect_req,
+                             &client,
+                             (const struct sockaddr*) &addr,
+                             echo_connect_cb));
+  ASSERT(0 == uv_read_start((uv_stream_t*) &client,
+                            small_alloc_cb,
+                            echo_client_read_cb));
+
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(write_cb_called == 1);
+  ASSERT(eof_cb_called == 2);
+  ASSERT(echo_read == ECHO_BYTES);
+
+  free(echo_data);
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+
+static void restart_read_cb(uv_stream_t* stream,
+                            ssize_t nread,
+                            const uv_buf_t* buf);
+
+
+static void restart_timer_cb(uv_timer_t* handle) {
+  ASSERT(0 == uv_read_start((uv_stream_t*) &pipes[0],
+                            small_alloc_cb,
+                            restart_read_cb));
+}
+
+
+static void restart_read_cb(uv_stream_t* stream,
+                            ssize_t nread,
+                            const uv_buf_t* buf) {
+  if (nread == UV_EOF) {
+    ASSERT(echo_read == 20);
+    eof_cb_called++;
+    uv_close((uv_handle_t*) stream, NULL);
+    uv_close((uv_handle_t*) &timer, NULL);
+    return;
+  }
+
+  /* The rest of what was received is kept while reading is stopped. */
+  ASSERT(nread == 7 || (nread == 6 && echo_read == 14));
+  ASSERT(0 == memcmp(buf->base, "abcdefghijklmnopqrst" + echo_read, nread));
+  echo_read += nread;
+
+  ASSERT(0 == uv_read_stop(stream));
+  ASSERT(0 == uv_timer_start(&timer, restart_timer_cb, 1, 0));
+}
+
+
+TEST_IMPL(io_uring_streams_pipe_read_stop) {
+  int fds[2];
+  int r;
+
+  r = io_uring_streams_init();
+  if (r == UV_ENOSYS) {
+    ASSERT(0 == uv_loop_close(&loop));
+    RETURN_SKIP("io_uring provided buffer rings are not available.");
+  }
+  ASSERT(r == 0);
+
+  ASSERT(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  ASSERT(20 == write(fds[1], "abcdefghijklmnopqrst", 20));
+  ASSERT(0 == shutdown(fds[1], SHUT_WR));
+
+  ASSERT(0 == uv_timer_init(&loop, &timer));
+  ASSERT(0 == uv_pipe_init(&loop, &pipes[0], 0));
+  ASSERT(0 == uv_pipe_open(&pipes[0], fds[0]));
+  ASSERT(0 == uv_read_start((uv_stream_t*) &pipes[0],
+                            small_alloc_cb,
+                            restart_read_cb));
+
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(echo_read == 20);
+  ASSERT(eof_cb_called == 1);
+
+  ASSERT(0 == close(fds[1]));
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+
+static void backlog_close_cb(uv_handle_t* handle) {
+  if (++accepted_count == BACKLOG_CONNS)
+    uv_close((uv_handle_t*) &server, NULL);
+}
+
+
+static void backlog_timer_cb(uv_timer_t* handle) {
+  ASSERT(0 == uv_tcp_init(&loop, &accepted));
+  ASSERT(0 == uv_accept((uv_stream_t*) &server, (uv_stream_t*) &accepted));
+  uv_close((uv_handle_t*) &accepted, backlog_close_cb);
+}
+
+
+static void backlog_connection_cb(uv_stream_t* handle, int status) {
+  /* Accepted later, the next connection waits until then. */
+  ASSERT(status == 0);
+  ASSERT(0 == uv_timer_start(&timer, backlog_timer_cb, 1, 0));
+}
+
+
+static void backlog_connect_cb(uv_connect_t* req, int status) {
+  ASSERT(status == 0);
+  uv_close((uv_handle_t*) req->handle, NULL);
+}
+
+
+TEST_IMPL(io_uring_streams_accept_later) {
+  struct sockaddr_in addr;
+  int i;
+  int r;
+
+  r = io_uring_streams_init();
+  if (r == UV_ENOSYS) {
+    ASSERT(0 == uv_loop_close(&loop));
+    RETURN_SKIP("io_uring provided buffer rings are not available.");
+  }
+  ASSERT(r == 0);
+
+  ASSERT(0 == uv_ip4_addr("127.0.0.1", TEST_PORT, &addr));
+  ASSERT(0 == uv_timer_init(&loop, &timer));
+  uv_unref((uv_handle_t*) &timer);
+  ASSERT(0 == uv_tcp_init(&loop, &server));
+  ASSERT(0 == uv_tcp_bind(&server, (const struct sockaddr*) &addr, 0));
+  ASSERT(0 == uv_listen((uv_stream_t*) &server,
+                        BACKLOG_CONNS,
+                        backlog_connection_cb));
+
+  for (i = 0; i < BACKLOG_CONNS; i++) {
+    ASSERT(0 == uv_tcp_init(&loop, &conns[i]));
+    ASSERT(0 == uv_tcp_connect(&conn_reqs[i],
+                               &conns[i],
+                               (const struct sockaddr*) &addr,
+                               backlog_connect_cb));
+  }
+
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(accepted_count == BACKLOG_CONNS);
+
+  uv_close((uv_handle_t*) &timer, NULL);
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+
+static void cancelled_write_cb(uv_write_t* req, int status) {
+  ASSERT(status == UV_ECANCELED);
+  write_cb_called++;
+}
+
+
+TEST_IMPL(io_uring_streams_close_writing) {
+  uv_buf_t buf;
+  int fds[2];
+  int r;
+
+  r = io_uring_streams_init();
+  if (r == UV_ENOSYS) {
+    ASSERT(0 == uv_loop_close(&loop));
+    RETURN_SKIP("io_uring provided buffer rings are not available.");
+  }
+  ASSERT(r == 0);
+
+  echo_data = calloc(1, ECHO_BYTES);
+  ASSERT_NOT_NULL(echo_data);
+
+  /* Nobody reads, the write is still with the kernel when closing. */
+  ASSERT(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  ASSERT(0 == uv_pipe_init(&loop, &pipes[0], 0));
+  ASSERT(0 == uv_pipe_open(&pipes[0], fds[0]));
+  buf = uv_buf_init(echo_data, ECHO_BYTES);
+  ASSERT(0 == uv_write(&big_write_req,
+                       (uv_stream_t*) &pipes[0],
+                       &buf,
+                       1,
+                       cancelled_write_cb));
+  ASSERT(0 != uv_run(&loop, UV_RUN_NOWAIT));
+  ASSERT(write_cb_called == 0);
+
+  uv_close((uv_handle_t*) &pipes[0], NULL);
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(write_cb_called == 1);
+
+  ASSERT(0 == close(fds[1]));
+  ASSERT(0 == uv_loop_close(&loop));
+  free(echo_data);
+  return 0;
+}
+
+#else
+
+TEST_IMPL(io_uring_tcp_ping_pong) {
+  RETURN_SKIP("io_uring is Linux only.");
+}
+
+TEST_IMPL(io_uring_poll_level_triggered) {
+  RETURN_SKIP("io_uring is Linux only.");
+}
+
+TEST_IMPL(io_uring_poll_fd_reuse) {
+  RETURN_SKIP("io_uring is Linux only.");
+}
+
+TEST_IMPL(io_uring_poll_close_many) {
+  RETURN_SKIP("io_uring is Linux only.");
+}
+
+TEST_IMPL(io_uring_fork) {
+  RETURN_SKIP("io_uring is Linux only.");
+}
+
+TEST_IMPL(io_uring_streams_echo) {
+  RETURN_SKIP("io_uring is Linux only.");
+}
+
+TEST_IMPL(io_uring_streams_pipe_read_stop) {
+  RETURN_SKIP("io_uring is Linux only.");
+}
+
+TEST_IMPL(io_uring_streams_accept_later) {
+  RETURN_SKIP("io_uring is Linux only.");
+}
+
+TEST_IMPL(io_uring_streams_close_writing) {
+  RETURN_SKIP("io_uring is Linux only.");
+}
+
+#endif  /* __linux__ */
@@ -26,6 +26,9 @@ TEST_DECLARE   (callback_order)
 TEST_DECLARE   (close_order)
 TEST_DECLARE   (run_once)
 TEST_DECLARE   (run_nowait)
+TEST_DECLARE   (run_budget_callbacks)
+TEST_DECLARE   (run_budget_time)
+TEST_DECLARE   (run_budget_io)
 TEST_DECLARE   (loop_alive)
 TEST_DECLARE   (loop_close)
 TEST_DECLARE   (loop_instant_close)
@@ -126,6 +129,28 @@ TEST_DECLARE   (tcp_bind_invalid_flags)
 TEST_DECLARE   (tcp_bind_writable_flags)
 TEST_DECLARE   (tcp_listen_without_bind)
 TEST_DECLARE   (tcp_connect_error_fault)
+TEST_DECLARE   (tcp_connect_addrinfo_blackhole)
+TEST_DECLARE   (tcp_connect_addrinfo_refused)
+TEST_DECLARE   (tcp_connect_addrinfo_fail)
+TEST_DECLARE   (tcp_connect_addrinfo_close)
+TEST_DECLARE   (io_uring_tcp_ping_pong)
+TEST_DECLARE   (io_uring_poll_level_triggered)
+TEST_DECLARE   (io_uring_poll_fd_reuse)
+TEST_DECLARE   (io_uring_poll_close_many)
+TEST_DECLARE   (io_uring_fork)
+TEST_DECLARE   (io_uring_streams_echo)
+TEST_DECLARE   (io_uring_streams_pipe_read_stop)
+TEST_DECLARE   (io_uring_streams_accept_later)
+TEST_DECLARE   (io_uring_streams_close_writing)
+TEST_DECLARE   (epoll_edge_configure)
+TEST_DECLARE   (epoll_edge_read_stop_start)
+TEST_DECLARE   (epoll_edge_read_starvation)
+TEST_DECLARE   (epoll_edge_write_full)
+TEST_DECLARE   (busy_poll_configure)
+TEST_DECLARE   (busy_poll_idle_backoff)
+TEST_DECLARE   (busy_poll_active)
+TEST_DECLARE   (poll_batch_configure)
+TEST_DECLARE   (poll_batch_adapt)
 TEST_DECLARE   (tcp_connect_timeout)
 TEST_DECLARE   (tcp_local_connect_timeout)
 TEST_DECLARE   (tcp6_local_connect_timeout)
@@ -227,6 +252,11 @@ TEST_DECLARE   (loop_handles)
 TEST_DECLARE   (get_loadavg)
 TEST_DECLARE   (walk_handles)
 TEST_DECLARE   (watcher_cross_stop)
+TEST_DECLARE   (watchdog_stall)
+TEST_DECLARE   (watchdog_start_stop)
+TEST_DECLARE   (trace_configure)
+TEST_DECLARE   (trace_events)
+TEST_DECLARE   (trace_wrap)
 TEST_DECLARE   (ref)
 TEST_DECLARE   (idle_ref)
 TEST_DECLARE   (async_ref)
@@ -236,8 +266,7 @@ TEST_DECLARE   (unref_in_prepare_cb)
 TEST_DECLARE   (timer_ref)
 TEST_DECLARE   (timer_ref2)
 TEST_DECLARE   (fs_event_ref)
-// TODO(chengzhong.wcz): support uv_fs_poll_t in aio;
-// TEST_DECLARE   (fs_poll_ref)
+TEST_DECLARE   (fs_poll_ref)
 TEST_DECLARE   (tcp_ref)
 TEST_DECLARE   (tcp_ref2)
 TEST_DECLARE   (tcp_ref2b)
@@ -262,6 +291,7 @@ TEST_DECLARE   (active)
 TEST_DECLARE   (embed)
 TEST_DECLARE   (async)
 TEST_DECLARE   (async_null_cb)
+TEST_DECLARE   (async_pending_close)
 TEST_DECLARE   (eintr_handling)
 TEST_DECLARE   (get_currentexe)
 TEST_DECLARE   (process_title)
@@ -274,14 +304,20 @@ TEST_DECLARE   (handle_fileno)
 TEST_DECLARE   (homedir)
 TEST_DECLARE   (tmpdir)
 TEST_DECLARE   (hrtime)
-// TODO(chengzhong.wcz): aio getaddrinfo.
-// TEST_DECLARE   (getaddrinfo_fail)
+TEST_DECLARE   (getaddrinfo_fail)
 TEST_DECLARE   (getaddrinfo_fail_sync)
-// TEST_DECLARE   (getaddrinfo_basic)
+TEST_DECLARE   (getaddrinfo_basic)
 TEST_DECLARE   (getaddrinfo_basic_sync)
-// TEST_DECLARE   (getaddrinfo_concurrent)
+TEST_DECLARE   (getaddrinfo_concurrent)
+TEST_DECLARE   (dns_resolve)
+TEST_DECLARE   (dns_timeout_cancel)
+TEST_DECLARE   (dns_failover)
+TEST_DECLARE   (dns_cache)
+TEST_DECLARE   (dns_cache_threadpool)
+TEST_DECLARE   (dns_cache_stale)
+TEST_DECLARE   (dns_getnameinfo)
 TEST_DECLARE   (gethostname)
-// TEST_DECLARE   (getnameinfo_basic_ip4)
+TEST_DECLARE   (getnameinfo_basic_ip4)
 TEST_DECLARE   (getnameinfo_basic_ip4_sync)
 // TEST_DECLARE   (getnameinfo_basic_ip6)
 TEST_DECLARE   (getsockname_tcp)
@@ -318,13 +354,13 @@ TEST_DECLARE   (spawn_reads_child_path)
 TEST_DECLARE   (spawn_inherit_streams)
 TEST_DECLARE   (spawn_quoted_path)
 TEST_DECLARE   (spawn_tcp_server)
-// TODO(chengzhong.wcz): support uv_fs_poll_t in aio;
-// TEST_DECLARE   (fs_poll)
-// TEST_DECLARE   (fs_poll_getpath)
-// TEST_DECLARE   (fs_poll_close_request)
-// TEST_DECLARE   (fs_poll_close_request_multi_start_stop)
-// TEST_DECLARE   (fs_poll_close_request_multi_stop_start)
-// TEST_DECLARE   (fs_poll_close_request_stop_when_active)
+TEST_DECLARE   (fs_poll)
+TEST_DECLARE   (fs_poll_getpath)
+TEST_DECLARE   (fs_poll_close_request)
+TEST_DECLARE   (fs_poll_close_request_multi_start_stop)
+TEST_DECLARE   (fs_poll_close_request_multi_stop_start)
+TEST_DECLARE   (fs_poll_close_request_stop_when_active)
+TEST_DECLARE   (fs_poll_many)
 TEST_DECLARE   (kill)
 TEST_DECLARE   (kill_invalid_signum)
 TEST_DECLARE   (fs_file_noent)
@@ -333,25 +369,25 @@ TEST_DECLARE   (fs_file_loop)
 TEST_DECLARE   (fs_file_async)
 TEST_DECLARE   (fs_file_sync)
 TEST_DECLARE   (fs_file_write_null_buffer)
-// TEST_DECLARE   (fs_async_dir)
-// TEST_DECLARE   (fs_async_sendfile)
+TEST_DECLARE   (fs_async_dir)
+TEST_DECLARE   (fs_async_sendfile)
 TEST_DECLARE   (fs_async_sendfile_nodata)
 TEST_DECLARE   (fs_mkdtemp)
 TEST_DECLARE   (fs_mkstemp)
 TEST_DECLARE   (fs_fstat)
 TEST_DECLARE   (fs_access)
 TEST_DECLARE   (fs_chmod)
-// TEST_DECLARE   (fs_copyfile)
-// TEST_DECLARE   (fs_unlink_readonly)
+TEST_DECLARE   (fs_copyfile)
+TEST_DECLARE   (fs_unlink_readonly)
 #ifdef _WIN32
 TEST_DECLARE   (fs_unlink_archive_readonly)
 #endif
-// TEST_DECLARE   (fs_chown)
-// TEST_DECLARE   (fs_link)
-// TEST_DECLARE   (fs_readlink)
-// TEST_DECLARE   (fs_realpath)
-// TEST_DECLARE   (fs_symlink)
-// TEST_DECLARE   (fs_symlink_dir)
+TEST_DECLARE   (fs_chown)
+TEST_DECLARE   (fs_link)
+TEST_DECLARE   (fs_readlink)
+TEST_DECLARE   (fs_realpath)
+TEST_DECLARE   (fs_symlink)
+TEST_DECLARE   (fs_symlink_dir)
 #ifdef _WIN32
 TEST_DECLARE   (fs_symlink_junction)
 TEST_DECLARE   (fs_non_symlink_reparse_point)
@@ -361,12 +397,12 @@ TEST_DECLARE   (fs_open_flags)
 #if defined(_WIN32) && !defined(USING_UV_SHARED)
 TEST_DECLARE   (fs_fd_hash)
 #endif
-// TEST_DECLARE   (fs_utime)
-// TEST_DECLARE   (fs_futime)
-// TEST_DECLARE   (fs_lutime)
+TEST_DECLARE   (fs_utime)
+TEST_DECLARE   (fs_futime)
+TEST_DECLARE   (fs_lutime)
 TEST_DECLARE   (fs_file_open_append)
-// TEST_DECLARE   (fs_statfs)
-// TEST_DECLARE   (fs_stat_missing_path)
+TEST_DECLARE   (fs_statfs)
+TEST_DECLARE   (fs_stat_missing_path)
 TEST_DECLARE   (fs_read_bufs)
 TEST_DECLARE   (fs_read_file_eof)
 TEST_DECLARE   (fs_event_watch_dir)
@@ -390,15 +426,15 @@ TEST_DECLARE   (fs_event_close_in_callback)
 TEST_DECLARE   (fs_event_start_and_close)
 TEST_DECLARE   (fs_event_error_reporting)
 TEST_DECLARE   (fs_event_getpath)
-// TEST_DECLARE   (fs_scandir_empty_dir)
-// TEST_DECLARE   (fs_scandir_non_existent_dir)
-// TEST_DECLARE   (fs_scandir_file)
-// TEST_DECLARE   (fs_open_dir)
-// TEST_DECLARE   (fs_readdir_empty_dir)
-// TEST_DECLARE   (fs_readdir_file)
-// TEST_DECLARE   (fs_readdir_non_empty_dir)
-// TEST_DECLARE   (fs_readdir_non_existing_dir)
-// TEST_DECLARE   (fs_rename_to_existing_file)
+TEST_DECLARE   (fs_scandir_empty_dir)
+TEST_DECLARE   (fs_scandir_non_existent_dir)
+TEST_DECLARE   (fs_scandir_file)
+TEST_DECLARE   (fs_open_dir)
+TEST_DECLARE   (fs_readdir_empty_dir)
+TEST_DECLARE   (fs_readdir_file)
+TEST_DECLARE   (fs_readdir_non_empty_dir)
+TEST_DECLARE   (fs_readdir_non_existing_dir)
+TEST_DECLARE   (fs_rename_to_existing_file)
 TEST_DECLARE   (fs_write_multiple_bufs)
 TEST_DECLARE   (fs_read_write_null_arguments)
 TEST_DECLARE   (get_osfhandle_valid_handle)
@@ -410,7 +446,7 @@ TEST_DECLARE   (fs_partial_read)
 TEST_DECLARE   (fs_partial_write)
 TEST_DECLARE   (fs_file_pos_after_op_with_offset)
 TEST_DECLARE   (fs_null_req)
-// TEST_DECLARE   (fs_read_dir)
+TEST_DECLARE   (fs_read_dir)
 #ifdef _WIN32
 TEST_DECLARE   (fs_file_pos_write)
 TEST_DECLARE   (fs_file_pos_append)
@@ -421,17 +457,26 @@ TEST_DECLARE   (fs_fchmod_archive_readonly)
 TEST_DECLARE   (fs_invalid_mkdir_name)
 #endif
 TEST_DECLARE   (fs_get_system_error)
+TEST_DECLARE   (fs_fallocate)
+TEST_DECLARE   (fs_writer_basic)
+TEST_DECLARE   (fs_writer_flush)
+TEST_DECLARE   (fs_writer_backpressure)
+TEST_DECLARE   (fs_writer_delay)
 TEST_DECLARE   (strscpy)
-// TODO(chengzhong.wcz): work out a solution on threadpool.
-// TEST_DECLARE   (threadpool_queue_work_simple)
-// TEST_DECLARE   (threadpool_queue_work_einval)
-// TEST_DECLARE   (threadpool_multiple_event_loops)
-// TEST_DECLARE   (threadpool_cancel_getaddrinfo)
-// TEST_DECLARE   (threadpool_cancel_getnameinfo)
-// TEST_DECLARE   (threadpool_cancel_random)
-// TEST_DECLARE   (threadpool_cancel_work)
-// TEST_DECLARE   (threadpool_cancel_fs)
-// TEST_DECLARE   (threadpool_cancel_single)
+TEST_DECLARE   (threadpool_queue_work_simple)
+TEST_DECLARE   (threadpool_queue_work_einval)
+TEST_DECLARE   (threadpool_loop_private)
+TEST_DECLARE   (threadpool_limits)
+TEST_DECLARE   (threadpool_work_metrics)
+TEST_DECLARE   (threadpool_priority)
+TEST_DECLARE   (threadpool_priority_deadline_normal)
+TEST_DECLARE   (threadpool_multiple_event_loops)
+TEST_DECLARE   (threadpool_cancel_getaddrinfo)
+TEST_DECLARE   (threadpool_cancel_getnameinfo)
+TEST_DECLARE   (threadpool_cancel_random)
+TEST_DECLARE   (threadpool_cancel_work)
+TEST_DECLARE   (threadpool_cancel_fs)
+TEST_DECLARE   (threadpool_cancel_single)
 TEST_DECLARE   (thread_local_storage)
 TEST_DECLARE   (thread_stack_size)
 TEST_DECLARE   (thread_stack_size_explicit)
@@ -499,9 +544,10 @@ HELPER_DECLARE (pipe_echo_server)
 
 TEST_DECLARE   (queue_foreach_delete)
 
-// TODO(chengzhong.wcz): find a way to get random async.
-// TEST_DECLARE   (random_async)
+TEST_DECLARE   (random_async)
+TEST_DECLARE   (random_async_next_tick)
 TEST_DECLARE   (random_sync)
+TEST_DECLARE   (random_chacha20_vector)
 
 TEST_DECLARE   (handle_type_name)
 TEST_DECLARE   (req_type_name)
@@ -513,6 +559,7 @@ TEST_DECLARE  (fork_socketpair)
 TEST_DECLARE  (fork_socketpair_started)
 TEST_DECLARE  (fork_signal_to_child)
 TEST_DECLARE  (fork_signal_to_child_closed)
+TEST_DECLARE  (fork_random)
 #ifndef __APPLE__ /* This is forbidden in a fork child: The process has forked
                      and you cannot use this CoreFoundation functionality
                      safely. You MUST exec(). */
@@ -522,8 +569,7 @@ TEST_DECLARE  (fork_fs_events_file_parent_child)
 TEST_DECLARE  (fork_fs_file_async)
 #endif
 #ifndef __MVS__
-// TODO(chengzhong.wcz): work out a solution on threadpool.
-// TEST_DECLARE  (fork_threadpool_queue_work_simple)
+TEST_DECLARE  (fork_threadpool_queue_work_simple)
 #endif
 #endif
 
@@ -534,6 +580,9 @@ TEST_DECLARE  (uname)
 TEST_DECLARE  (metrics_idle_time)
 TEST_DECLARE  (metrics_idle_time_thread)
 TEST_DECLARE  (metrics_idle_time_zero)
+TEST_DECLARE  (metrics_epoll_ctl_elided)
+TEST_DECLARE  (metrics_loop_phases)
+TEST_DECLARE  (metrics_syscalls)
 
 TASK_LIST_START
   TEST_ENTRY_CUSTOM (platform_output, 0, 1, 5000)
@@ -545,6 +594,9 @@ TASK_LIST_START
   TEST_ENTRY  (close_order)
   TEST_ENTRY  (run_once)
   TEST_ENTRY  (run_nowait)
+  TEST_ENTRY  (run_budget_callbacks)
+  TEST_ENTRY  (run_budget_time)
+  TEST_ENTRY  (run_budget_io)
   TEST_ENTRY  (loop_alive)
   TEST_ENTRY  (loop_close)
   TEST_ENTRY  (loop_instant_close)
@@ -689,6 +741,29 @@ TASK_LIST_START
   TEST_ENTRY  (tcp_bind_writable_flags)
   TEST_ENTRY  (tcp_listen_without_bind)
   TEST_ENTRY  (tcp_connect_error_fault)
+  TEST_ENTRY  (tcp_connect_addrinfo_blackhole)
+  TEST_ENTRY  (tcp_connect_addrinfo_refused)
+  TEST_ENTRY  (tcp_connect_addrinfo_fail)
+  TEST_ENTRY  (tcp_connect_addrinfo_close)
+
+  TEST_ENTRY  (io_uring_tcp_ping_pong)
+  TEST_ENTRY  (io_uring_poll_level_triggered)
+  TEST_ENTRY  (io_uring_poll_fd_reuse)
+  TEST_ENTRY  (io_uring_poll_close_many)
+  TEST_ENTRY  (io_uring_fork)
+  TEST_ENTRY  (io_uring_streams_echo)
+  TEST_ENTRY  (io_uring_streams_pipe_read_stop)
+  TEST_ENTRY  (io_uring_streams_accept_later)
+  TEST_ENTRY  (io_uring_streams_close_writing)
+  TEST_ENTRY  (epoll_edge_configure)
+  TEST_ENTRY  (epoll_edge_read_stop_start)
+  TEST_ENTRY  (epoll_edge_read_starvation)
+  TEST_ENTRY  (epoll_edge_write_full)
+  TEST_ENTRY  (busy_poll_configure)
+  TEST_ENTRY  (busy_poll_idle_backoff)
+  TEST_ENTRY  (busy_poll_active)
+  TEST_ENTRY  (poll_batch_configure)
+  TEST_ENTRY  (poll_batch_adapt)
   TEST_ENTRY  (tcp_connect_timeout)
   TEST_ENTRY  (tcp_local_connect_timeout)
   TEST_ENTRY  (tcp6_local_connect_timeout)
@@ -805,8 +880,7 @@ TASK_LIST_START
 
   TEST_ENTRY  (ref)
   TEST_ENTRY  (idle_ref)
-  // TODO(chengzhong.wcz): support uv_fs_poll_t in aio;
-  // TEST_ENTRY  (fs_poll_ref)
+  TEST_ENTRY  (fs_poll_ref)
   TEST_ENTRY  (async_ref)
   TEST_ENTRY  (prepare_ref)
   TEST_ENTRY  (check_ref)
@@ -840,12 +914,20 @@ TASK_LIST_START
 
   TEST_ENTRY  (watcher_cross_stop)
 
+  TEST_ENTRY  (watchdog_stall)
+  TEST_ENTRY  (watchdog_start_stop)
+
+  TEST_ENTRY  (trace_configure)
+  TEST_ENTRY  (trace_events)
+  TEST_ENTRY  (trace_wrap)
+
   TEST_ENTRY  (active)
 
   TEST_ENTRY  (embed)
 
   TEST_ENTRY  (async)
   TEST_ENTRY  (async_null_cb)
+  TEST_ENTRY  (async_pending_close)
   TEST_ENTRY  (eintr_handling)
 
   TEST_ENTRY  (get_currentexe)
@@ -870,17 +952,24 @@ TASK_LIST_START
 
   TEST_ENTRY_CUSTOM (hrtime, 0, 0, 20000)
 
-  // TODO(chengzhong.wcz): aio getaddrinfo.
-  // TEST_ENTRY_CUSTOM (getaddrinfo_fail, 0, 0, 10000)
+  TEST_ENTRY_CUSTOM (getaddrinfo_fail, 0, 0, 10000)
   TEST_ENTRY_CUSTOM (getaddrinfo_fail_sync, 0, 0, 10000)
 
-  // TEST_ENTRY  (getaddrinfo_basic)
+  TEST_ENTRY  (getaddrinfo_basic)
   TEST_ENTRY  (getaddrinfo_basic_sync)
-  // TEST_ENTRY  (getaddrinfo_concurrent)
+  TEST_ENTRY  (getaddrinfo_concurrent)
+
+  TEST_ENTRY  (dns_resolve)
+  TEST_ENTRY  (dns_timeout_cancel)
+  TEST_ENTRY  (dns_failover)
+  TEST_ENTRY  (dns_cache)
+  TEST_ENTRY  (dns_cache_threadpool)
+  TEST_ENTRY  (dns_cache_stale)
+  TEST_ENTRY  (dns_getnameinfo)
 
   TEST_ENTRY  (gethostname)
 
-  // TEST_ENTRY  (getnameinfo_basic_ip4)
+  TEST_ENTRY  (getnameinfo_basic_ip4)
   TEST_ENTRY  (getnameinfo_basic_ip4_sync)
   // TEST_ENTRY  (getnameinfo_basic_ip6)
 
@@ -934,13 +1023,13 @@ TASK_LIST_START
   TEST_ENTRY  (spawn_inherit_streams)
   TEST_ENTRY  (spawn_quoted_path)
   TEST_ENTRY  (spawn_tcp_server)
-  // TODO(chengzhong.wcz): support uv_fs_poll_t in aio;
-  // TEST_ENTRY  (fs_poll)
-  // TEST_ENTRY  (fs_poll_getpath)
-  // TEST_ENTRY  (fs_poll_close_request)
-  // TEST_ENTRY  (fs_poll_close_request_multi_start_stop)
-  // TEST_ENTRY  (fs_poll_close_request_multi_stop_start)
-  // TEST_ENTRY  (fs_poll_close_request_stop_when_active)
+  TEST_ENTRY  (fs_poll)
+  TEST_ENTRY  (fs_poll_getpath)
+  TEST_ENTRY  (fs_poll_close_request)
+  TEST_ENTRY  (fs_poll_close_request_multi_start_stop)
+  TEST_ENTRY  (fs_poll_close_request_multi_stop_start)
+  TEST_ENTRY  (fs_poll_close_request_stop_when_active)
+  TEST_ENTRY  (fs_poll_many)
   TEST_ENTRY  (kill)
   TEST_ENTRY  (kill_invalid_signum)
 
@@ -984,28 +1073,27 @@ TASK_LIST_START
   TEST_ENTRY  (fs_file_async)
   TEST_ENTRY  (fs_file_sync)
   TEST_ENTRY  (fs_file_write_null_buffer)
-  // TODO(chengzhong.wcz): support various fs ops in aio;
-  // TEST_ENTRY  (fs_async_dir)
-  // TEST_ENTRY  (fs_async_sendfile)
-  // TEST_ENTRY  (fs_async_sendfile_nodata)
-  // TEST_ENTRY  (fs_mkdtemp)
-  // TEST_ENTRY  (fs_mkstemp)
-  // TEST_ENTRY  (fs_fstat)
-  // TEST_ENTRY  (fs_access)
-  // TEST_ENTRY  (fs_chmod)
-  // TEST_ENTRY  (fs_copyfile)
-  // TEST_ENTRY  (fs_unlink_readonly)
+  TEST_ENTRY  (fs_async_dir)
+  TEST_ENTRY  (fs_async_sendfile)
+  TEST_ENTRY  (fs_async_sendfile_nodata)
+  TEST_ENTRY  (fs_mkdtemp)
+  TEST_ENTRY  (fs_mkstemp)
+  TEST_ENTRY  (fs_fstat)
+  TEST_ENTRY  (fs_access)
+  TEST_ENTRY  (fs_chmod)
+  TEST_ENTRY  (fs_copyfile)
+  TEST_ENTRY  (fs_unlink_readonly)
 #ifdef _WIN32
   TEST_ENTRY  (fs_unlink_archive_readonly)
 #endif
-  // TEST_ENTRY  (fs_chown)
-  // TEST_ENTRY  (fs_utime)
-  // TEST_ENTRY  (fs_futime)
-  // TEST_ENTRY  (fs_lutime)
-  // TEST_ENTRY  (fs_readlink)
-  // TEST_ENTRY  (fs_realpath)
-  // TEST_ENTRY  (fs_symlink)
-  // TEST_ENTRY  (fs_symlink_dir)
+  TEST_ENTRY  (fs_chown)
+  TEST_ENTRY  (fs_utime)
+  TEST_ENTRY  (fs_futime)
+  TEST_ENTRY  (fs_lutime)
+  TEST_ENTRY  (fs_readlink)
+  TEST_ENTRY  (fs_realpath)
+  TEST_ENTRY  (fs_symlink)
+  TEST_ENTRY  (fs_symlink_dir)
 #ifdef _WIN32
   TEST_ENTRY  (fs_symlink_junction)
   TEST_ENTRY  (fs_non_symlink_reparse_point)
@@ -1015,8 +1103,8 @@ TASK_LIST_START
 #if defined(_WIN32) && !defined(USING_UV_SHARED)
   TEST_ENTRY  (fs_fd_hash)
 #endif
-  // TEST_ENTRY  (fs_statfs)
-  // TEST_ENTRY  (fs_stat_missing_path)
+  TEST_ENTRY  (fs_statfs)
+  TEST_ENTRY  (fs_stat_missing_path)
   TEST_ENTRY  (fs_read_bufs)
   TEST_ENTRY  (fs_read_file_eof)
   TEST_ENTRY  (fs_file_open_append)
@@ -1041,15 +1129,15 @@ TASK_LIST_START
   TEST_ENTRY  (fs_event_start_and_close)
   TEST_ENTRY_CUSTOM (fs_event_error_reporting, 0, 0, 60000)
   TEST_ENTRY  (fs_event_getpath)
-  // TEST_ENTRY  (fs_scandir_empty_dir)
-  // TEST_ENTRY  (fs_scandir_non_existent_dir)
-  // TEST_ENTRY  (fs_scandir_file)
-  // TEST_ENTRY  (fs_open_dir)
-  // TEST_ENTRY  (fs_readdir_empty_dir)
-  // TEST_ENTRY  (fs_readdir_file)
-  // TEST_ENTRY  (fs_readdir_non_empty_dir)
-  // TEST_ENTRY  (fs_readdir_non_existing_dir)
-  // TEST_ENTRY  (fs_rename_to_existing_file)
+  TEST_ENTRY  (fs_scandir_empty_dir)
+  TEST_ENTRY  (fs_scandir_non_existent_dir)
+  TEST_ENTRY  (fs_scandir_file)
+  TEST_ENTRY  (fs_open_dir)
+  TEST_ENTRY  (fs_readdir_empty_dir)
+  TEST_ENTRY  (fs_readdir_file)
+  TEST_ENTRY  (fs_readdir_non_empty_dir)
+  TEST_ENTRY  (fs_readdir_non_existing_dir)
+  TEST_ENTRY  (fs_rename_to_existing_file)
   TEST_ENTRY  (fs_write_multiple_bufs)
   TEST_ENTRY  (fs_write_alotof_bufs)
   TEST_ENTRY  (fs_write_alotof_bufs_async)
@@ -1059,7 +1147,7 @@ TASK_LIST_START
   TEST_ENTRY  (fs_read_write_null_arguments)
   TEST_ENTRY  (fs_file_pos_after_op_with_offset)
   TEST_ENTRY  (fs_null_req)
-  // TEST_ENTRY  (fs_read_dir)
+  TEST_ENTRY  (fs_read_dir)
 #ifdef _WIN32
   TEST_ENTRY  (fs_file_pos_write)
   TEST_ENTRY  (fs_file_pos_append)
@@ -1070,19 +1158,28 @@ TASK_LIST_START
   TEST_ENTRY  (fs_invalid_mkdir_name)
 #endif
   TEST_ENTRY  (fs_get_system_error)
+  TEST_ENTRY  (fs_fallocate)
+  TEST_ENTRY  (fs_writer_basic)
+  TEST_ENTRY  (fs_writer_flush)
+  TEST_ENTRY  (fs_writer_backpressure)
+  TEST_ENTRY  (fs_writer_delay)
   TEST_ENTRY  (get_osfhandle_valid_handle)
   TEST_ENTRY  (open_osfhandle_valid_handle)
   TEST_ENTRY  (strscpy)
-  // TODO(chengzhong.wcz): work out a solution on threadpool.
-  // TEST_ENTRY  (threadpool_queue_work_simple)
-  // TEST_ENTRY  (threadpool_queue_work_einval)
-  // TEST_ENTRY_CUSTOM (threadpool_multiple_event_loops, 0, 0, 60000)
-  // TEST_ENTRY  (threadpool_cancel_getaddrinfo)
-  // TEST_ENTRY  (threadpool_cancel_getnameinfo)
-  // TEST_ENTRY  (threadpool_cancel_random)
-  // TEST_ENTRY  (threadpool_cancel_work)
-  // TEST_ENTRY  (threadpool_cancel_fs)
-  // TEST_ENTRY  (threadpool_cancel_single)
+  TEST_ENTRY  (threadpool_queue_work_simple)
+  TEST_ENTRY  (threadpool_queue_work_einval)
+  TEST_ENTRY  (threadpool_loop_private)
+  TEST_ENTRY  (threadpool_limits)
+  TEST_ENTRY  (threadpool_work_metrics)
+  TEST_ENTRY  (threadpool_priority)
+  TEST_ENTRY  (threadpool_priority_deadline_normal)
+  TEST_ENTRY_CUSTOM (threadpool_multiple_event_loops, 0, 0, 60000)
+  TEST_ENTRY  (threadpool_cancel_getaddrinfo)
+  TEST_ENTRY  (threadpool_cancel_getnameinfo)
+  TEST_ENTRY  (threadpool_cancel_random)
+  TEST_ENTRY  (threadpool_cancel_work)
+  TEST_ENTRY  (threadpool_cancel_fs)
+  TEST_ENTRY  (threadpool_cancel_single)
   TEST_ENTRY  (thread_local_storage)
   TEST_ENTRY  (thread_stack_size)
   TEST_ENTRY  (thread_stack_size_explicit)
@@ -1098,9 +1195,10 @@ TASK_LIST_START
 
   TEST_ENTRY  (queue_foreach_delete)
 
-  // TODO(chengzhong.wcz): find a way to get random async.
-  // TEST_ENTRY  (random_async)
+  TEST_ENTRY  (random_async)
+  TEST_ENTRY  (random_async_next_tick)
   TEST_ENTRY  (random_sync)
+  TEST_ENTRY  (random_chacha20_vector)
 
   TEST_ENTRY  (handle_type_name)
   TEST_ENTRY  (req_type_name)
@@ -1112,6 +1210,7 @@ TASK_LIST_START
   TEST_ENTRY  (fork_socketpair_started)
   TEST_ENTRY  (fork_signal_to_child)
   TEST_ENTRY  (fork_signal_to_child_closed)
+  TEST_ENTRY  (fork_random)
 #ifndef __APPLE__
   TEST_ENTRY  (fork_fs_events_child)
   TEST_ENTRY  (fork_fs_events_child_dir)
@@ -1119,8 +1218,7 @@ TASK_LIST_START
   TEST_ENTRY  (fork_fs_file_async)
 #endif
 #ifndef __MVS__
-  // TODO(chengzhong.wcz): work out a solution on threadpool.
-  // TEST_ENTRY  (fork_threadpool_queue_work_simple)
+  TEST_ENTRY  (fork_threadpool_queue_work_simple)
 #endif
 #endif
 
@@ -1135,6 +1233,9 @@ TASK_LIST_START
   TEST_ENTRY  (metrics_idle_time)
   TEST_ENTRY  (metrics_idle_time_thread)
   TEST_ENTRY  (metrics_idle_time_zero)
+  TEST_ENTRY  (metrics_epoll_ctl_elided)
+  TEST_ENTRY  (metrics_loop_phases)
+  TEST_ENTRY  (metrics_syscalls)
 
 #if 0
   /* These are for testing the test runner. */
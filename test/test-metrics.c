@@ -21,8 +21,14 @@
 
 #include "uv.h"
 #include "task.h"
+#include <stdlib.h>
 #include <string.h> /* memset */
 
+#ifndef _WIN32
+# include <sys/socket.h>
+# include <unistd.h>
+#endif
+
 #define UV_NS_TO_MS 1000000
 
 
@@ -133,3 +139,345 @@ TEST_IMPL(metrics_idle_time_zero) {
   MAKE_VALGRIND_HAPPY();
   return 0;
 }
+
+
+#ifndef _WIN32
+#define ELIDED_WRITES 4
+#define ELIDED_WRITE_SIZE (1024 * 1024)
+
+static uv_pipe_t elided_writer;
+static uv_pipe_t elided_reader;
+static uv_write_t elided_write_req;
+static uv_timer_t elided_timer;
+static uv_idle_t elided_idle;
+static char* elided_buf;
+static int elided_writes;
+static size_t elided_read;
+
+static void elided_write_cb(uv_write_t* req, int status);
+
+
+static void elided_alloc_cb(uv_handle_t* handle,
+                            size_t suggested_size,
+                            uv_buf_t* buf) {
+  static char slab[65536];
+  buf->base = slab;
+  buf->len = sizeof(slab);
+}
+
+
+static void elided_read_cb(uv_stream_t* stream,
+                           ssize_t nread,
+                           const uv_buf_t* buf) {
+  ASSERT_GE(nread, 0);
+  elided_read += nread;
+}
+
+
+static void elided_timer_cb(uv_timer_t* handle) {
+  uint64_t elided;
+
+  elided = uv_metrics_epoll_ctl_elided(handle->loop);
+#if defined(__linux__)
+  /* The writer stops waiting for POLLOUT after each write and starts again
+   * before the loop polls, that costs nothing. The last stop is caught up on
+   * when the kernel reports POLLOUT again.
+   */
+  ASSERT_EQ(elided, ELIDED_WRITES - 1);
+#else
+  ASSERT_EQ(elided, 0);
+#endif
+
+  ASSERT_EQ(elided_read, (size_t) ELIDED_WRITES * ELIDED_WRITE_SIZE);
+  uv_close((uv_handle_t*) &elided_writer, NULL);
+  uv_close((uv_handle_t*) &elided_reader, NULL);
+  uv_close((uv_handle_t*) &elided_idle, NULL);
+  uv_close((uv_handle_t*) handle, NULL);
+}
+
+
+/* Runs before the loop polls again, like a response that took a moment. */
+static void elided_idle_cb(uv_idle_t* handle) {
+  uv_buf_t buf;
+
+  ASSERT_EQ(0, uv_idle_stop(handle));
+
+  /* Bigger than the socket buffer, waits for POLLOUT again. */
+  buf = uv_buf_init(elided_buf, ELIDED_WRITE_SIZE);
+  ASSERT_EQ(0, uv_write(&elided_write_req, (uv_stream_t*) &elided_writer,
+                        &buf, 1, elided_write_cb));
+}
+
+
+static void elided_write_cb(uv_write_t* req, int status) {
+  ASSERT_EQ(0, status);
+
+  if (++elided_writes == ELIDED_WRITES)
+    ASSERT_EQ(0, uv_timer_start(&elided_timer, elided_timer_cb, 100, 0));
+  else
+    ASSERT_EQ(0, uv_idle_start(&elided_idle, elided_idle_cb));
+}
+#endif
+
+
+TEST_IMPL(metrics_epoll_ctl_elided) {
+#ifdef _WIN32
+  RETURN_SKIP("No socketpair on windows");
+#else
+  uv_loop_t* loop;
+  uv_buf_t buf;
+  int fds[2];
+
+  loop = uv_default_loop();
+  ASSERT_EQ(0, uv_metrics_epoll_ctl_elided(loop));
+
+  elided_buf = malloc(ELIDED_WRITE_SIZE);
+  ASSERT_NOT_NULL(elided_buf);
+  memset(elided_buf, 'x', ELIDED_WRITE_SIZE);
+
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  ASSERT_EQ(0, uv_pipe_init(loop, &elided_writer, 0));
+  ASSERT_EQ(0, uv_pipe_init(loop, &elided_reader, 0));
+  ASSERT_EQ(0, uv_pipe_open(&elided_writer, fds[0]));
+  ASSERT_EQ(0, uv_pipe_open(&elided_reader, fds[1]));
+  ASSERT_EQ(0, uv_timer_init(loop, &elided_timer));
+  ASSERT_EQ(0, uv_idle_init(loop, &elided_idle));
+
+  /* The writer keeps waiting for POLLIN, its interest shrinks back to that
+   * after each write.
+   */
+  ASSERT_EQ(0, uv_read_start((uv_stream_t*) &elided_writer,
+                             elided_alloc_cb,
+                             elided_read_cb));
+  ASSERT_EQ(0, uv_read_start((uv_stream_t*) &elided_reader,
+                             elided_alloc_cb,
+                             elided_read_cb));
+
+  buf = uv_buf_init(elided_buf, ELIDED_WRITE_SIZE);
+  ASSERT_EQ(0, uv_write(&elided_write_req, (uv_stream_t*) &elided_writer,
+                        &buf, 1, elided_write_cb));
+
+  ASSERT_EQ(0, uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT_EQ(elided_writes, ELIDED_WRITES);
+
+  free(elided_buf);
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+#endif
+}
+
+
+#define PHASES_TIMERS 3
+#define PHASES_SPIN 20  /* ms */
+
+static uv_timer_t phases_timer;
+static uv_check_t phases_check;
+static int phases_timer_cb_called;
+static int phases_check_cb_called;
+static int phases_poll_cb_called;
+#ifndef _WIN32
+static uv_poll_t phases_poll;
+#endif
+
+
+static void phases_timer_cb(uv_timer_t* handle) {
+  uint64_t t;
+
+  t = uv_hrtime();
+  while (uv_hrtime() - t < PHASES_SPIN * UV_NS_TO_MS) { }
+
+  if (++phases_timer_cb_called < PHASES_TIMERS)
+    return;
+
+  uv_close((uv_handle_t*) handle, NULL);
+  uv_close((uv_handle_t*) &phases_check, NULL);
+}
+
+
+static void phases_check_cb(uv_check_t* handle) {
+  phases_check_cb_called++;
+}
+
+
+#ifndef _WIN32
+static void phases_poll_cb(uv_poll_t* handle, int status, int events) {
+  ASSERT_EQ(0, status);
+  phases_poll_cb_called++;
+  uv_close((uv_handle_t*) handle, NULL);
+}
+#endif
+
+
+static uint64_t histogram_sum(const uint64_t* histogram) {
+  uint64_t sum;
+  int i;
+
+  sum = 0;
+  for (i = 0; i < UV_METRICS_HISTOGRAM_SIZE; i++)
+    sum += histogram[i];
+
+  return sum;
+}
+
+
+TEST_IMPL(metrics_loop_phases) {
+  uv_metrics_t metrics;
+  uv_loop_t* loop;
+  uint64_t callbacks;
+  int fds[2];
+  int r;
+
+  loop = uv_default_loop();
+  ASSERT_EQ(0, uv_metrics_info(loop, &metrics));
+  ASSERT_EQ(0, metrics.loop_count);
+  ASSERT_EQ(UV_EINVAL, uv_metrics_info(loop, NULL));
+
+  r = uv_loop_configure(loop, UV_METRICS_LOOP_PHASES);
+  if (r == UV_ENOSYS)
+    RETURN_SKIP("UV_METRICS_LOOP_PHASES is not available.");
+  ASSERT_EQ(0, r);
+
+  ASSERT_EQ(0, uv_timer_init(loop, &phases_timer));
+  ASSERT_EQ(0, uv_timer_start(&phases_timer, phases_timer_cb, 10, 10));
+  ASSERT_EQ(0, uv_check_init(loop, &phases_check));
+  ASSERT_EQ(0, uv_check_start(&phases_check, phases_check_cb));
+
+#ifndef _WIN32
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  ASSERT_EQ(1, write(fds[1], "!", 1));
+  ASSERT_EQ(0, uv_poll_init(loop, &phases_poll, fds[0]));
+  ASSERT_EQ(0, uv_poll_start(&phases_poll, UV_READABLE, phases_poll_cb));
+#else
+  (void) fds;
+  phases_poll_cb_called = 1;
+#endif
+
+  ASSERT_EQ(0, uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT_EQ(PHASES_TIMERS, phases_timer_cb_called);
+  ASSERT_EQ(1, phases_poll_cb_called);
+
+  ASSERT_EQ(0, uv_metrics_info(loop, &metrics));
+  ASSERT_GT(metrics.loop_count, PHASES_TIMERS);
+
+  /* Each timer, check and poll callback, and none for the closes. */
+  callbacks = PHASES_TIMERS + phases_check_cb_called + 1;
+  ASSERT_EQ(metrics.callbacks, callbacks);
+  ASSERT_EQ(metrics.events, 1);
+  ASSERT_EQ(histogram_sum(metrics.callback_histogram), callbacks);
+  ASSERT_EQ(histogram_sum(metrics.loop_histogram), metrics.loop_count);
+  ASSERT_EQ(histogram_sum(metrics.events_histogram), metrics.loop_count);
+
+  /* The timers spin, the loop is otherwise idle. Waiting for the timers
+   * isn't time spent in the poll phase.
+   */
+  ASSERT_GE(metrics.max_callback_time, PHASES_SPIN * UV_NS_TO_MS);
+  ASSERT_GE(metrics.phase_time[UV_METRICS_PHASE_TIMERS],
+            PHASES_TIMERS * PHASES_SPIN * UV_NS_TO_MS);
+  ASSERT_LT(metrics.phase_time[UV_METRICS_PHASE_POLL],
+            metrics.phase_time[UV_METRICS_PHASE_TIMERS]);
+  ASSERT_GT(metrics.loop_histogram[15], 0);  /* 16 ms to 32 ms. */
+
+#ifndef _WIN32
+  ASSERT_EQ(0, close(fds[0]));
+  ASSERT_EQ(0, close(fds[1]));
+#endif
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+#ifndef _WIN32
+static uv_pipe_t syscalls_reader;
+static uv_pipe_t syscalls_writer;
+static uv_write_t syscalls_write_req;
+static uv_async_t syscalls_async;
+static char syscalls_buf[16];
+static int syscalls_read_cb_called;
+static int syscalls_async_cb_called;
+
+
+static void syscalls_alloc_cb(uv_handle_t* handle,
+                              size_t size,
+                              uv_buf_t* buf) {
+  *buf = uv_buf_init(syscalls_buf, sizeof(syscalls_buf));
+}
+
+
+static void syscalls_read_cb(uv_stream_t* stream,
+                             ssize_t nread,
+                             const uv_buf_t* buf) {
+  ASSERT_EQ(nread, 5);
+  syscalls_read_cb_called++;
+  uv_close((uv_handle_t*) &syscalls_reader, NULL);
+  uv_close((uv_handle_t*) &syscalls_writer, NULL);
+}
+
+
+static void syscalls_async_cb(uv_async_t* handle) {
+  syscalls_async_cb_called++;
+  uv_close((uv_handle_t*) handle, NULL);
+}
+#endif
+
+
+TEST_IMPL(metrics_syscalls) {
+#ifdef _WIN32
+  uv_metrics_syscalls_t syscalls;
+
+  ASSERT_EQ(UV_ENOSYS, uv_metrics_syscalls(uv_default_loop(), &syscalls));
+  return 0;
+#else
+  uv_metrics_syscalls_t before;
+  uv_metrics_syscalls_t after;
+  uv_loop_t* loop;
+  uv_buf_t buf;
+  int fds[2];
+  int r;
+
+  loop = uv_default_loop();
+  r = uv_metrics_syscalls(loop, &before);
+  if (r == UV_ENOSYS)
+    RETURN_SKIP("Built without the system call counters.");
+  ASSERT_EQ(0, r);
+  ASSERT_EQ(UV_EINVAL, uv_metrics_syscalls(loop, NULL));
+
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  ASSERT_EQ(0, uv_pipe_init(loop, &syscalls_reader, 0));
+  ASSERT_EQ(0, uv_pipe_init(loop, &syscalls_writer, 0));
+  ASSERT_EQ(0, uv_pipe_open(&syscalls_reader, fds[0]));
+  ASSERT_EQ(0, uv_pipe_open(&syscalls_writer, fds[1]));
+  ASSERT_EQ(0, uv_read_start((uv_stream_t*) &syscalls_reader,
+                             syscalls_alloc_cb,
+                             syscalls_read_cb));
+
+  buf = uv_buf_init("hello", 5);
+  ASSERT_EQ(0, uv_write(&syscalls_write_req,
+                        (uv_stream_t*) &syscalls_writer,
+                        &buf,
+                        1,
+                        NULL));
+
+  ASSERT_EQ(0, uv_async_init(loop, &syscalls_async, syscalls_async_cb));
+  ASSERT_EQ(0, uv_async_send(&syscalls_async));
+  ASSERT_EQ(0, uv_async_send(&syscalls_async));  /* Coalesced, no write. */
+
+  ASSERT_EQ(0, uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT_EQ(1, syscalls_read_cb_called);
+  ASSERT_EQ(1, syscalls_async_cb_called);
+
+  ASSERT_EQ(0, uv_metrics_syscalls(loop, &after));
+  ASSERT_EQ(after.write - before.write, 1);
+  ASSERT_EQ(after.read - before.read, 1);
+  ASSERT_EQ(after.eventfd_write - before.eventfd_write, 1);
+  ASSERT_GE(after.eventfd_read - before.eventfd_read, 1);
+  ASSERT_EQ(after.accept, before.accept);
+#ifdef __linux__
+  ASSERT_GE(after.epoll_wait - before.epoll_wait, 1);
+  ASSERT_GE(after.epoll_ctl - before.epoll_ctl, 2);
+#endif
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+#endif
+}
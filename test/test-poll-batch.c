@@ -0,0 +1,156 @@
+/* Copyright libuv contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#ifdef __linux__
+
+#include <unistd.h>
+#include <sys/socket.h>
+
+#define NUM_READY 300
+#define BATCH_MAX 256
+#define BUSY_ROUNDS 8
+#define IDLE_ROUNDS 200
+
+static uv_loop_t loop;
+static uv_poll_t polls[NUM_READY + 1];
+static int fds[NUM_READY + 1][2];
+static uv_idle_t idle;
+static int poll_cb_called;
+static int idle_cb_called;
+static unsigned int busy_size;
+static unsigned int busy_repolls;
+
+
+TEST_IMPL(poll_batch_configure) {
+  unsigned int repolls;
+  unsigned int size;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(UV_EINVAL == uv_loop_configure(&loop, UV_LOOP_POLL_BATCH_MAX, 63u));
+  ASSERT(UV_EINVAL == uv_loop_configure(&loop,
+                                        UV_LOOP_POLL_BATCH_MAX,
+                                        1024u * 1024u + 1u));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_POLL_BATCH_MAX, 4096u));
+
+  /* Starts small, whatever the maximum. */
+  ASSERT(0 == uv_metrics_poll_batch(&loop, &size, &repolls));
+  ASSERT_EQ(size, 64);
+  ASSERT_EQ(repolls, 48 * 1024 / 64);
+
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+
+static void ready_cb(uv_poll_t* handle, int status, int events) {
+  ASSERT(status == 0);
+  ASSERT(events == UV_READABLE);
+  poll_cb_called++;
+}
+
+
+static void idle_cb(uv_idle_t* handle) {
+  int i;
+
+  idle_cb_called++;
+
+  /* Every descriptor is readable each time around, the buffer has grown to
+   * the maximum by now.
+   */
+  if (idle_cb_called == BUSY_ROUNDS) {
+    ASSERT(0 == uv_metrics_poll_batch(&loop, &busy_size, &busy_repolls));
+    for (i = 0; i < NUM_READY; i++)
+      ASSERT(0 == uv_poll_stop(&polls[i]));
+  }
+
+  if (idle_cb_called == BUSY_ROUNDS + IDLE_ROUNDS) {
+    uv_close((uv_handle_t*) handle, NULL);
+    for (i = 0; i <= NUM_READY; i++)
+      uv_close((uv_handle_t*) &polls[i], NULL);
+  }
+}
+
+
+TEST_IMPL(poll_batch_adapt) {
+  unsigned int repolls;
+  unsigned int size;
+  int i;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_POLL_BATCH_MAX, BATCH_MAX));
+
+  /* NUM_READY descriptors that stay readable and one that never is, it keeps
+   * the loop polling once the others are stopped.
+   */
+  for (i = 0; i <= NUM_READY; i++) {
+    ASSERT(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds[i]));
+    if (i < NUM_READY)
+      ASSERT(1 == write(fds[i][1], "!", 1));
+    ASSERT(0 == uv_poll_init(&loop, &polls[i], fds[i][0]));
+    ASSERT(0 == uv_poll_start(&polls[i], UV_READABLE, ready_cb));
+  }
+
+  ASSERT(0 == uv_idle_init(&loop, &idle));
+  ASSERT(0 == uv_idle_start(&idle, idle_cb));
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(idle_cb_called == BUSY_ROUNDS + IDLE_ROUNDS);
+  ASSERT(poll_cb_called >= NUM_READY * (BUSY_ROUNDS - 1));
+
+  /* 64, 128, 256 and no further. */
+  ASSERT_EQ(busy_size, BATCH_MAX);
+  ASSERT_EQ(busy_repolls, 48 * 1024 / BATCH_MAX);
+
+  /* Back down after polls that find next to nothing. */
+  ASSERT(0 == uv_metrics_poll_batch(&loop, &size, &repolls));
+  ASSERT_EQ(size, 64);
+  ASSERT_EQ(repolls, 48 * 1024 / 64);
+
+  for (i = 0; i <= NUM_READY; i++) {
+    ASSERT(0 == close(fds[i][0]));
+    ASSERT(0 == close(fds[i][1]));
+  }
+
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+#else
+
+TEST_IMPL(poll_batch_configure) {
+  uv_loop_t loop;
+  unsigned int repolls;
+  unsigned int size;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(UV_ENOSYS == uv_loop_configure(&loop, UV_LOOP_POLL_BATCH_MAX, 64u));
+  ASSERT(UV_ENOSYS == uv_metrics_poll_batch(&loop, &size, &repolls));
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+TEST_IMPL(poll_batch_adapt) {
+  RETURN_SKIP("epoll is Linux only.");
+}
+
+#endif  /* __linux__ */
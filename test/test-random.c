@@ -24,6 +24,10 @@
 
 #include <string.h>
 
+#ifndef _WIN32
+#include "../src/unix/chacha20-inl.h"
+#endif
+
 static char scratch[256];
 static int random_cb_called;
 
@@ -75,6 +79,57 @@ TEST_IMPL(random_async) {
 }
 
 
+static uv_random_t tick_reqs[3];
+static char tick_bufs[3][64];
+static int tick_cb_called;
+
+
+static void tick_cb(uv_random_t* req, int status, void* buf, size_t buflen) {
+  ASSERT(0 == status);
+  ASSERT(buflen == sizeof(tick_bufs[0]));
+  tick_cb_called++;
+
+  /* Started from a callback, so done on the next loop iteration. */
+  if (req == &tick_reqs[0])
+    ASSERT(0 == uv_random(req->loop,
+                          &tick_reqs[2],
+                          tick_bufs[2],
+                          sizeof(tick_bufs[2]),
+                          0,
+                          tick_cb));
+}
+
+
+TEST_IMPL(random_async_next_tick) {
+  uv_loop_t* loop;
+  int i;
+
+  loop = uv_default_loop();
+
+  for (i = 0; i < 2; i++)
+    ASSERT(0 == uv_random(loop,
+                          &tick_reqs[i],
+                          tick_bufs[i],
+                          sizeof(tick_bufs[i]),
+                          0,
+                          tick_cb));
+  ASSERT(0 == tick_cb_called);
+
+  ASSERT(0 != uv_run(loop, UV_RUN_NOWAIT));
+  ASSERT(2 == tick_cb_called);
+
+  ASSERT(0 == uv_run(loop, UV_RUN_NOWAIT));
+  ASSERT(3 == tick_cb_called);
+
+  /* Consecutive requests don't see the same bytes. */
+  ASSERT(0 != memcmp(tick_bufs[0], tick_bufs[1], sizeof(tick_bufs[0])));
+  ASSERT(0 != memcmp(tick_bufs[1], tick_bufs[2], sizeof(tick_bufs[0])));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
 TEST_IMPL(random_sync) {
   char zero[256];
   char buf[256];
@@ -92,3 +147,36 @@ TEST_IMPL(random_sync) {
   MAKE_VALGRIND_HAPPY();
   return 0;
 }
+
+
+TEST_IMPL(random_chacha20_vector) {
+#ifdef _WIN32
+  RETURN_SKIP("The keystream pool is Unix only.");
+#else
+  /* RFC 8439, section 2.3.2. */
+  static const unsigned char expected[64] = {
+    0x10, 0xf1, 0xe7, 0xe4, 0xd1, 0x3b, 0x59, 0x15,
+    0x50, 0x0f, 0xdd, 0x1f, 0xa3, 0x20, 0x71, 0xc4,
+    0xc7, 0xd1, 0xf4, 0xc7, 0x33, 0xc0, 0x68, 0x03,
+    0x04, 0x22, 0xaa, 0x9a, 0xc3, 0xd4, 0x6c, 0x4e,
+    0xd2, 0x82, 0x64, 0x46, 0x07, 0x9f, 0xaa, 0x09,
+    0x14, 0xc2, 0xd7, 0x05, 0xd9, 0x8b, 0x02, 0xa2,
+    0xb5, 0x12, 0x9c, 0xd1, 0xde, 0x16, 0x4e, 0xb9,
+    0xcb, 0xd0, 0x83, 0xe8, 0xa2, 0x50, 0x3c, 0x4e
+  };
+  static const uint32_t nonce[3] = { 0x09000000, 0x4a000000, 0x00000000 };
+  unsigned char out[64];
+  uint32_t key[8];
+  unsigned int i;
+
+  /* The key is the bytes 00..1f. */
+  for (i = 0; i < 8; i++)
+    key[i] = (4 * i) | (4 * i + 1) << 8 | (4 * i + 2) << 16 |
+             (uint32_t) (4 * i + 3) << 24;
+
+  uv__chacha20_block(key, 1, nonce, out);
+  ASSERT(0 == memcmp(out, expected, sizeof(expected)));
+
+  return 0;
+#endif
+}
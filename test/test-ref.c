@@ -208,17 +208,16 @@ TEST_IMPL(fs_event_ref) {
 }
 
 
-// TODO(chengzhong.wcz): there is no sync or aio support for fs polling.
-// TEST_IMPL(fs_poll_ref) {
-//   uv_fs_poll_t h;
-//   uv_fs_poll_init(uv_default_loop(), &h);
-//   uv_fs_poll_start(&h, NULL, ".", 999);
-//   uv_unref((uv_handle_t*)&h);
-//   uv_run(uv_default_loop(), UV_RUN_DEFAULT);
-//   do_close(&h);
-//   MAKE_VALGRIND_HAPPY();
-//   return 0;
-// }
+TEST_IMPL(fs_poll_ref) {
+  uv_fs_poll_t h;
+  uv_fs_poll_init(uv_default_loop(), &h);
+  uv_fs_poll_start(&h, NULL, ".", 999);
+  uv_unref((uv_handle_t*)&h);
+  uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+  do_close(&h);
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
 
 
 TEST_IMPL(tcp_ref) {
@@ -0,0 +1,232 @@
+/* Copyright libuv contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#ifndef _WIN32
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#define NUM_TIMERS 10
+#define NUM_READY 10
+#define NUM_SLOW 50
+#define SLOW_CB_TIME 200  /* us */
+#define SLOW_BUDGET 1000u  /* us */
+
+static uv_loop_t loop;
+static uv_timer_t timers[NUM_SLOW];
+static int callbacks;
+#ifdef __linux__
+static uv_poll_t polls[NUM_READY];
+static int fds[NUM_READY][2];
+static int poll_cb_seen[NUM_READY];
+#endif
+
+
+static void close_cb(uv_handle_t* handle) {
+  callbacks++;
+}
+
+
+static void close_timer_cb(uv_timer_t* handle) {
+  callbacks++;
+  uv_close((uv_handle_t*) handle, close_cb);
+}
+
+
+TEST_IMPL(run_budget_callbacks) {
+  int before;
+  int calls;
+  int r;
+  int i;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_RUN_BUDGET, 0u, 3u));
+
+  for (i = 0; i < NUM_TIMERS; i++) {
+    ASSERT(0 == uv_timer_init(&loop, &timers[i]));
+    ASSERT(0 == uv_timer_start(&timers[i], close_timer_cb, 0, 0));
+  }
+
+  /* The timers are all due, each closes its handle. That's twenty
+   * callbacks, three per call and two on the last one.
+   */
+  calls = 0;
+  do {
+    before = callbacks;
+    r = uv_run(&loop, UV_RUN_BUDGET);
+    calls++;
+
+    if (r != 0) {
+      ASSERT_EQ(callbacks - before, 3);
+      ASSERT_EQ(uv_backend_timeout(&loop), 0);
+    }
+  } while (r != 0);
+
+  ASSERT_EQ(callbacks - before, 2);
+  ASSERT_EQ(callbacks, 2 * NUM_TIMERS);
+  ASSERT_EQ(calls, 7);
+
+  /* No budget, the same as UV_RUN_NOWAIT. */
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_RUN_BUDGET, 0u, 0u));
+  callbacks = 0;
+  for (i = 0; i < NUM_TIMERS; i++) {
+    ASSERT(0 == uv_timer_init(&loop, &timers[i]));
+    ASSERT(0 == uv_timer_start(&timers[i], close_timer_cb, 0, 0));
+  }
+
+  ASSERT(0 == uv_run(&loop, UV_RUN_BUDGET));
+  ASSERT_EQ(callbacks, 2 * NUM_TIMERS);
+
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+
+static void slow_timer_cb(uv_timer_t* handle) {
+  uint64_t start;
+
+  start = uv_hrtime();
+  while (uv_hrtime() - start < SLOW_CB_TIME * 1000)
+    ;
+
+  callbacks++;
+  uv_close((uv_handle_t*) handle, NULL);
+}
+
+
+TEST_IMPL(run_budget_time) {
+  int before;
+  int calls;
+  int i;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_RUN_BUDGET, SLOW_BUDGET, 0u));
+
+  for (i = 0; i < NUM_SLOW; i++) {
+    ASSERT(0 == uv_timer_init(&loop, &timers[i]));
+    ASSERT(0 == uv_timer_start(&timers[i], slow_timer_cb, 0, 0));
+  }
+
+  /* The budget is checked before each callback, a call goes over it by one
+   * callback at most. Being preempted only makes it run fewer.
+   */
+  callbacks = 0;
+  calls = 0;
+  while (callbacks < NUM_SLOW) {
+    before = callbacks;
+    uv_run(&loop, UV_RUN_BUDGET);
+    calls++;
+
+    ASSERT_GE(callbacks - before, 1);
+    ASSERT_LE(callbacks - before, SLOW_BUDGET / SLOW_CB_TIME + 1);
+  }
+
+  ASSERT_GE(calls, NUM_SLOW / (SLOW_BUDGET / SLOW_CB_TIME + 1));
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+
+#ifdef __linux__
+static void ready_cb(uv_poll_t* handle, int status, int events) {
+  ASSERT(status == 0);
+  ASSERT(events == UV_READABLE);
+  poll_cb_seen[handle - polls]++;
+  callbacks++;
+}
+
+
+TEST_IMPL(run_budget_io) {
+  int before;
+  int i;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_RUN_BUDGET, 0u, 4u));
+
+  for (i = 0; i < NUM_READY; i++) {
+    ASSERT(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds[i]));
+    ASSERT(1 == write(fds[i][1], "!", 1));
+    ASSERT(0 == uv_poll_init(&loop, &polls[i], fds[i][0]));
+    ASSERT(0 == uv_poll_start(&polls[i], UV_READABLE, ready_cb));
+  }
+
+  /* The descriptors stay readable. The ones that didn't get to run go
+   * first on the next call, all of them have run after three calls.
+   */
+  callbacks = 0;
+  for (i = 0; i < 3; i++) {
+    before = callbacks;
+    ASSERT(0 != uv_run(&loop, UV_RUN_BUDGET));
+    ASSERT_EQ(callbacks - before, 4);
+    ASSERT_EQ(uv_backend_timeout(&loop), 0);
+  }
+
+  for (i = 0; i < NUM_READY; i++)
+    ASSERT_GE(poll_cb_seen[i], 1);
+
+  /* A descriptor that's closed doesn't get the event that was left over. */
+  memset(poll_cb_seen, 0, sizeof(poll_cb_seen));
+  for (i = 0; i < NUM_READY; i++)
+    uv_close((uv_handle_t*) &polls[i], NULL);
+
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  for (i = 0; i < NUM_READY; i++) {
+    ASSERT_EQ(poll_cb_seen[i], 0);
+    ASSERT(0 == close(fds[i][0]));
+    ASSERT(0 == close(fds[i][1]));
+  }
+
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+#else
+TEST_IMPL(run_budget_io) {
+  RETURN_SKIP("I/O is cut short on Linux only.");
+}
+#endif  /* __linux__ */
+
+#else
+
+TEST_IMPL(run_budget_callbacks) {
+  uv_loop_t loop;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(UV_ENOSYS == uv_loop_configure(&loop, UV_LOOP_RUN_BUDGET, 0u, 3u));
+  ASSERT(0 == uv_run(&loop, UV_RUN_BUDGET));
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+TEST_IMPL(run_budget_time) {
+  RETURN_SKIP("UV_LOOP_RUN_BUDGET is Unix only.");
+}
+
+TEST_IMPL(run_budget_io) {
+  RETURN_SKIP("UV_LOOP_RUN_BUDGET is Unix only.");
+}
+
+#endif  /* _WIN32 */
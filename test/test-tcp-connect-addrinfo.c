@@ -0,0 +1,313 @@
+/* Copyright libuv contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#ifndef _WIN32
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+/* A listener whose accept queue is full. The kernel drops further SYNs, so
+ * connecting to it hangs like connecting to a blackholed address.
+ */
+struct blackhole {
+  struct sockaddr_storage addr;
+  int listen_fd;
+  int filler_fd;
+};
+
+static uv_loop_t* loop;
+static uv_tcp_t server;
+static uv_tcp_t client;
+static uv_tcp_t accepted;
+static uv_connect_t connect_req;
+static uv_timer_t timer;
+static struct sockaddr_storage server_addr;
+static int connect_status;
+static int connect_cb_called;
+static int connection_cb_called;
+static uint64_t connect_time;
+
+
+static int bound_socket(int family, struct sockaddr_storage* addr) {
+  socklen_t len;
+  int fd;
+
+  memset(addr, 0, sizeof(*addr));
+  if (family == AF_INET6) {
+    ASSERT(0 == uv_ip6_addr("::1", 0, (struct sockaddr_in6*) addr));
+    len = sizeof(struct sockaddr_in6);
+  } else {
+    ASSERT(0 == uv_ip4_addr("127.0.0.1", 0, (struct sockaddr_in*) addr));
+    len = sizeof(struct sockaddr_in);
+  }
+
+  fd = socket(family, SOCK_STREAM, 0);
+  ASSERT(fd != -1);
+  ASSERT(0 == bind(fd, (struct sockaddr*) addr, len));
+  ASSERT(0 == getsockname(fd, (struct sockaddr*) addr, &len));
+
+  return fd;
+}
+
+
+static void blackhole_init(struct blackhole* b, int family) {
+  socklen_t len;
+
+  b->listen_fd = bound_socket(family, &b->addr);
+  ASSERT(0 == listen(b->listen_fd, 0));
+
+  b->filler_fd = socket(family, SOCK_STREAM, 0);
+  ASSERT(b->filler_fd != -1);
+  len = family == AF_INET6 ? sizeof(struct sockaddr_in6) :
+                             sizeof(struct sockaddr_in);
+  ASSERT(0 == connect(b->filler_fd, (struct sockaddr*) &b->addr, len));
+}
+
+
+static void blackhole_close(struct blackhole* b) {
+  ASSERT(0 == close(b->filler_fd));
+  ASSERT(0 == close(b->listen_fd));
+}
+
+
+static void ai_init(struct addrinfo* ai,
+                    struct sockaddr_storage* addr,
+                    struct addrinfo* next) {
+  memset(ai, 0, sizeof(*ai));
+  ai->ai_family = addr->ss_family;
+  ai->ai_socktype = SOCK_STREAM;
+  ai->ai_addr = (struct sockaddr*) addr;
+  ai->ai_addrlen = addr->ss_family == AF_INET6 ? sizeof(struct sockaddr_in6) :
+                                                 sizeof(struct sockaddr_in);
+  ai->ai_next = next;
+}
+
+
+static void connection_cb(uv_stream_t* handle, int status) {
+  ASSERT(status == 0);
+  ASSERT(0 == uv_tcp_init(loop, &accepted));
+  ASSERT(0 == uv_accept(handle, (uv_stream_t*) &accepted));
+  uv_close((uv_handle_t*) &accepted, NULL);
+  connection_cb_called++;
+}
+
+
+static void start_server(void) {
+  int len;
+
+  ASSERT(0 == uv_ip4_addr("127.0.0.1", 0, (struct sockaddr_in*) &server_addr));
+  ASSERT(0 == uv_tcp_init(loop, &server));
+  ASSERT(0 == uv_tcp_bind(&server, (struct sockaddr*) &server_addr, 0));
+  ASSERT(0 == uv_listen((uv_stream_t*) &server, 1, connection_cb));
+
+  len = sizeof(server_addr);
+  ASSERT(0 == uv_tcp_getsockname(&server, (struct sockaddr*) &server_addr,
+                                 &len));
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  struct sockaddr_storage peer;
+  int len;
+
+  ASSERT(req == &connect_req);
+  connect_status = status;
+  connect_cb_called++;
+  connect_time = uv_hrtime();
+
+  if (status == 0) {
+    len = sizeof(peer);
+    ASSERT(0 == uv_tcp_getpeername(&client, (struct sockaddr*) &peer, &len));
+    ASSERT(0 == memcmp(&peer, &server_addr, sizeof(struct sockaddr_in)));
+  }
+
+  uv_close((uv_handle_t*) &client, NULL);
+  if (uv_is_active((uv_handle_t*) &server))
+    uv_close((uv_handle_t*) &server, NULL);
+}
+
+
+static uint64_t run_connect(struct addrinfo* ai) {
+  uint64_t start;
+
+  ASSERT(0 == uv_tcp_init(loop, &client));
+  start = uv_hrtime();
+  ASSERT(0 == uv_tcp_connect_addrinfo(&connect_req, &client, ai, connect_cb));
+  ASSERT(0 == connect_cb_called);
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(1 == connect_cb_called);
+
+  return (connect_time - start) / 1000000;
+}
+
+
+TEST_IMPL(tcp_connect_addrinfo_blackhole) {
+  struct blackhole b;
+  struct addrinfo ai[2];
+  uint64_t elapsed;
+
+  /* The first address doesn't answer, the second one is tried after the
+   * connection attempt delay and wins. With IPv6 the list also has to be
+   * tried across families.
+   */
+  loop = uv_default_loop();
+  blackhole_init(&b, can_ipv6() ? AF_INET6 : AF_INET);
+  start_server();
+  ai_init(&ai[1], &server_addr, NULL);
+  ai_init(&ai[0], &b.addr, &ai[1]);
+
+  elapsed = run_connect(ai);
+  ASSERT(0 == connect_status);
+  ASSERT(1 == connection_cb_called);
+  ASSERT_GE(elapsed, 200);
+  ASSERT_LT(elapsed, 2000);
+
+  blackhole_close(&b);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+TEST_IMPL(tcp_connect_addrinfo_refused) {
+  struct sockaddr_storage refused_addr;
+  struct addrinfo ai[2];
+  uint64_t elapsed;
+  int fd;
+
+  /* A refused attempt makes way for the next one without waiting. */
+  loop = uv_default_loop();
+  fd = bound_socket(AF_INET, &refused_addr);
+  start_server();
+  ai_init(&ai[1], &server_addr, NULL);
+  ai_init(&ai[0], &refused_addr, &ai[1]);
+
+  elapsed = run_connect(ai);
+  ASSERT(0 == connect_status);
+  ASSERT(1 == connection_cb_called);
+  ASSERT_LT(elapsed, 250);
+
+  ASSERT(0 == close(fd));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+TEST_IMPL(tcp_connect_addrinfo_fail) {
+  struct sockaddr_storage addrs[2];
+  struct addrinfo ai[4];
+  int fds[2];
+
+  /* Duplicates and datagram entries are skipped, the last error is
+   * reported once every address has failed.
+   */
+  loop = uv_default_loop();
+  fds[0] = bound_socket(AF_INET, &addrs[0]);
+  fds[1] = bound_socket(AF_INET, &addrs[1]);
+  ai_init(&ai[3], &addrs[1], NULL);
+  ai_init(&ai[2], &addrs[0], &ai[3]);
+  ai_init(&ai[1], &addrs[0], &ai[2]);
+  ai[1].ai_socktype = SOCK_DGRAM;
+  ai_init(&ai[0], &addrs[0], &ai[1]);
+
+  run_connect(ai);
+  ASSERT(UV_ECONNREFUSED == connect_status);
+
+  ASSERT(0 == close(fds[0]));
+  ASSERT(0 == close(fds[1]));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static void close_timer_cb(uv_timer_t* handle) {
+  uv_close((uv_handle_t*) &client, NULL);
+  uv_close((uv_handle_t*) handle, NULL);
+}
+
+
+static void cancel_cb(uv_connect_t* req, int status) {
+  ASSERT(req == &connect_req);
+  ASSERT(status == UV_ECANCELED);
+  connect_cb_called++;
+}
+
+
+TEST_IMPL(tcp_connect_addrinfo_close) {
+  struct blackhole b[2];
+  struct addrinfo ai[2];
+  uv_tcp_t other;
+
+  /* Closing the handle stops all attempts in progress. */
+  loop = uv_default_loop();
+  blackhole_init(&b[0], AF_INET);
+  blackhole_init(&b[1], AF_INET);
+  ai_init(&ai[1], &b[1].addr, NULL);
+  ai_init(&ai[0], &b[0].addr, &ai[1]);
+
+  ASSERT(0 == uv_tcp_init(loop, &client));
+  ASSERT(0 == uv_tcp_connect_addrinfo(&connect_req, &client, ai, cancel_cb));
+  ASSERT(UV_EALREADY ==
+         uv_tcp_connect_addrinfo(&connect_req, &client, ai, cancel_cb));
+
+  ASSERT(0 == uv_tcp_init(loop, &other));
+  ASSERT(UV_EINVAL ==
+         uv_tcp_connect_addrinfo(&connect_req, &other, NULL, cancel_cb));
+  uv_close((uv_handle_t*) &other, NULL);
+
+  ASSERT(0 == uv_timer_init(loop, &timer));
+  ASSERT(0 == uv_timer_start(&timer, close_timer_cb, 300, 0));
+
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(1 == connect_cb_called);
+
+  blackhole_close(&b[0]);
+  blackhole_close(&b[1]);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+#else
+
+TEST_IMPL(tcp_connect_addrinfo_blackhole) {
+  RETURN_SKIP("Not supported on Windows.");
+}
+
+TEST_IMPL(tcp_connect_addrinfo_refused) {
+  RETURN_SKIP("Not supported on Windows.");
+}
+
+TEST_IMPL(tcp_connect_addrinfo_fail) {
+  RETURN_SKIP("Not supported on Windows.");
+}
+
+TEST_IMPL(tcp_connect_addrinfo_close) {
+  RETURN_SKIP("Not supported on Windows.");
+}
+
+#endif  /* !_WIN32 */
@@ -48,9 +48,11 @@ static unsigned done2_cb_called;
 static unsigned timer_cb_called;
 static uv_work_t pause_reqs[4];
 static uv_sem_t pause_sems[ARRAY_SIZE(pause_reqs)];
+static uv_sem_t started_sem;
 
 
 static void work_cb(uv_work_t* req) {
+  uv_sem_post(&started_sem);
   uv_sem_wait(pause_sems + (req - pause_reqs));
 }
 
@@ -72,10 +74,18 @@ static void saturate_threadpool(void) {
   putenv(buf);
 
   loop = uv_default_loop();
+  ASSERT(0 == uv_sem_init(&started_sem, 0));
   for (i = 0; i < ARRAY_SIZE(pause_reqs); i += 1) {
     ASSERT(0 == uv_sem_init(pause_sems + i, 0));
     ASSERT(0 == uv_queue_work(loop, pause_reqs + i, work_cb, done_cb));
   }
+
+  /* Work isn't started in strict submission order, wait until every thread
+   * is stuck before queueing the work that is to be cancelled.
+   */
+  for (i = 0; i < ARRAY_SIZE(pause_reqs); i += 1)
+    uv_sem_wait(&started_sem);
+  uv_sem_destroy(&started_sem);
 }
 
 
@@ -279,15 +289,24 @@ TEST_IMPL(threadpool_cancel_work) {
 
 TEST_IMPL(threadpool_cancel_fs) {
   struct cancel_info ci;
+#if defined(__linux__)
+  /* Reads, writes and syncs go straight to kernel AIO and can't be
+   * cancelled.
+   */
+  uv_fs_t reqs[22];
+#else
   uv_fs_t reqs[26];
+  uv_buf_t iov;
+#endif
   uv_loop_t* loop;
   unsigned n;
-  uv_buf_t iov;
 
   INIT_CANCEL_INFO(&ci, reqs);
   loop = uv_default_loop();
   saturate_threadpool();
+#if !defined(__linux__)
   iov = uv_buf_init(NULL, 0);
+#endif
 
   /* Needs to match ARRAY_SIZE(fs_reqs). */
   n = 0;
@@ -296,16 +315,22 @@ TEST_IMPL(threadpool_cancel_fs) {
   ASSERT(0 == uv_fs_close(loop, reqs + n++, 0, fs_cb));
   ASSERT(0 == uv_fs_fchmod(loop, reqs + n++, 0, 0, fs_cb));
   ASSERT(0 == uv_fs_fchown(loop, reqs + n++, 0, 0, 0, fs_cb));
+#if !defined(__linux__)
   ASSERT(0 == uv_fs_fdatasync(loop, reqs + n++, 0, fs_cb));
+#endif
   ASSERT(0 == uv_fs_fstat(loop, reqs + n++, 0, fs_cb));
+#if !defined(__linux__)
   ASSERT(0 == uv_fs_fsync(loop, reqs + n++, 0, fs_cb));
+#endif
   ASSERT(0 == uv_fs_ftruncate(loop, reqs + n++, 0, 0, fs_cb));
   ASSERT(0 == uv_fs_futime(loop, reqs + n++, 0, 0, 0, fs_cb));
   ASSERT(0 == uv_fs_link(loop, reqs + n++, "/", "/", fs_cb));
   ASSERT(0 == uv_fs_lstat(loop, reqs + n++, "/", fs_cb));
   ASSERT(0 == uv_fs_mkdir(loop, reqs + n++, "/", 0, fs_cb));
   ASSERT(0 == uv_fs_open(loop, reqs + n++, "/", 0, 0, fs_cb));
+#if !defined(__linux__)
   ASSERT(0 == uv_fs_read(loop, reqs + n++, 0, &iov, 1, 0, fs_cb));
+#endif
   ASSERT(0 == uv_fs_scandir(loop, reqs + n++, "/", 0, fs_cb));
   ASSERT(0 == uv_fs_readlink(loop, reqs + n++, "/", fs_cb));
   ASSERT(0 == uv_fs_realpath(loop, reqs + n++, "/", fs_cb));
@@ -316,7 +341,9 @@ TEST_IMPL(threadpool_cancel_fs) {
   ASSERT(0 == uv_fs_symlink(loop, reqs + n++, "/", "/", 0, fs_cb));
   ASSERT(0 == uv_fs_unlink(loop, reqs + n++, "/", fs_cb));
   ASSERT(0 == uv_fs_utime(loop, reqs + n++, "/", 0, 0, fs_cb));
+#if !defined(__linux__)
   ASSERT(0 == uv_fs_write(loop, reqs + n++, 0, &iov, 1, 0, fs_cb));
+#endif
   ASSERT(n == ARRAY_SIZE(reqs));
 
   ASSERT(0 == uv_timer_init(loop, &ci.timer_handle));
@@ -74,3 +74,393 @@ TEST_IMPL(threadpool_queue_work_einval) {
   MAKE_VALGRIND_HAPPY();
   return 0;
 }
+
+
+static int private_after_work_cb_count;
+
+
+static void private_work_cb(uv_work_t* req) {
+  uv_sleep(1);
+}
+
+
+static void private_after_work_cb(uv_work_t* req, int status) {
+  ASSERT(status == 0);
+  private_after_work_cb_count++;
+}
+
+
+TEST_IMPL(threadpool_loop_private) {
+  uv_work_t reqs[32];
+  uv_loop_t loop;
+  unsigned int i;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(UV_EINVAL == uv_loop_configure(&loop, UV_LOOP_THREADPOOL_SIZE, 0));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_THREADPOOL_SIZE, 3));
+  ASSERT(UV_EBUSY == uv_loop_configure(&loop, UV_LOOP_THREADPOOL_SIZE, 3));
+
+  for (i = 0; i < ARRAY_SIZE(reqs); i++)
+    ASSERT(0 == uv_queue_work(&loop,
+                              reqs + i,
+                              private_work_cb,
+                              private_after_work_cb));
+
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(private_after_work_cb_count == ARRAY_SIZE(reqs));
+
+  /* Closing the loop joins its threads. */
+  ASSERT(0 == uv_loop_close(&loop));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static void limits_work_cb(uv_work_t* req) {
+  uv_sleep(10);
+}
+
+
+TEST_IMPL(threadpool_limits) {
+  uv_threadpool_metrics_t metrics;
+  uv_work_t reqs[16];
+  uv_loop_t loop;
+  unsigned int i;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_THREADPOOL_SIZE, 4));
+
+  /* Nothing has been submitted, nothing has been started. */
+  ASSERT(0 == uv_threadpool_metrics(&loop, &metrics));
+  ASSERT(metrics.threads == 0);
+  ASSERT(metrics.max_threads == 4);
+  ASSERT(metrics.threads_spawned == 0);
+  ASSERT(UV_EINVAL == uv_threadpool_metrics(&loop, NULL));
+
+  ASSERT(UV_EINVAL == uv_threadpool_set_limits(&loop, 0, 0, 0));
+  ASSERT(UV_EINVAL == uv_threadpool_set_limits(&loop, 3, 2, 0));
+  ASSERT(UV_EINVAL == uv_threadpool_set_limits(&loop, 0, 1025, 0));
+
+  /* The minimum is started right away. */
+  ASSERT(0 == uv_threadpool_set_limits(&loop, 2, 4, 50));
+  ASSERT(0 == uv_threadpool_metrics(&loop, &metrics));
+  ASSERT(metrics.threads == 2);
+  ASSERT(metrics.min_threads == 2);
+  ASSERT(metrics.idle_timeout == 50);
+  ASSERT(metrics.threads_spawned == 2);
+
+  private_after_work_cb_count = 0;
+  for (i = 0; i < ARRAY_SIZE(reqs); i++)
+    ASSERT(0 == uv_queue_work(&loop,
+                              reqs + i,
+                              limits_work_cb,
+                              private_after_work_cb));
+
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(private_after_work_cb_count == ARRAY_SIZE(reqs));
+
+  ASSERT(0 == uv_threadpool_metrics(&loop, &metrics));
+  ASSERT(metrics.threads <= 4);
+  ASSERT(metrics.threads_spawned > 2);
+
+  /* Threads over the minimum go away once they've been idle long enough. */
+  for (i = 0; i < 100; i++) {
+    ASSERT(0 == uv_threadpool_metrics(&loop, &metrics));
+    if (metrics.threads == 2)
+      break;
+    uv_sleep(20);
+  }
+
+  ASSERT(metrics.threads == 2);
+  ASSERT(metrics.threads_retired > 0);
+  ASSERT(metrics.threads_spawned - metrics.threads_retired == 2);
+
+  ASSERT(0 == uv_loop_close(&loop));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static void metrics_after_work_cb(uv_work_t* req, int status) {
+  ASSERT(status == 0);
+  private_after_work_cb_count++;
+}
+
+
+static void metrics_stat_cb(uv_fs_t* req) {
+  ASSERT(req->result == 0);
+  uv_fs_req_cleanup(req);
+}
+
+
+static uint64_t histogram_sum(const uint64_t* histogram) {
+  uint64_t sum;
+  unsigned int i;
+
+  sum = 0;
+  for (i = 0; i < UV_THREADPOOL_HISTOGRAM_SIZE; i++)
+    sum += histogram[i];
+
+  return sum;
+}
+
+
+TEST_IMPL(threadpool_work_metrics) {
+  uv_threadpool_work_metrics_t metrics;
+  uv_work_t reqs[16];
+  uv_fs_t stat_req;
+  uv_loop_t loop;
+  unsigned int i;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_THREADPOOL_SIZE, 2));
+
+  ASSERT(UV_EINVAL == uv_threadpool_work_metrics(&loop, UV_WORK_CPU, NULL));
+  ASSERT(UV_EINVAL == uv_threadpool_work_metrics(&loop,
+                                                 (uv_work_kind) 42,
+                                                 &metrics));
+
+  /* Work submitted before metrics are enabled isn't counted. */
+  private_after_work_cb_count = 0;
+  ASSERT(0 == uv_queue_work(&loop,
+                            reqs,
+                            private_work_cb,
+                            metrics_after_work_cb));
+  ASSERT(0 == uv_loop_configure(&loop, UV_METRICS_THREADPOOL));
+
+  for (i = 1; i < ARRAY_SIZE(reqs); i++)
+    ASSERT(0 == uv_queue_work(&loop,
+                              reqs + i,
+                              private_work_cb,
+                              metrics_after_work_cb));
+  ASSERT(0 == uv_fs_stat(&loop, &stat_req, ".", metrics_stat_cb));
+
+  ASSERT(0 == uv_threadpool_work_metrics(&loop, UV_WORK_CPU, &metrics));
+  ASSERT(metrics.queued + metrics.completed <= ARRAY_SIZE(reqs) - 1);
+
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(private_after_work_cb_count == ARRAY_SIZE(reqs));
+
+  ASSERT(0 == uv_threadpool_work_metrics(&loop, UV_WORK_CPU, &metrics));
+  ASSERT(metrics.queued == 0);
+  ASSERT(metrics.completed == ARRAY_SIZE(reqs) - 1);
+  ASSERT(metrics.run_time >= (ARRAY_SIZE(reqs) - 1) * 1000000);
+  ASSERT(metrics.wait_time > 0);
+  ASSERT(histogram_sum(metrics.wait_histogram) == metrics.completed);
+  ASSERT(histogram_sum(metrics.run_histogram) == metrics.completed);
+  ASSERT(histogram_sum(metrics.queue_histogram) == metrics.completed);
+  /* Every item slept for at least 1 ms, i.e. 1000 us or more. */
+  for (i = 0; i < 10; i++)
+    ASSERT(metrics.run_histogram[i] == 0);
+
+  ASSERT(0 == uv_threadpool_work_metrics(&loop, UV_WORK_FAST_IO, &metrics));
+  ASSERT(metrics.completed == 1);
+  ASSERT(metrics.queued == 0);
+
+  ASSERT(0 == uv_threadpool_work_metrics(&loop, UV_WORK_SLOW_IO, &metrics));
+  ASSERT(metrics.completed == 0);
+
+  ASSERT(0 == uv_loop_close(&loop));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static uv_sem_t priority_started;
+static uv_sem_t priority_blocked;
+static uv_work_t priority_reqs[25];
+static unsigned int priority_order[ARRAY_SIZE(priority_reqs)];
+static unsigned int priority_count;
+
+
+static void priority_work_cb(uv_work_t* req) {
+  if (req == priority_reqs) {
+    uv_sem_post(&priority_started);
+    uv_sem_wait(&priority_blocked);
+  }
+
+  priority_order[priority_count++] = req - priority_reqs;
+}
+
+
+static void priority_after_work_cb(uv_work_t* req, int status) {
+  ASSERT(status == 0);
+}
+
+
+static void queue_priority(unsigned int i,
+                           uv_work_priority priority,
+                           uint64_t deadline) {
+  ASSERT(0 == uv_queue_work_priority(priority_reqs[0].loop,
+                                     priority_reqs + i,
+                                     priority,
+                                     deadline,
+                                     priority_work_cb,
+                                     priority_after_work_cb));
+}
+
+
+TEST_IMPL(threadpool_priority) {
+  uv_threadpool_work_metrics_t metrics;
+  uv_loop_t loop;
+  unsigned int i;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_THREADPOOL_SIZE, 1));
+  ASSERT(0 == uv_loop_configure(&loop, UV_METRICS_THREADPOOL));
+  ASSERT(0 == uv_sem_init(&priority_started, 0));
+  ASSERT(0 == uv_sem_init(&priority_blocked, 0));
+
+  ASSERT(UV_EINVAL == uv_queue_work_priority(&loop,
+                                             priority_reqs,
+                                             (uv_work_priority) 42,
+                                             0,
+                                             priority_work_cb,
+                                             NULL));
+
+  /* Keep the only thread busy while everything else is queued. */
+  ASSERT(0 == uv_queue_work(&loop,
+                            priority_reqs,
+                            priority_work_cb,
+                            priority_after_work_cb));
+  uv_sem_wait(&priority_started);
+
+  queue_priority(1, UV_WORK_PRIORITY_LOW, 0);
+  ASSERT(0 == uv_queue_work(&loop,
+                            priority_reqs + 2,
+                            priority_work_cb,
+                            priority_after_work_cb));
+  ASSERT(0 == uv_queue_work(&loop,
+                            priority_reqs + 3,
+                            priority_work_cb,
+                            priority_after_work_cb));
+  for (i = 4; i < 24; i++)
+    queue_priority(i, UV_WORK_PRIORITY_HIGH, 0);
+  queue_priority(24, UV_WORK_PRIORITY_LOW, 1);
+
+  /* Let the deadline of the last one pass. */
+  uv_sleep(10);
+  uv_sem_post(&priority_blocked);
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(priority_count == ARRAY_SIZE(priority_reqs));
+
+  /* Overdue work goes first, normal work gets a turn after a burst of high
+   * priority work, low priority work comes last.
+   */
+  ASSERT(priority_order[0] == 0);
+  ASSERT(priority_order[1] == 24);
+  for (i = 0; i < 16; i++)
+    ASSERT(priority_order[2 + i] == 4 + i);
+  ASSERT(priority_order[18] == 2);
+  for (i = 0; i < 4; i++)
+    ASSERT(priority_order[19 + i] == 20 + i);
+  ASSERT(priority_order[23] == 3);
+  ASSERT(priority_order[24] == 1);
+
+  ASSERT(0 == uv_threadpool_priority_metrics(&loop,
+                                             UV_WORK_PRIORITY_HIGH,
+                                             &metrics));
+  ASSERT(metrics.completed == 20);
+  ASSERT(metrics.late == 0);
+  ASSERT(0 == uv_threadpool_priority_metrics(&loop,
+                                             UV_WORK_PRIORITY_NORMAL,
+                                             &metrics));
+  ASSERT(metrics.completed == 3);
+  ASSERT(0 == uv_threadpool_priority_metrics(&loop,
+                                             UV_WORK_PRIORITY_LOW,
+                                             &metrics));
+  ASSERT(metrics.completed == 2);
+  ASSERT(metrics.late == 1);
+  ASSERT(metrics.queued == 0);
+
+  uv_sem_destroy(&priority_started);
+  uv_sem_destroy(&priority_blocked);
+  ASSERT(0 == uv_loop_close(&loop));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static uv_getaddrinfo_t slow_reqs[3];
+static int deadline_started;
+static int slow_cb_called;
+
+
+static void deadline_work_cb(uv_work_t* req) {
+  deadline_started = 1;
+  priority_work_cb(req);
+}
+
+
+static void slow_getaddrinfo_cb(uv_getaddrinfo_t* req,
+                                int status,
+                                struct addrinfo* res) {
+  /* The deadline was queued last but must not wait for slow I/O. */
+  ASSERT(deadline_started == 1);
+  uv_freeaddrinfo(res);
+  slow_cb_called++;
+}
+
+
+TEST_IMPL(threadpool_priority_deadline_normal) {
+  uv_loop_t loop;
+  unsigned int i;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_THREADPOOL_SIZE, 1));
+  ASSERT(0 == uv_sem_init(&priority_started, 0));
+  ASSERT(0 == uv_sem_init(&priority_blocked, 0));
+
+  /* Keep the only thread busy while everything else is queued. */
+  ASSERT(0 == uv_queue_work(&loop,
+                            priority_reqs,
+                            priority_work_cb,
+                            priority_after_work_cb));
+  uv_sem_wait(&priority_started);
+
+  for (i = 1; i < 3; i++)
+    ASSERT(0 == uv_queue_work(&loop,
+                              priority_reqs + i,
+                              priority_work_cb,
+                              priority_after_work_cb));
+
+  /* A named service keeps the lookups off the loop's own resolver, they go
+   * to the threadpool as slow I/O.
+   */
+  for (i = 0; i < ARRAY_SIZE(slow_reqs); i++)
+    ASSERT(0 == uv_getaddrinfo(&loop,
+                               slow_reqs + i,
+                               slow_getaddrinfo_cb,
+                               "localhost",
+                               "http",
+                               NULL));
+
+  ASSERT(0 == uv_queue_work_priority(&loop,
+                                     priority_reqs + 3,
+                                     UV_WORK_PRIORITY_NORMAL,
+                                     60000,
+                                     deadline_work_cb,
+                                     priority_after_work_cb));
+
+  uv_sem_post(&priority_blocked);
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(slow_cb_called == ARRAY_SIZE(slow_reqs));
+  ASSERT(priority_count == 4);
+
+  /* Normal work with a deadline goes ahead of plain normal work. */
+  ASSERT(priority_order[0] == 0);
+  ASSERT(priority_order[1] == 3);
+  ASSERT(priority_order[2] == 1);
+  ASSERT(priority_order[3] == 2);
+
+  uv_sem_destroy(&priority_started);
+  uv_sem_destroy(&priority_blocked);
+  ASSERT(0 == uv_loop_close(&loop));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
@@ -0,0 +1,260 @@
+/* Copyright libuv contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <string.h>
+
+#ifndef _WIN32
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#define NUM_RECORDS 256
+#define NUM_TIMERS 10
+#define TRACE_FILE "test_dir_trace"
+
+static uv_loop_t loop;
+static uv_timer_t timers[NUM_TIMERS];
+static uv_trace_record_t records[NUM_RECORDS];
+#ifdef __linux__
+static uv_pipe_t reader;
+static uv_pipe_t writer;
+static uv_write_t write_req;
+static char buffer[16];
+static int read_cb_called;
+#endif
+
+
+TEST_IMPL(trace_configure) {
+  unsigned int count;
+  int r;
+
+  ASSERT(0 == uv_loop_init(&loop));
+
+  count = NUM_RECORDS;
+  ASSERT(UV_ENOSYS == uv_loop_trace_records(&loop, records, &count));
+
+  r = uv_loop_configure(&loop, UV_LOOP_TRACE, 16u);
+  if (r == UV_ENOSYS) {
+    ASSERT(0 == uv_loop_close(&loop));
+    RETURN_SKIP("Built without the loop trace.");
+  }
+
+  ASSERT(r == 0);
+  ASSERT(UV_EINVAL == uv_loop_configure(&loop, UV_LOOP_TRACE, 24u));
+  ASSERT(UV_EINVAL == uv_loop_trace_records(&loop, NULL, &count));
+  ASSERT(0 == uv_loop_trace_records(&loop, records, &count));
+  ASSERT_EQ(count, 0);
+
+  /* 0 turns it off. */
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_TRACE, 0u));
+  ASSERT(UV_ENOSYS == uv_loop_trace_records(&loop, records, &count));
+
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+
+static void timer_cb(uv_timer_t* handle) {
+  uv_close((uv_handle_t*) handle, NULL);
+}
+
+
+#ifdef __linux__
+static void alloc_cb(uv_handle_t* handle, size_t size, uv_buf_t* buf) {
+  *buf = uv_buf_init(buffer, sizeof(buffer));
+}
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf) {
+  ASSERT_EQ(nread, 1);
+  read_cb_called++;
+  uv_close((uv_handle_t*) &reader, NULL);
+  uv_close((uv_handle_t*) &writer, NULL);
+}
+
+
+static void write_cb(uv_write_t* req, int status) {
+  ASSERT_EQ(status, 0);
+}
+
+
+static int has_event(unsigned int count, uv_trace_event event, int type) {
+  unsigned int i;
+
+  for (i = 0; i < count; i++)
+    if (records[i].event == event && records[i].type == type)
+      return 1;
+
+  return 0;
+}
+
+
+TEST_IMPL(trace_events) {
+  uv_trace_record_t* dumped;
+  uv_fs_t req;
+  uv_buf_t buf;
+  unsigned int count;
+  unsigned int i;
+  uv_file file;
+  char header[24];
+  int fds[2];
+  int r;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  r = uv_loop_configure(&loop, UV_LOOP_TRACE, (unsigned int) NUM_RECORDS);
+  if (r == UV_ENOSYS) {
+    ASSERT(0 == uv_loop_close(&loop));
+    RETURN_SKIP("Built without the loop trace.");
+  }
+
+  ASSERT(r == 0);
+  ASSERT(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  ASSERT(0 == uv_pipe_init(&loop, &reader, 0));
+  ASSERT(0 == uv_pipe_init(&loop, &writer, 0));
+  ASSERT(0 == uv_pipe_open(&reader, fds[0]));
+  ASSERT(0 == uv_pipe_open(&writer, fds[1]));
+  ASSERT(0 == uv_read_start((uv_stream_t*) &reader, alloc_cb, read_cb));
+
+  buf = uv_buf_init("!", 1);
+  ASSERT(0 == uv_write(&write_req, (uv_stream_t*) &writer, &buf, 1, write_cb));
+
+  ASSERT(0 == uv_timer_init(&loop, &timers[0]));
+  ASSERT(0 == uv_timer_start(&timers[0], timer_cb, 0, 0));
+
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT_EQ(read_cb_called, 1);
+
+  count = NUM_RECORDS;
+  ASSERT(0 == uv_loop_trace_records(&loop, records, &count));
+  ASSERT_GT(count, 0);
+  ASSERT_LT(count, NUM_RECORDS);
+
+  ASSERT(has_event(count, UV_TRACE_POLL_ENTER, UV_UNKNOWN_HANDLE));
+  ASSERT(has_event(count, UV_TRACE_POLL_EXIT, UV_UNKNOWN_HANDLE));
+  ASSERT(has_event(count, UV_TRACE_IO, UV_UNKNOWN_HANDLE));
+  ASSERT(has_event(count, UV_TRACE_TIMER, UV_TIMER));
+  ASSERT(has_event(count, UV_TRACE_WRITE, UV_NAMED_PIPE));
+  ASSERT(has_event(count, UV_TRACE_CLOSE, UV_NAMED_PIPE));
+  ASSERT(has_event(count, UV_TRACE_CLOSE, UV_TIMER));
+
+  for (i = 1; i < count; i++)
+    ASSERT_GE(records[i].time, records[i - 1].time);
+
+  /* The same records, after a header. */
+  unlink(TRACE_FILE);
+  file = uv_fs_open(NULL, &req, TRACE_FILE, O_RDWR | O_CREAT, 0644, NULL);
+  ASSERT_GE(file, 0);
+  uv_fs_req_cleanup(&req);
+  ASSERT(0 == uv_loop_trace_dump(&loop, file));
+
+  dumped = malloc(count * sizeof(*dumped));
+  ASSERT_NOT_NULL(dumped);
+  buf = uv_buf_init(header, sizeof(header));
+  ASSERT_EQ(sizeof(header), uv_fs_read(NULL, &req, file, &buf, 1, 0, NULL));
+  uv_fs_req_cleanup(&req);
+  ASSERT(0 == memcmp(header, "UVTRACE", 8));
+
+  buf = uv_buf_init((char*) dumped, count * sizeof(*dumped));
+  ASSERT_EQ(count * sizeof(*dumped),
+            uv_fs_read(NULL, &req, file, &buf, 1, sizeof(header), NULL));
+  uv_fs_req_cleanup(&req);
+  ASSERT(0 == memcmp(dumped, records, count * sizeof(*dumped)));
+
+  free(dumped);
+  ASSERT(0 == uv_fs_close(NULL, &req, file, NULL));
+  uv_fs_req_cleanup(&req);
+  unlink(TRACE_FILE);
+
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+#else
+TEST_IMPL(trace_events) {
+  RETURN_SKIP("Polls and I/O are traced on Linux only.");
+}
+#endif  /* __linux__ */
+
+
+TEST_IMPL(trace_wrap) {
+  unsigned int count;
+  unsigned int i;
+  int r;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  r = uv_loop_configure(&loop, UV_LOOP_TRACE, 4u);
+  if (r == UV_ENOSYS) {
+    ASSERT(0 == uv_loop_close(&loop));
+    RETURN_SKIP("Built without the loop trace.");
+  }
+
+  ASSERT(r == 0);
+  for (i = 0; i < NUM_TIMERS; i++) {
+    ASSERT(0 == uv_timer_init(&loop, &timers[i]));
+    ASSERT(0 == uv_timer_start(&timers[i], timer_cb, 0, 0));
+  }
+
+  /* Ten timers fire, ten handles close. Only the last four are kept, the
+   * close callbacks run the handle that was closed last first.
+   */
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+
+  count = NUM_RECORDS;
+  ASSERT(0 == uv_loop_trace_records(&loop, records, &count));
+  ASSERT_EQ(count, 4);
+  for (i = 0; i < count; i++) {
+    ASSERT_EQ(records[i].event, UV_TRACE_CLOSE);
+    ASSERT_EQ(records[i].arg, (uintptr_t) &timers[3 - i]);
+  }
+
+  /* The most recent ones if they don't all fit. */
+  count = 2;
+  ASSERT(0 == uv_loop_trace_records(&loop, records, &count));
+  ASSERT_EQ(count, 2);
+  ASSERT_EQ(records[1].arg, (uintptr_t) &timers[0]);
+
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+#else
+
+TEST_IMPL(trace_configure) {
+  uv_loop_t loop;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(UV_ENOSYS == uv_loop_configure(&loop, UV_LOOP_TRACE, 16u));
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+TEST_IMPL(trace_events) {
+  RETURN_SKIP("The loop trace is Unix only.");
+}
+
+TEST_IMPL(trace_wrap) {
+  RETURN_SKIP("The loop trace is Unix only.");
+}
+
+#endif  /* _WIN32 */
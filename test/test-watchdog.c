@@ -0,0 +1,135 @@
+/* Copyright libuv contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#ifndef _WIN32
+
+#define THRESHOLD 50  /* ms */
+#define STALL_TIME 300  /* ms */
+#define IDLE_TIME 200  /* ms */
+
+static uv_loop_t loop;
+static uv_timer_t timer;
+static uv_stall_t seen;
+static int stall_cb_called;
+static int timer_cb_called;
+
+
+static void stall_cb(uv_loop_t* handle, const uv_stall_t* stall) {
+  ASSERT_PTR_EQ(handle, &loop);
+  seen = *stall;
+  stall_cb_called++;
+}
+
+
+static void timer_cb(uv_timer_t* handle) {
+  uint64_t start;
+
+  start = uv_hrtime();
+  while (uv_hrtime() - start < STALL_TIME * (uint64_t) 1e6)
+    ;
+
+  timer_cb_called++;
+}
+
+
+TEST_IMPL(watchdog_stall) {
+  uv_stall_t stalls[UV_WATCHDOG_STALLS];
+  unsigned int count;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_watchdog_start(&loop, THRESHOLD, stall_cb));
+
+  /* Blocked in the poll phase for a while, that's not a stall. Then the
+   * timer's callback takes six times the threshold, that's one.
+   */
+  ASSERT(0 == uv_timer_init(&loop, &timer));
+  ASSERT(0 == uv_timer_start(&timer, timer_cb, IDLE_TIME, 0));
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT_EQ(timer_cb_called, 1);
+
+  /* Waits for the stall callback, it runs on the watchdog thread. */
+  ASSERT(0 == uv_loop_watchdog_stop(&loop));
+  ASSERT(0 == uv_loop_watchdog_stop(&loop));
+  ASSERT_EQ(stall_cb_called, 1);
+  ASSERT_EQ(seen.type, UV_TIMER);
+  ASSERT_PTR_EQ(seen.handle, &timer);
+  ASSERT(seen.callback == (void (*)(void)) timer_cb);
+  ASSERT_EQ(seen.fd, -1);
+  ASSERT_GE(seen.elapsed, THRESHOLD * (uint64_t) 1e6);
+  ASSERT_LE(seen.elapsed, STALL_TIME * (uint64_t) 1e6);
+
+  /* Kept after the watchdog stops. */
+  count = ARRAY_SIZE(stalls);
+  ASSERT(0 == uv_loop_watchdog_stalls(&loop, stalls, &count));
+  ASSERT_EQ(count, 1);
+  ASSERT_EQ(stalls[0].type, UV_TIMER);
+  ASSERT_EQ(stalls[0].time, seen.time);
+
+  uv_close((uv_handle_t*) &timer, NULL);
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+
+TEST_IMPL(watchdog_start_stop) {
+  uv_stall_t stalls[1];
+  unsigned int count;
+
+  ASSERT(0 == uv_loop_init(&loop));
+
+  count = ARRAY_SIZE(stalls);
+  ASSERT(0 == uv_loop_watchdog_stalls(&loop, stalls, &count));
+  ASSERT_EQ(count, 0);
+  ASSERT(UV_EINVAL == uv_loop_watchdog_stalls(&loop, NULL, &count));
+
+  ASSERT(UV_EINVAL == uv_loop_watchdog_start(&loop, 0, stall_cb));
+  ASSERT(0 == uv_loop_watchdog_start(&loop, THRESHOLD, NULL));
+  ASSERT(UV_EBUSY == uv_loop_watchdog_start(&loop, THRESHOLD, stall_cb));
+  ASSERT(0 == uv_loop_watchdog_stop(&loop));
+  ASSERT(0 == uv_loop_watchdog_start(&loop, THRESHOLD, stall_cb));
+
+  /* uv_loop_close() stops it. */
+  ASSERT(0 == uv_loop_close(&loop));
+  ASSERT_EQ(stall_cb_called, 0);
+  return 0;
+}
+
+#else
+
+TEST_IMPL(watchdog_stall) {
+  RETURN_SKIP("The watchdog is Unix only.");
+}
+
+TEST_IMPL(watchdog_start_stop) {
+  uv_loop_t loop;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(UV_ENOSYS == uv_loop_watchdog_start(&loop, 50, NULL));
+  ASSERT(0 == uv_loop_watchdog_stop(&loop));
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+#endif  /* _WIN32 */
@@ -0,0 +1,126 @@
+#!/usr/bin/python
+
+# Converts a loop trace written by uv_loop_trace_dump() to the trace event
+# JSON that chrome://tracing and Perfetto load.
+#
+#   trace_to_chrome.py trace.bin > trace.json
+
+from __future__ import print_function
+
+import json
+import struct
+import sys
+
+HEADER = '8sIIQ'
+RECORD = 'QHHiQ'
+
+# uv_trace_event.
+POLL_ENTER = 1
+POLL_EXIT = 2
+IO = 3
+TIMER = 4
+AIO_SUBMIT = 5
+AIO_COMPLETE = 6
+WRITE = 7
+CLOSE = 8
+
+EVENTS = {
+  POLL_ENTER: 'poll',
+  POLL_EXIT: 'poll',
+  IO: 'io',
+  TIMER: 'timer',
+  AIO_SUBMIT: 'aio submit',
+  AIO_COMPLETE: 'aio complete',
+  WRITE: 'write',
+  CLOSE: 'close',
+}
+
+# uv_handle_type, in the order of its values. UV_FILE_WRITER comes after
+# UV_FILE.
+HANDLES = [
+  'unknown', 'async', 'check', 'fs_event', 'fs_poll', 'handle', 'idle',
+  'pipe', 'poll', 'prepare', 'process', 'stream', 'tcp', 'timer', 'tty',
+  'udp', 'signal', 'file', 'file_writer',
+]
+
+
+def signed(arg):
+  return arg - (1 << 64) if arg >= 1 << 63 else arg
+
+
+def read_trace(f):
+  data = f.read()
+
+  # The file is in the byte order of the host that wrote it.
+  for order in '<>':
+    magic, version, size, count = struct.unpack_from(order + HEADER, data)
+    if version == 1:
+      break
+  else:
+    raise ValueError('not a libuv trace')
+
+  if magic.rstrip(b'\0') != b'UVTRACE':
+    raise ValueError('not a libuv trace')
+
+  offset = struct.calcsize(HEADER)
+  for i in range(count):
+    yield struct.unpack_from(order + RECORD, data, offset + i * size)
+
+
+def to_chrome(records):
+  events = []
+  start = None
+
+  for time, event, handle, fd, arg in records:
+    if start is None:
+      start = time
+
+    e = {
+      'name': EVENTS.get(event, 'event %d' % event),
+      'ts': (time - start) / 1000.0,
+      'pid': 1,
+      'tid': 1,
+      'args': {},
+    }
+
+    if fd != -1:
+      e['args']['fd'] = fd
+
+    if 0 <= handle < len(HANDLES) and handle != 0:
+      e['args']['handle'] = HANDLES[handle]
+
+    if event == POLL_ENTER:
+      e['ph'] = 'B'
+      e['args']['timeout'] = signed(arg)
+    elif event == POLL_EXIT:
+      e['ph'] = 'E'
+      e['args']['events'] = arg
+    else:
+      e['ph'] = 'i'
+      e['s'] = 't'
+      if event == IO:
+        e['args']['events'] = arg
+      elif event == AIO_SUBMIT:
+        e['args']['iocbs'] = arg
+      elif event in (AIO_COMPLETE, WRITE):
+        e['args']['result'] = signed(arg)
+      else:
+        e['args']['ptr'] = '0x%x' % arg
+
+    events.append(e)
+
+  # The ring may start in the middle of a poll.
+  if events and events[0]['ph'] == 'E':
+    events.pop(0)
+
+  return {'traceEvents': events, 'displayTimeUnit': 'ns'}
+
+
+if __name__ == '__main__':
+  if len(sys.argv) != 2:
+    print('usage: %s <trace file>' % sys.argv[0], file=sys.stderr)
+    sys.exit(1)
+
+  with open(sys.argv[1], 'rb') as f:
+    json.dump(to_chrome(read_trace(f)), sys.stdout, indent=1)
+  print()
@@ -69,6 +69,7 @@
         'include/uv/threadpool.h',
         'include/uv/version.h',
         'src/fs-poll.c',
+        'src/fs-writer.c',
         'src/heap-inl.h',
         'src/idna.c',
         'src/idna.h',
@@ -159,6 +160,8 @@
             'src/unix/atomic-ops.h',
             'src/unix/core.c',
             'src/unix/dl.c',
+            'src/unix/dns-cache.c',
+            'src/unix/dns.c',
             'src/unix/fs.c',
             'src/unix/getaddrinfo.c',
             'src/unix/getnameinfo.c',
@@ -168,6 +171,7 @@
             'src/unix/pipe.c',
             'src/unix/poll.c',
             'src/unix/process.c',
+            'src/unix/random-chacha20.c',
             'src/unix/random-devurandom.c',
             'src/unix/signal.c',
             'src/unix/spinlock.h',